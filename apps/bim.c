@@ -15,6 +15,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include "bim.h"
+#include <toaru/termbuf.h>
 #include <kuroko/kuroko.h>
 #include <kuroko/vm.h>
 #include <kuroko/debug.h>
@@ -241,8 +242,9 @@ void bim_unget(int c) {
 }
 
 void redraw_statusbar(void);
+void screen_flush(void);
 int bim_getch_timeout(int timeout) {
-	fflush(stdout);
+	screen_flush();
 	if (_bim_unget != -1) {
 		int out = _bim_unget;
 		_bim_unget = -1;
@@ -1722,6 +1724,13 @@ void setup_buffer(buffer_t * env) {
 	env->lines[0]->available = 32;
 }
 
+/**
+ * Once the editor owns the terminal, everything it draws goes through
+ * a shadow screen, and only the cells that changed are sent when we
+ * are about to wait for input.
+ */
+static termbuf_t * term_out = NULL;
+
 /**
  * Toggle buffered / unbuffered modes
  */
@@ -1738,9 +1747,12 @@ void set_unbuffered(void) {
 	new.c_cc[VLNEXT] = 0;
 #endif
 	tcsetattr(STDOUT_FILENO, TCSAFLUSH, &new);
+	if (term_out) termbuf_resume(term_out);
 }
 
 void set_buffered(void) {
+	/* Someone else gets the terminal; our idea of what it shows won't last */
+	if (term_out) termbuf_suspend(term_out);
 	tcsetattr(STDOUT_FILENO, TCSAFLUSH, &old);
 }
 
@@ -1825,11 +1837,34 @@ int codepoint_width(wchar_t codepoint) {
  * some assumptions about the target terminal.
  */
 
+void screen_vprintf(const char * fmt, va_list args) {
+	if (term_out) {
+		termbuf_vprintf(term_out, fmt, args);
+	} else {
+		vprintf(fmt, args);
+	}
+}
+
+void screen_printf(const char * fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	screen_vprintf(fmt, args);
+	va_end(args);
+}
+
+/**
+ * Send the current frame to the terminal.
+ */
+void screen_flush(void) {
+	if (term_out) termbuf_flush(term_out);
+	fflush(stdout);
+}
+
 /**
  * Move the terminal cursor
  */
 void place_cursor(int x, int y) {
-	printf("\033[%d;%dH", y, x);
+	screen_printf("\033[%d;%dH", y, x);
 }
 
 /**
@@ -1874,7 +1909,7 @@ char * color_string(const char * fg, const char * bg) {
  * color modes.
  */
 void set_colors(const char * fg, const char * bg) {
-	printf("%s", color_string(fg, bg));
+	screen_printf("%s", color_string(fg, bg));
 }
 
 /**
@@ -1883,16 +1918,16 @@ void set_colors(const char * fg, const char * bg) {
  * (See set_colors above)
  */
 void set_fg_color(const char * fg) {
-	printf("\033[22;23;");
+	screen_printf("\033[22;23;");
 	if (*fg == '@') {
 		int _fg = atoi(fg+1);
 		if (_fg < 10) {
-			printf("3%dm", _fg);
+			screen_printf("3%dm", _fg);
 		} else {
-			printf("9%dm", _fg-10);
+			screen_printf("9%dm", _fg-10);
 		}
 	} else {
-		printf("38;%sm", fg);
+		screen_printf("38;%sm", fg);
 	}
 }
 
@@ -1901,7 +1936,7 @@ void set_fg_color(const char * fg) {
  */
 void clear_to_end(void) {
 	if (global_config.can_bce) {
-		printf("\033[K");
+		screen_printf("\033[K");
 	}
 }
 
@@ -1913,9 +1948,9 @@ void paint_line(const char * bg) {
 	if (!global_config.can_bce) {
 		set_colors(COLOR_FG, bg);
 		for (int i = 0; i < global_config.term_width; ++i) {
-			printf(" ");
+			screen_printf(" ");
 		}
-		printf("\r");
+		screen_printf("\r");
 	}
 }
 
@@ -1923,42 +1958,42 @@ void paint_line(const char * bg) {
  * Enable bold text display
  */
 void set_bold(void) {
-	printf("\033[1m");
+	screen_printf("\033[1m");
 }
 
 /**
  * Disable bold
  */
 void unset_bold(void) {
-	printf("\033[22m");
+	screen_printf("\033[22m");
 }
 
 /**
  * Enable underlined text display
  */
 void set_underline(void) {
-	printf("\033[4m");
+	screen_printf("\033[4m");
 }
 
 /**
  * Disable underlined text display
  */
 void unset_underline(void) {
-	printf("\033[24m");
+	screen_printf("\033[24m");
 }
 
 /**
  * Reset text display attributes
  */
 void reset(void) {
-	printf("\033[0m");
+	screen_printf("\033[0m");
 }
 
 /**
  * Clear the entire screen
  */
 void clear_screen(void) {
-	printf("\033[H\033[2J");
+	screen_printf("\033[H\033[2J");
 }
 
 /**
@@ -1966,7 +2001,7 @@ void clear_screen(void) {
  */
 void hide_cursor(void) {
 	if (global_config.can_hideshow) {
-		printf("\033[?25l");
+		screen_printf("\033[?25l");
 	}
 }
 
@@ -1975,7 +2010,7 @@ void hide_cursor(void) {
  */
 void show_cursor(void) {
 	if (global_config.can_hideshow) {
-		printf("\033[?25h");
+		screen_printf("\033[?25h");
 	}
 }
 
@@ -1983,14 +2018,14 @@ void show_cursor(void) {
  * Store the cursor position
  */
 void store_cursor(void) {
-	printf("\0337");
+	screen_printf("\0337");
 }
 
 /**
  * Restore the cursor position.
  */
 void restore_cursor(void) {
-	printf("\0338");
+	screen_printf("\0338");
 }
 
 /**
@@ -1998,9 +2033,9 @@ void restore_cursor(void) {
  */
 void mouse_enable(void) {
 	if (global_config.can_mouse) {
-		printf("\033[?1000h");
+		screen_printf("\033[?1000h");
 		if (global_config.can_sgrmouse) {
-			printf("\033[?1006h");
+			screen_printf("\033[?1006h");
 		}
 	}
 }
@@ -2011,9 +2046,9 @@ void mouse_enable(void) {
 void mouse_disable(void) {
 	if (global_config.can_mouse) {
 		if (global_config.can_sgrmouse) {
-			printf("\033[?1006l");
+			screen_printf("\033[?1006l");
 		}
-		printf("\033[?1000l");
+		screen_printf("\033[?1000l");
 	}
 }
 
@@ -2021,24 +2056,49 @@ void mouse_disable(void) {
  * Shift the screen up one line
  */
 void shift_up(int amount) {
-	printf("\033[%dS", amount);
+	screen_printf("\033[%dS", amount);
 }
 
 /**
  * Shift the screen down one line.
  */
 void shift_down(int amount) {
-	printf("\033[%dT", amount);
+	screen_printf("\033[%dT", amount);
 }
 
 void insert_lines_at(int line, int count) {
 	place_cursor(1, line);
-	printf("\033[%dL", count);
+	screen_printf("\033[%dL", count);
 }
 
 void delete_lines_at(int line, int count) {
 	place_cursor(1, line);
-	printf("\033[%dM", count);
+	screen_printf("\033[%dM", count);
+}
+
+void redraw_tabbar(void);
+
+/**
+ * Scroll the text region by some number of lines
+ * (positive moves text up). Callers draw the lines
+ * that scroll into view.
+ *
+ * Where the terminal can insert and delete lines, the
+ * tab bar and status lines are left where they are.
+ */
+void scroll_text_region(int amount) {
+	int top = global_config.tabs_visible ? 2 : 1;
+	if (!global_config.can_insert) {
+		if (amount > 0) shift_up(amount);
+		else shift_down(-amount);
+		redraw_tabbar();
+	} else if (term_out) {
+		termbuf_scroll(term_out, top - 1, global_config.term_height - global_config.bottom_size, amount);
+	} else if (amount > 0) {
+		delete_lines_at(top, amount);
+	} else {
+		insert_lines_at(top, -amount);
+	}
 }
 
 /**
@@ -2046,7 +2106,7 @@ void delete_lines_at(int line, int count) {
  */
 void set_alternate_screen(void) {
 	if (global_config.can_altscreen) {
-		printf("\033[?1049h");
+		screen_printf("\033[?1049h");
 	}
 }
 
@@ -2055,7 +2115,7 @@ void set_alternate_screen(void) {
  */
 void unset_alternate_screen(void) {
 	if (global_config.can_altscreen) {
-		printf("\033[?1049l");
+		screen_printf("\033[?1049l");
 	}
 }
 
@@ -2064,7 +2124,7 @@ void unset_alternate_screen(void) {
  */
 void set_bracketed_paste(void) {
 	if (global_config.can_bracketedpaste) {
-		printf("\033[?2004h");
+		screen_printf("\033[?2004h");
 	}
 }
 
@@ -2073,7 +2133,7 @@ void set_bracketed_paste(void) {
  */
 void unset_bracketed_paste(void) {
 	if (global_config.can_bracketedpaste) {
-		printf("\033[?2004l");
+		screen_printf("\033[?2004l");
 	}
 }
 
@@ -2177,7 +2237,7 @@ void redraw_tabbar(void) {
 
 	if (global_config.tab_offset) {
 		set_colors(COLOR_NUMBER_FG, COLOR_NUMBER_BG);
-		printf("<");
+		screen_printf("<");
 		offset++;
 	}
 
@@ -2216,17 +2276,17 @@ void redraw_tabbar(void) {
 
 		if (filled) {
 			offset += size;
-			printf("%s", title);
+			screen_printf("%s", title);
 			set_colors(COLOR_NUMBER_FG, COLOR_NUMBER_BG);
 			while (offset != global_config.term_width - 1) {
-				printf(" ");
+				screen_printf(" ");
 				offset++;
 			}
-			printf(">");
+			screen_printf(">");
 			break;
 		}
 
-		printf("%s", title);
+		screen_printf("%s", title);
 
 		offset += size;
 	}
@@ -2286,10 +2346,10 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 
 			/* If we should be drawing by now... */
 			if (j >= offset) {
-				if (was_underlining) printf("\033[24m");
+				if (was_underlining) screen_printf("\033[24m");
 				/* Fill remainder with -'s */
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("-");
+				screen_printf("-");
 				set_colors(COLOR_FG, line->is_current ? COLOR_ALT_BG : COLOR_BG);
 			}
 
@@ -2322,16 +2382,16 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 			if (j - offset + c.display_width >= width) {
 				/* We draw this with special colors so it isn't ambiguous */
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				if (was_underlining) printf("\033[24m");
+				if (was_underlining) screen_printf("\033[24m");
 
 				/* If it's wide, draw ---> as needed */
 				while (j - offset < width - 1) {
-					printf("-");
+					screen_printf("-");
 					j++;
 				}
 
 				/* End the line with a > to show it overflows */
-				printf(">");
+				screen_printf(">");
 				set_colors(COLOR_FG, COLOR_BG);
 				return;
 			}
@@ -2362,10 +2422,10 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 			}
 
 			if ((c.flags & FLAG_UNDERLINE) && !was_underlining) {
-				printf("\033[4m");
+				screen_printf("\033[4m");
 				was_underlining = 1;
 			} else if (!(c.flags & FLAG_UNDERLINE) && was_underlining) {
-				printf("\033[24m");
+				screen_printf("\033[24m");
 				was_underlining = 0;
 			}
 
@@ -2386,54 +2446,54 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 			/* Render special characters */
 			if (c.codepoint == '\t') {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("%s", global_config.tab_indicator);
+				screen_printf("%s", global_config.tab_indicator);
 				for (int i = 1; i < c.display_width; ++i) {
-					printf("%s" ,global_config.space_indicator);
+					screen_printf("%s" ,global_config.space_indicator);
 				}
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint < 32) {
 				/* Codepoints under 32 to get converted to ^@ escapes */
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("^%c", '@' + c.codepoint);
+				screen_printf("^%c", '@' + c.codepoint);
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint == 0x7f) {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("^?");
+				screen_printf("^?");
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint > 0x7f && c.codepoint < 0xa0) {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("<%2x>", c.codepoint);
+				screen_printf("<%2x>", c.codepoint);
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint == 0xa0) {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("_");
+				screen_printf("_");
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.display_width == 8) {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("[U+%04x]", c.codepoint);
+				screen_printf("[U+%04x]", c.codepoint);
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.display_width == 10) {
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("[U+%06x]", c.codepoint);
+				screen_printf("[U+%06x]", c.codepoint);
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (i > 0 && is_spaces && c.codepoint == ' ' && !(i % env->tabstop)) {
 				_set_colors(COLOR_ALT_FG, COLOR_BG); /* Normal background so this is more subtle */
 				if (global_config.can_unicode) {
-					printf("▏");
+					screen_printf("▏");
 				} else {
-					printf("|");
+					screen_printf("|");
 				}
 				_set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint == ' ' && i == line->actual - 1) {
 				/* Special case: space at end of line */
 				_set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("%s",global_config.space_indicator);
+				screen_printf("%s",global_config.space_indicator);
 				_set_colors(COLOR_FG, COLOR_BG);
 			} else {
 				/* Normal characters get output */
 				char tmp[7]; /* Max six bytes, use 7 to ensure last is always nil */
 				to_eight(c.codepoint, tmp);
-				printf("%s", tmp);
+				screen_printf("%s", tmp);
 			}
 
 			/* Advance the terminal cell offset by the render width of this character */
@@ -2457,7 +2517,7 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 		}
 	}
 
-	if (was_underlining) printf("\033[24m");
+	if (was_underlining) screen_printf("\033[24m");
 
 	/**
 	 * Determine what color the rest of the line should be.
@@ -2495,11 +2555,11 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 		env->sel_col < width) {
 		set_colors(COLOR_FG, COLOR_BG);
 		while (j < env->sel_col) {
-			printf(" ");
+			screen_printf(" ");
 			j++;
 		}
 		set_colors(COLOR_SELECTFG, COLOR_SELECTBG);
-		printf(" ");
+		screen_printf(" ");
 		j++;
 		set_colors(COLOR_FG, COLOR_BG);
 	}
@@ -2513,7 +2573,7 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 		/* Fill out the normal background */
 		if (j < offset) j = offset;
 		for (; j < width + offset && j < env->maxcolumn; ++j) {
-			printf(" ");
+			screen_printf(" ");
 		}
 
 		/* Draw the line */
@@ -2521,9 +2581,9 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 			j++;
 			set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
 			if (global_config.can_unicode) {
-				printf("▏"); /* Should this be configurable? */
+				screen_printf("▏"); /* Should this be configurable? */
 			} else {
-				printf("|");
+				screen_printf("|");
 			}
 		}
 
@@ -2542,7 +2602,7 @@ void render_line(line_t * line, int width, int offset, int line_no) {
 		/* Paint the rest of the line */
 		if (j < offset) j = offset;
 		for (; j < width + offset; ++j) {
-			printf(" ");
+			screen_printf(" ");
 		}
 	}
 }
@@ -2581,9 +2641,9 @@ void draw_line_number(int x) {
 	}
 	int num_size = num_width() - 2; /* Padding */
 	for (int y = 0; y < num_size - log_base_10(x + 1); ++y) {
-		printf(" ");
+		screen_printf(" ");
 	}
-	printf("%d%c", x + 1, ((x+1 == env->line_no || global_config.horizontal_shift_scrolling) && env->coffset > 0) ? '<' : ' ');
+	screen_printf("%d%c", x + 1, ((x+1 == env->line_no || global_config.horizontal_shift_scrolling) && env->coffset > 0) ? '<' : ' ');
 }
 
 /**
@@ -2642,27 +2702,27 @@ void redraw_line(int x) {
 		switch (env->lines[x]->rev_status) {
 			case 1:
 				set_colors(COLOR_NUMBER_FG, COLOR_GREEN);
-				printf(" ");
+				screen_printf(" ");
 				break;
 			case 2:
 				set_colors(COLOR_NUMBER_FG, global_config.color_gutter ? COLOR_SEARCH_BG : COLOR_ALT_FG);
-				printf(" ");
+				screen_printf(" ");
 				break;
 			case 3:
 				set_colors(COLOR_NUMBER_FG, COLOR_KEYWORD);
-				printf(" ");
+				screen_printf(" ");
 				break;
 			case 4:
 				set_colors(COLOR_ALT_FG, COLOR_RED);
-				printf("▆");
+				screen_printf("▆");
 				break;
 			case 5:
 				set_colors(COLOR_KEYWORD, COLOR_RED);
-				printf("▆");
+				screen_printf("▆");
 				break;
 			default:
 				set_colors(COLOR_NUMBER_FG, COLOR_ALT_FG);
-				printf(" ");
+				screen_printf(" ");
 				break;
 		}
 	}
@@ -2691,13 +2751,13 @@ void draw_excess_line(int j) {
 	place_cursor(1+env->left,1 + global_config.tabs_visible + j);
 	paint_line(COLOR_ALT_BG);
 	set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-	printf("~");
+	screen_printf("~");
 	if (env->left + env->width == global_config.term_width && global_config.can_bce) {
 		clear_to_end();
 	} else {
 		/* Paint the rest of the line */
 		for (int x = 1; x < env->width; ++x) {
-			printf(" ");
+			screen_printf(" ");
 		}
 	}
 }
@@ -2936,13 +2996,13 @@ void redraw_statusbar(void) {
 		}
 		if (is_chopped) {
 			set_colors(COLOR_ALT_FG, COLOR_STATUS_BG);
-			printf("<");
+			screen_printf("<");
 		}
 		set_colors(COLOR_STATUS_FG, COLOR_STATUS_BG);
-		printf("%s ", file_name);
+		screen_printf("%s ", file_name);
 	}
 
-	printf("%s", status_bits);
+	screen_printf("%s", status_bits);
 
 	/* Clear the rest of the status bar */
 	clear_to_end();
@@ -2950,7 +3010,7 @@ void redraw_statusbar(void) {
 	/* Move the cursor appropriately to draw it */
 	place_cursor(global_config.term_width - right_width, global_config.term_height - 1);
 	set_colors(COLOR_STATUS_FG, COLOR_STATUS_BG);
-	printf("%s",right_hand);
+	screen_printf("%s",right_hand);
 }
 
 /**
@@ -2961,7 +3021,7 @@ void redraw_nav_buffer() {
 	if (nav_buffer) {
 		store_cursor();
 		place_cursor(global_config.term_width - nav_buffer - 2, global_config.term_height);
-		printf("%s", nav_buf);
+		screen_printf("%s", nav_buf);
 		clear_to_end();
 		restore_cursor();
 	}
@@ -2990,12 +3050,12 @@ void redraw_commandline(void) {
 	/* If we are in an edit mode, note that. */
 	if (env->mode == MODE_INSERT) {
 		set_bold();
-		printf("-- INSERT --");
+		screen_printf("-- INSERT --");
 		clear_to_end();
 		unset_bold();
 	} else if (env->mode == MODE_LINE_SELECTION) {
 		set_bold();
-		printf("-- LINE SELECTION -- (%d:%d)",
+		screen_printf("-- LINE SELECTION -- (%d:%d)",
 			(env->start_line < env->line_no) ? env->start_line : env->line_no,
 			(env->start_line < env->line_no) ? env->line_no : env->start_line
 		);
@@ -3003,7 +3063,7 @@ void redraw_commandline(void) {
 		unset_bold();
 	} else if (env->mode == MODE_COL_SELECTION) {
 		set_bold();
-		printf("-- COL SELECTION -- (%d:%d %d)",
+		screen_printf("-- COL SELECTION -- (%d:%d %d)",
 			(env->start_line < env->line_no) ? env->start_line : env->line_no,
 			(env->start_line < env->line_no) ? env->line_no : env->start_line,
 			(env->sel_col)
@@ -3012,7 +3072,7 @@ void redraw_commandline(void) {
 		unset_bold();
 	} else if (env->mode == MODE_COL_INSERT) {
 		set_bold();
-		printf("-- COL INSERT -- (%d:%d %d)",
+		screen_printf("-- COL INSERT -- (%d:%d %d)",
 			(env->start_line < env->line_no) ? env->start_line : env->line_no,
 			(env->start_line < env->line_no) ? env->line_no : env->start_line,
 			(env->sel_col)
@@ -3021,17 +3081,17 @@ void redraw_commandline(void) {
 		unset_bold();
 	} else if (env->mode == MODE_REPLACE) {
 		set_bold();
-		printf("-- REPLACE --");
+		screen_printf("-- REPLACE --");
 		clear_to_end();
 		unset_bold();
 	} else if (env->mode == MODE_CHAR_SELECTION) {
 		set_bold();
-		printf("-- CHAR SELECTION -- ");
+		screen_printf("-- CHAR SELECTION -- ");
 		clear_to_end();
 		unset_bold();
 	} else if (env->mode == MODE_DIRECTORY_BROWSE) {
 		set_bold();
-		printf("-- DIRECTORY BROWSE --");
+		screen_printf("-- DIRECTORY BROWSE --");
 		clear_to_end();
 		unset_bold();
 	} else {
@@ -3059,7 +3119,7 @@ void render_commandline_message(char * message, ...) {
 	paint_line(COLOR_BG);
 	set_colors(COLOR_FG, COLOR_BG);
 
-	vprintf(message, args);
+	screen_vprintf(message, args);
 	va_end(args);
 
 	/* Clear the rest of the status bar */
@@ -3086,6 +3146,13 @@ BIM_ACTION(redraw_all, 0,
 	}
 }
 
+BIM_ACTION(repaint_screen, 0,
+	"Repaint the screen, including anything the terminal is assumed to still show."
+)(void) {
+	if (term_out) termbuf_invalidate(term_out);
+	redraw_all();
+}
+
 void pause_for_key(void) {
 	int c;
 	while ((c = bim_getch())== -1);
@@ -3131,7 +3198,7 @@ void update_title(void) {
 	getcwd(cwd, 1024);
 
 	for (int i = 1; i < 3; ++i) {
-		printf("\033]%d;%s%s (%s) - Bim\007", i, env->file_name ? env->file_name : "[No Name]", env->modified ? " +" : "", cwd);
+		screen_printf("\033]%d;%s%s (%s) - Bim\007", i, env->file_name ? env->file_name : "[No Name]", env->modified ? " +" : "", cwd);
 	}
 }
 
@@ -3172,7 +3239,7 @@ void render_status_message(char * message, ...) {
 	set_colors(COLOR_STATUS_FG, COLOR_STATUS_BG);
 
 	/* Process format string */
-	vprintf(message, args);
+	screen_vprintf(message, args);
 	va_end(args);
 
 	/* Clear the rest of the status bar */
@@ -3198,14 +3265,14 @@ void render_error(char * message, ...) {
 		set_colors(COLOR_ERROR_FG, COLOR_ERROR_BG);
 
 		/* Draw the message */
-		vprintf(message, args);
+		screen_vprintf(message, args);
 		va_end(args);
 		global_config.had_error = 1;
 	} else {
-		printf("bim: error during startup: ");
-		vprintf(message, args);
+		screen_printf("bim: error during startup: ");
+		screen_vprintf(message, args);
 		va_end(args);
-		printf("\n");
+		screen_printf("\n");
 	}
 
 }
@@ -3381,6 +3448,7 @@ void update_screen_size(void) {
 	ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
 	global_config.term_width = w.ws_col;
 	global_config.term_height = w.ws_row;
+	if (term_out) termbuf_resize(term_out, w.ws_col, w.ws_row);
 	if (env) {
 		if (left_buffer) {
 			update_split_size();
@@ -4354,12 +4422,7 @@ BIM_ACTION(cursor_down, 0,
 
 			/* Tell terminal to scroll */
 			if (global_config.can_scroll && !left_buffer) {
-				if (!global_config.can_insert) {
-					shift_up(1);
-					redraw_tabbar();
-				} else {
-					delete_lines_at(global_config.tabs_visible ? 2 : 1, 1);
-				}
+				scroll_text_region(1);
 
 				/* A new line appears on screen at the bottom, draw it */
 				int l = global_config.term_height - global_config.bottom_size - global_config.tabs_visible;
@@ -4444,12 +4507,7 @@ BIM_ACTION(cursor_up, 0,
 
 			/* Tell terminal to scroll */
 			if (global_config.can_scroll && !left_buffer) {
-				if (!global_config.can_insert) {
-					shift_down(1);
-					redraw_tabbar();
-				} else {
-					insert_lines_at(global_config.tabs_visible ? 2 : 1, 1);
-				}
+				scroll_text_region(-1);
 
 				/*
 				 * The line at the top of the screen should always be real
@@ -5064,19 +5122,19 @@ int _prefix_command_run_script(char * cmd) {
 		/* Close the temporary buffer */
 		buffer_close(new);
 	} else {
+		/* Set buffered for shell application */
+		set_buffered();
+
 		/* Reset and draw some line feeds */
 		reset();
 		printf("\n\n");
 
-		/* Set buffered for shell application */
-		set_buffered();
-
 		/* Call the shell and wait for completion */
 		system(&cmd[1]);
 
 		/* Return to the editor, wait for user to press enter. */
-		set_unbuffered();
 		printf("\n\nPress ENTER to continue.");
+		set_unbuffered();
 		int c;
 		while ((c = bim_getch(), c != ENTER_KEY && c != LINE_FEED));
 
@@ -6504,16 +6562,16 @@ void render_command_input_buffer(void) {
 	/* If there's a mode name to render, draw it first */
 	int _left_gutter = 0;
 	if (env->mode == MODE_LINE_SELECTION) {
-		_left_gutter = printf("(LINE %d:%d)",
+		_left_gutter = screen_printf("(LINE %d:%d)",
 			(env->start_line < env->line_no) ? env->start_line : env->line_no,
 			(env->start_line < env->line_no) ? env->line_no : env->start_line);
 	} else if (env->mode == MODE_COL_SELECTION) {
-		_left_gutter = printf("(COL %d:%d %d)",
+		_left_gutter = screen_printf("(COL %d:%d %d)",
 			(env->start_line < env->line_no) ? env->start_line : env->line_no,
 			(env->start_line < env->line_no) ? env->line_no : env->start_line,
 			(env->sel_col));
 	} else if (env->mode == MODE_CHAR_SELECTION) {
-		_left_gutter = printf("(CHAR)");
+		_left_gutter = screen_printf("(CHAR)");
 	}
 
 	/* Figure out the cursor position and adjust the offset if necessary */
@@ -6536,16 +6594,16 @@ void render_command_input_buffer(void) {
 	/* If the input buffer is horizontally shifted because it's too long, indicate that. */
 	if (global_config.command_offset) {
 		set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-		printf("<");
+		screen_printf("<");
 	} else {
 		/* Otherwise indicate buffer mode (search / ?, or command :) */
 		set_colors(COLOR_FG, COLOR_BG);
 		if (global_config.overlay_mode == OVERLAY_MODE_SEARCH) {
-			printf(global_config.search_direction == 0 ? "?" : "/");
+			screen_printf(global_config.search_direction == 0 ? "?" : "/");
 		} else if (global_config.overlay_mode == OVERLAY_MODE_FILESEARCH) {
-			printf("_");
+			screen_printf("_");
 		} else {
-			printf(":");
+			screen_printf(":");
 		}
 	}
 
@@ -6924,15 +6982,15 @@ void draw_search_match(uint32_t * buffer, int redraw_buffer) {
 	redraw_statusbar();
 	redraw_commandline();
 	set_fg_color(COLOR_ALT_FG);
-	printf("[%d/%d] ", my_index, match_count);
+	screen_printf("[%d/%d] ", my_index, match_count);
 	set_fg_color(COLOR_KEYWORD);
-	printf(redraw_buffer == 1 ? "/" : "?");
+	screen_printf(redraw_buffer == 1 ? "/" : "?");
 	set_fg_color(COLOR_FG);
 	uint32_t * c = buffer;
 	while (*c) {
 		char tmp[7] = {0}; /* Max six bytes, use 7 to ensure last is always nil */
 		to_eight(*c, tmp);
-		printf("%s", tmp);
+		screen_printf("%s", tmp);
 		c++;
 	}
 }
@@ -7079,7 +7137,7 @@ BIM_ACTION(search_next, 0,
 	draw_search_match(global_config.search, 1);
 	if (wrapped) {
 		set_fg_color(COLOR_ALT_FG);
-		printf(" (search wrapped to top)");
+		screen_printf(" (search wrapped to top)");
 	}
 }
 
@@ -7107,7 +7165,7 @@ BIM_ACTION(search_prev, 0,
 	draw_search_match(global_config.search, 0);
 	if (wrapped) {
 		set_fg_color(COLOR_ALT_FG);
-		printf(" (search wrapped to bottom)");
+		screen_printf(" (search wrapped to bottom)");
 	}
 }
 
@@ -7237,12 +7295,7 @@ void handle_common_mouse(int buttons, int x, int y) {
 			env->loading = 0;
 			if (!shifted) return;
 			if (global_config.can_scroll && !left_buffer) {
-				if (!global_config.can_insert) {
-					shift_down(shifted);
-					redraw_tabbar();
-				} else {
-					insert_lines_at(global_config.tabs_visible ? 2 : 1, shifted);
-				}
+				scroll_text_region(-shifted);
 				for (int i = 0; i < shifted; ++i) {
 					redraw_line(env->offset+i);
 				}
@@ -7277,12 +7330,7 @@ void handle_common_mouse(int buttons, int x, int y) {
 			env->loading = 0;
 			if (!shifted) return;
 			if (global_config.can_scroll && !left_buffer) {
-				if (!global_config.can_insert) {
-					shift_up(shifted);
-					redraw_tabbar();
-				} else {
-					delete_lines_at(global_config.tabs_visible ? 2 : 1, shifted);
-				}
+				scroll_text_region(shifted);
 				int l = global_config.term_height - global_config.bottom_size - global_config.tabs_visible;
 				for (int i = 0; i < shifted; ++i) {
 					if (env->offset + l - i < env->line_count + 1) {
@@ -8887,19 +8935,19 @@ void draw_completion_matches(uint32_t * tmp, struct completion_match *matches, i
 		for (int j = 0; j < box_width; ++j) {
 			if (j == original_length) set_colors(i == index ? COLOR_NUMERAL : COLOR_STATUS_FG, COLOR_STATUS_BG);
 			if (j == match_width) set_colors(COLOR_TYPE, COLOR_STATUS_BG);
-			if (j < match_width) printf("%c", matches[i].string[j]);
-			else if (j > match_width && j - match_width - 1 < file_width) printf("%c", matches[i].file[j-match_width-1]);
-			else printf(" ");
+			if (j < match_width) screen_printf("%c", matches[i].string[j]);
+			else if (j > match_width && j - match_width - 1 < file_width) screen_printf("%c", matches[i].file[j-match_width-1]);
+			else screen_printf(" ");
 		}
 	}
 	if (max_count == 0) {
 		place_cursor(box_x + env->left, box_y);
 		set_colors(COLOR_STATUS_FG, COLOR_STATUS_BG);
-		printf(" (no matches) ");
+		screen_printf(" (no matches) ");
 	} else if (max_count != matches_count) {
 		place_cursor(box_x + env->left, box_y+max_count);
 		set_colors(COLOR_STATUS_FG, COLOR_STATUS_BG);
-		printf(" (%d more) ", matches_count-max_count);
+		screen_printf(" (%d more) ", matches_count-max_count);
 	}
 }
 
@@ -9122,7 +9170,7 @@ int read_one_character(char * message) {
 		if (c == KEY_CTRL_V) {
 			if (!global_config.overlay_mode) {
 				render_commandline_message(message);
-				printf(" ^V");
+				screen_printf(" ^V");
 				place_cursor_actual();
 			}
 			while ((c = bim_getch()) == -1);
@@ -9593,7 +9641,7 @@ struct action_map _NORMAL_MAP[] = {
 	{'A',           insert_at_end, opt_rw, 0},
 	{'u',           undo_history, opt_rw, 0},
 	{KEY_CTRL_R,    redo_history, opt_rw, 0},
-	{KEY_CTRL_L,    redraw_all, 0, 0},
+	{KEY_CTRL_L,    repaint_screen, 0, 0},
 	{KEY_CTRL_G,    goto_definition, 0, 0},
 	{'i',           enter_insert, opt_rw, 0},
 	{'R',           enter_replace, opt_rw, 0},
@@ -10196,6 +10244,8 @@ struct CommandDef {
 
 int process_krk_command(const char * cmd, KrkValue * outVal) {
 	place_cursor(global_config.term_width, global_config.term_height);
+	/* Scripts print directly, so stop tracking the screen until they are done */
+	if (term_out) termbuf_suspend(term_out);
 	fprintf(stdout, "\n");
 	/* By resetting, we're at 0 frames. */
 	krk_resetStack();
@@ -10239,6 +10289,7 @@ int process_krk_command(const char * cmd, KrkValue * outVal) {
 		krk_resetStack();
 		hadOutput = 1;
 	}
+	if (term_out) termbuf_resume(term_out);
 	/* If we had either an exception or a non-zero, non-None result,
 	 * we want to wait for a key press before continuing, and avoid
 	 * clearing the screen if the user is going to enter another command. */
@@ -10334,7 +10385,10 @@ int set_capability(char * arg) {
 	if (!strcmp(argname, "24bit")) global_config.can_24bit = value;
 	else if (!strcmp(argname, "256color")) global_config.can_256color = value;
 	else if (!strcmp(argname, "altscreen")) global_config.can_altscreen = value;
-	else if (!strcmp(argname, "bce")) global_config.can_bce = value;
+	else if (!strcmp(argname, "bce")) {
+		global_config.can_bce = value;
+		if (term_out) term_out->flags = value ? (term_out->flags | TERMBUF_BCE) : (term_out->flags & ~TERMBUF_BCE);
+	}
 	else if (!strcmp(argname, "bright")) global_config.can_bright = value;
 	else if (!strcmp(argname, "hideshow")) global_config.can_hideshow = value;
 	else if (!strcmp(argname, "italic")) global_config.can_italic = value;
@@ -11123,6 +11177,8 @@ void init_terminal(void) {
 	set_unbuffered();
 	mouse_enable();
 	global_config.has_terminal = 1;
+	term_out = termbuf_create(stdout, global_config.term_width, global_config.term_height,
+		global_config.can_bce ? TERMBUF_BCE : 0);
 
 	signal(SIGWINCH, SIGWINCH_handler);
 	signal(SIGCONT,  SIGCONT_handler);
@@ -11270,9 +11326,9 @@ BIM_COMMAND(setcolor, "setcolor", "Set colorscheme colors") {
 #define PRINT_COLOR do { \
 	render_commandline_message("%20s = ", c->name); \
 	set_colors(*c->value, *c->value); \
-	printf("   "); \
+	screen_printf("   "); \
 	set_colors(COLOR_FG, COLOR_BG); \
-	printf(" %s\n", *c->value); \
+	screen_printf(" %s\n", *c->value); \
 	} while (0)
 	if (argc < 2) {
 		/* Print colors */
@@ -15,8 +15,7 @@
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
-#include <toaru/button.h>
-#include <toaru/text.h>
+#include <toaru/ttk.h>
 #include <kuroko/kuroko.h>
 #include <kuroko/vm.h>
 
@@ -36,20 +35,20 @@ static int32_t height = 240;
 
 static char * title_str = "Calculator";
 
-static struct TT_Font * _tt_font = NULL;
-static struct TT_Font * _tt_mono = NULL;
-static struct TT_Font * _tt_mono_bold = NULL;
 
 static int textInputIsAccumulatorValue = 0;
 static char accumulator[1024] = {0};
 static char textInput[1024] = {0};
 
 struct CalculatorButton {
-	struct TTKButton ttkButton;
 	char * label;
 	void (*onClick)(struct CalculatorButton *);
 };
 
+static ttk_window_t * ttk = NULL;
+static ttk_widget_t * accumulator_label = NULL;
+static ttk_widget_t * input_label = NULL;
+
 static void calc_numeric(char * text) {
 	if (textInputIsAccumulatorValue) {
 		textInputIsAccumulatorValue = 0;
@@ -124,8 +123,8 @@ static void btn_func_equ(struct CalculatorButton * self) {
 	textInputIsAccumulatorValue = 1;
 }
 
-#define N(n) {{0},#n,btn_numeric}
-#define F(n,func) {{0},n,btn_func_ ## func}
+#define N(n) {#n,btn_numeric}
+#define F(n,func) {n,btn_func_ ## func}
 
 #define BTN_ROWS 4
 #define BTN_COLS 5
@@ -137,29 +136,23 @@ struct CalculatorButton buttons[] = {
 	N(0), N(.), F("mod",pct), F("+",add), F("=",equ),
 };
 
-static void redraw(void) {
-	struct decor_bounds bounds;
-	decor_get_bounds(window, &bounds);
-	draw_fill(ctx, rgb(204,204,204));
-
-	draw_rectangle_solid(ctx, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT + 4, window->width - bounds.width, 42, rgb(255,255,255));
-
-	tt_set_size(_tt_mono, 10);
-	tt_draw_string(ctx, _tt_mono, bounds.left_width + 5, bounds.top_height + MENU_BAR_HEIGHT + 14, accumulator, rgb(0,0,0));
-
-	struct TT_Font * inputFont = textInputIsAccumulatorValue ? _tt_mono_bold : _tt_mono;
-	tt_set_size(inputFont, 16);
-	tt_draw_string(ctx, inputFont, bounds.left_width + 5, bounds.top_height + MENU_BAR_HEIGHT + 35, textInput, rgb(0,0,0));
+/**
+ * Push the calculator state into the display labels; only the
+ * labels whose text actually changed get redrawn.
+ */
+static void update_display(void) {
+	ttk_label_set_text(accumulator_label, accumulator);
+	ttk_label_set_font(input_label, textInputIsAccumulatorValue ? TTK_FONT_MONO_BOLD : TTK_FONT_MONO, 16);
+	ttk_label_set_text(input_label, textInput);
+	ttk_window_update(ttk);
+}
 
-	for (int i = 0; i < (BTN_ROWS * BTN_COLS); ++i) {
-		ttk_button_draw(ctx, &buttons[i].ttkButton);
-	}
+static void redraw(void) {
+	ttk_window_draw(ttk);
+}
 
+static void draw_menu_bar(ttk_window_t * self) {
 	menu_bar_render(&menu_bar, ctx);
-
-	render_decorations(window, ctx, title_str);
-	flip(ctx);
-	yutani_flip(yctx, window);
 }
 
 static void redraw_window_callback(struct menu_bar * self) {
@@ -167,18 +160,45 @@ static void redraw_window_callback(struct menu_bar * self) {
 	redraw();
 }
 
-int in_button(struct TTKButton * button, struct yutani_msg_window_mouse_event * me) {
-	if (me->new_y >= button->y && me->new_y < button->y  + button->height) {
-		if (me->new_x >= button->x && me->new_x < button->x + button->width) {
-			return 1;
+static void button_activated(ttk_widget_t * self) {
+	struct CalculatorButton * button = self->user_data;
+	button->onClick(button);
+	update_display();
+}
+
+static ttk_widget_t * build_interface(void) {
+	ttk_widget_t * root = ttk_box_create(TTK_VERTICAL, 5, 0);
+
+	ttk_widget_t * display = ttk_box_create(TTK_VERTICAL, 0, 1);
+	display->background = rgb(255,255,255);
+	accumulator_label = ttk_label_create("", TTK_FONT_MONO, 10);
+	accumulator_label->background = rgb(255,255,255);
+	input_label = ttk_label_create("", TTK_FONT_MONO, 16);
+	input_label->background = rgb(255,255,255);
+	ttk_widget_add(display, accumulator_label);
+	ttk_widget_add(display, input_label);
+	ttk_widget_add(root, display);
+
+	ttk_widget_t * grid = ttk_box_create(TTK_VERTICAL, 5, 0);
+	grid->expand = 1;
+	for (int row = 0; row < BTN_ROWS; ++row) {
+		ttk_widget_t * line = ttk_box_create(TTK_HORIZONTAL, 5, 0);
+		line->expand = 1;
+		for (int col = 0; col < BTN_COLS; ++col) {
+			struct CalculatorButton * button = &buttons[row * BTN_COLS + col];
+			ttk_widget_t * widget = ttk_button_create(button->label, button_activated);
+			widget->user_data = button;
+			widget->expand = 1;
+			ttk_widget_add(line, widget);
 		}
+		ttk_widget_add(grid, line);
 	}
-	return 0;
-}
+	ttk_widget_add(root, grid);
 
-#define BASE_TOP 50
+	return root;
+}
 
-void setup_buttons(void) {
+static void setup_menu_bar(void) {
 	struct decor_bounds bounds;
 	decor_get_bounds(window, &bounds);
 
@@ -186,27 +206,6 @@ void setup_buttons(void) {
 	menu_bar.y = bounds.top_height;
 	menu_bar.width = ctx->width - bounds.width;
 	menu_bar.window = window;
-
-	size_t ind = 0;
-
-	int aWidth     = ctx->width - bounds.width - 10;
-	int baseWidth  = aWidth / BTN_COLS;
-	int extraWidth = aWidth - baseWidth * BTN_COLS;
-
-	int aHeight     = ctx->height - bounds.height - 10 - MENU_BAR_HEIGHT - BASE_TOP;
-	int baseHeight  = aHeight / BTN_ROWS;
-	int extraHeight = aHeight - baseHeight * BTN_ROWS;
-
-	for (int row = 0; row < BTN_ROWS; ++row) {
-		for (int col = 0; col < BTN_COLS; ++col, ++ind) {
-			buttons[ind].ttkButton.title  = buttons[ind].label;
-			buttons[ind].ttkButton.width  = ((col + 1 < BTN_COLS) ? baseWidth : (baseWidth + extraWidth)) - 5;
-			buttons[ind].ttkButton.height = ((row + 1 < BTN_ROWS) ? baseHeight : (baseHeight + extraHeight)) - 5;
-			buttons[ind].ttkButton.x = 5 + bounds.left_width + baseWidth * col;
-			buttons[ind].ttkButton.y = MENU_BAR_HEIGHT + BASE_TOP + 5 + bounds.top_height + baseHeight * row;
-		}
-	}
-
 }
 
 void resize_finish(int w, int h) {
@@ -218,43 +217,11 @@ void resize_finish(int w, int h) {
 	reinit_graphics_yutani(ctx, window);
 	width  = w;
 	height = h;
-	setup_buttons();
-	redraw();
+	setup_menu_bar();
+	ttk_window_resize(ttk);
 	yutani_window_resize_done(yctx, window);
 }
 
-static void clear_highlights(int *changed) {
-	for (int i = 0; i < BTN_ROWS * BTN_COLS; ++i) {
-		if (buttons[i].ttkButton.hilight) {
-			*changed = 1;
-			buttons[i].ttkButton.hilight = 0;
-		}
-	}
-}
-
-void set_hilight(struct TTKButton * button, int hilight) {
-	int changed = 0;
-	if (!button) {
-		clear_highlights(&changed);
-	} else if (button && (button->hilight != hilight)) {
-		changed = 1;
-		clear_highlights(&changed);
-		button->hilight = hilight;
-	}
-	if (changed) redraw();
-}
-
-static void update_buttons(struct yutani_msg_window_mouse_event * me, int hilight) {
-	struct TTKButton * inButton = NULL;
-	for (int i = 0; i < BTN_ROWS * BTN_COLS; ++i) {
-		if (in_button(&buttons[i].ttkButton, me)) {
-			inButton = &buttons[i].ttkButton;
-			break;
-		}
-	}
-	set_hilight(inButton, inButton ? hilight : 0);
-}
-
 static void _menu_action_exit(struct MenuEntry * entry) {
 	exit(0);
 }
@@ -287,10 +254,6 @@ int main(int argc, char * argv[]) {
 	struct decor_bounds bounds;
 	decor_get_bounds(NULL, &bounds);
 
-	_tt_font = tt_font_from_shm("sans-serif");
-	_tt_mono = tt_font_from_shm("monospace");
-	_tt_mono_bold = tt_font_from_shm("monospace.bold");
-
 	window = yutani_window_create(yctx, width + bounds.width, height + bounds.height);
 	req_center_x = yctx->display_width / 2;
 	req_center_y = yctx->display_height / 2;
@@ -315,11 +278,12 @@ int main(int argc, char * argv[]) {
 	menu_insert(m, menu_create_normal("star",NULL,"About Calculator",_menu_action_about));
 	menu_set_insert(menu_bar.set, "help", m);
 
-	setup_buttons();
+	setup_menu_bar();
+	ttk = ttk_window_create(yctx, window, ctx, title_str, MENU_BAR_HEIGHT);
+	ttk->draw_chrome = draw_menu_bar;
+	ttk_window_set_root(ttk, build_interface());
 	redraw();
 
-	struct TTKButton * _down_button = NULL;
-
 	vm.binpath = strdup("/bin/calculator"); /* Just assume this so we can get module imports */
 	krk_initVM(KRK_GLOBAL_CLEAN_OUTPUT);
 	krk_startModule("__main__");
@@ -348,7 +312,7 @@ int main(int argc, char * argv[]) {
 									char tmp[2] = {ke->event.key, '\0'};
 									calc_func(tmp);
 								}
-								redraw();
+								update_display();
 							}
 						}
 					}
@@ -389,37 +353,8 @@ int main(int argc, char * argv[]) {
 
 							menu_bar_mouse_event(yctx, window, &menu_bar, me, me->new_x, me->new_y);
 
-							struct decor_bounds bounds;
-							decor_get_bounds(window, &bounds);
-							if (me->new_y > bounds.top_height) {
-
-								if (me->command == YUTANI_MOUSE_EVENT_DOWN) {
-									for (int i = 0; i < BTN_ROWS * BTN_COLS; ++i) {
-										if (in_button(&buttons[i].ttkButton, me)) {
-											set_hilight(&buttons[i].ttkButton, 2);
-											_down_button = &buttons[i].ttkButton;
-										}
-									}
-								} else if (me->command == YUTANI_MOUSE_EVENT_RAISE || me->command == YUTANI_MOUSE_EVENT_CLICK) {
-									if (_down_button) {
-										if (in_button(_down_button, me)) {
-											((struct CalculatorButton*)_down_button)->onClick((struct CalculatorButton*)_down_button);
-											_down_button->hilight = 0;
-										}
-									}
-									_down_button = NULL;
-								}
-
-								if (!me->buttons & YUTANI_MOUSE_BUTTON_LEFT) {
-									update_buttons(me, 1);
-								} else if (_down_button) {
-									if (in_button(_down_button, me)) {
-										set_hilight(_down_button, 2);
-									} else {
-										set_hilight(NULL, 0);
-									}
-								}
-							}
+							ttk_window_mouse_event(ttk, me);
+							ttk_window_update(ttk);
 						}
 					}
 					break;
@@ -32,6 +32,7 @@
 #include <sys/sysfunc.h>
 #include <sys/shm.h>
 #include <pthread.h>
+#include <sched.h>
 #include <dlfcn.h>
 
 #include <toaru/graphics.h>
@@ -395,6 +396,8 @@ static yutani_server_window_t * server_window_create(yutani_globals_t * yg, int
 	win->server_flags = flags;
 	win->opacity = 255;
 	win->hidden = 1;
+	win->frame_requested = 0;
+	win->last_damage = yg->frame_count;
 
 	char key[1024];
 	YUTANI_SHMKEY(yg->server_ident, key, 1024, win);
@@ -661,13 +664,29 @@ static inline int matrix_is_translation(gfx_matrix_t m) {
 	return (m[0][0] == 1.0 && m[0][1] == 0.0 && m[1][0] == 0.0 && m[1][1] == 1.0);
 }
 
+#if YUTANI_DEBUG_BLEND_COUNT
 /**
- * Blit a window to the framebuffer.
+ * Count the rows of a window that fall within the clip region of a context.
+ */
+static size_t count_clipped_rows(gfx_context_t * ctx, int32_t top, int32_t height) {
+	int32_t start = max(top, 0);
+	int32_t end = min(top + height, (int32_t)ctx->height);
+	if (!ctx->clips) return (end > start) ? end - start : 0;
+	size_t count = 0;
+	for (int32_t y = start; y < end; ++y) {
+		if (ctx->clips[y]) count++;
+	}
+	return count;
+}
+#endif
+
+/**
+ * Blit a window to a context.
  *
  * Applies transformations (rotation, animations) and then renders
  * the window through alpha blitting.
  */
-static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * window, int x, int y) {
+static int yutani_blit_window(yutani_globals_t * yg, gfx_context_t * ctx, yutani_server_window_t * window, int x, int y) {
 
 	if (window->hidden) {
 		return 0;
@@ -753,15 +772,21 @@ static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * wi
 			}
 		}
 		if (matrix_is_translation(m)) {
-			draw_sprite_alpha(yg->backend_ctx, &_win_sprite, window->x, window->y, opacity);
+			draw_sprite_alpha(ctx, &_win_sprite, window->x, window->y, opacity);
 		} else {
-			draw_sprite_transform(yg->backend_ctx, &_win_sprite, m, opacity);
+			draw_sprite_transform(ctx, &_win_sprite, m, opacity);
 		}
 	} else if (window->opacity != 255) {
-		draw_sprite_alpha(yg->backend_ctx, &_win_sprite, window->x, window->y, opacity);
+		draw_sprite_alpha(ctx, &_win_sprite, window->x, window->y, opacity);
 	} else {
-		draw_sprite(yg->backend_ctx, &_win_sprite, window->x, window->y);
+		draw_sprite(ctx, &_win_sprite, window->x, window->y);
+	}
+
+#if YUTANI_DEBUG_BLEND_COUNT
+	if (yg->debug_blends) {
+		yg->blend_rows += count_clipped_rows(ctx, window->y, window->height);
 	}
+#endif
 
 	return 0;
 }
@@ -830,25 +855,164 @@ static void yutani_post_vbox_rects(yutani_globals_t * yg) {
 	write(yg->vbox_rects, tmp, sizeof(tmp));
 }
 
+/**
+ * Drop rows of the static layer cache that include the window
+ * at stack position @p index, within [top, top+height).
+ */
+static void static_layers_invalidate(yutani_globals_t * yg, int index, int32_t top, int32_t height) {
+	if (!yg->static_level) return;
+	int32_t start = max(top, 0);
+	int32_t end = min(top + height, (int32_t)yg->height);
+	for (int32_t y = start; y < end; ++y) {
+		if (yg->static_level[y] > index) yg->static_level[y] = 0;
+	}
+}
+
+/**
+ * Find a window's position in the static stack, or -1.
+ */
+static int static_layers_index(yutani_globals_t * yg, yutani_server_window_t * w) {
+	for (int i = 0; i < yg->static_count; ++i) {
+		if (yg->static_stack[i] == w) return i;
+	}
+	return -1;
+}
+
+/**
+ * Drop the whole static layer cache, eg. after a display resize.
+ */
+static void static_layers_reset(yutani_globals_t * yg) {
+	if (yg->static_level) {
+		memset(yg->static_level, 0, sizeof(uint16_t) * yg->static_ctx->height);
+	}
+}
+
+/**
+ * Make sure the static layer cache matches the display size.
+ */
+static void static_layers_alloc(yutani_globals_t * yg) {
+	if (yg->static_ctx && yg->static_ctx->width == yg->width && yg->static_ctx->height == yg->height) return;
+
+	if (yg->static_ctx) {
+		gfx_no_clip(yg->static_ctx);
+		free(yg->static_ctx);
+		sprite_free(yg->static_sprite);
+		free(yg->static_level);
+	}
+
+	yg->static_sprite = create_sprite(yg->width, yg->height, ALPHA_OPAQUE);
+	yg->static_ctx = init_graphics_sprite(yg->static_sprite);
+	yg->static_level = calloc(yg->height, sizeof(uint16_t));
+	gfx_add_clip(yg->static_ctx, 0, 0, 0, 0);
+}
+
+/**
+ * Append a window to this frame's stack, noting where it first
+ * differs from the stack the cache was built against.
+ */
+static void static_layers_push(yutani_globals_t * yg, yutani_server_window_t * w, int * count, int * diverged) {
+	if (!w || w->hidden) return;
+	if (*count == yg->static_capacity) {
+		yg->static_capacity = yg->static_capacity ? yg->static_capacity * 2 : 16;
+		yg->static_stack = realloc(yg->static_stack, sizeof(yutani_server_window_t *) * yg->static_capacity);
+	}
+	if (*diverged < 0 && (*count >= yg->static_count || yg->static_stack[*count] != w)) {
+		*diverged = *count;
+	}
+	yg->static_stack[(*count)++] = w;
+}
+
+/**
+ * Can this window be kept in the static layer cache?
+ *
+ * Windows that are animating, transformed, or were damaged within the
+ * last few frames are drawn directly every frame instead.
+ */
+static int window_is_static(yutani_globals_t * yg, yutani_server_window_t * w) {
+	if (w->anim_mode || w->rotation || w == yg->resizing_window) return 0;
+	return yg->frame_count - w->last_damage >= YUTANI_STATIC_SETTLE_FRAMES;
+}
+
 /**
  * Blit all windows into the given context.
  *
+ * The longest run of unchanging windows from the bottom of the stack
+ * (usually at least the wallpaper) is composited into a cache once.
+ * Damaged rows are then a single opaque copy from the cache followed
+ * by whatever windows are still changing above it.
+ *
  * This is called for rendering and for screenshots.
  */
 static void yutani_blit_windows(yutani_globals_t * yg) {
-	if (!yg->bottom_z || yg->bottom_z->anim_mode) {
-		draw_fill(yg->backend_ctx, rgb(0,0,0));
-	}
-	if (yg->bottom_z) yutani_blit_window(yg, yg->bottom_z, yg->bottom_z->x, yg->bottom_z->y);
+	gfx_context_t * out = yg->backend_ctx;
+	int count = 0;
+	int diverged = -1;
+
+	static_layers_alloc(yg);
+
+	static_layers_push(yg, yg->bottom_z, &count, &diverged);
 	foreach (node, yg->mid_zs) {
-		yutani_server_window_t * w = node->value;
-		if (w) yutani_blit_window(yg, w, w->x, w->y);
+		static_layers_push(yg, node->value, &count, &diverged);
 	}
 	foreach (node, yg->overlay_zs) {
-		yutani_server_window_t * w = node->value;
-		if (w) yutani_blit_window(yg, w, w->x, w->y);
+		static_layers_push(yg, node->value, &count, &diverged);
+	}
+	static_layers_push(yg, yg->top_z, &count, &diverged);
+
+	if (diverged < 0 && count != yg->static_count) diverged = count;
+	if (diverged >= 0) static_layers_invalidate(yg, diverged, 0, yg->height);
+	yg->static_count = count;
+
+	int split = 0;
+	while (split < count && window_is_static(yg, yg->static_stack[split])) split++;
+
+	if (!split) {
+		if (!yg->bottom_z || yg->bottom_z->anim_mode) {
+			draw_fill(out, rgb(0,0,0));
+		}
+		for (int i = 0; i < count; ++i) {
+			yutani_server_window_t * w = yg->static_stack[i];
+			yutani_blit_window(yg, out, w, w->x, w->y);
+		}
+		return;
+	}
+
+	gfx_context_t * cache = yg->static_ctx;
+	uint16_t * level = yg->static_level;
+
+	/* Rows built past the split hold windows that are now changing */
+	for (unsigned int y = 0; y < yg->height; ++y) {
+		if (out->clips && !out->clips[y]) continue;
+		if (level[y] > split) level[y] = 0;
+		if (!level[y]) memset(&GFX(cache, 0, y), 0, cache->width * 4);
+	}
+
+	/* Bring each row up to the split, starting from the first window it is missing */
+	for (int i = 0; i < split; ++i) {
+		int needed = 0;
+		for (unsigned int y = 0; y < yg->height; ++y) {
+			cache->clips[y] = (!out->clips || out->clips[y]) && level[y] <= i;
+			needed |= cache->clips[y];
+		}
+		if (needed) {
+			yutani_server_window_t * w = yg->static_stack[i];
+			yutani_blit_window(yg, cache, w, w->x, w->y);
+		}
+	}
+
+	for (unsigned int y = 0; y < yg->height; ++y) {
+		if (out->clips && !out->clips[y]) continue;
+		level[y] = split;
+		memcpy(&GFX(out, 0, y), &GFX(cache, 0, y), out->width * 4);
+#if YUTANI_DEBUG_BLEND_COUNT
+		yg->static_rows++;
+#endif
+	}
+
+	for (int i = split; i < count; ++i) {
+		yutani_server_window_t * w = yg->static_stack[i];
+		yutani_blit_window(yg, out, w, w->x, w->y);
 	}
-	if (yg->top_z) yutani_blit_window(yg, yg->top_z, yg->top_z->x, yg->top_z->y);
 }
 
 /**
@@ -941,6 +1105,7 @@ static void resize_display(yutani_globals_t * yg) {
 
 	TRACE("Marking...");
 	yg->resize_on_next = 0;
+	static_layers_reset(yg);
 	mark_screen(yg, 0, 0, yg->width, yg->height);
 
 	TRACE("Sending welcome messages...");
@@ -950,6 +1115,65 @@ static void resize_display(yutani_globals_t * yg) {
 	TRACE("Done.");
 }
 
+/**
+ * Tell clients waiting on a frame callback that a frame went out.
+ *
+ * Hidden windows keep their requests until they are shown again,
+ * so an animating client that is hidden stops drawing.
+ */
+static void send_frame_done(yutani_globals_t * yg) {
+	if (!yg->frame_requests->length) return;
+
+	uint64_t now = yutani_current_time(yg);
+	node_t * node = yg->frame_requests->head;
+	while (node) {
+		node_t * next = node->next;
+		yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, node->value);
+		if (!w || !w->hidden) {
+			if (w) {
+				w->frame_requested = 0;
+				yutani_msg_buildx_frame_alloc(response);
+				yutani_msg_buildx_frame(response, YUTANI_MSG_FRAME_DONE, w->wid, now);
+				pex_send(yg->server, w->owner, response->size, (char *)response);
+			}
+			list_delete(yg->frame_requests, node);
+			free(node);
+		}
+		node = next;
+	}
+}
+
+/**
+ * Is there anything for the next frame to do?
+ *
+ * When there isn't, the main loop sleeps until a client or
+ * input device wakes it instead of ticking at 60Hz.
+ */
+static int has_pending_frame(yutani_globals_t * yg) {
+	if (yg->update_list->length) return 1;
+	if (yg->last_mouse_x != yg->mouse_x || yg->last_mouse_y != yg->mouse_y) return 1;
+	if (yg->resize_on_next || yg->screenshot_frame) return 1;
+	if (yg->windows_to_remove->length) return 1;
+
+	if (yg->bottom_z && yg->bottom_z->anim_mode) return 1;
+	if (yg->top_z && yg->top_z->anim_mode) return 1;
+	foreach (node, yg->mid_zs) {
+		yutani_server_window_t * w = node->value;
+		if (w && w->anim_mode) return 1;
+	}
+	foreach (node, yg->overlay_zs) {
+		yutani_server_window_t * w = node->value;
+		if (w && w->anim_mode) return 1;
+	}
+
+	foreach (node, yg->frame_requests) {
+		yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, node->value);
+		if (!w || !w->hidden) return 1;
+	}
+
+	return 0;
+}
+
 /**
  * Redraw all windows, as well as the mouse cursor.
  *
@@ -1003,6 +1227,8 @@ static void redraw_windows(yutani_globals_t * yg) {
 
 	/* Render */
 	if (has_updates) {
+		yg->frame_count++;
+
 		/*
 		 * In theory, we should restrict this to windows within the clip region,
 		 * but calculating that may be more trouble than it's worth;
@@ -1010,6 +1236,15 @@ static void redraw_windows(yutani_globals_t * yg) {
 		 */
 		yutani_blit_windows(yg);
 
+#if YUTANI_DEBUG_BLEND_COUNT
+		if (yg->debug_blends) {
+			TRACE("frame %lu: %zu window rows blended, %zu rows copied from static layers",
+				(unsigned long)yg->frame_count, yg->blend_rows, yg->static_rows);
+			yg->blend_rows = 0;
+			yg->static_rows = 0;
+		}
+#endif
+
 		/* Send VirtualBox rects */
 		yutani_post_vbox_rects(yg);
 
@@ -1096,6 +1331,8 @@ static void redraw_windows(yutani_globals_t * yg) {
 	if (yg->screenshot_frame) {
 		yutani_screenshot(yg);
 	}
+
+	send_frame_done(yg);
 }
 
 /**
@@ -1161,6 +1398,11 @@ static void mark_window_relative(yutani_globals_t * yg, yutani_server_window_t *
 		rect->height = bottom_bound - top_bound;
 	}
 
+	/* Rows of the static layers that included this window are stale */
+	window->last_damage = yg->frame_count;
+	int index = static_layers_index(yg, window);
+	if (index >= 0) static_layers_invalidate(yg, index, rect->y, rect->height);
+
 	list_insert(yg->update_list, rect);
 }
 
@@ -1213,6 +1455,13 @@ static void window_actually_close(yutani_globals_t * yg, yutani_server_window_t
 	/* Mark the region where the window was */
 	mark_window(yg, w);
 
+	/* Forget it in the static layers so the stack never points at a freed window */
+	int index = static_layers_index(yg, w);
+	if (index >= 0) {
+		static_layers_invalidate(yg, index, 0, yg->height);
+		yg->static_count = index;
+	}
+
 	/* And if it was focused, unfocus it. */
 	if (w == yg->focused_window) {
 		/* find the top z-ordered window */
@@ -1466,6 +1715,15 @@ static void handle_key_event(yutani_globals_t * yg, struct yutani_msg_key_event
 			yg->debug_bounds = (1-yg->debug_bounds);
 			return;
 		}
+#endif
+#if YUTANI_DEBUG_BLEND_COUNT
+		if ((ke->event.action == KEY_ACTION_DOWN) &&
+			(ke->event.modifiers & KEY_MOD_LEFT_SUPER) &&
+			(ke->event.modifiers & KEY_MOD_LEFT_SHIFT) &&
+			(ke->event.keycode == 'm')) {
+			yg->debug_blends = (1-yg->debug_blends);
+			return;
+		}
 #endif
 		/* Screenshot key */
 		if ((ke->event.action == KEY_ACTION_DOWN) &&
@@ -2154,6 +2412,7 @@ int main(int argc, char * argv[]) {
 	yg->mid_zs = list_create();
 	yg->overlay_zs = list_create();
 	yg->windows_to_remove = list_create();
+	yg->frame_requests = list_create();
 
 	yg->window_subscribers = list_create();
 
@@ -2174,6 +2433,12 @@ int main(int argc, char * argv[]) {
 		}
 	}
 
+	if (!yutani_options.nested) {
+		/* Keep the cursor and frames moving when the system is busy. */
+		struct sched_param param = { .sched_priority = 10 };
+		sched_setscheduler(0, SCHED_RR, &param);
+	}
+
 	int fds[4];
 	int mfd = -1;
 	int kfd = -1;
@@ -2207,15 +2472,23 @@ int main(int argc, char * argv[]) {
 
 	while (1) {
 
-		unsigned long frameTime = yutani_time_since(yg, last_redraw);
-		if (frameTime > 15) {
-			redraw_windows(yg);
-			last_redraw = yutani_current_time(yg);
-			frameTime = 0;
+		/*
+		 * Redraw at most once every 16ms, and only when there is something to
+		 * draw; with nothing pending, sleep until input or a client arrives.
+		 */
+		int timeout = -1;
+		if (has_pending_frame(yg)) {
+			unsigned long frameTime = yutani_time_since(yg, last_redraw);
+			if (frameTime > 15) {
+				redraw_windows(yg);
+				last_redraw = yutani_current_time(yg);
+				frameTime = 0;
+			}
+			if (has_pending_frame(yg)) timeout = 16 - frameTime;
 		}
 
 		if (yutani_options.nested) {
-			int index = fswait2(2, fds, 16 - frameTime);
+			int index = fswait2(2, fds, timeout);
 
 			if (index == 1) {
 				yutani_msg_t * m = yutani_poll(yg->host_context);
@@ -2274,7 +2547,7 @@ int main(int argc, char * argv[]) {
 				continue;
 			}
 		} else {
-			int index = fswait2(amfd == -1 ? 3 : 4, fds, 16 - frameTime);
+			int index = fswait2(amfd == -1 ? 3 : 4, fds, timeout);
 
 			if (index == 2) {
 				unsigned char buf[1];
@@ -2403,6 +2676,16 @@ int main(int argc, char * argv[]) {
 					}
 				}
 				break;
+			case YUTANI_MSG_FRAME_REQUEST:
+				{
+					struct yutani_msg_frame * fr = (void *)m->data;
+					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)fr->wid);
+					if (w && w->owner == p->source && !w->frame_requested) {
+						w->frame_requested = 1;
+						list_insert(yg->frame_requests, (void *)(uintptr_t)w->wid);
+					}
+				}
+				break;
 			case YUTANI_MSG_KEY_EVENT:
 				{
 					/* XXX Verify this is from a valid device client */
@@ -16,16 +16,23 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 
-#define CHUNK_SIZE 4096
+#define CHUNK_SIZE (128 * 1024)
 
 static int recursive = 0;
 static int symlinks = 0;
-static int copy_thing(char * tmp, char * tmp2);
+static int copy_thing(int s_dir, char * s_name, char * tmp, int d_dir, char * d_name, char * tmp2);
 
-static int copy_link(char * source, char * dest, int mode, int uid, int gid) {
+/*
+ * Sources and destinations are named relative to an open directory
+ * (or AT_FDCWD) so that copying a tree doesn't have the kernel walk
+ * each full path again; the full paths are still carried along for
+ * messages and for chmod/chown.
+ */
+
+static int copy_link(int s_dir, char * s_name, char * dest, int mode, int uid, int gid) {
 	//fprintf(stderr, "need to copy link %s to %s\n", source, dest);
 	char tmp[1024];
-	readlink(source, tmp, 1024);
+	readlinkat(s_dir, s_name, tmp, 1024);
 	symlink(tmp, dest);
 	chmod(dest, mode);
 	chown(dest, uid, gid);
@@ -33,27 +40,48 @@ static int copy_link(char * source, char * dest, int mode, int uid, int gid) {
 	return 0;
 }
 
-static int copy_file(char * source, char * dest, int mode,int uid, int gid) {
+/* For when copy_file_range isn't available between these two files. */
+static int copy_data_fallback(int s_fd, int d_fd, off_t offset, off_t length) {
+	char * buf = malloc(CHUNK_SIZE);
+
+	lseek(s_fd, offset, SEEK_SET);
+	lseek(d_fd, offset, SEEK_SET);
+
+	while (length > 0) {
+		ssize_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
+		if (r <= 0) break;
+		length -= r;
+		if (write(d_fd, buf, r) != r) {
+			free(buf);
+			return 1;
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
+static int copy_file(int s_dir, char * s_name, int d_dir, char * d_name, char * dest, int mode,int uid, int gid) {
 	//fprintf(stderr, "need to copy file %s to %s %x\n", source, dest, mode);
 
-	int d_fd = open(dest, O_WRONLY | O_CREAT, mode);
-	int s_fd = open(source, O_RDONLY);
+	int d_fd = openat(d_dir, d_name, O_WRONLY | O_CREAT | O_TRUNC, mode);
+	int s_fd = openat(s_dir, s_name, O_RDONLY);
 
-	ssize_t length;
+	off_t length;
 
 	length = lseek(s_fd, 0, SEEK_END);
 	lseek(s_fd, 0, SEEK_SET);
 
-	//fprintf(stderr, "%d bytes to copy\n", length);
-
-	char buf[CHUNK_SIZE];
+	/* Let the kernel move the data; it can share blocks between tmpfs files outright. */
+	off_t copied = 0;
+	while (copied < length) {
+		ssize_t r = copy_file_range(s_fd, NULL, d_fd, NULL, length - copied, 0);
+		if (r <= 0) break;
+		copied += r;
+	}
 
-	while (length > 0) {
-		size_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
-		//fprintf(stderr, "copying %d bytes from %s to %s\n", r, source, dest);
-		write(d_fd, buf, r);
-		length -= r;
-		//fprintf(stderr, "%d bytes remaining\n", length);
+	if (copied < length) {
+		copy_data_fallback(s_fd, d_fd, copied, length - copied);
 	}
 
 	close(s_fd);
@@ -63,18 +91,26 @@ static int copy_file(char * source, char * dest, int mode,int uid, int gid) {
 	return 0;
 }
 
-static int copy_directory(char * source, char * dest, int mode, int uid, int gid) {
-	DIR * dirp = opendir(source);
-	if (dirp == NULL) {
+static int copy_directory(int s_dir, char * s_name, char * source, int d_dir, char * d_name, char * dest, int mode, int uid, int gid) {
+	int s_fd = openat(s_dir, s_name, O_RDONLY | O_DIRECTORY);
+	if (s_fd < 0) {
 		fprintf(stderr, "Failed to copy directory %s\n", source);
 		return 1;
 	}
+	DIR * dirp = fdopendir(s_fd);
 
 	//fprintf(stderr, "Creating %s\n", dest);
 	if (!strcmp(dest, "/")) {
 		dest = "";
 	} else {
-		mkdir(dest, mode);
+		mkdirat(d_dir, d_name, mode);
+	}
+
+	int d_fd = openat(d_dir, d_name, O_RDONLY | O_DIRECTORY);
+	if (d_fd < 0) {
+		fprintf(stderr, "Failed to create directory %s\n", dest);
+		closedir(dirp);
+		return 1;
 	}
 
 	struct dirent * ent = readdir(dirp);
@@ -90,33 +126,30 @@ static int copy_directory(char * source, char * dest, int mode, int uid, int gid
 		char tmp2[strlen(dest)+strlen(ent->d_name)+2];
 		sprintf(tmp2, "%s/%s", dest, ent->d_name);
 		//fprintf(stderr,"%s → %s\n", tmp, tmp2);
-		copy_thing(tmp,tmp2);
+		copy_thing(s_fd, ent->d_name, tmp, d_fd, ent->d_name, tmp2);
 		ent = readdir(dirp);
 	}
 	closedir(dirp);
+	close(d_fd);
 
 	chown(dest, uid, gid);
 
 	return 0;
 }
 
-static int copy_thing(char * tmp, char * tmp2) {
+static int copy_thing(int s_dir, char * s_name, char * tmp, int d_dir, char * d_name, char * tmp2) {
 	struct stat statbuf;
-	if (symlinks) {
-		lstat(tmp,&statbuf);
-	} else {
-		stat(tmp,&statbuf);
-	}
+	fstatat(s_dir, s_name, &statbuf, symlinks ? AT_SYMLINK_NOFOLLOW : 0);
 	if (S_ISLNK(statbuf.st_mode)) {
-		return copy_link(tmp, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
+		return copy_link(s_dir, s_name, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
 	} else if (S_ISDIR(statbuf.st_mode)) {
 		if (!recursive) {
 			fprintf(stderr, "cp: %s: omitting directory\n", tmp);
 			return 1;
 		}
-		return copy_directory(tmp, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
+		return copy_directory(s_dir, s_name, tmp, d_dir, d_name, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
 	} else if (S_ISREG(statbuf.st_mode)) {
-		return copy_file(tmp, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
+		return copy_file(s_dir, s_name, d_dir, d_name, tmp2, statbuf.st_mode & 07777, statbuf.st_uid, statbuf.st_gid);
 	} else {
 		fprintf(stderr, "cp: %s is not any of the required file types?\n", tmp);
 		return 1;
@@ -153,7 +186,7 @@ int main(int argc, char ** argv) {
 				if (!source) source = argv[optind];
 				char output[4096];
 				sprintf(output, "%s/%s", destination, source);
-				copy_thing(argv[optind], output);
+				copy_thing(AT_FDCWD, argv[optind], argv[optind], AT_FDCWD, output, output);
 				optind++;
 			}
 		} else {
@@ -161,7 +194,7 @@ int main(int argc, char ** argv) {
 				fprintf(stderr, "cp: target '%s' is not a directory\n", destination);
 				return 1;
 			}
-			copy_thing(argv[optind], destination);
+			copy_thing(AT_FDCWD, argv[optind], argv[optind], AT_FDCWD, destination, destination);
 		}
 	} else {
 		fprintf(stderr, "cp: not enough arguments\n");
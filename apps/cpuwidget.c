@@ -105,13 +105,6 @@ static void shift_graph(gfx_context_t * ctx) {
 	}
 }
 
-extern struct TT_Contour * tt_contour_start(float x, float y);
-extern struct TT_Shape * tt_contour_finish(struct TT_Contour * in);
-extern struct TT_Contour * tt_contour_line_to(struct TT_Contour * shape, float x, float y);
-extern void tt_path_paint(gfx_context_t * ctx, const struct TT_Shape * shape, uint32_t color);
-extern void tt_contour_stroke_bounded(gfx_context_t * ctx, struct TT_Contour * in, uint32_t color, float width,
-		int x_0, int y_0, int w, int h);
-
 static void graph_between(gfx_context_t * ctx, size_t old, size_t new, size_t scale, uint32_t color, int direction) {
 	static float factor[EASE_WIDTH] = {0.0};
 	if (factor[0] == 0.0) {
@@ -129,24 +122,28 @@ static void graph_between(gfx_context_t * ctx, size_t old, size_t new, size_t sc
 		samples[i] = (direction == 0) ? (value * (ctx->height - 1) / (float)scale) : ((scale - value) * (ctx->height - 1) / (float)scale);
 	}
 
-	/* Main line */
-	struct TT_Contour * contour = tt_contour_start(ctx->width - EASE_WIDTH, samples[0]);
+	/* Main line, stroked only within the region we are easing into */
+	gfx_context_t * sub = init_graphics_subregion(ctx, ctx->width - EASE_WIDTH, 0, EASE_WIDTH - 1, ctx->height);
+	gfx_path_t * path = gfx_path_create();
+	gfx_path_move_to(path, 0, samples[0]);
 	for (int i = 1; i < EASE_WIDTH; ++i) {
-		contour = tt_contour_line_to(contour, ctx->width - EASE_WIDTH + i, samples[i]);
+		gfx_path_line_to(path, i, samples[i]);
 	}
-	/* Now slow stroke, but only within these bounds */
-	tt_contour_stroke_bounded(ctx, contour, color, 0.5, ctx->width - EASE_WIDTH, 0, EASE_WIDTH - 1, ctx->height);
+	gfx_path_stroke(sub, path, 1.0, color);
+	free(sub);
 
 	/* Now finish the lower part of the graph */
-	contour = tt_contour_line_to(contour, ctx->width - 1, ctx->height);
-	contour = tt_contour_line_to(contour, ctx->width - EASE_WIDTH, ctx->height);
-
-	struct TT_Shape * shape = tt_contour_finish(contour);
+	gfx_path_reset(path);
+	gfx_path_move_to(path, ctx->width - EASE_WIDTH, samples[0]);
+	for (int i = 1; i < EASE_WIDTH; ++i) {
+		gfx_path_line_to(path, ctx->width - EASE_WIDTH + i, samples[i]);
+	}
+	gfx_path_line_to(path, ctx->width - 1, ctx->height);
+	gfx_path_line_to(path, ctx->width - EASE_WIDTH, ctx->height);
 
 	uint32_t c = premultiply(rgba(_RED(color),_GRE(color),_BLU(color),_ALP(color) * 0.25));
-	tt_path_paint(ctx, shape, c);
-	free(shape);
-	free(contour);
+	gfx_path_fill(ctx, path, c, GFX_FILL_NONZERO);
+	gfx_path_free(path);
 }
 
 static void next_cpu(gfx_context_t * ctx) {
@@ -0,0 +1,180 @@
+/**
+ * @brief dmesg - Show and control the kernel log
+ *
+ * The kernel keeps its recent messages in /proc/kmsg, one per line
+ * as "<level>[timestamp] text". Which levels reach the console, and
+ * which are kept at all, are set with ioctls on /dev/console.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <kernel/kmsg.h>
+
+static const char * level_names[] = {
+	"emerg", "alert", "crit", "error", "warning", "notice", "info", "debug",
+};
+
+static int parse_level(const char * arg) {
+	if (*arg >= '0' && *arg <= '7' && !arg[1]) return *arg - '0';
+	if (!*arg) return -1;
+	for (int i = 0; i < 8; ++i) {
+		if (!strncmp(arg, level_names[i], strlen(arg))) return i;
+	}
+	return -1;
+}
+
+static char * read_log(size_t * size_out) {
+	int fd = open("/proc/kmsg", O_RDONLY);
+	if (fd < 0) return NULL;
+
+	size_t size = 0, space = 64 * 1024;
+	char * buf = malloc(space);
+	ssize_t r;
+	while ((r = read(fd, buf + size, space - size)) > 0) {
+		size += r;
+		if (size == space) {
+			space *= 2;
+			buf = realloc(buf, space);
+		}
+	}
+	close(fd);
+
+	*size_out = size;
+	return buf;
+}
+
+static void show_log(char * buf, size_t size, int max_level, int raw) {
+	int level = KMSG_LEVEL_INFO;
+	char * end = buf + size;
+	while (buf < end) {
+		char * nl = memchr(buf, '\n', end - buf);
+		char * next = nl ? nl + 1 : end;
+		char * text = buf;
+		/* Lines without a level continue the message before them */
+		if (end - buf >= 3 && buf[0] == '<' && buf[1] >= '0' && buf[1] <= '7' && buf[2] == '>') {
+			level = buf[1] - '0';
+			if (!raw) text += 3;
+		}
+		if (level <= max_level) fwrite(text, 1, next - text, stdout);
+		buf = next;
+	}
+}
+
+static void show_stats(struct kmsg_stats * stats) {
+	printf("messages:  %lu logged, %lu dropped\n", stats->records, stats->dropped);
+	if (stats->records) {
+		printf("dprintf:   %lu ns on average, %lu ns at most\n",
+			stats->log_ns_total / stats->records, stats->log_ns_max);
+	}
+	if (stats->console_records) {
+		printf("console:   %lu ns a message on average, %lu ns for the longest write\n",
+			stats->console_ns_total / stats->console_records, stats->console_ns_max);
+	}
+}
+
+static void show_usage(char * argv[]) {
+	fprintf(stderr,
+			"dmesg - show and control the kernel log\n"
+			"\n"
+			"usage: %s [-rs] [-l LEVEL] [-n LEVEL] [-R LEVEL]\n"
+			"\n"
+			" -l     \033[3mshow only messages at LEVEL or more important\033[0m\n"
+			" -r     \033[3mkeep the <level> at the start of each message\033[0m\n"
+			" -n     \033[3mwrite messages at LEVEL or more important to the console\033[0m\n"
+			" -R     \033[3mdiscard messages less important than LEVEL\033[0m\n"
+			" -s     \033[3mshow how many messages were logged, and how long logging took\033[0m\n"
+			" -?     \033[3mshow this help text\033[0m\n"
+			"\n"
+			" LEVEL is a number from 0 to 7, or one of error, warning, notice, info, debug\n"
+			"\n", argv[0]);
+}
+
+int main(int argc, char * argv[]) {
+	int opt;
+	int max_level = 7;
+	int raw = 0;
+	int stats = 0;
+	int console_level = -1;
+	int record_level = -1;
+
+	while ((opt = getopt(argc, argv, "l:rn:R:s?")) != -1) {
+		switch (opt) {
+			case 'l':
+				max_level = parse_level(optarg);
+				break;
+			case 'r':
+				raw = 1;
+				break;
+			case 'n':
+				console_level = parse_level(optarg);
+				if (console_level < 0) max_level = -1;
+				break;
+			case 'R':
+				record_level = parse_level(optarg);
+				if (record_level < 0) max_level = -1;
+				break;
+			case 's':
+				stats = 1;
+				break;
+			case '?':
+				show_usage(argv);
+				return 0;
+		}
+	}
+
+	if (max_level < 0) {
+		fprintf(stderr, "%s: invalid level\n", argv[0]);
+		return 1;
+	}
+
+	if (console_level >= 0 || record_level >= 0 || stats) {
+		int fd = open("/dev/console", O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], "/dev/console", strerror(errno));
+			return 1;
+		}
+
+		if (stats) {
+			struct kmsg_stats kstats;
+			if (ioctl(fd, IO_KMSG_GET_STATS, &kstats) < 0) {
+				fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+				return 1;
+			}
+			show_stats(&kstats);
+		}
+
+		if (console_level >= 0 || record_level >= 0) {
+			struct kmsg_levels levels;
+			ioctl(fd, IO_KMSG_GET_LEVELS, &levels);
+			if (console_level >= 0) levels.console = console_level;
+			if (record_level >= 0) levels.record = record_level;
+			if (ioctl(fd, IO_KMSG_SET_LEVELS, &levels) < 0) {
+				fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+				return 1;
+			}
+		}
+
+		close(fd);
+		return 0;
+	}
+
+	size_t size;
+	char * log = read_log(&size);
+	if (!log) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], "/proc/kmsg", strerror(errno));
+		return 1;
+	}
+
+	show_log(log, size, max_level, raw);
+	free(log);
+	return 0;
+}
@@ -23,7 +23,7 @@ static int human = 0;
 static int all = 1;
 static int is_arg = 0;
 
-static uint64_t count_thing(char * tmp);
+static uint64_t count_thing(int dirfd, char * name, char * path);
 
 static int print_human_readable_size(char * _out, size_t s) {
 	if (s >= 1<<20) {
@@ -50,12 +50,18 @@ static void print_size(uint64_t size, char * name) {
 	fprintf(stdout, "%7s %s\n", sizes, name);
 }
 
-static uint64_t count_directory(char * source) {
-	DIR * dirp = opendir(source);
-	if (dirp == NULL) {
+/*
+ * Entries are looked up relative to their open directory, so the
+ * kernel doesn't walk the whole path again for each one; full paths
+ * are only built for directories, which are printed.
+ */
+static uint64_t count_directory(int dirfd, char * name, char * source) {
+	int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
 		//fprintf(stderr, "could not open %s\n", source);
 		return 0;
 	}
+	DIR * dirp = fdopendir(fd);
 
 	int was_arg = is_arg;
 	is_arg = 0;
@@ -68,9 +74,7 @@ static uint64_t count_directory(char * source) {
 			ent = readdir(dirp);
 			continue;
 		}
-		char tmp[strlen(source)+strlen(ent->d_name)+2];
-		sprintf(tmp, "%s/%s", source, ent->d_name);
-		total += count_thing(tmp);
+		total += count_thing(fd, ent->d_name, source);
 		ent = readdir(dirp);
 	}
 	closedir(dirp);
@@ -82,14 +86,17 @@ static uint64_t count_directory(char * source) {
 	return total;
 }
 
-static uint64_t count_thing(char * tmp) {
+static uint64_t count_thing(int dirfd, char * name, char * path) {
 	struct stat statbuf;
-	lstat(tmp,&statbuf);
+	fstatat(dirfd, name, &statbuf, AT_SYMLINK_NOFOLLOW);
 	if (S_ISDIR(statbuf.st_mode)) {
-		return count_directory(tmp);
+		if (!path) return count_directory(dirfd, name, name);
+		char tmp[strlen(path)+strlen(name)+2];
+		sprintf(tmp, "%s/%s", path, name);
+		return count_directory(dirfd, name, tmp);
 	} else {
 		if (is_arg) {
-			print_size(statbuf.st_size, tmp);
+			print_size(statbuf.st_size, name);
 		}
 		return statbuf.st_size;
 	}
@@ -120,7 +127,7 @@ int main(int argc, char * argv[]) {
 
 	for (int i = optind; i < argc; ++i) {
 		is_arg = 1;
-		total += count_thing(argv[i]);
+		total += count_thing(AT_FDCWD, argv[i], NULL);
 	}
 
 	if (show_total) {
@@ -297,8 +297,8 @@ static void draw_file(struct File * f, int offset) {
 		if (f->selected) {
 			struct gradient_definition edge = {FILE_HEIGHT - 4, y+2, HILIGHT_BORDER_TOP, HILIGHT_BORDER_BOTTOM};
 			struct gradient_definition body = {FILE_HEIGHT - 6, y+3, HILIGHT_GRADIENT_TOP, HILIGHT_GRADIENT_BOTTOM};
-			draw_rounded_rectangle_pattern(contents, x + 2,y + 2, FILE_WIDTH-4, FILE_HEIGHT-4, 3, gfx_vertical_gradient_pattern, &edge);
-			draw_rounded_rectangle_pattern(contents, x + 3,y + 3, FILE_WIDTH-6, FILE_HEIGHT-6, 4, gfx_vertical_gradient_pattern, &body);
+			draw_rounded_rectangle_span(contents, x + 2,y + 2, FILE_WIDTH-4, FILE_HEIGHT-4, 3, gfx_vertical_gradient_span, &edge);
+			draw_rounded_rectangle_span(contents, x + 3,y + 3, FILE_WIDTH-6, FILE_HEIGHT-6, 4, gfx_vertical_gradient_span, &body);
 
 			text_color = rgb(255,255,255);
 		}
@@ -341,8 +341,8 @@ static void draw_file(struct File * f, int offset) {
 		if (f->selected) {
 			struct gradient_definition edge = {FILE_HEIGHT - 4, y+2, HILIGHT_BORDER_TOP, HILIGHT_BORDER_BOTTOM};
 			struct gradient_definition body = {FILE_HEIGHT - 6, y+3, HILIGHT_GRADIENT_TOP, HILIGHT_GRADIENT_BOTTOM};
-			draw_rounded_rectangle_pattern(contents, x + 2,y + 2, FILE_WIDTH-4, FILE_HEIGHT-4, 3, gfx_vertical_gradient_pattern, &edge);
-			draw_rounded_rectangle_pattern(contents, x + 3,y + 3, FILE_WIDTH-6, FILE_HEIGHT-6, 4, gfx_vertical_gradient_pattern, &body);
+			draw_rounded_rectangle_span(contents, x + 2,y + 2, FILE_WIDTH-4, FILE_HEIGHT-4, 3, gfx_vertical_gradient_span, &edge);
+			draw_rounded_rectangle_span(contents, x + 3,y + 3, FILE_WIDTH-6, FILE_HEIGHT-6, 4, gfx_vertical_gradient_span, &body);
 
 			text_color = rgb(255,255,255);
 		} else if (offset == hilighted_offset) {
@@ -350,11 +350,7 @@ static void draw_file(struct File * f, int offset) {
 			draw_rounded_rectangle(contents, x + 3, y + 3, FILE_WIDTH - 6, FILE_HEIGHT - 6, 4, rgb(255,255,255));
 		}
 
-		if (icon->width != 16 || icon->height != 16) {
-			draw_sprite_scaled(contents, icon, x + 4, y + 4, 16, 16);
-		} else {
-			draw_sprite(contents, icon, x + 4, y + 4);
-		}
+		draw_sprite(contents, icon_get_scaled(icon, 16, 16), x + 4, y + 4);
 
 		char * name = ellipsify(f->name, 13, tt_font_thin, FILE_WIDTH - 26, NULL);
 
@@ -951,11 +947,11 @@ static void _draw_nav_bar(struct decor_bounds bounds) {
 	/* Draw input box */
 	if (nav_bar_focused) {
 		struct gradient_definition edge = {28, bounds.top_height + menu_bar_height + 3, rgb(0,120,220), rgb(0,120,220)};
-		draw_rounded_rectangle_pattern(ctx, bounds.left_width + 2 + x + 1, bounds.top_height + menu_bar_height + 4, main_window->width - bounds.width - x - 6, 26, 4, gfx_vertical_gradient_pattern, &edge);
+		draw_rounded_rectangle_span(ctx, bounds.left_width + 2 + x + 1, bounds.top_height + menu_bar_height + 4, main_window->width - bounds.width - x - 6, 26, 4, gfx_vertical_gradient_span, &edge);
 		draw_rounded_rectangle(ctx, bounds.left_width + 2 + x + 3, bounds.top_height + menu_bar_height + 6, main_window->width - bounds.width - x - 10, 22, 2, rgb(250,250,250));
 	} else {
 		struct gradient_definition edge = {28, bounds.top_height + menu_bar_height + 3, rgb(90,90,90), rgb(110,110,110)};
-		draw_rounded_rectangle_pattern(ctx, bounds.left_width + 2 + x + 1, bounds.top_height + menu_bar_height + 4, main_window->width - bounds.width - x - 6, 26, 4, gfx_vertical_gradient_pattern, &edge);
+		draw_rounded_rectangle_span(ctx, bounds.left_width + 2 + x + 1, bounds.top_height + menu_bar_height + 4, main_window->width - bounds.width - x - 6, 26, 4, gfx_vertical_gradient_span, &edge);
 		draw_rounded_rectangle(ctx, bounds.left_width + 2 + x + 2, bounds.top_height + menu_bar_height + 5, main_window->width - bounds.width - x - 8, 24, 3, rgb(250,250,250));
 	}
 
@@ -1299,10 +1295,14 @@ static void draw_background(int width, int height) {
 		draw_sprite(ctx, wallpaper, 0, 0);
 	} else if (nw >= width) {
 		/* Scaled wallpaper is wider, height should match. */
-		draw_sprite_scaled(ctx, wallpaper, ((int)width - nw) / 2, 0, nw+2, height);
+		sprite_t * scaled = gfx_sprite_resample(wallpaper, nw+2, height);
+		draw_sprite(ctx, scaled, ((int)width - nw) / 2, 0);
+		sprite_free(scaled);
 	} else {
 		/* Scaled wallpaper is taller, width should match. */
-		draw_sprite_scaled(ctx, wallpaper, 0, ((int)height - nh) / 2, width+2, nh);
+		sprite_t * scaled = gfx_sprite_resample(wallpaper, width+2, nh);
+		draw_sprite(ctx, scaled, 0, ((int)height - nh) / 2);
+		sprite_free(scaled);
 	}
 
 	/* Free the original wallpaper. */
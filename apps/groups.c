@@ -11,27 +11,37 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pwd.h>
+#include <grp.h>
 
-int main(int argc, char ** argv) {
-	/* First print our egid group */
-	struct passwd * p = getpwuid(getegid());
+static void print_group(gid_t gid) {
+	struct group * g = getgrgid(gid);
+	if (g) {
+		fprintf(stdout, "%s ", g->gr_name);
+		return;
+	}
+
+	/* Users' own groups share their uid and are not listed in /etc/group */
+	struct passwd * p = getpwuid(gid);
 	if (p) {
 		fprintf(stdout, "%s ", p->pw_name);
+	} else {
+		fprintf(stdout, "%d ", gid);
 	}
+}
+
+int main(int argc, char ** argv) {
+	/* First print our egid group */
+	print_group(getegid());
 	/* Then get the group list. */
 	int groupCount = getgroups(0, NULL);
 	if (groupCount) {
 		gid_t * myGroups = malloc(sizeof(gid_t) * groupCount);
 		groupCount = getgroups(groupCount, myGroups);
 		for (int i = 0; i < groupCount; ++i) {
-			p = getpwuid(myGroups[i]);
-			if (p) {
-				fprintf(stdout, "%s ", p->pw_name);
-			}
+			print_group(myGroups[i]);
 		}
 	}
 	fprintf(stdout,"\n");
-	endpwent();
 	return 0;
 }
 
@@ -102,7 +102,7 @@ static void redraw(char * username, char * password, int fails, char * argv[]) {
 	}
 
 	struct gradient_definition edge = {30, 114, rgb(0,120,220), rgb(0,120,220)};
-	draw_rounded_rectangle_pattern(myctx, 30, 120, prompt->width - 70, 26, 4, gfx_vertical_gradient_pattern, &edge);
+	draw_rounded_rectangle_span(myctx, 30, 120, prompt->width - 70, 26, 4, gfx_vertical_gradient_span, &edge);
 	draw_rounded_rectangle(myctx, 32, 122, prompt->width - 74, 22, 3, rgb(250,250,250));
 
 	char password_circles[512] = {0};;
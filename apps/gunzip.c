@@ -87,7 +87,10 @@ int main(int argc, char * argv[]) {
 	ctx.write_output = _write;
 	ctx.ring = NULL; /* Use the global one */
 
-	if (gzip_decompress(&ctx)) {
+	int status = gzip_decompress(&ctx);
+	if (status) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], optind < argc ? argv[optind] : "stdin",
+			status == 2 ? "checksum or size does not match" : "not in gzip format");
 		return 1;
 	}
 
@@ -11,6 +11,29 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <toaru/blockread.h>
+
+/* Copy the first @p lines lines of @p fd to stdout. */
+static int head_file(int fd, size_t lines) {
+	block_reader_t * reader = block_reader_open(fd, 0);
+	if (!reader) return ENOMEM;
+
+	int error = 0;
+	char * data;
+	ssize_t len = 0;
+	while (lines && (len = block_reader_next(reader, &data)) > 0) {
+		size_t end = block_skip_lines(data, len, &lines);
+		if (block_write_all(STDOUT_FILENO, data, end) < 0) {
+			error = errno;
+			break;
+		}
+	}
+
+	if (len < 0) error = reader->error;
+	block_reader_close(reader);
+	return error;
+}
 
 int main(int argc, char * argv[]) {
 	int n = 10;
@@ -38,33 +61,26 @@ int main(int argc, char * argv[]) {
 	}
 
 	for (int i = optind; i < argc; ++i) {
-		FILE * f = (!strcmp(argv[i],"-")) ? stdin : fopen(argv[i],"r");
-		if (!f) {
+		int fd = (!strcmp(argv[i],"-")) ? STDIN_FILENO : open(argv[i],O_RDONLY);
+		if (fd < 0) {
 			fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], strerror(errno));
 			retval = 1;
 			continue;
 		}
 
 		if (print_names) {
-			fprintf(stdout, "==> %s <==\n", (f == stdin) ? "standard input" : argv[i]);
+			fprintf(stdout, "==> %s <==\n", (fd == STDIN_FILENO) ? "standard input" : argv[i]);
+			fflush(stdout);
 		}
 
-		int line = 1;
-
-		while (!feof(f)) {
-			int c = fgetc(f);
-			if (c >= 0) {
-				fputc(c, stdout);
-
-				if (c == '\n') {
-					line++;
-					if (line > n) break;
-				}
-			}
+		int error = head_file(fd, n > 0 ? n : 0);
+		if (error) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], strerror(error));
+			retval = 1;
 		}
 
-		if (f != stdin) {
-			fclose(f);
+		if (fd != STDIN_FILENO) {
+			close(fd);
 		}
 	}
 
@@ -20,7 +20,7 @@
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
 #include <toaru/text.h>
-#include <toaru/markup.h>
+#include <toaru/markup_text.h>
 
 #define APPLICATION_TITLE "Help Browser"
 #define HELP_DIR "/usr/share/help"
@@ -34,194 +34,15 @@ static int application_running = 1;
 static gfx_context_t * contents = NULL;
 static sprite_t * contents_sprite = NULL;
 static int contents_width = 0;
+static int contents_offset = -1; /* scroll offset currently rendered into contents, or -1 */
 
 static char * current_topic = NULL;
+static markup_layout_t * layout = NULL;
+static int document_height = 0;
 static int scroll_offset;
 
-/* Markup Renderer { */
 #define BASE_X 2
 #define BASE_Y 2
-#define LINE_HEIGHT 20
-#define HEAD_HEIGHT 28
-
-static int cursor_y = 0;
-static int cursor_x = 0;
-static list_t * state = NULL;
-static int current_state = 0;
-
-static struct TT_Font * tt_font_thin = NULL;
-static struct TT_Font * tt_font_bold = NULL;
-static struct TT_Font * tt_font_oblique = NULL;
-static struct TT_Font * tt_font_bold_oblique = NULL;
-static struct TT_Font * tt_font_mono = NULL;
-
-struct Char {
-	char c; /* TODO: unicode */
-	char state;
-};
-
-//static list_t * lines = NULL;
-static list_t * buffer = NULL;
-
-static struct TT_Font * state_to_font(int current_state) {
-	if (current_state & (1 << 3)) {
-		return tt_font_mono;
-	}
-	if (current_state & (1 << 0 | 1 << 2) ) {
-		if (current_state & (1 << 1)) {
-			return tt_font_bold_oblique;
-		}
-		return tt_font_bold;
-	} else if (current_state & (1 << 1)) {
-		return tt_font_oblique;
-	}
-	return tt_font_thin;
-}
-
-static int current_size(void) {
-	if (current_state & (1 << 2)) {
-		return 22;
-	}
-	return 13;
-}
-
-static int buffer_width(list_t * buffer) {
-	int out = 0;
-	foreach(node, buffer) {
-		struct Char * c = node->value;
-
-		char tmp[2] = {c->c, '\0'};
-
-		tt_set_size(state_to_font(c->state), current_size());
-		out += tt_string_width(state_to_font(c->state), tmp);
-	}
-	return out;
-}
-
-static int draw_buffer(list_t * buffer) {
-	int x = 0;
-	while (buffer->length) {
-		node_t * node = list_dequeue(buffer);
-		struct Char * c = node->value;
-		char tmp[2] = { c->c, '\0' };
-		tt_set_size(state_to_font(c->state), current_size());
-		if (contents) {
-			x += tt_draw_string(contents, state_to_font(c->state), cursor_x + x, cursor_y + current_size(), tmp, 0xFF000000);
-		} else {
-			x += tt_string_width(state_to_font(c->state), tmp);
-		}
-		free(c);
-		free(node);
-	}
-	x += 4;
-	return x;
-}
-
-static int current_line_height(void) {
-	if (current_state & (1 << 2)) {
-		return HEAD_HEIGHT;
-	} else {
-		return LINE_HEIGHT;
-	}
-}
-
-static void write_buffer(void) {
-	if (buffer_width(buffer) + cursor_x > contents_width) {
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-	}
-	cursor_x += draw_buffer(buffer);
-}
-
-static int parser_open(struct markup_state * self, void * user, struct markup_tag * tag) {
-	if (!strcmp(tag->name, "b")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 0);
-	} else if (!strcmp(tag->name, "i")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 1);
-	} else if (!strcmp(tag->name, "h1")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 2);
-	} else if (!strcmp(tag->name, "br")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-	} else if (!strcmp(tag->name, "mono")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 3);
-	}
-	markup_free_tag(tag);
-	return 0;
-}
-
-static int parser_close(struct markup_state * self, void * user, char * tag_name) {
-	if (!strcmp(tag_name, "b")) {
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "i")) {
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "mono")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "h1")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	}
-	return 0;
-}
-
-static int parser_data(struct markup_state * self, void * user, char * data) {
-	char * c = data;
-	while (*c) {
-		if (*c == ' ' && !(current_state & (1 << 3))) {
-			if (buffer->length) {
-				write_buffer();
-			}
-		} else if (*c == '\n') {
-			if (buffer->length) {
-				write_buffer();
-			}
-			if (current_state & (1 << 3)) {
-				cursor_x = BASE_X;
-				cursor_y += current_line_height();
-			}
-		} else {
-			int chr = *c;
-			if (*c == '&') {
-				if (c[1] == 'l' && c[2] == 't' && c[3] == ';') {
-					c += 3;
-					chr = '<';
-				} else if (c[1] == 'g' && c[2] == 't' && c[3] == ';') {
-					c += 3;
-					chr = '>';
-				}
-			}
-			struct Char * ch = malloc(sizeof(struct Char));
-			ch->c = chr;
-			ch->state = current_state;
-			list_insert(buffer, ch);
-		}
-		c++;
-	}
-	return 0;
-}
-
-/* } End Markup Renderer */
 
 static struct menu_bar menu_bar = {0};
 static struct menu_bar_entries menu_entries[] = {
@@ -235,72 +56,78 @@ static void _menu_action_exit(struct MenuEntry * entry) {
 	application_running = 0;
 }
 
+/**
+ * Lay out the current topic for the current window width. The layout
+ * is kept until the topic or the width changes.
+ */
 static void reinitialize_contents(void) {
-	if (contents) {
-		free(contents);
-	}
-
-	if (contents_sprite) {
-		sprite_free(contents_sprite);
-	}
-
 	struct decor_bounds bounds;
 	decor_get_bounds(main_window, &bounds);
-	contents = NULL;
 	contents_width = main_window->width - bounds.width;
 
-	{
-		struct markup_state * parser = markup_init(NULL, parser_open, parser_close, parser_data);
-		cursor_y = BASE_Y;
-		cursor_x = BASE_X;
-		state = list_create();
-		buffer = list_create();
-
-		char * str = current_topic;
-		while (*str) {
-			if (markup_parse(parser, *str++)) {
-				fprintf(stderr,"There was an error.\n");
-				return;
-			}
-		}
+	markup_layout_free(layout);
+	layout = markup_layout_create(current_topic, contents_width - BASE_X, MARKUP_LAYOUT_DOCUMENT);
+	document_height = BASE_Y + markup_layout_height(layout) + 40;
+	contents_offset = -1;
+}
 
-		markup_finish(parser);
-		write_buffer();
-		list_free(state);
-		free(state);
-		free(buffer);
-	}
+/**
+ * Draw the part of the document that belongs in rows [top,top+height)
+ * of the viewport.
+ */
+static void render_rows(int top, int height) {
+	gfx_context_t * band = init_graphics_subregion(contents, 0, top, contents->width, height);
+	draw_fill(band, rgb(255,255,255));
+	markup_layout_draw(band, layout, BASE_X, BASE_Y - scroll_offset - top, 0xFF000000);
+	free(band);
+}
 
-	contents_sprite = create_sprite(contents_width, cursor_y + current_size() + 20, ALPHA_EMBEDDED);
-	contents = init_graphics_sprite(contents_sprite);
+/**
+ * Bring the viewport up to date with the scroll offset. When scrolling,
+ * rows that are still visible are moved, and only the newly exposed
+ * lines are rendered.
+ */
+static void update_contents(int width, int height) {
+	if (!contents || contents->width != width || contents->height != height) {
+		if (contents) free(contents);
+		if (contents_sprite) sprite_free(contents_sprite);
+		contents_sprite = create_sprite(width, height, ALPHA_OPAQUE);
+		contents = init_graphics_sprite(contents_sprite);
+		contents_offset = -1;
+	}
 
-	draw_fill(contents, rgb(255,255,255));
+	int delta = scroll_offset - contents_offset;
+	if (contents_offset < 0 || abs(delta) >= height) {
+		render_rows(0, height);
+	} else if (delta > 0) {
+		memmove(&GFX(contents,0,0), &GFX(contents,0,delta), (height - delta) * GFX_S(contents));
+		render_rows(height - delta, delta);
+	} else if (delta < 0) {
+		memmove(&GFX(contents,0,-delta), &GFX(contents,0,0), (height + delta) * GFX_S(contents));
+		render_rows(0, -delta);
+	}
+	contents_offset = scroll_offset;
+}
 
-	{
-		struct markup_state * parser = markup_init(NULL, parser_open, parser_close, parser_data);
-		cursor_y = BASE_Y;
-		cursor_x = BASE_X;
-		state = list_create();
-		buffer = list_create();
+/**
+ * Render the viewport and copy it into the window.
+ */
+static void draw_contents(void) {
+	struct decor_bounds bounds;
+	decor_get_bounds(main_window, &bounds);
+	int height = ctx->height - MENU_BAR_HEIGHT - bounds.height;
+	if (height <= 0 || contents_width <= 0) return;
 
-		char * str = current_topic;
-		while (*str) {
-			if (markup_parse(parser, *str++)) {
-				fprintf(stderr,"There was an error.\n");
-				return;
-			}
-		}
+	update_contents(contents_width, height);
 
-		markup_finish(parser);
-		write_buffer();
-		list_free(state);
-		free(state);
-		free(buffer);
+	for (int y = 0; y < height; ++y) {
+		memcpy(&GFX(ctx, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT + y),
+			&GFX(contents, 0, y), contents_width * sizeof(uint32_t));
 	}
 }
 
 static void redraw_window(void) {
-	draw_fill(ctx, rgb(255,255,255));
+	draw_contents();
 
 	render_decorations(main_window, ctx, APPLICATION_TITLE);
 
@@ -313,14 +140,29 @@ static void redraw_window(void) {
 	menu_bar.window = main_window;
 	menu_bar_render(&menu_bar, ctx);
 
+	flip(ctx);
+	yutani_flip(yctx, main_window);
+}
+
+/**
+ * Redraw after scrolling: the menu bar is untouched, so only
+ * the rows below it need to be sent to the compositor.
+ */
+static void redraw_scrolled(void) {
+	draw_contents();
+	render_decorations(main_window, ctx, APPLICATION_TITLE);
+
+	struct decor_bounds bounds;
+	decor_get_bounds(main_window, &bounds);
+	int top = bounds.top_height + MENU_BAR_HEIGHT;
+
 	gfx_clear_clip(ctx);
-	gfx_add_clip(ctx, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT, ctx->width - bounds.width, ctx->height - MENU_BAR_HEIGHT - bounds.height);
-	draw_sprite(ctx, contents_sprite, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT - scroll_offset);
+	gfx_add_clip(ctx, 0, top, ctx->width, ctx->height - top);
+	flip(ctx);
 	gfx_clear_clip(ctx);
 	gfx_add_clip(ctx, 0, 0, ctx->width, ctx->height);
 
-	flip(ctx);
-	yutani_flip(yctx, main_window);
+	yutani_flip_region(yctx, main_window, 0, top, ctx->width, ctx->height - top);
 }
 
 static void resize_finish(int w, int h) {
@@ -441,12 +283,12 @@ static void _scroll_down(void) {
 	decor_get_bounds(main_window, &bounds);
 	int available_height = main_window->height - bounds.height - MENU_BAR_HEIGHT;
 
-	if (available_height > contents->height) {
+	if (available_height > document_height) {
 		scroll_offset = 0;
 	} else {
 		scroll_offset += SCROLL_AMOUNT;
-		if (scroll_offset > contents->height - available_height) {
-			scroll_offset = contents->height - available_height;
+		if (scroll_offset > document_height - available_height) {
+			scroll_offset = document_height - available_height;
 		}
 	}
 }
@@ -492,11 +334,7 @@ int main(int argc, char * argv[]) {
 	yutani_window_move(yctx, main_window, yctx->display_width / 2 - main_window->width / 2, yctx->display_height / 2 - main_window->height / 2);
 	ctx = init_graphics_yutani_double_buffer(main_window);
 
-	tt_font_thin         = tt_font_from_shm("sans-serif");
-	tt_font_bold         = tt_font_from_shm("sans-serif.bold");
-	tt_font_oblique      = tt_font_from_shm("sans-serif.italic");
-	tt_font_bold_oblique = tt_font_from_shm("sans-serif.bolditalic");
-	tt_font_mono         = tt_font_from_shm("monospace");
+	markup_text_init();
 
 	yutani_window_advertise_icon(yctx, main_window, APPLICATION_TITLE, "help");
 
@@ -616,10 +454,10 @@ int main(int argc, char * argv[]) {
 								if (me->buttons & YUTANI_MOUSE_SCROLL_UP) {
 									/* Scroll up */
 									_scroll_up();
-									redraw_window();
+									redraw_scrolled();
 								} else if (me->buttons & YUTANI_MOUSE_SCROLL_DOWN) {
 									_scroll_down();
-									redraw_window();
+									redraw_scrolled();
 								}
 							}
 						}
@@ -27,11 +27,31 @@
  * So if you wish to run daemons, be sure to fork them off and then
  * exit so that the rest of the startup process can continue.
  *
+ * A script may instead declare what it needs in comments at its top:
+ *
+ *   # provides: network
+ *   # requires: modules tmpfs
+ *   # background
+ *
+ * Scripts with such a header start as soon as every script providing
+ * something they require has finished - rather than waiting for every
+ * script sorted before them - so independent scripts run at the same
+ * time, up to one per core. Every script also provides its own file
+ * name. Scripts without a header still wait for everything before them.
+ *
+ * A `background` script is expected to run for a while without holding
+ * anything up: it doesn't count against the limit of scripts running at
+ * once, and `init` won't wait for it before rebooting. Any script can
+ * say it is ready before it exits by writing "ready NAME" to the packet
+ * exchange endpoint /dev/pex/init; scripts requiring NAME then start.
+ *
  * When the last startup script finishes, `init` will reboot the system.
  */
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,8 +59,34 @@
 #include <unistd.h>
 #include <wait.h>
 #include <sys/wait.h>
+#include <sys/fswait.h>
+#include <toaru/pex.h>
 
 #define INITD_PATH "/etc/startup.d"
+#define MAX_NAMES 16
+
+enum {
+	SERVICE_WAITING,
+	SERVICE_RUNNING,
+	SERVICE_DONE,
+};
+
+struct service {
+	char name[256];
+	char * header;
+	char * provides[MAX_NAMES];
+	char * requires[MAX_NAMES];
+	int provides_count;
+	int requires_count;
+	int has_header;
+	int background;
+	int state;
+	pid_t pid;
+};
+
+static struct service * services;
+static int service_count = 0;
+static int pex_endpoint = -1;
 
 /* Initialize fd 0, 1, 2 */
 void set_console(void) {
@@ -49,13 +95,10 @@ void set_console(void) {
 	syscall_open("/dev/null", 1, 0);
 }
 
-/* Run a startup script and wait for it to finish */
-int start_options(char * args[]) {
-
-	/* Fork child to run script */
+/* Run a startup script without waiting for it */
+static int spawn(char * args[]) {
 	int cpid = syscall_fork();
 
-	/* Child process... */
 	if (!cpid) {
 		/* Pass environment from init to child */
 		syscall_execve(args[0], args, environ);
@@ -63,6 +106,15 @@ int start_options(char * args[]) {
 		syscall_exit(0);
 	}
 
+	return cpid;
+}
+
+/* Run a startup script and wait for it to finish */
+int start_options(char * args[]) {
+
+	/* Fork child to run script */
+	int cpid = spawn(args);
+
 	/* Wait for the child process to finish */
 	int pid = 0;
 	do {
@@ -88,6 +140,227 @@ int start_options(char * args[]) {
 	return cpid;
 }
 
+/* Split a header line into whitespace-separated names */
+static void parse_names(char * line, char ** names, int * count) {
+	while (*line) {
+		while (*line == ' ' || *line == '\t') line++;
+		if (!*line) break;
+		if (*count < MAX_NAMES) names[(*count)++] = line;
+		while (*line && *line != ' ' && *line != '\t') line++;
+		if (*line) *line++ = '\0';
+	}
+}
+
+/**
+ * Read the provides/requires/background header from the leading
+ * comment block of a script. Binaries and scripts without any of
+ * these lines are left with no header.
+ */
+static void read_header(struct service * service) {
+	char path[512];
+	sprintf(path, INITD_PATH "/%s", service->name);
+
+	service->provides[service->provides_count++] = service->name;
+
+	int fd = syscall_open(path, O_RDONLY, 0);
+	if (fd < 0) return;
+	char * buf = malloc(1025);
+	int r = syscall_read(fd, buf, 1024);
+	syscall_close(fd);
+	if (r <= 0) {
+		free(buf);
+		return;
+	}
+	buf[r] = '\0';
+	service->header = buf;
+
+	char * line = buf;
+	while (*line == '#') {
+		char * next = strchr(line, '\n');
+		if (next) *next++ = '\0';
+		else next = line + strlen(line);
+
+		char * key = line + 1;
+		while (*key == ' ' || *key == '\t') key++;
+
+		if (!strncmp(key, "provides:", 9)) {
+			parse_names(key + 9, service->provides, &service->provides_count);
+			service->has_header = 1;
+		} else if (!strncmp(key, "requires:", 9)) {
+			parse_names(key + 9, service->requires, &service->requires_count);
+			service->has_header = 1;
+		} else if (!strncmp(key, "background", 10)) {
+			service->background = 1;
+			service->has_header = 1;
+		}
+
+		line = next;
+		/* Blank lines don't end the header */
+		while (*line == '\n') line++;
+	}
+}
+
+static int provides(struct service * service, const char * name) {
+	for (int i = 0; i < service->provides_count; ++i) {
+		if (!strcmp(service->provides[i], name)) return 1;
+	}
+	return 0;
+}
+
+static int can_start(int index) {
+	struct service * service = &services[index];
+
+	if (!service->has_header) {
+		/* Old-style script: everything sorted before it must be finished */
+		for (int i = 0; i < index; ++i) {
+			if (services[i].state != SERVICE_DONE) return 0;
+		}
+		return 1;
+	}
+
+	/* Requirements nothing provides are ignored */
+	for (int r = 0; r < service->requires_count; ++r) {
+		for (int i = 0; i < service_count; ++i) {
+			if (i == index) continue;
+			if (services[i].state != SERVICE_DONE && provides(&services[i], service->requires[r])) return 0;
+		}
+	}
+	return 1;
+}
+
+static void start_service(struct service * service) {
+	char path[512];
+	sprintf(path, INITD_PATH "/%s", service->name);
+	service->pid = spawn((char *[]){path, NULL});
+	service->state = service->pid > 0 ? SERVICE_RUNNING : SERVICE_DONE;
+}
+
+static void start_services(int max_running) {
+	int running = 0, waiting = 0;
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].state == SERVICE_RUNNING && !services[i].background) running++;
+	}
+
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].state != SERVICE_WAITING) continue;
+		if (!can_start(i)) {
+			waiting++;
+			continue;
+		}
+		if (!services[i].background) {
+			if (running >= max_running) {
+				waiting++;
+				continue;
+			}
+			running++;
+		}
+		start_service(&services[i]);
+	}
+
+	/* Nothing can make progress: a cycle, or a requirement on ourselves. Break it in sorted order. */
+	if (waiting && !running) {
+		int any_background = 0;
+		for (int i = 0; i < service_count; ++i) {
+			if (services[i].state == SERVICE_RUNNING) any_background = 1;
+		}
+		if (!any_background) {
+			for (int i = 0; i < service_count; ++i) {
+				if (services[i].state == SERVICE_WAITING) {
+					start_service(&services[i]);
+					break;
+				}
+			}
+		}
+	}
+}
+
+static void service_exited(pid_t pid) {
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].pid == pid && services[i].state == SERVICE_RUNNING) {
+			services[i].state = SERVICE_DONE;
+		}
+	}
+}
+
+static void service_ready(char * name) {
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].state == SERVICE_RUNNING && provides(&services[i], name)) {
+			services[i].state = SERVICE_DONE;
+		}
+	}
+}
+
+/* Handle one "ready NAME" message from /dev/pex/init */
+static void read_message(void) {
+	char buf[PACKET_SIZE + 1];
+	int r = syscall_read(pex_endpoint, buf, PACKET_SIZE);
+	if (r < (int)sizeof(pex_packet_t)) return;
+
+	pex_packet_t * packet = (pex_packet_t *)buf;
+	char * msg = (char *)packet->data;
+	size_t size = packet->size < MAX_PACKET_SIZE ? packet->size : MAX_PACKET_SIZE;
+	msg[size] = '\0';
+	while (size && (msg[size-1] == '\n' || msg[size-1] == ' ')) msg[--size] = '\0';
+
+	if (!strncmp(msg, "ready ", 6)) {
+		service_ready(msg + 6);
+	}
+}
+
+/* Is anything left that has to finish before we reboot? */
+static int startup_finished(void) {
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].state == SERVICE_WAITING) return 0;
+		if (services[i].state == SERVICE_RUNNING && !services[i].background) return 0;
+	}
+	return 1;
+}
+
+/* Could a ready message let something start? */
+static int awaiting_ready(void) {
+	int running = 0, waiting = 0;
+	for (int i = 0; i < service_count; ++i) {
+		if (services[i].state == SERVICE_RUNNING) running = 1;
+		if (services[i].state == SERVICE_WAITING) waiting = 1;
+	}
+	return running && waiting;
+}
+
+static void run_services(void) {
+	cpu_set_t cpus;
+	int max_running = 1;
+	if (!sched_getaffinity(0, sizeof(cpus), &cpus) && CPU_COUNT(&cpus) > 1) {
+		max_running = CPU_COUNT(&cpus);
+	}
+
+	pex_endpoint = syscall_open("/dev/pex/init", O_CREAT | O_EXCL | O_RDWR | O_APPEND, 0);
+
+	while (1) {
+		start_services(max_running);
+		if (startup_finished()) break;
+
+		if (pex_endpoint >= 0 && awaiting_ready()) {
+			/* Watch for ready messages while collecting children */
+			int fds[] = {pex_endpoint};
+			if (fswait2(1, fds, 10) == 0) read_message();
+			int pid;
+			while ((pid = waitpid(-1, NULL, WNOKERN | WNOHANG)) > 0) {
+				service_exited(pid);
+			}
+		} else {
+			int pid = waitpid(-1, NULL, WNOKERN);
+			if (pid > 0) {
+				service_exited(pid);
+			} else if (pid == -1 && errno == ECHILD) {
+				/* Lost track of something; don't wait forever. */
+				for (int i = 0; i < service_count; ++i) {
+					if (services[i].state == SERVICE_RUNNING) services[i].state = SERVICE_DONE;
+				}
+			}
+		}
+	}
+}
+
 int main(int argc, char * argv[]) {
 	/* Initialize stdin/out/err */
 	set_console();
@@ -121,14 +394,17 @@ int main(int argc, char * argv[]) {
 		}
 		qsort(entries, count, sizeof(struct dirent), comparator);
 
-		/* Run scripts */
+		/* Collect scripts and their headers */
+		services = calloc(count, sizeof(struct service));
 		for (int i = 0; i < count; ++i) {
 			if (entries[i].d_name[0] != '.') {
-				char path[256];
-				sprintf(path, "/etc/startup.d/%s", entries[i].d_name);
-				start_options((char *[]){path, NULL});
+				struct service * service = &services[service_count++];
+				strcpy(service->name, entries[i].d_name);
+				read_header(service);
 			}
 		}
+
+		run_services();
 	}
 
 	/* Self-explanatory */
@@ -20,6 +20,7 @@
 #include <termios.h>
 #include <time.h>
 #include <pwd.h>
+#include <grp.h>
 #include <errno.h>
 
 #include <sys/ioctl.h>
@@ -128,10 +129,11 @@ static void print_entry(struct tfile * file, int colwidth) {
 static int print_username(char * _out, int uid) {
 
 	TRACE("getpwuid");
-	struct passwd * p = getpwuid(uid);
+	struct passwd pwd, * p;
+	char buf[1024];
 	int out = 0;
 
-	if (p) {
+	if (!getpwuid_r(uid, &pwd, buf, sizeof(buf), &p) && p) {
 		TRACE("p is set");
 		out = sprintf(_out, "%s", p->pw_name);
 	} else {
@@ -139,11 +141,21 @@ static int print_username(char * _out, int uid) {
 		out = sprintf(_out, "%d", uid);
 	}
 
-	endpwent();
-
 	return out;
 }
 
+static int print_groupname(char * _out, int gid) {
+	struct group grp, * g;
+	char buf[1024];
+
+	if (!getgrgid_r(gid, &grp, buf, sizeof(buf), &g) && g) {
+		return sprintf(_out, "%s", g->gr_name);
+	}
+
+	/* Users' own groups share their uid and are not listed in /etc/group */
+	return print_username(_out, gid);
+}
+
 static int print_human_readable_size(char * _out, size_t s) {
 	if (s >= 1<<20) {
 		size_t t = s / (1 << 20);
@@ -172,7 +184,7 @@ static void update_column_widths(int * widths, struct tfile * file) {
 
 	/* Group */
 	TRACE("group");
-	n = print_username(tmp, file->statbuf.st_gid);
+	n = print_groupname(tmp, file->statbuf.st_gid);
 	if (n > widths[2]) widths[2] = n;
 
 	/* File size */
@@ -213,7 +225,7 @@ static void print_entry_long(int * widths, struct tfile * file) {
 	char tmp[100];
 	print_username(tmp, file->statbuf.st_uid);
 	printf("%-*s ", widths[1], tmp);
-	print_username(tmp, file->statbuf.st_gid);
+	print_groupname(tmp, file->statbuf.st_gid);
 	printf("%-*s ", widths[2], tmp);
 
 	if (human_readable) {
@@ -311,8 +323,11 @@ static int display_dir(char * p) {
 		printf("%s:\n", p);
 	}
 
-	/* Read the entries in the directory */
+	/* Read the entries in the directory; entries are looked up
+	 * relative to it, rather than by building and walking a path
+	 * for each one. */
 	list_t * ents_list = list_create();
+	int dfd = dirfd(dirp);
 
 	TRACE("reading entries");
 	struct dirent * ent = readdir(dirp);
@@ -322,13 +337,11 @@ static int display_dir(char * p) {
 
 			f->name = strdup(ent->d_name);
 
-			char tmp[strlen(p)+strlen(ent->d_name)+2];
-			sprintf(tmp, "%s/%s", p, ent->d_name);
-			lstat(tmp, &f->statbuf);
+			fstatat(dfd, ent->d_name, &f->statbuf, AT_SYMLINK_NOFOLLOW);
 			if (S_ISLNK(f->statbuf.st_mode)) {
-				stat(tmp, &f->statbufl);
+				fstatat(dfd, ent->d_name, &f->statbufl, 0);
 				f->link = malloc(4096);
-				readlink(tmp, f->link, 4096);
+				readlinkat(dfd, ent->d_name, f->link, 4096);
 			}
 
 			list_insert(ents_list, (void *)f);
@@ -31,7 +31,7 @@
 	if (_debug) { TRACE(__VA_ARGS__); } \
 } while (0)
 
-#define CHUNK_SIZE 4096
+#define CHUNK_SIZE (128 * 1024)
 
 static int _debug = 0;
 static FILE * _splash = NULL;
@@ -74,14 +74,22 @@ void copy_file(char * source, char * dest, int mode,int uid, int gid) {
 
 	//fprintf(stderr, "%d bytes to copy\n", length);
 
-	char buf[CHUNK_SIZE];
-
+	/* Have the kernel move the data in large pieces */
 	while (length > 0) {
-		size_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
-		//fprintf(stderr, "copying %d bytes from %s to %s\n", r, source, dest);
-		write(d_fd, buf, r);
+		ssize_t r = copy_file_range(s_fd, NULL, d_fd, NULL, length, 0);
+		if (r <= 0) break;
 		length -= r;
-		//fprintf(stderr, "%d bytes remaining\n", length);
+	}
+
+	if (length > 0) {
+		char * buf = malloc(CHUNK_SIZE);
+		while (length > 0) {
+			ssize_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
+			if (r <= 0) break;
+			write(d_fd, buf, r);
+			length -= r;
+		}
+		free(buf);
 	}
 
 	close(s_fd);
@@ -0,0 +1,248 @@
+/**
+ * @brief modprobe - Load kernel modules for the PCI devices present
+ *
+ * Modules list the devices they drive with MODULE_PCI_IDS, which puts
+ * a table of vendor:device pairs in a "modpci" section of the module.
+ * We read the bus once from /proc/pci, read the table from every
+ * module in the module directory without loading anything, and then
+ * load each module that matches a device, skipping ones already loaded.
+ *
+ * Modules for bridges (such as the PIIX4 interrupt remapper) go first,
+ * as the devices behind them depend on them; the rest load in name order.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/sysfunc.h>
+#include <kernel/elf.h>
+
+#define MODULE_PCI_SECTION "modpci"
+#define PCI_CLASS_BRIDGE 0x06
+
+struct pci_device {
+	unsigned short class;
+	unsigned short vendor;
+	unsigned short device;
+};
+
+struct candidate {
+	char name[256];
+	char path[512];
+	int bridge;
+};
+
+static struct pci_device * devices = NULL;
+static size_t device_count = 0;
+
+static int verbose = 0;
+static int dry_run = 0;
+
+/* Lines look like "00:01.0 (0601, 8086:7000)"; the indented ones after are details. */
+static int read_pci_devices(void) {
+	FILE * f = fopen("/proc/pci", "r");
+	if (!f) return -1;
+
+	size_t space = 16;
+	devices = malloc(sizeof(struct pci_device) * space);
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == ' ' || line[0] == '\n') continue;
+		unsigned int class, vendor, device;
+		char * paren = strstr(line, " (");
+		if (!paren || sscanf(paren, " (%x, %x:%x)", &class, &vendor, &device) != 3) continue;
+		if (device_count == space) {
+			space *= 2;
+			devices = realloc(devices, sizeof(struct pci_device) * space);
+		}
+		devices[device_count].class  = class;
+		devices[device_count].vendor = vendor;
+		devices[device_count].device = device;
+		device_count++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/* Modules show up in /proc/modules by the name in their metadata, which is also their file name. */
+static int module_loaded(const char * name) {
+	FILE * f = fopen("/proc/modules", "r");
+	if (!f) return 0;
+
+	char line[1024];
+	int found = 0;
+	while (fgets(line, sizeof(line), f)) {
+		char * nl = strchr(line, '\n');
+		if (nl) *nl = '\0';
+		char * mod_name = strrchr(line, ' ');
+		if (mod_name && !strcmp(mod_name + 1, name)) {
+			found = 1;
+			break;
+		}
+	}
+
+	fclose(f);
+	return found;
+}
+
+/**
+ * Read the PCI ID table from a module file and match it against
+ * the bus. Returns 1 if any device matched, setting @p bridge if
+ * one of the matches was a bridge.
+ */
+static int match_module(const char * path, int * bridge) {
+	FILE * f = fopen(path, "r");
+	if (!f) return 0;
+
+	int matched = 0;
+	Elf64_Header header;
+	Elf64_Shdr * sections = NULL;
+	char * names = NULL;
+	unsigned char * table = NULL;
+
+	if (fread(&header, sizeof(header), 1, f) != 1) goto _done;
+	if (memcmp(header.e_ident, "\177ELF", 4) || header.e_ident[EI_CLASS] != ELFCLASS64) goto _done;
+	if (header.e_shentsize != sizeof(Elf64_Shdr) || header.e_shstrndx >= header.e_shnum) goto _done;
+
+	sections = malloc(sizeof(Elf64_Shdr) * header.e_shnum);
+	fseek(f, header.e_shoff, SEEK_SET);
+	if (fread(sections, sizeof(Elf64_Shdr), header.e_shnum, f) != header.e_shnum) goto _done;
+
+	Elf64_Shdr * strtab = &sections[header.e_shstrndx];
+	names = malloc(strtab->sh_size + 1);
+	fseek(f, strtab->sh_offset, SEEK_SET);
+	if (fread(names, 1, strtab->sh_size, f) != strtab->sh_size) goto _done;
+	names[strtab->sh_size] = '\0';
+
+	for (unsigned int i = 0; i < header.e_shnum; ++i) {
+		if (sections[i].sh_name >= strtab->sh_size) continue;
+		if (strcmp(names + sections[i].sh_name, MODULE_PCI_SECTION)) continue;
+
+		size_t size = sections[i].sh_size;
+		table = malloc(size);
+		fseek(f, sections[i].sh_offset, SEEK_SET);
+		if (fread(table, 1, size, f) != size) goto _done;
+
+		/* Pairs of little-endian 16-bit vendor and device IDs */
+		for (size_t j = 0; j + 4 <= size; j += 4) {
+			unsigned short vendor = table[j]   | (table[j+1] << 8);
+			unsigned short device = table[j+2] | (table[j+3] << 8);
+			for (size_t d = 0; d < device_count; ++d) {
+				if (devices[d].vendor == vendor && devices[d].device == device) {
+					matched = 1;
+					if ((devices[d].class >> 8) == PCI_CLASS_BRIDGE) *bridge = 1;
+				}
+			}
+		}
+		break;
+	}
+
+_done:
+	free(table);
+	free(names);
+	free(sections);
+	fclose(f);
+	return matched;
+}
+
+static int candidate_compare(const void * a, const void * b) {
+	const struct candidate * left = a;
+	const struct candidate * right = b;
+	if (left->bridge != right->bridge) return right->bridge - left->bridge;
+	return strcmp(left->name, right->name);
+}
+
+static void show_usage(char * argv[]) {
+	fprintf(stderr,
+			"modprobe - load modules for present PCI devices\n"
+			"\n"
+			"usage: %s [-nv] [DIRECTORY]\n"
+			"\n"
+			" -n     \033[3mshow what would be loaded, but don't load it\033[0m\n"
+			" -v     \033[3mprint each module as it is loaded\033[0m\n"
+			" -?     \033[3mshow this help text\033[0m\n"
+			"\n"
+			" DIRECTORY defaults to /mod\n"
+			"\n", argv[0]);
+}
+
+int main(int argc, char * argv[]) {
+	int opt;
+
+	while ((opt = getopt(argc, argv, "nv?")) != -1) {
+		switch (opt) {
+			case 'n':
+				dry_run = 1;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			case '?':
+				show_usage(argv);
+				return 0;
+		}
+	}
+
+	char * dir = optind < argc ? argv[optind] : "/mod";
+
+	if (read_pci_devices()) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], "/proc/pci", strerror(errno));
+		return 1;
+	}
+
+	DIR * d = opendir(dir);
+	if (!d) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], dir, strerror(errno));
+		return 1;
+	}
+
+	size_t count = 0, space = 16;
+	struct candidate * candidates = malloc(sizeof(struct candidate) * space);
+
+	struct dirent * ent;
+	while ((ent = readdir(d))) {
+		size_t len = strlen(ent->d_name);
+		if (len < 4 || strcmp(ent->d_name + len - 3, ".ko")) continue;
+
+		struct candidate * c = &candidates[count];
+		snprintf(c->path, sizeof(c->path), "%s/%s", dir, ent->d_name);
+		snprintf(c->name, sizeof(c->name), "%.*s", (int)(len - 3), ent->d_name);
+		c->bridge = 0;
+
+		if (!match_module(c->path, &c->bridge)) continue;
+		if (module_loaded(c->name)) continue;
+
+		if (++count == space) {
+			space *= 2;
+			candidates = realloc(candidates, sizeof(struct candidate) * space);
+		}
+	}
+	closedir(d);
+
+	qsort(candidates, count, sizeof(struct candidate), candidate_compare);
+
+	int retval = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (verbose || dry_run) {
+			fprintf(stderr, "%s: %s\n", dry_run ? "would load" : "loading", candidates[i].path);
+		}
+		if (dry_run) continue;
+
+		char * args[] = {candidates[i].path, NULL};
+		if (sysfunc(TOARU_SYS_FUNC_INSMOD, args) != 0) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], candidates[i].path, strerror(errno));
+			retval = 1;
+		}
+	}
+
+	return retval;
+}
@@ -4,9 +4,11 @@
 #include <string.h>
 #include <wchar.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/ioctl.h>
 
 #include <toaru/decodeutf8.h>
+#include <toaru/blockread.h>
 
 static int term_width = 80;
 static int term_height = 25;
@@ -144,30 +146,48 @@ static void next_line(void) {
 	}
 }
 
-static void do_file(char * name, FILE * f) {
-	if (!f) {
+static void do_file(char * name, int fd) {
+	if (fd < 0) {
 		printf("\033[7m`%s`: %s\033[0m", name, strerror(errno));
 		next_line();
 		return;
 	}
+	block_reader_t * reader = block_reader_open(fd, 0);
 	uint32_t code, state = 0;
-	while (!feof(f)) {
-		int c = fgetc(f);
-		if (c < 0) break;
-		if (!decode(&state, &code, c)) {
-			if (code == '\n') next_line();
-			else {
-				int width = char_width(code);
-				if (term_x + width > term_width) {
-					next_line();
+	char * data;
+	ssize_t len;
+	while ((len = block_reader_next(reader, &data)) > 0) {
+		ssize_t i = 0;
+		while (i < len) {
+			/* Plain printable ASCII goes out as a run, up to the edge of the screen */
+			if (state == UTF8_ACCEPT) {
+				ssize_t run = 0;
+				while (i + run < len && run < term_width - term_x &&
+					(unsigned char)data[i + run] >= 0x20 && (unsigned char)data[i + run] < 0x7F) run++;
+				if (run) {
+					fwrite(data + i, 1, run, stdout);
+					term_x += run;
+					i += run;
+					continue;
 				}
-				char_draw(code);
-				term_x += width;
 			}
-		} else if (state == UTF8_REJECT) {
-			state = 0;
+			unsigned char c = data[i++];
+			if (!decode(&state, &code, c)) {
+				if (code == '\n') next_line();
+				else {
+					int width = char_width(code);
+					if (term_x + width > term_width) {
+						next_line();
+					}
+					char_draw(code);
+					term_x += width;
+				}
+			} else if (state == UTF8_REJECT) {
+				state = 0;
+			}
 		}
 	}
+	block_reader_close(reader);
 }
 
 int main(int argc, char * argv[]) {
@@ -184,13 +204,13 @@ int main(int argc, char * argv[]) {
 	set_unbuffered();
 
 	if (argc < 2) {
-		do_file("stdin",stdin);
+		do_file("stdin",STDIN_FILENO);
 	}
 
 	for (int i = 1; i < argc; ++i) {
-		FILE * f = fopen(argv[1], "r");
-		do_file(argv[1], f);
-		fclose(f);
+		int fd = open(argv[i], O_RDONLY);
+		do_file(argv[i], fd);
+		if (fd >= 0) close(fd);
 	}
 
 	set_buffered();
@@ -0,0 +1,60 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * nice - Run a command with an adjusted scheduling priority
+ *
+ * With no command, prints the current nice value.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
+
+static int usage(char * argv[]) {
+	fprintf(stderr, "usage: %s [-n ADJUSTMENT] [COMMAND [ARG]...]\n", argv[0]);
+	return 1;
+}
+
+int main(int argc, char * argv[]) {
+	int adjustment = 10;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+			case 'n': {
+				char * end;
+				adjustment = strtol(optarg, &end, 10);
+				if (*end || end == optarg) {
+					fprintf(stderr, "%s: invalid adjustment: %s\n", argv[0], optarg);
+					return 1;
+				}
+				break;
+			}
+			default:
+				return usage(argv);
+		}
+	}
+
+	if (optind == argc) {
+		errno = 0;
+		int prio = getpriority(PRIO_PROCESS, 0);
+		if (prio == -1 && errno) {
+			fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+			return 1;
+		}
+		printf("%d\n", prio);
+		return 0;
+	}
+
+	if (nice(adjustment) == -1 && errno) {
+		fprintf(stderr, "%s: cannot set priority: %s\n", argv[0], strerror(errno));
+	}
+
+	execvp(argv[optind], &argv[optind]);
+	fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind], strerror(errno));
+	return 127;
+}
@@ -9,15 +9,11 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
-#include <wait.h>
-#include <pthread.h>
-#include <sched.h>
 #include <signal.h>
 
 #include <toaru/yutani.h>
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
-#include <toaru/spinlock.h>
 #include <toaru/menu.h>
 
 #define dist(a,b,c,d) sqrt((double)(((a) - (c)) * ((a) - (c)) + ((b) - (d)) * ((b) - (d))))
@@ -32,8 +28,6 @@ uint16_t win_height;
 uint16_t off_x;
 uint16_t off_y;
 
-static int volatile draw_lock = 0;
-
 gfx_context_t * ctx;
 
 void sigint_handler() {
@@ -60,38 +54,29 @@ uint32_t hsv_to_rgb(int h, float s, float v) {
 	return rgb((rp + m) * 255, (gp + m) * 255, (bp + m) * 255);
 }
 
-void * draw_thread(void * garbage) {
-	(void)garbage;
-
-	double time = 0;
-
-	/* Generate a palette */
-	uint32_t palette[256];
-	for (int x = 0; x < 256; ++x) {
-		palette[x] = hsv_to_rgb(x,1.0,1.0);
-	}
-
-	while (!should_exit) {
-
-		time += 1.0;
+static uint32_t palette[256];
+static double phase = 0;
 
-		spin_lock(&draw_lock);
-		for (int x = 0; x < win_width; ++x) {
-			for (int y = 0; y < win_height; ++y) {
-				double value = sin(dist(x + time, y, 128.0, 128.0) / 8.0)
-					+ sin(dist(x, y, 64.0, 64.0) / 8.0)
-					+ sin(dist(x, y + time / 7, 192.0, 64) / 7.0)
-					+ sin(dist(x, y, 192.0, 100.0) / 8.0);
-				GFX(ctx, x + off_x, y + off_y) = palette[(unsigned int)((value + 4) * 32) & 0xFF];
-			}
+/**
+ * Draw one frame and ask to hear back when it has been shown;
+ * the next frame is drawn when FRAME_DONE arrives.
+ */
+static void draw_frame(void) {
+	phase += 1.0;
+
+	for (int x = 0; x < win_width; ++x) {
+		for (int y = 0; y < win_height; ++y) {
+			double value = sin(dist(x + phase, y, 128.0, 128.0) / 8.0)
+				+ sin(dist(x, y, 64.0, 64.0) / 8.0)
+				+ sin(dist(x, y + phase / 7, 192.0, 64) / 7.0)
+				+ sin(dist(x, y, 192.0, 100.0) / 8.0);
+			GFX(ctx, x + off_x, y + off_y) = palette[(unsigned int)((value + 4) * 32) & 0xFF];
 		}
-		redraw_borders();
-		flip(ctx);
-		yutani_flip(yctx, wina);
-		spin_unlock(&draw_lock);
-		sched_yield();
 	}
-	return NULL;
+	redraw_borders();
+	flip(ctx);
+	yutani_window_request_frame(yctx, wina);
+	yutani_flip(yctx, wina);
 }
 
 void resize_finish(int w, int h) {
@@ -136,15 +121,14 @@ int main (int argc, char ** argv) {
 
 	ctx = init_graphics_yutani_double_buffer(wina);
 
-	draw_fill(ctx, rgb(0,0,0));
-	redraw_borders();
-	flip(ctx);
-	yutani_flip(yctx, wina);
+	/* Generate a palette */
+	for (int x = 0; x < 256; ++x) {
+		palette[x] = hsv_to_rgb(x,1.0,1.0);
+	}
 
 	yutani_window_advertise_icon(yctx, wina, "Plasma", "plasma");
 
-	pthread_t thread;
-	pthread_create(&thread, NULL, draw_thread, NULL);
+	draw_frame();
 
 	signal(SIGINT, sigint_handler);
 	while (!should_exit) {
@@ -152,6 +136,9 @@ int main (int argc, char ** argv) {
 		while (m) {
 			menu_process_event(yctx, m);
 			switch (m->type) {
+				case YUTANI_MSG_FRAME_DONE:
+					draw_frame();
+					break;
 				case YUTANI_MSG_KEY_EVENT:
 					{
 						struct yutani_msg_key_event * ke = (void*)m->data;
@@ -177,9 +164,7 @@ int main (int argc, char ** argv) {
 					{
 						struct yutani_msg_window_resize * wr = (void*)m->data;
 						if (wr->wid == wina->wid) {
-							spin_lock(&draw_lock);
 							resize_finish(wr->width, wr->height);
-							spin_unlock(&draw_lock);
 						}
 					}
 					break;
@@ -204,8 +189,6 @@ int main (int argc, char ** argv) {
 		}
 	}
 
-	wait(NULL);
-
 	yutani_close(yctx, wina);
 	return 0;
 }
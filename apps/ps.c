@@ -55,8 +55,6 @@ void print_username(int uid) {
 	} else {
 		printf("%-8d", uid);
 	}
-
-	endpwent();
 }
 
 struct process * process_from_pid(pid_t pid) {
@@ -154,7 +152,6 @@ struct process * process_entry(struct dirent *dent) {
 	} else {
 		if ((len = sprintf(garbage, "%d", out->uid)) > widths[2]) widths[2] = len;
 	}
-	endpwent();
 
 	if (collect_commandline) {
 		sprintf(tmp, "/proc/%s/cmdline", dent->d_name);
@@ -206,7 +203,6 @@ void print_entry(struct process * out) {
 		} else {
 			printf("%-*d ", widths[2], out->uid);
 		}
-		endpwent();
 	}
 	printf("%*d ", widths[0], out->pid);
 	if (show_threads) {
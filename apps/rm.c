@@ -18,14 +18,17 @@
 #include <sys/ioctl.h>
 
 static int recursive = 0;
-static int rm_thing(char * tmp);
+static int rm_thing(int dirfd, char * name, char * tmp);
 
-static int rm_directory(char * source) {
-	DIR * dirp = opendir(source);
-	if (dirp == NULL) {
+/* Entries are removed relative to their open directory; the full
+ * path is only kept for messages. */
+static int rm_directory(int dirfd, char * name, char * source) {
+	int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY);
+	if (fd < 0) {
 		fprintf(stderr, "could not open %s\n", source);
 		return 1;
 	}
+	DIR * dirp = fdopendir(fd);
 
 	struct dirent * ent = readdir(dirp);
 	while (ent != NULL) {
@@ -35,26 +38,29 @@ static int rm_directory(char * source) {
 		}
 		char tmp[strlen(source)+strlen(ent->d_name)+2];
 		sprintf(tmp, "%s/%s", source, ent->d_name);
-		int status = rm_thing(tmp);
-		if (status) return status;
+		int status = rm_thing(fd, ent->d_name, tmp);
+		if (status) {
+			closedir(dirp);
+			return status;
+		}
 		ent = readdir(dirp);
 	}
 	closedir(dirp);
 
-	return unlink(source);
+	return unlinkat(dirfd, name, AT_REMOVEDIR);
 }
 
-static int rm_thing(char * tmp) {
+static int rm_thing(int dirfd, char * name, char * tmp) {
 	struct stat statbuf;
-	lstat(tmp,&statbuf);
+	fstatat(dirfd, name, &statbuf, AT_SYMLINK_NOFOLLOW);
 	if (S_ISDIR(statbuf.st_mode)) {
 		if (!recursive) {
 			fprintf(stderr, "rm: %s: is a directory\n", tmp);
 			return 1;
 		}
-		return rm_directory(tmp);
+		return rm_directory(dirfd, name, tmp);
 	} else {
-		return unlink(tmp);
+		return unlinkat(dirfd, name, 0);
 	}
 }
 
@@ -75,7 +81,7 @@ int main(int argc, char * argv[]) {
 	int ret = 0;
 
 	for (int i = optind; i < argc; ++i) {
-		ret |= rm_thing(argv[i]);
+		ret |= rm_thing(AT_FDCWD, argv[i], argv[i]);
 	}
 
 	return ret;
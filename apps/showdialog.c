@@ -9,8 +9,7 @@
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
-#include <toaru/button.h>
-#include <toaru/text.h>
+#include <toaru/ttk.h>
 
 #include <sys/utsname.h>
 
@@ -30,49 +29,82 @@ static char * icon_path;
 static char * title_str;
 static char * copyright_str[20] = {NULL};
 
-static struct TT_Font * _tt_font = NULL;
+static ttk_window_t * ttk = NULL;
+static int playing = 1;
+static int status = 0;
 
-static void draw_string(int y, const char * string, uint32_t color) {
-
-	struct decor_bounds bounds;
-	decor_get_bounds(window, &bounds);
+static void draw_logo(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	draw_sprite(ctx, &logo, 0, -top);
+}
 
-	tt_set_size(_tt_font, 13);
-	tt_draw_string(ctx, _tt_font, bounds.left_width + 80, bounds.top_height + 30 + y + 13, string, color);
+static void button_okay(ttk_widget_t * self) {
+	playing = 0;
+	status = 0;
 }
 
-struct TTKButton _ok = {0};
-struct TTKButton _cancel = {0};
+static void button_cancel(ttk_widget_t * self) {
+	playing = 0;
+	status = 1;
+}
 
-static void redraw(void) {
+static ttk_widget_t * spacer(int height) {
+	ttk_widget_t * out = ttk_widget_create(sizeof(ttk_widget_t));
+	out->min_height = height;
+	return out;
+}
 
-	struct decor_bounds bounds;
-	decor_get_bounds(window, &bounds);
+static ttk_widget_t * build_interface(void) {
+	ttk_widget_t * root = ttk_box_create(TTK_HORIZONTAL, 0, 15);
 
-	draw_fill(ctx, rgb(204,204,204));
-	draw_sprite(ctx, &logo, bounds.left_width + 20, bounds.top_height + 20);
-	int offset = 0;
+	ttk_widget_t * icon = ttk_widget_create(sizeof(ttk_widget_t));
+	icon->draw = draw_logo;
+	icon->min_width = 60;
+	icon->min_height = logo.height;
+	ttk_widget_add(root, icon);
 
+	ttk_widget_t * column = ttk_box_create(TTK_VERTICAL, 0, 0);
+	column->expand = 1;
+	ttk_widget_add(column, spacer(10));
 	for (char ** copy_str = copyright_str; *copy_str; ++copy_str) {
 		if (**copy_str == '-') {
-			offset += 10;
+			ttk_widget_add(column, spacer(10));
 		} else if (**copy_str == '%') {
-			draw_string(offset, *copy_str+1, rgb(0,0,255));
-			offset += 20;
+			ttk_widget_t * label = ttk_label_create(*copy_str+1, TTK_FONT_SANS, 13);
+			ttk_label_set_color(label, rgb(0,0,255));
+			ttk_widget_add(column, label);
 		} else {
-			draw_string(offset, *copy_str, rgb(0,0,0));
-			offset += 20;
+			ttk_widget_add(column, ttk_label_create(*copy_str, TTK_FONT_SANS, 13));
 		}
 	}
 
-	ttk_button_draw(ctx, &_ok);
-	ttk_button_draw(ctx, &_cancel);
+	ttk_widget_t * filler = spacer(0);
+	filler->expand = 1;
+	ttk_widget_add(column, filler);
 
-	window->decorator_flags |= DECOR_FLAG_NO_MAXIMIZE;
-	render_decorations(window, ctx, title_str);
+	ttk_widget_t * buttons = ttk_box_create(TTK_HORIZONTAL, BUTTON_PADDING, 0);
+	filler = spacer(0);
+	filler->expand = 1;
+	ttk_widget_add(buttons, filler);
 
-	flip(ctx);
-	yutani_flip(yctx, window);
+	ttk_widget_t * cancel = ttk_button_create("Cancel", button_cancel);
+	cancel->min_width = BUTTON_WIDTH;
+	cancel->min_height = BUTTON_HEIGHT;
+	ttk_widget_add(buttons, cancel);
+
+	ttk_widget_t * okay = ttk_button_create("Okay", button_okay);
+	okay->min_width = BUTTON_WIDTH;
+	okay->min_height = BUTTON_HEIGHT;
+	ttk_widget_add(buttons, okay);
+
+	ttk_widget_add(column, buttons);
+	ttk_widget_add(root, column);
+
+	return root;
+}
+
+static void redraw(void) {
+	window->decorator_flags |= DECOR_FLAG_NO_MAXIMIZE;
+	ttk_window_draw(ttk);
 }
 
 static void init_default(void) {
@@ -83,56 +115,15 @@ static void init_default(void) {
 	copyright_str[1] = "You can press \"Okay\" or \"Cancel\" or close the window.";
 }
 
-int in_button(struct TTKButton * button, struct yutani_msg_window_mouse_event * me) {
-	if (me->new_y >= button->y && me->new_y < button->y  + button->height) {
-		if (me->new_x >= button->x && me->new_x < button->x + button->width) {
-			return 1;
-		}
-	}
-	return 0;
-}
-
-void setup_buttons(void) {
-	struct decor_bounds bounds;
-	decor_get_bounds(window, &bounds);
-
-	_ok.title = "Okay";
-	_ok.width = BUTTON_WIDTH;
-	_ok.height = BUTTON_HEIGHT;
-	_ok.x = ctx->width - bounds.right_width - BUTTON_WIDTH - BUTTON_PADDING;
-	_ok.y = ctx->height - bounds.bottom_height - BUTTON_HEIGHT - BUTTON_PADDING;
-
-	_cancel.title = "Cancel";
-	_cancel.width = BUTTON_WIDTH;
-	_cancel.height = BUTTON_HEIGHT;
-	_cancel.x = ctx->width - bounds.right_width - BUTTON_WIDTH * 2 - BUTTON_PADDING * 2;
-	_cancel.y = ctx->height - bounds.bottom_height - BUTTON_HEIGHT - BUTTON_PADDING;
-}
-
 void resize_finish(int w, int h) {
 	yutani_window_resize_accept(yctx, window, w, h);
 	reinit_graphics_yutani(ctx, window);
 	width  = w;
 	height = h;
-	setup_buttons();
-	redraw();
+	ttk_window_resize(ttk);
 	yutani_window_resize_done(yctx, window);
 }
 
-void set_hilight(struct TTKButton * button, int hilight) {
-	if (!button && (_ok.hilight || _cancel.hilight)) {
-		_ok.hilight = 0;
-		_cancel.hilight = 0;
-		redraw();
-	} else if (button && (button->hilight != hilight)) {
-		_ok.hilight = 0;
-		_cancel.hilight = 0;
-		button->hilight = hilight;
-		redraw();
-	}
-}
-
-
 int main(int argc, char * argv[]) {
 	int req_center_x, req_center_y;
 	yctx = yutani_init();
@@ -145,8 +136,6 @@ int main(int argc, char * argv[]) {
 	struct decor_bounds bounds;
 	decor_get_bounds(NULL, &bounds);
 
-	_tt_font = tt_font_from_shm("sans-serif");
-
 	window = yutani_window_create_flags(yctx, width + bounds.width, height + bounds.height, YUTANI_WINDOW_FLAG_DIALOG_ANIMATION);
 	req_center_x = yctx->display_width / 2;
 	req_center_y = yctx->display_height / 2;
@@ -183,14 +172,11 @@ int main(int argc, char * argv[]) {
 	yutani_window_advertise_icon(yctx, window, title_str, "star");
 
 	ctx = init_graphics_yutani_double_buffer(window);
-	setup_buttons();
 	load_sprite(&logo, icon_path);
+	ttk = ttk_window_create(yctx, window, ctx, title_str, 0);
+	ttk_window_set_root(ttk, build_interface());
 	redraw();
 
-	struct TTKButton * _down_button = NULL;
-
-	int playing = 1;
-	int status = 0;
 	while (playing) {
 		yutani_msg_t * m = yutani_poll(yctx);
 		while (m) {
@@ -245,52 +231,8 @@ int main(int argc, char * argv[]) {
 									break;
 							}
 
-							struct decor_bounds bounds;
-							decor_get_bounds(window, &bounds);
-							if (me->new_y > bounds.top_height) {
-
-								if (me->command == YUTANI_MOUSE_EVENT_DOWN) {
-									if (in_button(&_ok, me)) {
-										set_hilight(&_ok, 2);
-										_down_button = &_ok;
-									} else if (in_button(&_cancel, me)) {
-										set_hilight(&_cancel, 2);
-										_down_button = &_cancel;
-									}
-								} else if (me->command == YUTANI_MOUSE_EVENT_RAISE || me->command == YUTANI_MOUSE_EVENT_CLICK) {
-									if (_down_button) {
-										if (in_button(_down_button, me)) {
-											if (_down_button == &_cancel) {
-												playing = 0;
-												status  = 1;
-												break;
-											} else if (_down_button == &_ok) {
-												playing = 0;
-												status = 0;
-												break;
-											}
-											_down_button->hilight = 0;
-										}
-									}
-									_down_button = NULL;
-								}
-
-								if (!me->buttons & YUTANI_MOUSE_BUTTON_LEFT) {
-									if (in_button(&_ok, me)) {
-										set_hilight(&_ok, 1);
-									} else if (in_button(&_cancel, me)) {
-										set_hilight(&_cancel, 1);
-									} else {
-										set_hilight(NULL,0);
-									}
-								} else if (_down_button) {
-									if (in_button(_down_button, me)) {
-										set_hilight(_down_button, 2);
-									} else {
-										set_hilight(NULL, 0);
-									}
-								}
-							}
+							ttk_window_mouse_event(ttk, me);
+							ttk_window_update(ttk);
 						}
 					}
 					break;
@@ -10,7 +10,6 @@
 #include <sched.h>
 #include <math.h>
 
-#include <sys/fswait.h>
 #include <sys/time.h>
 
 #include <toaru/yutani.h>
@@ -69,6 +68,7 @@ static void draw(void) {
 		}
 	}
 	flip(ctx);
+	yutani_window_request_frame(yctx, wina);
 	yutani_flip(yctx, wina);
 }
 
@@ -122,54 +122,54 @@ int main (int argc, char ** argv) {
 	draw_fill(ctx, rgba(0,0,0,0));
 	flip(ctx);
 
+	draw();
+
 	while (!should_exit) {
-		int fds[1] = {fileno(yctx->sock)};
-		int index = fswait2(1,fds,10);
-		if (index == 0) {
-			yutani_msg_t * m = yutani_poll(yctx);
-			while (m) {
-				switch (m->type) {
-					case YUTANI_MSG_KEY_EVENT:
-						{
-							struct yutani_msg_key_event * ke = (void*)m->data;
-							if (ke->event.action == KEY_ACTION_DOWN && ke->event.keycode == 'q') {
-								should_exit = 1;
-								sched_yield();
-							}
-						}
-						break;
-					case YUTANI_MSG_WINDOW_MOUSE_EVENT:
-						{
-							struct yutani_msg_window_mouse_event * me = (void*)m->data;
-							if (me->command == YUTANI_MOUSE_EVENT_DOWN && me->buttons & YUTANI_MOUSE_BUTTON_LEFT) {
-								yutani_window_drag_start(yctx, wina);
-							}
+		yutani_msg_t * m = yutani_poll(yctx);
+		while (m) {
+			switch (m->type) {
+				case YUTANI_MSG_FRAME_DONE:
+					/* Draw the next frame only once the last one is on screen */
+					if (flakes_made < 20 && precise_time_since(last_flake) > 1000) {
+						add_flake();
+						flakes_made += 1;
+						last_flake = precise_current_time();
+					}
+					draw();
+					break;
+				case YUTANI_MSG_KEY_EVENT:
+					{
+						struct yutani_msg_key_event * ke = (void*)m->data;
+						if (ke->event.action == KEY_ACTION_DOWN && ke->event.keycode == 'q') {
+							should_exit = 1;
+							sched_yield();
 						}
-						break;
-					case YUTANI_MSG_RESIZE_OFFER:
-						{
-							struct yutani_msg_window_resize * wr = (void*)m->data;
-							resize_finish(wr->width, wr->height);
+					}
+					break;
+				case YUTANI_MSG_WINDOW_MOUSE_EVENT:
+					{
+						struct yutani_msg_window_mouse_event * me = (void*)m->data;
+						if (me->command == YUTANI_MOUSE_EVENT_DOWN && me->buttons & YUTANI_MOUSE_BUTTON_LEFT) {
+							yutani_window_drag_start(yctx, wina);
 						}
-						break;
-					case YUTANI_MSG_WINDOW_CLOSE:
-					case YUTANI_MSG_SESSION_END:
-						should_exit = 1;
-						break;
-					default:
-						break;
-				}
-				free(m);
-				m = yutani_poll_async(yctx);
-			}
-		} else {
-			if (flakes_made < 20 && precise_time_since(last_flake) > 1000) {
-				add_flake();
-				flakes_made += 1;
-				last_flake = precise_current_time();
+					}
+					break;
+				case YUTANI_MSG_RESIZE_OFFER:
+					{
+						struct yutani_msg_window_resize * wr = (void*)m->data;
+						resize_finish(wr->width, wr->height);
+					}
+					break;
+				case YUTANI_MSG_WINDOW_CLOSE:
+				case YUTANI_MSG_SESSION_END:
+					should_exit = 1;
+					break;
+				default:
+					break;
 			}
+			free(m);
+			m = yutani_poll_async(yctx);
 		}
-		draw();
 	}
 
 	yutani_close(yctx, wina);
@@ -5,7 +5,15 @@
  *
  * sort - Sort standard in or files.
  *
- * Currently implemented with a naive insertion sort.
+ * Input is read in large blocks into one buffer and split into
+ * lines in place; the line table is then merge sorted, so the
+ * sort is stable and equal keys keep their input order with -s.
+ * Large tables are sorted in parallel, one slice per core, and
+ * the slices merged.
+ *
+ * When the input outgrows the memory budget (-S), each full buffer
+ * is sorted and written to a temporary file as a run, and the runs
+ * are merged at the end.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,87 +22,671 @@
 #include <getopt.h>
 #include <errno.h>
 #include <ctype.h>
-#include <toaru/list.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define READ_CHUNK      (64 * 1024)
+#define DEFAULT_BUDGET  (16 * 1024 * 1024)
+#define PARALLEL_MIN    8192
+#define MAX_THREADS     16
+#define MAX_KEYS        16
+
+#define KEY_NUMERIC  (1 << 0)
+#define KEY_REVERSE  (1 << 1)
+#define KEY_FOLD     (1 << 2)
+#define KEY_BLANKS   (1 << 3)
+
+struct line {
+	char * s;
+	size_t len;
+	double number; /* the first key, parsed once, when it is numeric */
+};
+
+struct key {
+	int start_field, start_char;
+	int end_field, end_char; /* end_field == 0: to end of line; end_char == 0: to end of field */
+	int flags;
+};
+
+static struct key keys[MAX_KEYS];
+static int key_count = 0;
+static int global_flags = 0;
+static int separator = -1;
+static int unique = 0;
+static int stable = 0;
+static int first_numeric = 0;
+static size_t budget = DEFAULT_BUDGET;
+static char * argv_0 = "sort";
+
+/* The current run: input text, and the lines within it */
+static char * text = NULL;
+static size_t text_used = 0, text_size = 0;
+static struct line * lines = NULL;
+static size_t line_count = 0, line_space = 0;
+static size_t line_start = 0; /* offset of the incomplete line at the end of text */
+
+/* Runs already written out */
+static FILE ** runs = NULL;
+static size_t run_count = 0;
+
+static inline int is_blank(char c) {
+	return c == ' ' || c == '\t';
+}
+
+static const char * field_start(const char * s, const char * end, int field) {
+	for (int i = 1; i < field && s < end; ++i) {
+		if (separator >= 0) {
+			s = memchr(s, separator, end - s);
+			if (!s) return end;
+			s++;
+		} else {
+			while (s < end && is_blank(*s)) s++;
+			while (s < end && !is_blank(*s)) s++;
+		}
+	}
+	return s;
+}
+
+static const char * field_end(const char * s, const char * end) {
+	if (separator >= 0) {
+		const char * sep = memchr(s, separator, end - s);
+		return sep ? sep : end;
+	}
+	while (s < end && is_blank(*s)) s++;
+	while (s < end && !is_blank(*s)) s++;
+	return s;
+}
+
+static const char * skip_blanks(const char * s, const char * end) {
+	while (s < end && is_blank(*s)) s++;
+	return s;
+}
+
+static void key_range(const struct line * l, const struct key * k, const char ** start, const char ** stop) {
+	const char * end = l->s + l->len;
+
+	const char * s = field_start(l->s, end, k->start_field);
+	const char * fend = field_end(s, end);
+	if (k->flags & KEY_BLANKS) s = skip_blanks(s, fend);
+	if (k->start_char > 1) {
+		s = (size_t)(fend - s) > (size_t)(k->start_char - 1) ? s + k->start_char - 1 : fend;
+	}
+
+	const char * e = end;
+	if (k->end_field) {
+		e = field_start(l->s, end, k->end_field);
+		fend = field_end(e, end);
+		if (k->end_char) {
+			if (k->flags & KEY_BLANKS) e = skip_blanks(e, fend);
+			e = (size_t)(fend - e) > (size_t)k->end_char ? e + k->end_char : fend;
+		} else {
+			e = fend;
+		}
+	}
+
+	*start = s;
+	*stop = e < s ? s : e;
+}
+
+/* Blanks, an optional minus sign, digits and a decimal part; anything after is ignored. */
+static double numeric_value(const char * s, const char * e) {
+	double value = 0.0;
+	int negative = 0;
+
+	s = skip_blanks(s, e);
+	if (s < e && *s == '-') {
+		negative = 1;
+		s++;
+	}
+	while (s < e && isdigit(*s)) {
+		value = value * 10.0 + (*s++ - '0');
+	}
+	if (s < e && *s == '.') {
+		double scale = 0.1;
+		for (s++; s < e && isdigit(*s); s++, scale /= 10.0) {
+			value += (*s - '0') * scale;
+		}
+	}
+	return negative ? -value : value;
+}
+
+static int compare_text(const char * a, size_t alen, const char * b, size_t blen, int flags) {
+	if (flags & KEY_NUMERIC) {
+		double x = numeric_value(a, a + alen);
+		double y = numeric_value(b, b + blen);
+		return (x > y) - (x < y);
+	}
+
+	size_t n = alen < blen ? alen : blen;
+	if (flags & KEY_FOLD) {
+		for (size_t i = 0; i < n; ++i) {
+			int c = toupper((unsigned char)a[i]) - toupper((unsigned char)b[i]);
+			if (c) return c;
+		}
+	} else {
+		int c = memcmp(a, b, n);
+		if (c) return c;
+	}
+	return (alen > blen) - (alen < blen);
+}
+
+/* Compare by keys only; this is what -u uses to decide lines are duplicates. */
+static int compare_keys(const struct line * a, const struct line * b) {
+	if (!key_count && first_numeric) {
+		int c = (a->number > b->number) - (a->number < b->number);
+		return (global_flags & KEY_REVERSE) ? -c : c;
+	} else if (!key_count) {
+		const char * as = a->s, * bs = b->s;
+		if (global_flags & KEY_BLANKS) {
+			as = skip_blanks(as, a->s + a->len);
+			bs = skip_blanks(bs, b->s + b->len);
+		}
+		int c = compare_text(as, a->s + a->len - as, bs, b->s + b->len - bs, global_flags);
+		return (global_flags & KEY_REVERSE) ? -c : c;
+	}
+
+	for (int i = 0; i < key_count; ++i) {
+		if (i == 0 && first_numeric) {
+			int c = (a->number > b->number) - (a->number < b->number);
+			if (c) return (keys[0].flags & KEY_REVERSE) ? -c : c;
+			continue;
+		}
+		const char *as, *ae, *bs, *be;
+		key_range(a, &keys[i], &as, &ae);
+		key_range(b, &keys[i], &bs, &be);
+		int c = compare_text(as, ae - as, bs, be - bs, keys[i].flags);
+		if (c) return (keys[i].flags & KEY_REVERSE) ? -c : c;
+	}
+	return 0;
+}
+
+static int compare_lines(const struct line * a, const struct line * b) {
+	int c = compare_keys(a, b);
+	if (c || stable || unique) return c;
+
+	/* Last resort: the whole line, bytewise */
+	c = compare_text(a->s, a->len, b->s, b->len, 0);
+	return (global_flags & KEY_REVERSE) ? -c : c;
+}
+
+/* Merge two sorted, adjacent halves of src into dst. */
+static void merge(struct line * src, struct line * dst, size_t mid, size_t n) {
+	size_t i = 0, j = mid, k = 0;
+	while (i < mid && j < n) {
+		/* Take from the left on ties so the sort stays stable */
+		if (compare_lines(&src[j], &src[i]) < 0) {
+			dst[k++] = src[j++];
+		} else {
+			dst[k++] = src[i++];
+		}
+	}
+	while (i < mid) dst[k++] = src[i++];
+	while (j < n) dst[k++] = src[j++];
+}
+
+/* Sort a, using tmp (of the same size) as scratch. Result ends up in a. */
+static void merge_sort(struct line * a, struct line * tmp, size_t n) {
+	if (n <= 16) {
+		for (size_t i = 1; i < n; ++i) {
+			struct line l = a[i];
+			size_t j = i;
+			while (j > 0 && compare_lines(&l, &a[j-1]) < 0) {
+				a[j] = a[j-1];
+				j--;
+			}
+			a[j] = l;
+		}
+		return;
+	}
+
+	size_t mid = n / 2;
+	merge_sort(a, tmp, mid);
+	merge_sort(a + mid, tmp + mid, n - mid);
+
+	/* Already in order? Common for presorted input. */
+	if (compare_lines(&a[mid], &a[mid-1]) >= 0) return;
+
+	merge(a, tmp, mid, n);
+	memcpy(a, tmp, n * sizeof(struct line));
+}
+
+struct sort_job {
+	struct line * a;
+	struct line * tmp;
+	size_t mid;
+	size_t n;
+};
+
+static void * sort_thread(void * arg) {
+	struct sort_job * job = arg;
+	merge_sort(job->a, job->tmp, job->n);
+	return NULL;
+}
+
+static void * merge_thread(void * arg) {
+	struct sort_job * job = arg;
+	merge(job->a, job->tmp, job->mid, job->n);
+	memcpy(job->a, job->tmp, job->n * sizeof(struct line));
+	return NULL;
+}
+
+static int thread_count(size_t n) {
+	if (n < PARALLEL_MIN) return 1;
+	cpu_set_t cpus;
+	if (sched_getaffinity(0, sizeof(cpus), &cpus)) return 1;
+	int count = CPU_COUNT(&cpus);
+	if (count > MAX_THREADS) count = MAX_THREADS;
+	return count < 1 ? 1 : count;
+}
+
+/* Sort the line table: one slice per thread, then merge slices pairwise. */
+static void sort_lines(struct line * a, size_t n) {
+	if (n < 2) return;
+
+	struct line * tmp = malloc(n * sizeof(struct line));
+	int threads = thread_count(n);
+
+	if (threads == 1) {
+		merge_sort(a, tmp, n);
+		free(tmp);
+		return;
+	}
+
+	size_t bounds[MAX_THREADS + 1];
+	for (int i = 0; i <= threads; ++i) {
+		bounds[i] = n * i / threads;
+	}
+
+	pthread_t tids[MAX_THREADS];
+	struct sort_job jobs[MAX_THREADS];
+	for (int i = 0; i < threads; ++i) {
+		jobs[i].a = a + bounds[i];
+		jobs[i].tmp = tmp + bounds[i];
+		jobs[i].n = bounds[i+1] - bounds[i];
+		pthread_create(&tids[i], NULL, sort_thread, &jobs[i]);
+	}
+	for (int i = 0; i < threads; ++i) {
+		pthread_join(tids[i], NULL);
+	}
+
+	/* Each round halves the number of slices */
+	for (int width = 1; width < threads; width *= 2) {
+		int merges = 0;
+		for (int i = 0; i + width < threads; i += 2 * width) {
+			size_t lo = bounds[i];
+			size_t mid = bounds[i + width];
+			size_t hi = bounds[(i + 2 * width) < threads ? i + 2 * width : threads];
+			jobs[merges].a = a + lo;
+			jobs[merges].tmp = tmp + lo;
+			jobs[merges].mid = mid - lo;
+			jobs[merges].n = hi - lo;
+			pthread_create(&tids[merges], NULL, merge_thread, &jobs[merges]);
+			merges++;
+		}
+		for (int i = 0; i < merges; ++i) {
+			pthread_join(tids[i], NULL);
+		}
+	}
+
+	free(tmp);
+}
+
+/* Write sorted lines, dropping duplicates for -u. */
+static int write_lines(FILE * out, struct line * a, size_t n) {
+	struct line * last = NULL;
+	for (size_t i = 0; i < n; ++i) {
+		if (unique && last && !compare_keys(last, &a[i])) continue;
+		fwrite(a[i].s, 1, a[i].len, out);
+		fputc('\n', out);
+		last = &a[i];
+	}
+	return ferror(out) ? -1 : 0;
+}
+
+static void add_line(size_t start, size_t end) {
+	if (line_count == line_space) {
+		line_space = line_space ? line_space * 2 : 1024;
+		lines = realloc(lines, line_space * sizeof(struct line));
+	}
+	/* Offsets for now; text may still move. Fixed up in finish_run. */
+	lines[line_count].s = (char *)start;
+	lines[line_count].len = end - start;
+	line_count++;
+}
+
+/* Parse the first key up front if it's numeric, rather than in every comparison. */
+static void parse_number(struct line * l) {
+	if (!first_numeric) return;
+	const char * s = l->s, * e = l->s + l->len;
+	if (key_count) key_range(l, &keys[0], &s, &e);
+	l->number = numeric_value(s, e);
+}
+
+static void finish_run(void) {
+	for (size_t i = 0; i < line_count; ++i) {
+		lines[i].s = text + (size_t)lines[i].s;
+		parse_number(&lines[i]);
+	}
+	sort_lines(lines, line_count);
+}
+
+/* Write a run as length-prefixed lines, so the merge doesn't need to rescan for newlines. */
+static void spill_run(void) {
+	finish_run();
+
+	FILE * f = tmpfile();
+	if (!f) {
+		fprintf(stderr, "%s: can't create temporary file: %s\n", argv_0, strerror(errno));
+		exit(2);
+	}
+	setvbuf(f, NULL, _IOFBF, READ_CHUNK);
 
-int compare(const char * a, const char * b) {
+	struct line * last = NULL;
+	for (size_t i = 0; i < line_count; ++i) {
+		if (unique && last && !compare_keys(last, &lines[i])) continue;
+		fwrite(&lines[i].len, sizeof(size_t), 1, f);
+		fwrite(lines[i].s, 1, lines[i].len, f);
+		last = &lines[i];
+	}
+	if (fflush(f) || ferror(f)) {
+		fprintf(stderr, "%s: can't write temporary file: %s\n", argv_0, strerror(errno));
+		exit(2);
+	}
+	rewind(f);
+
+	runs = realloc(runs, sizeof(FILE *) * (run_count + 1));
+	runs[run_count++] = f;
+
+	/* Keep the incomplete line at the end for the next run */
+	memmove(text, text + line_start, text_used - line_start);
+	text_used -= line_start;
+	line_start = 0;
+	line_count = 0;
+}
+
+static void read_input(FILE * f) {
 	while (1) {
-		while (*a == *b || tolower(*a) == tolower(*b)) {
-			if (!*a) return 0;
-			a++;
-			b++;
+		if (text_used + READ_CHUNK + 1 > text_size) {
+			text_size = text_size ? text_size * 2 : READ_CHUNK * 4;
+			while (text_used + READ_CHUNK + 1 > text_size) text_size *= 2;
+			text = realloc(text, text_size);
 		}
 
-		while (*a && !isalnum(*a)) a++;
-		while (*b && !isalnum(*b)) b++;
+		size_t r = fread(text + text_used, 1, READ_CHUNK, f);
+		if (!r) break;
 
-		if (tolower(*a) == tolower(*b)) continue;
+		char * p = text + text_used;
+		char * end = p + r;
+		while ((p = memchr(p, '\n', end - p))) {
+			*p = '\0';
+			add_line(line_start, p - text);
+			line_start = p - text + 1;
+			p++;
+		}
+		text_used += r;
 
-		if (tolower(*a) < tolower(*b)) return -1;
-		return 1;
+		if (text_used >= budget && line_count) {
+			spill_run();
+		}
+	}
+
+	/* Last line with no newline */
+	if (line_start < text_used) {
+		text[text_used] = '\0';
+		add_line(line_start, text_used);
+		text_used++;
+		line_start = text_used;
 	}
 }
 
+struct run_reader {
+	FILE * f;
+	struct line line;
+	size_t space;
+	int index;
+};
+
+static int read_run_line(struct run_reader * r) {
+	size_t len;
+	if (fread(&len, sizeof(size_t), 1, r->f) != 1) return 0;
+	if (len + 1 > r->space) {
+		r->space = len + 1;
+		r->line.s = realloc(r->line.s, r->space);
+	}
+	if (fread(r->line.s, 1, len, r->f) != len) return 0;
+	r->line.s[len] = '\0';
+	r->line.len = len;
+	parse_number(&r->line);
+	return 1;
+}
+
+/* Heap ordering: by line, then by run, so the merge is stable across runs. */
+static int reader_less(struct run_reader * a, struct run_reader * b) {
+	int c = compare_lines(&a->line, &b->line);
+	if (c) return c < 0;
+	return a->index < b->index;
+}
+
+static void sift_down(struct run_reader ** heap, size_t n, size_t i) {
+	while (1) {
+		size_t smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+		if (l < n && reader_less(heap[l], heap[smallest])) smallest = l;
+		if (r < n && reader_less(heap[r], heap[smallest])) smallest = r;
+		if (smallest == i) return;
+		struct run_reader * t = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = t;
+		i = smallest;
+	}
+}
+
+static int merge_runs(FILE * out) {
+	struct run_reader * readers = calloc(run_count, sizeof(struct run_reader));
+	struct run_reader ** heap = malloc(sizeof(struct run_reader *) * run_count);
+	size_t n = 0;
+
+	for (size_t i = 0; i < run_count; ++i) {
+		readers[i].f = runs[i];
+		readers[i].index = i;
+		setvbuf(runs[i], NULL, _IOFBF, READ_CHUNK);
+		if (read_run_line(&readers[i])) heap[n++] = &readers[i];
+	}
+	for (size_t i = n / 2; i-- > 0;) sift_down(heap, n, i);
+
+	struct line last = {NULL, 0, 0.0};
+	size_t last_space = 0;
+	int have_last = 0;
+
+	while (n) {
+		struct run_reader * r = heap[0];
+		if (!(unique && have_last && !compare_keys(&last, &r->line))) {
+			fwrite(r->line.s, 1, r->line.len, out);
+			fputc('\n', out);
+			if (unique) {
+				if (r->line.len + 1 > last_space) {
+					last_space = r->line.len + 1;
+					last.s = realloc(last.s, last_space);
+				}
+				memcpy(last.s, r->line.s, r->line.len + 1);
+				last.len = r->line.len;
+				last.number = r->line.number;
+				have_last = 1;
+			}
+		}
+		if (!read_run_line(r)) heap[0] = heap[--n];
+		sift_down(heap, n, 0);
+	}
+
+	for (size_t i = 0; i < run_count; ++i) {
+		free(readers[i].line.s);
+		fclose(runs[i]);
+	}
+	free(last.s);
+	free(readers);
+	free(heap);
+	return ferror(out) ? -1 : 0;
+}
+
+static int parse_flags(const char * s, int * flags) {
+	for (; *s; ++s) {
+		switch (*s) {
+			case 'n': *flags |= KEY_NUMERIC; break;
+			case 'r': *flags |= KEY_REVERSE; break;
+			case 'f': *flags |= KEY_FOLD; break;
+			case 'b': *flags |= KEY_BLANKS; break;
+			default: return -1;
+		}
+	}
+	return 0;
+}
+
+/* -k FIELD[.CHAR][FLAGS][,FIELD[.CHAR][FLAGS]] */
+static int parse_key(char * spec, struct key * k) {
+	char * end;
+	int flags = 0;
+
+	memset(k, 0, sizeof(struct key));
+	k->start_field = strtol(spec, &end, 10);
+	if (end == spec || k->start_field < 1) return -1;
+	if (*end == '.') {
+		k->start_char = strtol(end + 1, &end, 10);
+		if (k->start_char < 1) return -1;
+	}
+
+	char * comma = strchr(end, ',');
+	if (comma) *comma = '\0';
+	if (parse_flags(end, &flags)) return -1;
+
+	if (comma) {
+		spec = comma + 1;
+		k->end_field = strtol(spec, &end, 10);
+		if (end == spec || k->end_field < 1) return -1;
+		if (*end == '.') {
+			k->end_char = strtol(end + 1, &end, 10);
+		}
+		if (parse_flags(end, &flags)) return -1;
+	}
+
+	/* A key with no flags of its own takes the global ones */
+	k->flags = flags ? flags : -1;
+	return 0;
+}
+
+static size_t parse_size(const char * s) {
+	char * end;
+	size_t size = strtoul(s, &end, 10);
+	switch (*end) {
+		case 'k': case 'K': size <<= 10; break;
+		case 'm': case 'M': size <<= 20; break;
+		case 'g': case 'G': size <<= 30; break;
+	}
+	return size;
+}
+
+static int usage(char * argv[]) {
+	fprintf(stderr,
+			"usage: %s [-fnrsub] [-k KEY]... [-t SEP] [-o FILE] [-S SIZE] [FILE]...\n"
+			"\n"
+			" -f       \033[3mfold lower case to upper case\033[0m\n"
+			" -n       \033[3mcompare as numbers\033[0m\n"
+			" -r       \033[3mreverse the order\033[0m\n"
+			" -b       \033[3mignore leading blanks in keys\033[0m\n"
+			" -s       \033[3mkeep lines with equal keys in input order\033[0m\n"
+			" -u       \033[3monly output the first of lines with equal keys\033[0m\n"
+			" -k KEY   \033[3msort on FIELD[.CHAR][,FIELD[.CHAR]], with optional bfnr\033[0m\n"
+			" -t SEP   \033[3mfields are separated by SEP instead of blanks\033[0m\n"
+			" -o FILE  \033[3mwrite output to FILE\033[0m\n"
+			" -S SIZE  \033[3mmemory to use before sorting in temporary files\033[0m\n"
+			"\n", argv[0]);
+	return 2;
+}
+
 int main(int argc, char * argv[]) {
-	int reverse = 0;
 	int opt;
+	char * output = NULL;
 
-	list_t * lines = list_create();
-	list_t * files = list_create();
+	argv_0 = argv[0];
 
-	while ((opt = getopt(argc, argv, "r")) != -1) {
+	while ((opt = getopt(argc, argv, "bfnrsuk:t:o:S:?")) != -1) {
 		switch (opt) {
-			case 'r':
-				reverse = 1;
+			case 'b': global_flags |= KEY_BLANKS; break;
+			case 'f': global_flags |= KEY_FOLD; break;
+			case 'n': global_flags |= KEY_NUMERIC; break;
+			case 'r': global_flags |= KEY_REVERSE; break;
+			case 's': stable = 1; break;
+			case 'u': unique = 1; break;
+			case 'k':
+				if (key_count == MAX_KEYS || parse_key(optarg, &keys[key_count])) {
+					fprintf(stderr, "%s: invalid key: %s\n", argv[0], optarg);
+					return 2;
+				}
+				key_count++;
+				break;
+			case 't':
+				if (!optarg[0] || optarg[1]) {
+					fprintf(stderr, "%s: separator must be one character\n", argv[0]);
+					return 2;
+				}
+				separator = (unsigned char)optarg[0];
 				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'S':
+				budget = parse_size(optarg);
+				if (budget < READ_CHUNK) budget = READ_CHUNK;
+				break;
+			default:
+				return usage(argv);
 		}
 	}
 
+	for (int i = 0; i < key_count; ++i) {
+		if (keys[i].flags == -1) keys[i].flags = global_flags;
+	}
+	first_numeric = !!((key_count ? keys[0].flags : global_flags) & KEY_NUMERIC);
+
+	int retval = 0;
+
 	if (optind == argc) {
-		/* No arguments */
-		list_insert(files, stdin);
+		read_input(stdin);
 	} else {
-		while (optind < argc) {
-			FILE * f = fopen(argv[optind], "r");
+		for (; optind < argc; optind++) {
+			FILE * f = !strcmp(argv[optind], "-") ? stdin : fopen(argv[optind], "r");
 			if (!f) {
 				fprintf(stderr, "%s: %s: %s\n", argv[0], argv[optind], strerror(errno));
-			} else {
-				list_insert(files, f);
+				retval = 2;
+				continue;
 			}
-			optind++;
+			read_input(f);
+			if (f != stdin) fclose(f);
 		}
 	}
 
-	char line_buf[4096] = {0};
-	foreach (node, files) {
-		FILE * f = node->value;
-		while (!feof(f)) {
-			if (!fgets(line_buf, 4096, f)) {
-				break;
-			}
-			if (!strchr(line_buf,'\n')) {
-				fprintf(stderr, "%s: oversized line\n", argv[0]);
-			}
-			char * line = strdup(line_buf);
-			node_t * next = NULL;
-			foreach (lnode, lines) {
-				char * cmp = lnode->value;
-				if (reverse ? (compare(cmp, line) < 0) : (compare(line, cmp) < 0)) {
-					next = lnode;
-					break;
-				}
-			}
-			if (next) {
-				list_insert_before(lines, next, line);
-			} else {
-				list_insert(lines, line);
-			}
+	/* Only open the output once everything is read, so -o can name an input. */
+	FILE * out = stdout;
+	if (output) {
+		out = fopen(output, "w");
+		if (!out) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], output, strerror(errno));
+			return 2;
 		}
 	}
+	setvbuf(out, NULL, _IOFBF, READ_CHUNK);
 
-	foreach (lnode, lines) {
-		char * line = lnode->value;
-		fprintf(stdout, "%s", line);
+	int status;
+	if (run_count) {
+		if (line_count) spill_run();
+		status = merge_runs(out);
+	} else {
+		finish_run();
+		status = write_lines(out, lines, line_count);
 	}
 
-	return 0;
+	if (fflush(out) || status) {
+		fprintf(stderr, "%s: write error: %s\n", argv[0], strerror(errno));
+		return 2;
+	}
+
+	return retval;
 }
@@ -99,6 +99,22 @@ const char * syscall_names[] = {
 	[SYS_GETGROUPS]    = "getgroups",
 	[SYS_SETGROUPS]    = "setgroups",
 	[SYS_TIMES]        = "times",
+	[SYS_SYNC]         = "sync",
+	[SYS_FSYNC]        = "fsync",
+	[SYS_FDATASYNC]    = "fdatasync",
+	[SYS_GETPRIORITY]  = "getpriority",
+	[SYS_SETPRIORITY]  = "setpriority",
+	[SYS_SCHED_SETSCHEDULER] = "sched_setscheduler",
+	[SYS_SCHED_GETPARAM]     = "sched_getparam",
+	[SYS_SCHED_SETAFFINITY]  = "sched_setaffinity",
+	[SYS_SCHED_GETAFFINITY]  = "sched_getaffinity",
+	[SYS_GETRANDOM]    = "getrandom",
+	[SYS_OPENAT]       = "openat",
+	[SYS_FSTATAT]      = "fstatat",
+	[SYS_READLINKAT]   = "readlinkat",
+	[SYS_UNLINKAT]     = "unlinkat",
+	[SYS_MKDIRAT]      = "mkdirat",
+	[SYS_COPY_FILE_RANGE] = "copy_file_range",
 	[SYS_PTRACE]       = "ptrace",
 	[SYS_SOCKET]       = "socket",
 	[SYS_SETSOCKOPT]   = "setsockopt",
@@ -173,6 +189,22 @@ char syscall_mask[] = {
 	[SYS_GETGROUPS]    = 1,
 	[SYS_SETGROUPS]    = 1,
 	[SYS_TIMES]        = 1,
+	[SYS_SYNC]         = 1,
+	[SYS_FSYNC]        = 1,
+	[SYS_FDATASYNC]    = 1,
+	[SYS_GETPRIORITY]  = 1,
+	[SYS_SETPRIORITY]  = 1,
+	[SYS_SCHED_SETSCHEDULER] = 1,
+	[SYS_SCHED_GETPARAM]     = 1,
+	[SYS_SCHED_SETAFFINITY]  = 1,
+	[SYS_SCHED_GETAFFINITY]  = 1,
+	[SYS_GETRANDOM]    = 1,
+	[SYS_OPENAT]       = 1,
+	[SYS_FSTATAT]      = 1,
+	[SYS_READLINKAT]   = 1,
+	[SYS_UNLINKAT]     = 1,
+	[SYS_MKDIRAT]      = 1,
+	[SYS_COPY_FILE_RANGE] = 1,
 	[SYS_PTRACE]       = 1,
 	[SYS_SOCKET]       = 1,
 	[SYS_SETSOCKOPT]   = 1,
@@ -591,11 +623,76 @@ static void handle_syscall(pid_t pid, struct regs * r) {
 			uint_arg(r->rdx);
 			break;
 		case SYS_CLOSE:
+		case SYS_FSYNC:
+		case SYS_FDATASYNC:
 			fd_arg(pid, r->rbx);
 			break;
 		case SYS_SBRK:
 			uint_arg(r->rbx);
 			break;
+		case SYS_GETPRIORITY:
+			int_arg(r->rbx); COMMA;
+			int_arg(r->rcx);
+			break;
+		case SYS_SETPRIORITY:
+			int_arg(r->rbx); COMMA;
+			int_arg(r->rcx); COMMA;
+			int_arg(r->rdx);
+			break;
+		case SYS_SCHED_SETSCHEDULER:
+			int_arg(r->rbx); COMMA;
+			int_arg(r->rcx); COMMA;
+			pointer_arg(r->rdx);
+			break;
+		case SYS_SCHED_GETPARAM:
+			int_arg(r->rbx); COMMA;
+			pointer_arg(r->rcx);
+			break;
+		case SYS_SCHED_SETAFFINITY:
+		case SYS_SCHED_GETAFFINITY:
+			int_arg(r->rbx); COMMA;
+			uint_arg(r->rcx); COMMA;
+			pointer_arg(r->rdx);
+			break;
+		case SYS_GETRANDOM:
+			pointer_arg(r->rbx); COMMA;
+			uint_arg(r->rcx); COMMA;
+			uint_arg(r->rdx);
+			break;
+		case SYS_OPENAT:
+			fd_arg(pid, r->rbx); COMMA;
+			string_arg(pid, r->rcx); COMMA;
+			open_flags(r->rdx);
+			break;
+		case SYS_FSTATAT:
+			fd_arg(pid, r->rbx); COMMA;
+			string_arg(pid, r->rcx); COMMA;
+			pointer_arg(r->rdx); COMMA;
+			int_arg(r->rsi);
+			break;
+		case SYS_READLINKAT:
+			fd_arg(pid, r->rbx); COMMA;
+			string_arg(pid, r->rcx); COMMA;
+			pointer_arg(r->rdx); COMMA;
+			int_arg(r->rsi);
+			break;
+		case SYS_UNLINKAT:
+			fd_arg(pid, r->rbx); COMMA;
+			string_arg(pid, r->rcx); COMMA;
+			int_arg(r->rdx);
+			break;
+		case SYS_MKDIRAT:
+			fd_arg(pid, r->rbx); COMMA;
+			string_arg(pid, r->rcx); COMMA;
+			uint_arg(r->rdx);
+			break;
+		case SYS_COPY_FILE_RANGE:
+			fd_arg(pid, r->rbx); COMMA;
+			pointer_arg(r->rcx); COMMA;
+			fd_arg(pid, r->rdx); COMMA;
+			pointer_arg(r->rsi); COMMA;
+			uint_arg(r->rdi);
+			break;
 		case SYS_SEEK:
 			fd_arg(pid, r->rbx); COMMA;
 			int_arg(r->rcx); COMMA;
@@ -772,6 +869,7 @@ static void handle_syscall(pid_t pid, struct regs * r) {
 		case SYS_SETSID:
 		case SYS_GETGID:
 		case SYS_GETEGID:
+		case SYS_SYNC:
 			break;
 		default:
 			fprintf(logfile, "...");
@@ -0,0 +1,13 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * sync - Write cached file system data to disk
+ */
+#include <unistd.h>
+
+int main(int argc, char * argv[]) {
+	sync();
+	return 0;
+}
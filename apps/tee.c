@@ -6,11 +6,14 @@
  * tee - copy stdin to stdout and to specified files
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <signal.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <toaru/blockread.h>
 
 int main(int argc, char * argv[]) {
 	int append = 0;
@@ -29,33 +32,50 @@ int main(int argc, char * argv[]) {
 	}
 
 	int file_count = argc - optind;
-	FILE ** files = malloc(sizeof(FILE *) * file_count);
+	int * files = malloc(sizeof(int) * file_count);
+	char ** names = malloc(sizeof(char *) * file_count);
+	int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
 
 	for (int i = 0, j = optind; j < argc && i < file_count; j++) {
-		files[i] = fopen(argv[j], append ? "a" : "w");
-		if (!files[i]) {
+		files[i] = open(argv[j], flags, 0666);
+		if (files[i] < 0) {
 			fprintf(stderr, "%s: %s: %s\n", argv[0], argv[j], strerror(errno));
 			ret_val = 1;
 			file_count--;
 			continue;
 		} else {
+			names[i] = argv[j];
 			i++;
 		}
 	}
 
-	while (!feof(stdin)) {
-		int c = fgetc(stdin);
-		if (c >= 0) {
-			fputc(c, stdout);
+	block_reader_t * reader = block_reader_open(STDIN_FILENO, 0);
+	char * data;
+	ssize_t len;
+	while ((len = block_reader_next(reader, &data)) > 0) {
+		block_write_all(STDOUT_FILENO, data, len);
 
-			for (int i = 0; i < file_count; ++i) {
-				fputc(c, files[i]);
+		for (int i = 0; i < file_count; ++i) {
+			if (files[i] < 0) continue;
+			if (block_write_all(files[i], data, len) < 0) {
+				/* Keep going for the other outputs */
+				fprintf(stderr, "%s: %s: %s\n", argv[0], names[i], strerror(errno));
+				ret_val = 1;
+				close(files[i]);
+				files[i] = -1;
 			}
 		}
 	}
 
+	if (len < 0) {
+		fprintf(stderr, "%s: %s: %s\n", argv[0], "stdin", strerror(reader->error));
+		ret_val = 1;
+	}
+
+	block_reader_close(reader);
+
 	for (int i = 0; i < file_count; ++i) {
-		fclose(files[i]);
+		if (files[i] >= 0) close(files[i]);
 	}
 
 	return ret_val;
@@ -209,7 +209,6 @@ char * format_username(int uid) {
 	} else {
 		snprintf(tmp, 100, "%-8d", uid);
 	}
-	endpwent();
 	return strdup(tmp);
 }
 
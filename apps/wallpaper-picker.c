@@ -14,6 +14,7 @@
 #include <toaru/menu.h>
 #include <toaru/button.h>
 #include <toaru/list.h>
+#include <toaru/icon_cache.h>
 
 #include <sys/utsname.h>
 
@@ -64,10 +65,10 @@ static void redraw(void) {
 	/* Scale the wallpaper into the buffer. */
 	if (nw <= width) {
 		/* Scaled wallpaper is wider, height should match. */
-		draw_sprite_scaled(ctx, &wallpaper, bounds.left_width + ((int)max_width - nw) / 2, bounds.top_height, nw+2, max_height);
+		draw_sprite(ctx, icon_get_scaled(&wallpaper, nw+2, max_height), bounds.left_width + ((int)max_width - nw) / 2, bounds.top_height);
 	} else {
 		/* Scaled wallpaper is taller, width should match. */
-		draw_sprite_scaled(ctx, &wallpaper, bounds.left_width, bounds.top_height + ((int)max_height - nh) / 2, max_width+2, nh);
+		draw_sprite(ctx, icon_get_scaled(&wallpaper, max_width+2, nh), bounds.left_width, bounds.top_height + ((int)max_height - nh) / 2);
 	}
 
 	/* Draws the path for the selected wallpaper in white, centered, with a drop shadow */
@@ -156,6 +157,7 @@ void set_hilight(struct TTKButton * button, int hilight) {
 }
 
 void load_wallpaper(void) {
+	icon_cache_forget(&wallpaper);
 	if (wallpaper.bitmap) free(wallpaper.bitmap);
 	wallpaper.bitmap = NULL;
 	/* load wallpaper */
@@ -10,14 +10,49 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <errno.h>
-#include <toaru/decodeutf8.h>
+#include <fcntl.h>
+#include <toaru/blockread.h>
+
+struct counts {
+	size_t lines;
+	size_t words;
+	size_t chars;
+	size_t bytes;
+};
+
+static int show_lines = 0;
+static int show_words = 0;
+static int show_chars = 0;
+static int show_bytes = 0;
+
+static int count_file(int fd, struct counts * out) {
+	block_reader_t * reader = block_reader_open(fd, 0);
+	if (!reader) return ENOMEM;
+
+	block_words_t words = {0};
+	char * data;
+	ssize_t len;
+	while ((len = block_reader_next(reader, &data)) > 0) {
+		out->bytes += len;
+		if (show_lines) out->lines += block_count_lines(data, len);
+		if (show_words) out->words += block_count_words(data, len, &words);
+		if (show_chars) out->chars += block_count_chars(data, len);
+	}
 
-int main(int argc, char * argv[]) {
-	int show_lines = 0;
-	int show_words = 0;
-	int show_chars = 0;
-	int show_bytes = 0;
+	int error = len < 0 ? reader->error : 0;
+	block_reader_close(reader);
+	return error;
+}
+
+static void print_counts(struct counts * counts, char * name) {
+	if (show_lines) fprintf(stdout, "%zu ", counts->lines);
+	if (show_words) fprintf(stdout, "%zu ", counts->words);
+	if (show_chars) fprintf(stdout, "%zu ", counts->chars);
+	if (show_bytes) fprintf(stdout, "%zu ", counts->bytes);
+	fprintf(stdout, "%s\n", name);
+}
 
+int main(int argc, char * argv[]) {
 	int opt;
 
 	while ((opt = getopt(argc,argv,"cmlw")) != -1) {
@@ -37,10 +72,12 @@ int main(int argc, char * argv[]) {
 		}
 	}
 
+	if (!show_words && !show_chars && !show_bytes && !show_lines) {
+		show_lines = show_words = show_bytes = 1;
+	}
+
 	int retval = 0;
-	int total_lines = 0;
-	int total_chars = 0;
-	int total_words = 0;
+	struct counts total = {0};
 	int just_stdin = 0;
 
 	if (optind == argc) {
@@ -55,77 +92,33 @@ int main(int argc, char * argv[]) {
 			retval = 1;
 			continue;
 		}
-		FILE * f = (!strcmp(argv[i], "-") || just_stdin) ? stdin : fopen(argv[i], "r");
-		if (!f) {
+		int fd = (!strcmp(argv[i], "-") || just_stdin) ? STDIN_FILENO : open(argv[i], O_RDONLY);
+		if (fd < 0) {
 			fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], strerror(errno));
 			retval = 1;
 			continue;
 		}
 
-		int lines = 0;
-		int chars = 0;
-		int words = 0;
-		int ch;
-		uint32_t state, c;
-		int last_was_whitespace = 0;
-
-		while (!feof(f)) {
-			ch = getc(f);
-			if (ch < 0) break;
-
-			if (show_chars) {
-				if (!decode(&state, &c, ch)) {
-				} else if (state == UTF8_REJECT) {
-					state = 0;
-				}
-			} else {
-				c = ch;
-			}
-
-			chars++;
-			if (c == '\n') {
-				last_was_whitespace = 1;
-				lines++;
-				words++;
-			} else if (c == ' ') {
-				if (last_was_whitespace) continue;
-				last_was_whitespace = 1;
-				words++;
-			} else {
-				last_was_whitespace = 0;
-			}
-		}
-
-		if (!last_was_whitespace && chars > 0) words++;
-
-		if (!show_words && !show_chars && !show_bytes && !show_lines) {
-			fprintf(stdout, "%d %d %d %s\n", lines, words, chars, argv[i]);
-		} else {
-			if (show_lines) fprintf(stdout, "%d ", lines);
-			if (show_words) fprintf(stdout, "%d ", words);
-			if (show_bytes|show_chars) fprintf(stdout, "%d ", chars);
-			fprintf(stdout, "%s\n", argv[i]);
+		struct counts counts = {0};
+		int error = count_file(fd, &counts);
+		if (fd != STDIN_FILENO) close(fd);
+		if (error) {
+			fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], strerror(error));
+			retval = 1;
+			continue;
 		}
 
-		total_lines += lines;
-		total_words += words;
-		total_chars += chars;
+		print_counts(&counts, argv[i]);
 
-		if (f != stdin) fclose(f);
-		if (just_stdin) return 0;
+		total.lines += counts.lines;
+		total.words += counts.words;
+		total.chars += counts.chars;
+		total.bytes += counts.bytes;
 	}
 
 	if (optind + 1 < argc) {
-		if (!show_words && !show_chars && !show_bytes && !show_lines) {
-			fprintf(stdout, "%d %d %d %s\n", total_lines, total_words, total_chars, "total");
-		} else {
-			if (show_lines) fprintf(stdout, "%d ", total_lines);
-			if (show_words) fprintf(stdout, "%d ", total_words);
-			if (show_bytes|show_chars) fprintf(stdout, "%d ", total_chars);
-			fprintf(stdout, "%s\n", "total");
-		}
+		print_counts(&total, "total");
 	}
 
 	return retval;
 }
-
@@ -1,4 +1,5 @@
 #!/bin/sh
+# provides: splash
 
 # This daemonizes
 exec splash-log
@@ -1,4 +1,6 @@
 #!/bin/sh
+# provides: root
+# requires: splash
 
 if not kcmdline -q migrate then exit 0
 
@@ -1,4 +1,6 @@
 #!/bin/sh
+# provides: hostname
+# requires: splash root
 
 export-cmd HOSTNAME cat /etc/hostname
 
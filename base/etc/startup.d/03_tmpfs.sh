@@ -1,4 +1,6 @@
 #!/bin/sh
+# provides: tmpfs
+# requires: splash root
 
 echo -n "Mounting tmpfs..." > /dev/pex/splash
 mount tmpfs tmp,777 /tmp
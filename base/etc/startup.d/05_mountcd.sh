@@ -1,4 +1,6 @@
 #!/bin/sh
+# provides: cdrom
+# requires: splash root modules
 
 if not stat -Lq /dev/cdrom0 then exit 0
 
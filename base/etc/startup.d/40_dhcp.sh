@@ -1,4 +1,7 @@
 #!/bin/sh
+# provides: network
+# requires: splash root tmpfs modules
+# background
 
 if kcmdline -q no-startup-dhcp then exit 0
 
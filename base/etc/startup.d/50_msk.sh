@@ -1,4 +1,7 @@
 #!/bin/sh
+# provides: packages
+# requires: splash root tmpfs network
+# background
 
 if kcmdline -q no-startup-msk then exit 0
 
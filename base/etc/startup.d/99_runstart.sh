@@ -1,4 +1,5 @@
 #!/bin/sh
+# requires: splash root hostname tmpfs modules cdrom network
 
 export-cmd START kcmdline -g start
 
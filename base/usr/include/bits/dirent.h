@@ -16,7 +16,9 @@ typedef struct DIR {
 } DIR;
 
 DIR * opendir (const char * dirname);
+DIR * fdopendir (int fd);
 int closedir (DIR * dir);
 struct dirent * readdir (DIR * dirp);
+int dirfd (DIR * dirp);
 
 _End_C_Header
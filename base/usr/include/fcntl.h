@@ -43,8 +43,15 @@ struct flock {
 
 #define FD_CLOEXEC (1 << 0)
 
+/* For the *at() calls */
+#define AT_FDCWD            -100   /* Resolve relative to the working directory */
+#define AT_SYMLINK_NOFOLLOW 0x0100 /* fstatat: don't follow a final symlink */
+#define AT_REMOVEDIR        0x0200 /* unlinkat: the name is a directory */
+#define AT_EMPTY_PATH       0x1000 /* fstatat: an empty name means the fd itself */
+
 #ifndef __kernel__
 extern int open (const char *, int, ...);
+extern int openat(int dirfd, const char * path, int flags, ...);
 extern int chmod(const char *path, mode_t mode);
 extern int fcntl(int fd, int cmd, ...);
 #endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <_cheader.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+_Begin_C_Header
+
+struct group {
+	char *  gr_name;   // group name
+	char *  gr_passwd; // password (not meaningful)
+	gid_t   gr_gid;    // group id
+	char ** gr_mem;    // member usernames, NULL-terminated
+};
+
+struct group * getgrent(void);
+void setgrent(void);
+void endgrent(void);
+struct group * getgrnam(const char * name);
+struct group * getgrgid(gid_t gid);
+int getgrnam_r(const char * name, struct group * grp, char * buf, size_t buflen, struct group ** result);
+int getgrgid_r(gid_t gid, struct group * grp, char * buf, size_t buflen, struct group ** result);
+
+_End_C_Header
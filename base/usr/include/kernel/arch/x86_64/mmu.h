@@ -23,6 +23,8 @@ uintptr_t mmu_first_frame(void);
 void mmu_frame_allocate(union PML * page, unsigned int flags);
 void mmu_frame_map_address(union PML * page, unsigned int flags, uintptr_t physAddr);
 void mmu_frame_free(union PML * page);
+void mmu_frame_reserve(union PML * page);
+int mmu_demand_fault(uintptr_t addr, int write);
 uintptr_t mmu_map_to_physical(union PML * root, uintptr_t virtAddr);
 union PML * mmu_get_page(uintptr_t virtAddr, int flags);
 void mmu_set_directory(union PML * new_pml);
@@ -0,0 +1,16 @@
+/**
+ * @brief CRC-32 and Adler-32 checksums
+ *
+ * The kernel build of libtoaru_checksum. Start a CRC-32 at 0 and an
+ * Adler-32 at 1, and pass the result back in to continue over more data.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHECKSUM_CRC32_INIT   0
+#define CHECKSUM_ADLER32_INIT 1
+
+extern uint32_t checksum_crc32(uint32_t crc, const void * data, size_t len);
+extern uint32_t checksum_adler32(uint32_t adler, const void * data, size_t len);
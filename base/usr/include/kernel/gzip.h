@@ -6,6 +6,9 @@
  * very straightforward API: Point @c gzip_inputPtr at your gzip data,
  * point @c gzip_outputPtr where you want the output to go, and then
  * run @c gzip_decompress().
+ *
+ * Returns 0 on success, 1 if the data isn't gzip, and 2 if the
+ * decompressed data does not match the CRC or size in the trailer.
  */
 #pragma once
 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Kernel log levels; lower is more important */
+#define KMSG_LEVEL_ERROR   3
+#define KMSG_LEVEL_WARNING 4
+#define KMSG_LEVEL_NOTICE  5
+#define KMSG_LEVEL_INFO    6
+#define KMSG_LEVEL_DEBUG   7
+
+/* ioctls on /dev/console */
+#define IO_KMSG_GET_LEVELS 0x4B01
+#define IO_KMSG_SET_LEVELS 0x4B02
+#define IO_KMSG_GET_STATS  0x4B03
+
+struct kmsg_levels {
+	int console;  /* messages at or below this level are written to the console */
+	int record;   /* messages above this level are discarded outright */
+};
+
+struct kmsg_stats {
+	uint64_t records;         /* messages logged */
+	uint64_t dropped;         /* messages lost to a full ring */
+	uint64_t log_ns_max;      /* longest time a dprintf() took */
+	uint64_t log_ns_total;
+	uint64_t console_ns_max;  /* longest time one message took to write to the console */
+	uint64_t console_ns_total;
+	uint64_t console_records; /* messages written to the console */
+};
+
+#ifdef _KERNEL_
+/* Put one of these in front of a dprintf() format, as in dprintf(LOG_DEBUG "..."). */
+#define LOG_ERROR   "\0013"
+#define LOG_WARNING "\0014"
+#define LOG_NOTICE  "\0015"
+#define LOG_INFO    "\0016"
+#define LOG_DEBUG   "\0017"
+#endif
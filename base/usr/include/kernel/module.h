@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <kernel/hashmap.h>
 
 struct Module {
@@ -15,4 +16,18 @@ struct LoadedModule {
 	size_t loadedSize;
 };
 
+/**
+ * PCI vendor:device pairs a module drives. Listed in their own
+ * section so `modprobe` can find them without loading the module.
+ */
+struct ModulePciId {
+	uint16_t vendor;
+	uint16_t device;
+};
+
+#define MODULE_PCI_SECTION "modpci"
+#define MODULE_PCI_IDS(...) \
+	__attribute__((section(MODULE_PCI_SECTION), used)) \
+	static const struct ModulePciId module_pci_ids[] = { __VA_ARGS__ }
+
 hashmap_t * modules_get_list(void);
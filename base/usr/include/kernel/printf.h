@@ -2,6 +2,7 @@
 
 #include <stdarg.h>
 #include <kernel/types.h>
+#include <kernel/kmsg.h>
 
 __attribute__((format(__printf__,1,2)))
 extern int printf(const char *fmt, ...);
@@ -13,3 +14,6 @@ extern size_t xvasprintf(int (*callback)(void *, char), void * userData, const c
 __attribute__((format(__printf__,1,2)))
 extern int dprintf(const char *fmt, ...);
 extern void console_set_output(size_t (*output)(size_t,uint8_t*));
+extern void console_start(void);
+extern void console_tick(void);
+extern void console_panic(void);
@@ -10,6 +10,7 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/signal_defs.h>
+#include <sched.h>
 
 #define PROC_REUSE_FDS 0x0001
 #define KERNEL_STACK_SIZE 0x9000
@@ -55,6 +56,7 @@ typedef struct file_descriptors {
 	fs_node_t ** entries;
 	uint64_t * offsets;
 	int * modes;
+	char ** paths;          /* Paths of open directories, for the *at() calls */
 	size_t length;
 	size_t capacity;
 	size_t refs;
@@ -97,6 +99,8 @@ typedef struct process {
 	fd_table_t *  fds;               /* File descriptor table */
 
 	tree_node_t * tree_entry;
+	struct process * pid_next;       /* Next process in this PID hash bucket */
+	unsigned long generation;        /* Set when added to the PID table; never reused */
 	struct regs * syscall_registers;
 	struct regs * interrupt_registers;
 	list_t * wait_queue;
@@ -134,16 +138,35 @@ typedef struct process {
 	uint64_t time_sys_children; /* sum of sys times from waited-for children */
 	uint16_t usage[4];          /* four permille samples over some period (currently 4Hz) */
 
+	/* Scheduling */
+	int sched_policy;           /* SCHED_OTHER, SCHED_FIFO, or SCHED_RR */
+	int sched_priority;         /* static priority for the real-time policies */
+	int nice;                   /* -20 to 19; sets the length of a SCHED_OTHER time slice */
+	int time_slice;             /* timer ticks left before this process is preempted */
+	int sched_boost;            /* last blocked before its slice ran out; runs ahead of CPU-bound processes */
+	uint64_t cpu_affinity;      /* bitmap of cores this process may run on */
+
 	/* Tracing */
 	pid_t tracer;
 	spin_lock_t wait_lock;
 	list_t * tracees;
 } process_t;
 
+/**
+ * A process pointer that may outlive the process. Its address and PID
+ * can both be reused, but not its generation, so is_valid_process()
+ * can check it with one PID table lookup without dereferencing it.
+ */
+typedef struct {
+	process_t * process;
+	pid_t pid;
+	unsigned long generation;
+} process_handle_t;
+
 typedef struct {
 	uint64_t end_tick;
 	uint64_t end_subtick;
-	process_t * process;
+	process_handle_t handle;
 	int is_fswait;
 } sleeper_t;
 
@@ -214,12 +237,18 @@ extern int wakeup_queue(list_t * queue);
 extern int wakeup_queue_interrupted(list_t * queue);
 extern int sleep_on(list_t * queue);
 extern int sleep_on_unlocking(list_t * queue, spin_lock_t * release);
-extern int process_alert_node(process_t * process, void * value);
+extern int process_alert_node(process_handle_t * handle, void * value);
+extern process_handle_t * process_handle(process_t * process);
+extern int is_valid_process(process_handle_t * handle);
+extern void process_handle_insert(list_t * list, process_t * process);
 extern void sleep_until(process_t * process, unsigned long seconds, unsigned long subseconds);
 extern void switch_task(uint8_t reschedule);
 extern int process_wait_nodes(process_t * process,fs_node_t * nodes[], int timeout);
 extern process_t * process_get_parent(process_t * process);
 extern int process_is_ready(process_t * proc);
+extern int process_tick(void);
+extern int process_ready_waiting(void);
+extern void process_set_scheduling(process_t * proc, int policy, int priority, int nice);
 extern void wakeup_sleepers(unsigned long seconds, unsigned long subseconds);
 extern void task_exit(int retval);
 extern __attribute__((noreturn)) void switch_next(void);
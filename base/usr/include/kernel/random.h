@@ -0,0 +1,8 @@
+#pragma once
+
+#include <kernel/types.h>
+
+extern void random_get_bytes(void * buffer, size_t size);
+extern void random_add_entropy(const void * data, size_t len);
+extern uint32_t rand(void);
+extern void random_initialize(void);
@@ -12,6 +12,8 @@
 	(this_core->current_process->fds->offsets[(FD)])
 #define FD_MODE(FD) \
 	(this_core->current_process->fds->modes[(FD)])
+#define FD_PATH(FD) \
+	(this_core->current_process->fds->paths[(FD)])
 
 #define PTR_INRANGE(PTR) \
 	((uintptr_t)(PTR) > this_core->current_process->image.entry && ((uintptr_t)(PTR) < 0x8000000000000000))
@@ -50,6 +50,8 @@ typedef int (*selectcheck_type_t) (struct fs_node *);
 typedef int (*selectwait_type_t) (struct fs_node *, void * process);
 typedef int (*chown_type_t) (struct fs_node *, uid_t, gid_t);
 typedef int (*truncate_type_t) (struct fs_node *);
+typedef int (*sync_type_t) (struct fs_node *, int datasync);
+typedef ssize_t (*copy_range_type_t) (struct fs_node * src, off_t src_off, struct fs_node * dst, off_t dst_off, size_t size);
 
 typedef struct fs_node {
 	char name[256];         /* The filename. */
@@ -93,6 +95,9 @@ typedef struct fs_node {
 	selectwait_type_t selectwait;
 
 	chown_type_t chown;
+
+	sync_type_t sync;       /* Write back cached data; with datasync, metadata only as far as needed to read it back */
+	copy_range_type_t copy_range; /* Copy between two nodes of the same file system without a user buffer */
 } fs_node_t;
 
 struct vfs_entry {
@@ -115,6 +120,10 @@ fs_node_t *finddir_fs(fs_node_t *node, char *name);
 int mkdir_fs(char *name, mode_t permission);
 int create_file_fs(char *name, mode_t permission);
 fs_node_t *kopen(const char *filename, unsigned int flags);
+fs_node_t *kopen_at(fs_node_t * dir, const char * dir_path, const char *filename, unsigned int flags);
+int mkdir_at_fs(fs_node_t * dir, const char * dir_path, char * name, mode_t permission);
+int create_file_at_fs(fs_node_t * dir, const char * dir_path, char * name, mode_t permission);
+int unlink_at_fs(fs_node_t * dir, const char * dir_path, char * name);
 char *canonicalize_path(const char *cwd, const char *input);
 fs_node_t *clone_fs(fs_node_t * source);
 int ioctl_fs(fs_node_t *node, unsigned long request, void * argp);
@@ -126,6 +135,9 @@ ssize_t readlink_fs(fs_node_t * node, char * buf, size_t size);
 int selectcheck_fs(fs_node_t * node);
 int selectwait_fs(fs_node_t * node, void * process);
 int truncate_fs(fs_node_t * node);
+int sync_fs(fs_node_t * node, int datasync);
+ssize_t copy_range_fs(fs_node_t * src, off_t src_off, fs_node_t * dst, off_t dst_off, size_t size);
+void vfs_sync(void);
 
 void vfs_install(void);
 void * vfs_mount(const char * path, fs_node_t * local_root);
@@ -24,5 +24,7 @@ void setpwent(void);
 void endpwent(void);
 struct passwd * getpwnam(const char * name);
 struct passwd * getpwuid(uid_t uid);
+int getpwnam_r(const char * name, struct passwd * pwd, char * buf, size_t buflen, struct passwd ** result);
+int getpwuid_r(uid_t uid, struct passwd * pwd, char * buf, size_t buflen, struct passwd ** result);
 
 _End_C_Header
@@ -1,7 +1,48 @@
 #pragma once
 
 #include <_cheader.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 _Begin_C_Header
+
+/* Scheduling policies */
+#define SCHED_OTHER 0 /* Time-shared, weighted by nice value */
+#define SCHED_FIFO  1 /* Real-time; runs until it blocks or yields */
+#define SCHED_RR    2 /* Real-time; round-robin among equal priorities */
+
+/* Static priorities for the real-time policies; higher runs first */
+#define SCHED_PRIORITY_MIN 1
+#define SCHED_PRIORITY_MAX 99
+
+struct sched_param {
+	int sched_priority;
+};
+
+/* One bit per core */
+#define CPU_SETSIZE 64
+
+typedef struct {
+	uint64_t bits;
+} cpu_set_t;
+
+#define CPU_ZERO(set)      ((set)->bits = 0)
+#define CPU_SET(cpu, set)  ((set)->bits |= (1ULL << (cpu)))
+#define CPU_CLR(cpu, set)  ((set)->bits &= ~(1ULL << (cpu)))
+#define CPU_ISSET(cpu, set) (!!((set)->bits & (1ULL << (cpu))))
+#define CPU_COUNT(set)     (__builtin_popcountll((set)->bits))
+
+#ifndef _KERNEL_
 extern int sched_yield(void);
+extern int sched_get_priority_min(int policy);
+extern int sched_get_priority_max(int policy);
+extern int sched_setscheduler(pid_t pid, int policy, const struct sched_param * param);
+extern int sched_getscheduler(pid_t pid);
+extern int sched_setparam(pid_t pid, const struct sched_param * param);
+extern int sched_getparam(pid_t pid, struct sched_param * param);
+extern int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t * mask);
+extern int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t * mask);
+#endif
+
 _End_C_Header
@@ -37,6 +37,10 @@ extern unsigned long long int strtoull(const char *nptr, char **endptr, int base
 extern void srand(unsigned int);
 extern int rand(void);
 
+extern unsigned int arc4random(void);
+extern void arc4random_buf(void * buf, size_t nbytes);
+extern unsigned int arc4random_uniform(unsigned int upper_bound);
+
 #define ATEXIT_MAX 32
 extern int atexit(void (*h)(void));
 extern void _handle_atexit(void);
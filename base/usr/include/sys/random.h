@@ -0,0 +1,17 @@
+#pragma once
+
+#include <_cheader.h>
+#include <sys/types.h>
+#include <stddef.h>
+
+_Begin_C_Header
+
+/* Accepted for compatibility; the kernel generator never blocks */
+#define GRND_NONBLOCK 0x1
+#define GRND_RANDOM   0x2
+
+#ifndef _KERNEL_
+extern ssize_t getrandom(void * buf, size_t buflen, unsigned int flags);
+#endif
+
+_End_C_Header
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <_cheader.h>
+#include <sys/types.h>
+
+_Begin_C_Header
+
+/* Targets for getpriority/setpriority */
+#define PRIO_PROCESS 0
+#define PRIO_PGRP    1
+#define PRIO_USER    2
+
+/* Range of nice values; lower values get more of the processor */
+#define PRIO_MIN (-20)
+#define PRIO_MAX 19
+
+#ifndef _KERNEL_
+extern int getpriority(int which, id_t who);
+extern int setpriority(int which, id_t who, int prio);
+#endif
+
+_End_C_Header
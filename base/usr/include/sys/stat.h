@@ -77,7 +77,9 @@ struct stat  {
 extern int stat(const char *file, struct stat *st);
 extern int lstat(const char *path, struct stat *st);
 extern int fstat(int fd, struct stat *st);
+extern int fstatat(int dirfd, const char *path, struct stat *st, int flags);
 extern int mkdir(const char *pathname, mode_t mode);
+extern int mkdirat(int dirfd, const char *pathname, mode_t mode);
 extern mode_t umask(mode_t mask);
 
 _End_C_Header
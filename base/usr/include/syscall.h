@@ -130,6 +130,22 @@ DECL_SYSCALL1(setgid, unsigned int);
 DECL_SYSCALL2(getgroups, int, int*);
 DECL_SYSCALL2(setgroups, int, const int*);
 DECL_SYSCALL1(times, struct tms*);
+DECL_SYSCALL0(sync);
+DECL_SYSCALL1(fsync, int);
+DECL_SYSCALL1(fdatasync, int);
+DECL_SYSCALL2(getpriority, int, int);
+DECL_SYSCALL3(setpriority, int, int, int);
+DECL_SYSCALL3(sched_setscheduler, int, int, const void*);
+DECL_SYSCALL2(sched_getparam, int, void*);
+DECL_SYSCALL3(sched_setaffinity, int, unsigned long, const void*);
+DECL_SYSCALL3(sched_getaffinity, int, unsigned long, void*);
+DECL_SYSCALL3(getrandom, void*, unsigned long, unsigned int);
+DECL_SYSCALL4(openat, int, const char*, int, int);
+DECL_SYSCALL4(fstatat, int, const char*, void*, int);
+DECL_SYSCALL4(readlinkat, int, const char*, char*, long);
+DECL_SYSCALL3(unlinkat, int, const char*, int);
+DECL_SYSCALL3(mkdirat, int, const char*, unsigned int);
+DECL_SYSCALL5(copy_file_range, int, long*, int, long*, unsigned long);
 DECL_SYSCALL4(ptrace, int, int, void*, void*);
 
 _End_C_Header
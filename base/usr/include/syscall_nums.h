@@ -72,3 +72,19 @@
 #define SYS_GETGROUPS 69
 #define SYS_SETGROUPS 70
 #define SYS_TIMES 71
+#define SYS_SYNC 72
+#define SYS_FSYNC 73
+#define SYS_FDATASYNC 74
+#define SYS_GETPRIORITY 75
+#define SYS_SETPRIORITY 76
+#define SYS_SCHED_SETSCHEDULER 77
+#define SYS_SCHED_GETPARAM 78
+#define SYS_SCHED_SETAFFINITY 79
+#define SYS_SCHED_GETAFFINITY 80
+#define SYS_GETRANDOM 81
+#define SYS_OPENAT 82
+#define SYS_FSTATAT 83
+#define SYS_READLINKAT 84
+#define SYS_UNLINKAT 85
+#define SYS_MKDIRAT 86
+#define SYS_COPY_FILE_RANGE 87
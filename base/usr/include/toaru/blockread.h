@@ -0,0 +1,45 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * Block-at-a-time input for text utilities.
+ *
+ * Input is read from a file descriptor in large blocks, and the
+ * counting helpers scan a block eight bytes at a time instead of
+ * classifying each byte through stdio and ctype.
+ */
+#pragma once
+
+#include <_cheader.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+_Begin_C_Header
+
+#define BLOCK_READER_SIZE (64 * 1024)
+
+typedef struct block_reader {
+	int fd;
+	size_t size;
+	char * buffer;
+	int error;        /* errno of a failed read, or 0 */
+} block_reader_t;
+
+/* Word counting state carried between blocks */
+typedef struct block_words {
+	int in_word;
+} block_words_t;
+
+extern block_reader_t * block_reader_open(int fd, size_t size);
+extern ssize_t block_reader_next(block_reader_t * reader, char ** data);
+extern void block_reader_close(block_reader_t * reader);
+
+extern size_t block_count_lines(const char * data, size_t len);
+extern size_t block_count_chars(const char * data, size_t len);
+extern size_t block_count_words(const char * data, size_t len, block_words_t * state);
+extern size_t block_skip_lines(const char * data, size_t len, size_t * lines);
+
+extern int block_write_all(int fd, const char * data, size_t len);
+
+_End_C_Header
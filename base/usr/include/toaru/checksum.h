@@ -0,0 +1,27 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * CRC-32 and Adler-32 checksums.
+ *
+ * Both take the running checksum and return it updated with another
+ * block of data, so a stream can be checked a piece at a time. Start
+ * a CRC-32 at 0 and an Adler-32 at 1; the values match zlib's crc32()
+ * and adler32().
+ */
+#pragma once
+
+#include <_cheader.h>
+#include <stdint.h>
+#include <stddef.h>
+
+_Begin_C_Header
+
+#define CHECKSUM_CRC32_INIT   0
+#define CHECKSUM_ADLER32_INIT 1
+
+uint32_t checksum_crc32(uint32_t crc, const void * data, size_t len);
+uint32_t checksum_adler32(uint32_t adler, const void * data, size_t len);
+
+_End_C_Header
@@ -87,6 +87,8 @@ extern int load_sprite_bmp(sprite_t * sprite, const char * filename);
 extern void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y);
 extern void draw_sprite_scaled(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, uint16_t width, uint16_t height);
 extern void draw_sprite_scaled_alpha(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, uint16_t width, uint16_t height, float alpha);
+extern sprite_t * gfx_sprite_halve(const sprite_t * sprite);
+extern sprite_t * gfx_sprite_resample(const sprite_t * sprite, uint16_t width, uint16_t height);
 extern void draw_sprite_alpha(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, float alpha);
 extern void draw_sprite_alpha_paint(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, float alpha, uint32_t c);
 extern void draw_sprite_rotate(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, float rotation, float alpha);
@@ -120,6 +122,30 @@ extern float gfx_line_distance(const struct gfx_point * p, const struct gfx_poin
 extern void draw_line_aa_points(gfx_context_t * ctx, struct gfx_point *v, struct gfx_point *w, uint32_t color, float thickness);
 extern void draw_line_aa(gfx_context_t * ctx, int x_1, int x_2, int y_1, int y_2, uint32_t color, float thickness);
 
+typedef struct gfx_path gfx_path_t;
+
+struct gfx_edge {
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+};
+
+#define GFX_FILL_NONZERO 0
+#define GFX_FILL_EVENODD 1
+
+extern gfx_path_t * gfx_path_create(void);
+extern void gfx_path_free(gfx_path_t * path);
+extern void gfx_path_reset(gfx_path_t * path);
+extern void gfx_path_move_to(gfx_path_t * path, float x, float y);
+extern void gfx_path_line_to(gfx_path_t * path, float x, float y);
+extern void gfx_path_quad_to(gfx_path_t * path, float cx, float cy, float x, float y);
+extern void gfx_path_cubic_to(gfx_path_t * path, float c1x, float c1y, float c2x, float c2y, float x, float y);
+extern void gfx_path_close(gfx_path_t * path);
+extern void gfx_path_fill(gfx_context_t * ctx, gfx_path_t * path, uint32_t color, int rule);
+extern void gfx_path_stroke(gfx_context_t * ctx, gfx_path_t * path, float width, uint32_t color);
+extern void gfx_fill_edges(gfx_context_t * ctx, const struct gfx_edge * edges, size_t count, uint32_t color, int rule);
+
 struct gradient_definition {
 	int height;
 	int y;
@@ -129,6 +155,13 @@ struct gradient_definition {
 
 extern uint32_t gfx_vertical_gradient_pattern(int32_t x, int32_t y, double alpha, void * extra);
 
+/* Span shaders fill @p count premultiplied pixels starting at (x,y) */
+typedef void (*gfx_span_shader_t)(uint32_t * span, int32_t x, int32_t y, int32_t count, void * extra);
+
+extern void gfx_vertical_gradient_span(uint32_t * span, int32_t x, int32_t y, int32_t count, void * extra);
+extern void gfx_fill_span(uint32_t * span, int32_t x, int32_t y, int32_t count, void * extra);
+extern void draw_rounded_rectangle_span(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, int radius, gfx_span_shader_t shader, void * extra);
+
 extern gfx_context_t * init_graphics_subregion(gfx_context_t * base, int x, int y, int width, int height);
 
 extern void gfx_matrix_identity(gfx_matrix_t);
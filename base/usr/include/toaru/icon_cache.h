@@ -7,6 +7,8 @@ _Begin_C_Header
 
 extern sprite_t * icon_get_16(const char * name);
 extern sprite_t * icon_get_48(const char * name);
+extern sprite_t * icon_get_scaled(const sprite_t * sprite, uint16_t width, uint16_t height);
+extern void icon_cache_forget(const sprite_t * sprite);
 
 _End_C_Header
 
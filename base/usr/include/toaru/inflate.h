@@ -31,7 +31,13 @@ struct inflate_context {
 	struct huff_ring * ring;
 };
 
+/*
+ * These return 0 on success, 1 if the input isn't something we can
+ * decompress, and 2 if it decompressed but its checksum or size did
+ * not match. Output has already been written by the time that's known.
+ */
 int deflate_decompress(struct inflate_context * ctx);
 int gzip_decompress(struct inflate_context * ctx);
+int zlib_decompress(struct inflate_context * ctx);
 
 _End_C_Header
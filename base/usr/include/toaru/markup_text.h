@@ -9,4 +9,23 @@ int markup_string_height(const char * str);
 int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint32_t color);
 void markup_text_init(void);
 
+/**
+ * A parsed and positioned markup string. Building one runs the parser
+ * and measures every run once; drawing only walks the runs that fall
+ * within the target context.
+ *
+ * With MARKUP_LAYOUT_DOCUMENT, whitespace separates words, lines wrap
+ * at max_width, &lt; and &gt; are decoded, and h1/mono are blocks;
+ * runs are placed below y rather than on it.
+ */
+typedef struct markup_layout markup_layout_t;
+
+#define MARKUP_LAYOUT_DOCUMENT (1 << 0)
+
+markup_layout_t * markup_layout_create(const char * str, int max_width, int flags);
+void markup_layout_free(markup_layout_t * layout);
+int markup_layout_width(markup_layout_t * layout);
+int markup_layout_height(markup_layout_t * layout);
+int markup_layout_draw(gfx_context_t * ctx, markup_layout_t * layout, int x, int y, uint32_t color);
+
 _End_C_Header
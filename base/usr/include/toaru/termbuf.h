@@ -0,0 +1,101 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * Shadow-screen terminal output.
+ *
+ * Applications write escape sequences and text as they normally
+ * would; they are applied to a grid of cells instead of being sent
+ * to the terminal. termbuf_flush() compares that grid with what the
+ * terminal is known to show and sends only the differences, as one
+ * write.
+ */
+#pragma once
+
+#include <_cheader.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+_Begin_C_Header
+
+/* Cell attributes */
+#define TERMBUF_BOLD      (1 << 0)
+#define TERMBUF_ITALIC    (1 << 1)
+#define TERMBUF_UNDERLINE (1 << 2)
+#define TERMBUF_INVERSE   (1 << 3)
+
+/* Colors: default, one of the 256 indexed colors, or 24-bit */
+#define TERMBUF_COLOR_DEFAULT  0
+#define TERMBUF_COLOR_INDEX(n) (0x01000000 | ((n) & 0xFF))
+#define TERMBUF_COLOR_RGB(r,g,b) (0x02000000 | (((r) & 0xFF) << 16) | (((g) & 0xFF) << 8) | ((b) & 0xFF))
+
+/* Creation flags */
+#define TERMBUF_LINE_MODE (1 << 0) /* A single line at an unknown row; only column movement is used */
+#define TERMBUF_BCE       (1 << 1) /* Erasing fills with the current background color */
+
+typedef struct {
+	uint32_t codepoint;        /* 0 for the right half of a wide character */
+	uint32_t fg;
+	uint32_t bg;
+	uint8_t  attr;
+	uint8_t  width;
+} termbuf_cell_t;
+
+typedef struct termbuf {
+	FILE * stream;
+	int width;
+	int height;
+	int flags;
+
+	termbuf_cell_t * screen;   /* What the terminal shows */
+	termbuf_cell_t * next;     /* What the application has drawn */
+
+	/* Application state, as set by the sequences it wrote */
+	int x, y;
+	int saved_x, saved_y;
+	int cursor_visible;
+	int scroll_top, scroll_bottom;
+	termbuf_cell_t pen;
+
+	/* Terminal state; -1 where unknown */
+	int term_x, term_y;
+	int term_cursor_visible;
+	termbuf_cell_t term_pen;
+	int term_pen_valid;
+
+	int valid;                 /* screen matches the terminal */
+	int dirty;                 /* next has changed since the last flush */
+	int suspended;             /* pass everything straight through */
+
+	/* Escape sequence parser */
+	int state;
+	char seq[64];
+	int seq_len;
+	uint32_t utf8_state;
+	uint32_t utf8_codepoint;
+
+	/* Pending output */
+	char * out;
+	size_t out_len;
+	size_t out_size;
+
+	/* Statistics */
+	size_t bytes_written;
+	size_t frames;
+} termbuf_t;
+
+extern termbuf_t * termbuf_create(FILE * stream, int width, int height, int flags);
+extern void termbuf_free(termbuf_t * tb);
+extern void termbuf_resize(termbuf_t * tb, int width, int height);
+extern void termbuf_write(termbuf_t * tb, const char * data, size_t len);
+extern int  termbuf_printf(termbuf_t * tb, const char * fmt, ...);
+extern int  termbuf_vprintf(termbuf_t * tb, const char * fmt, va_list args);
+extern void termbuf_scroll(termbuf_t * tb, int top, int bottom, int amount);
+extern void termbuf_flush(termbuf_t * tb);
+extern void termbuf_invalidate(termbuf_t * tb);
+extern void termbuf_suspend(termbuf_t * tb);
+extern void termbuf_resume(termbuf_t * tb);
+
+_End_C_Header
@@ -4,6 +4,8 @@
 
 extern struct TT_Font * tt_font_from_file(const char * fileName);
 extern struct TT_Font * tt_font_from_shm(const char * identifier);
+extern struct TT_Font * tt_font_from_memory(uint8_t * buffer);
+extern struct TT_Font * tt_font_from_file_mem(const char * fileName);
 extern int tt_glyph_for_codepoint(struct TT_Font * font, unsigned int codepoint);
 extern void tt_draw_glyph(gfx_context_t * ctx, struct TT_Font * font, int x_offset, int y_offset, unsigned int glyph, uint32_t color);
 extern void tt_set_size(struct TT_Font * font, float sizeInEm);
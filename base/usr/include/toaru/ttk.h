@@ -0,0 +1,174 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * Retained-mode widget toolkit.
+ *
+ * Widgets form a tree that is laid out once and then rendered into a
+ * surface the window keeps. Changing a widget only invalidates its own
+ * rows; ttk_window_update() redraws just those and sends the changed
+ * rectangles to the compositor with yutani_flip_region().
+ */
+#pragma once
+
+#include <_cheader.h>
+#include <toaru/graphics.h>
+#include <toaru/yutani.h>
+#include <toaru/list.h>
+
+_Begin_C_Header
+
+struct ttk_window;
+
+/* Widget state bits */
+#define TTK_STATE_HOVER    (1 << 0)
+#define TTK_STATE_PRESSED  (1 << 1)
+#define TTK_STATE_FOCUSED  (1 << 2)
+#define TTK_STATE_DISABLED (1 << 3)
+
+/* Widget flags */
+#define TTK_FLAG_FOCUSABLE   (1 << 0) /* Takes keyboard focus when clicked */
+#define TTK_FLAG_HOVERABLE   (1 << 1) /* Redraws when hovered or pressed */
+#define TTK_FLAG_CONTAINER   (1 << 2) /* Draws before its children */
+#define TTK_FLAG_SCROLLABLE  (1 << 3) /* Children render into its own surface */
+
+#define TTK_VERTICAL   0
+#define TTK_HORIZONTAL 1
+
+#define TTK_ALIGN_LEFT   0
+#define TTK_ALIGN_CENTER 1
+#define TTK_ALIGN_RIGHT  2
+
+#define TTK_FONT_SANS      0
+#define TTK_FONT_SANS_BOLD 1
+#define TTK_FONT_MONO      2
+#define TTK_FONT_MONO_BOLD 3
+
+struct ttk_rect {
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+typedef struct ttk_widget {
+	/**
+	 * Render the widget. @p ctx covers the widget's rows from @p top
+	 * down and has already been filled with the background.
+	 */
+	void (*draw)(struct ttk_widget * self, gfx_context_t * ctx, int top);
+	/* Position children within self->rect */
+	void (*layout)(struct ttk_widget * self);
+	/* Mouse input, in widget coordinates; return non-zero if handled */
+	int  (*mouse)(struct ttk_widget * self, struct yutani_msg_window_mouse_event * me, int x, int y);
+	/* Keyboard input while focused; return non-zero if handled */
+	int  (*key)(struct ttk_widget * self, struct yutani_msg_key_event * ke);
+	/* Release widget-specific data */
+	void (*destroy)(struct ttk_widget * self);
+
+	/* Called when a button is clicked, enter is pressed in an entry, or a list row is activated */
+	void (*activate)(struct ttk_widget * self);
+
+	struct ttk_window * window;
+	struct ttk_widget * parent;
+	struct ttk_widget * owner; /* scroll view whose surface this renders into, or NULL */
+	list_t * children;
+
+	struct ttk_rect rect;      /* position within the owning surface */
+	int min_width;
+	int min_height;
+	int expand;                /* share of leftover space in a box */
+
+	int flags;
+	int state;
+	uint32_t background;
+
+	/* Scrollable widgets: where children render, and how far it is scrolled */
+	gfx_context_t * content;
+	int scroll_y;
+
+	/* Rows waiting to be redrawn, as [dirty_top, dirty_bottom) */
+	int dirty_top;
+	int dirty_bottom;
+
+	void * user_data;
+} ttk_widget_t;
+
+#define TTK_MAX_DAMAGE 16
+
+typedef struct ttk_window {
+	yutani_t * yctx;
+	yutani_window_t * window;
+	gfx_context_t * ctx;
+	char * title;
+
+	ttk_widget_t * root;
+	int top_inset;             /* rows below the decorations reserved for a menu bar */
+	void (*draw_chrome)(struct ttk_window * self);
+
+	struct ttk_rect area;      /* window area covered by the retained surface */
+	sprite_t * surface_sprite;
+	gfx_context_t * surface;
+
+	ttk_widget_t * hover;
+	ttk_widget_t * pressed;
+	ttk_widget_t * focus;
+
+	int needs_layout;
+	int pending;
+	int damage_count;
+	struct ttk_rect damage[TTK_MAX_DAMAGE];
+
+	void * user_data;
+} ttk_window_t;
+
+/* Windows */
+extern ttk_window_t * ttk_window_create(yutani_t * yctx, yutani_window_t * window, gfx_context_t * ctx, char * title, int top_inset);
+extern void ttk_window_set_root(ttk_window_t * win, ttk_widget_t * root);
+extern void ttk_window_draw(ttk_window_t * win);
+extern void ttk_window_update(ttk_window_t * win);
+extern void ttk_window_resize(ttk_window_t * win);
+extern int  ttk_window_mouse_event(ttk_window_t * win, struct yutani_msg_window_mouse_event * me);
+extern int  ttk_window_key_event(ttk_window_t * win, struct yutani_msg_key_event * ke);
+extern void ttk_window_free(ttk_window_t * win);
+
+/* Generic widget operations */
+extern ttk_widget_t * ttk_widget_create(size_t size);
+extern void ttk_widget_add(ttk_widget_t * parent, ttk_widget_t * child);
+extern void ttk_widget_invalidate(ttk_widget_t * widget);
+extern void ttk_widget_invalidate_rows(ttk_widget_t * widget, int y, int height);
+extern void ttk_widget_scroll(ttk_widget_t * widget, int y, int height, int delta);
+extern void ttk_widget_set_disabled(ttk_widget_t * widget, int disabled);
+extern void ttk_widget_free(ttk_widget_t * widget);
+
+/* Box layout */
+extern ttk_widget_t * ttk_box_create(int direction, int spacing, int padding);
+
+/* Label */
+extern ttk_widget_t * ttk_label_create(const char * text, int font, int size);
+extern void ttk_label_set_text(ttk_widget_t * label, const char * text);
+extern void ttk_label_set_align(ttk_widget_t * label, int align);
+extern void ttk_label_set_font(ttk_widget_t * label, int font, int size);
+extern void ttk_label_set_color(ttk_widget_t * label, uint32_t color);
+
+/* Button */
+extern ttk_widget_t * ttk_button_create(const char * title, void (*activate)(ttk_widget_t *));
+
+/* Scroll view */
+extern ttk_widget_t * ttk_scroll_view_create(ttk_widget_t * child);
+extern void ttk_scroll_view_scroll_to(ttk_widget_t * view, int offset);
+
+/* List view */
+extern ttk_widget_t * ttk_list_view_create(int row_height);
+extern void ttk_list_view_set_items(ttk_widget_t * list, char ** items, int count);
+extern void ttk_list_view_select(ttk_widget_t * list, int index);
+extern int  ttk_list_view_selected(ttk_widget_t * list);
+extern void ttk_list_view_scroll_to(ttk_widget_t * list, int offset);
+
+/* Text entry */
+extern ttk_widget_t * ttk_entry_create(int font, int size);
+extern void ttk_entry_set_text(ttk_widget_t * entry, const char * text);
+extern const char * ttk_entry_get_text(ttk_widget_t * entry);
+
+_End_C_Header
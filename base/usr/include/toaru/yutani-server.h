@@ -82,6 +82,13 @@ static int yutani_is_closing_animation[] = {
 /* Debug Options */
 #define YUTANI_DEBUG_WINDOW_BOUNDS 1
 #define YUTANI_DEBUG_WINDOW_SHAPES 1
+#define YUTANI_DEBUG_BLEND_COUNT 1
+
+/*
+ * Number of frames a window has to go without damage before
+ * it is folded into the static layer cache.
+ */
+#define YUTANI_STATIC_SETTLE_FRAMES 4
 
 /* Command line flag values */
 struct {
@@ -161,6 +168,12 @@ typedef struct YutaniServerWindow {
 
 	/* Window is hidden? */
 	int hidden;
+
+	/* Client is waiting for a FRAME_DONE */
+	int frame_requested;
+
+	/* Frame in which the window was last damaged */
+	uint64_t last_damage;
 } yutani_server_window_t;
 
 typedef struct YutaniGlobals {
@@ -209,6 +222,9 @@ typedef struct YutaniGlobals {
 	/* Damage region list */
 	list_t * update_list;
 
+	/* Windows waiting for a FRAME_DONE, by wid */
+	list_t * frame_requests;
+
 	/* Mouse cursors */
 	sprite_t mouse_sprite;
 	sprite_t mouse_sprite_drag;
@@ -285,6 +301,11 @@ typedef struct YutaniGlobals {
 	int debug_bounds;
 	int debug_shapes;
 
+	/* Report how many window rows were blended each frame */
+	int debug_blends;
+	size_t blend_rows;
+	size_t static_rows;
+
 	/* If the next rendered frame should be saved as a screenshot */
 	int screenshot_frame;
 
@@ -307,6 +328,24 @@ typedef struct YutaniGlobals {
 
 	int reload_renderer;
 	uint8_t active_modifiers;
+
+	/*
+	 * Static layer cache.
+	 *
+	 * static_ctx holds, for each row, the bottom static_level[row]
+	 * windows of static_stack composited over black. Damage to a
+	 * window, or a change in the stack below it, drops the affected
+	 * rows back to a lower level.
+	 */
+	sprite_t * static_sprite;
+	gfx_context_t * static_ctx;
+	uint16_t * static_level;
+	yutani_server_window_t ** static_stack;
+	int static_count;
+	int static_capacity;
+
+	/* Frames rendered, for settling windows into the static cache */
+	uint64_t frame_count;
 } yutani_globals_t;
 
 struct key_bind {
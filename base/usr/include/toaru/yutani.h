@@ -250,6 +250,11 @@ struct yutani_msg_special_request {
 	uint32_t request;
 };
 
+struct yutani_msg_frame {
+	yutani_wid_t wid;
+	uint64_t time; /* Compositor clock, in milliseconds, when the frame was presented */
+};
+
 struct yutani_msg_clipboard {
 	uint32_t size;
 	char content[];
@@ -282,6 +287,9 @@ struct yutani_msg_clipboard {
 
 #define YUTANI_MSG_WINDOW_MOVE_RELATIVE 0x00000015
 
+/* Ask for a FRAME_DONE after the next frame the compositor presents */
+#define YUTANI_MSG_FRAME_REQUEST       0x00000016
+
 /* Some session management / de stuff */
 #define YUTANI_MSG_WINDOW_ADVERTISE    0x00000020
 #define YUTANI_MSG_SUBSCRIBE           0x00000021
@@ -310,6 +318,7 @@ struct yutani_msg_clipboard {
 /* Server responses */
 #define YUTANI_MSG_WELCOME             0x00010001
 #define YUTANI_MSG_WINDOW_INIT         0x00010002
+#define YUTANI_MSG_FRAME_DONE          0x00010003
 
 /*
  * YUTANI_ZORDER
@@ -526,6 +535,7 @@ extern void yutani_window_move_relative(yutani_t * yctx, yutani_window_t * windo
 extern void yutani_close(yutani_t * y, yutani_window_t * win);
 extern void yutani_set_stack(yutani_t *, yutani_window_t *, int);
 extern void yutani_flip_region(yutani_t *, yutani_window_t * win, int32_t x, int32_t y, int32_t width, int32_t height);
+extern void yutani_window_request_frame(yutani_t * yctx, yutani_window_t * window);
 extern void yutani_window_resize(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
 extern void yutani_window_resize_offer(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
 extern void yutani_window_resize_accept(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
@@ -47,6 +47,8 @@ extern ssize_t read(int fd, void * buf, size_t count);
 
 extern int symlink(const char *target, const char *linkpath);
 extern ssize_t readlink(const char *pathname, char *buf, size_t bufsiz);
+extern ssize_t readlinkat(int dirfd, const char *pathname, char *buf, size_t bufsiz);
+extern ssize_t copy_file_range(int fd_in, off_t * off_in, int fd_out, off_t * off_out, size_t len, unsigned int flags);
 
 extern int chdir(const char *path);
 //extern int fchdir(int fd);
@@ -64,6 +66,7 @@ extern char * optarg;
 extern int optind, opterr, optopt;
 
 extern int unlink(const char * pathname);
+extern int unlinkat(int dirfd, const char * pathname, int flags);
 
 /* Unimplemented stubs */
 extern int rmdir(const char *pathname); /* TODO  rm probably just works */
@@ -99,6 +102,10 @@ extern unsigned int alarm(unsigned int seconds);
 extern void *sbrk(intptr_t increment);
 
 extern void sync(void);
+extern int fsync(int fd);
+extern int fdatasync(int fd);
+extern int nice(int inc);
+extern int getentropy(void * buffer, size_t length);
 extern int truncate(const char *, off_t);
 
 #define _PC_PATH_MAX 1
@@ -261,6 +261,7 @@ int cmos_time_stuff(struct regs *r) {
 	uint64_t timer_ticks, timer_subticks;
 	update_ticks(clock_ticks, &timer_ticks, &timer_subticks);
 	wakeup_sleepers(timer_ticks, timer_subticks);
+	console_tick();
 	irq_ack(0);
 
 	if (time_slice_basis + SUBSECONDS_PER_SECOND/4 <= clock_ticks) {
@@ -269,6 +270,7 @@ int cmos_time_stuff(struct regs *r) {
 	}
 
 	arch_tick_others();
+	if (!process_tick()) return 1;
 	switch_task(1);
 	asm volatile (
 		".global _ret_from_preempt_source\n"
@@ -274,10 +274,14 @@ static void map_more_stack(uintptr_t fromAddr) {
 	spin_lock(proc->image.lock);
 	for (uintptr_t i = fromAddr; i < proc->image.userstack; i += 0x1000) {
 		union PML * page = mmu_get_page(i, MMU_GET_MAKE);
-		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+		if (page->bits.present || page->bits.demand) continue;
+		/* Skipped-over pages are only reserved */
+		mmu_frame_reserve(page);
 	}
-	proc->image.userstack = fromAddr;
+	if (fromAddr < proc->image.userstack) proc->image.userstack = fromAddr;
 	spin_unlock(proc->image.lock);
+
+	mmu_demand_fault(fromAddr, 1);
 }
 
 static void panic(const char * desc, struct regs * r, uintptr_t faulting_address) {
@@ -303,6 +307,10 @@ struct regs * isr_handler(struct regs * r) {
 		case 14: /* Page fault */ {
 			uintptr_t faulting_address;
 			asm volatile("mov %%cr2, %0" : "=r"(faulting_address));
+			/* Demand-zero memory, touched by the process or by the kernel on its behalf */
+			if (mmu_demand_fault(faulting_address, r->err_code & 0x2)) {
+				break;
+			}
 			if (!this_core->current_process || r->cs == 0x08) {
 				panic("Page fault in kernel", r, faulting_address);
 			}
@@ -339,7 +347,7 @@ struct regs * isr_handler(struct regs * r) {
 			return r;
 		}
 		case 123: {
-			switch_task(1);
+			if (process_tick()) switch_task(1);
 			return r;
 		}
 		case 39: {
@@ -376,7 +384,7 @@ struct regs * isr_handler(struct regs * r) {
 
 done:
 
-	if (this_core->current_process == this_core->kernel_idle_task && process_queue && process_queue->head) {
+	if (this_core->current_process == this_core->kernel_idle_task && process_ready_waiting()) {
 		/* If this is kidle and we got here, instead of finishing the interrupt
 		 * we can just switch task and there will probably be something else
 		 * to run that was awoken by the interrupt. */
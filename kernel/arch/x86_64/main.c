@@ -247,7 +247,9 @@ void pat_initialize(void) {
 /**
  * @brief Turns on the floating-point unit.
  *
- * Enables a few bits so we can get SSE.
+ * Enables a few bits so we can get SSE. Also sets CR0.WP so that
+ * kernel writes to read-only user pages (the shared zero page of
+ * demand-zero memory) fault instead of going through.
  *
  * We don't do any fancy lazy FPU reload as x86-64 assumes a wide
  * variety of FPU-provided registers are available so most userspace
@@ -265,6 +267,7 @@ void fpu_initialize(void) {
 		"mov %%cr0, %%rax\n"
 		"and $0xfffb, %%ax\n"
 		"or  $0x0002, %%ax\n"
+		"or  $0x10000, %%rax\n" /* WP */
 		"mov %%rax, %%cr0\n"
 		"mov %%cr4, %%rax\n"
 		"or $0x600, %%rax\n"
@@ -290,8 +293,12 @@ static void mount_ramdisk(uintptr_t addr, size_t len) {
 		gzip_inputPtr = (void*)data;
 		gzip_outputPtr = mmu_map_from_physical(physicalAddress);
 		/* Do the deed */
-		if (gzip_decompress()) {
-			dprintf("gzip: failed to decompress payload\n");
+		int status = gzip_decompress();
+		if (status == 2) {
+			dprintf(LOG_ERROR "gzip: initial ramdisk is corrupt (checksum mismatch)\n");
+			return;
+		} else if (status) {
+			dprintf(LOG_ERROR "gzip: failed to decompress payload\n");
 			return;
 		}
 		ramdisk_mount(physicalAddress, decompressedSize);
@@ -412,6 +419,9 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 	 * as soon as we can call printf(), which is as soon as we get to long mode. */
 	early_log_initialize();
 
+	/* Initialize GS base; the kernel log keeps a ring for each core. */
+	arch_set_core_base((uintptr_t)&processor_local_data[0]);
+
 	dprintf("%s %d.%d.%d-%s %s %s\n",
 		__kernel_name,
 		__kernel_version_major,
@@ -421,9 +431,6 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 		__kernel_version_codename,
 		__kernel_arch);
 
-	/* Initialize GS base */
-	arch_set_core_base((uintptr_t)&processor_local_data[0]);
-
 	/* Time the TSC and get the initial boot time from the RTC. */
 	arch_clock_initialize();
 
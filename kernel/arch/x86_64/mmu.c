@@ -151,6 +151,11 @@ uintptr_t mmu_first_frame(void) {
  * If @p page->bits.page is unset, a new frame will be allocated.
  */
 void mmu_frame_allocate(union PML * page, unsigned int flags) {
+	if (page->bits.demand) {
+		/* Never hand out the zero page as a private frame */
+		page->bits.page   = 0;
+		page->bits.demand = 0;
+	}
 	if (page->bits.page == 0) {
 		spin_lock(frame_alloc_lock);
 		uintptr_t index = mmu_first_frame();
@@ -168,6 +173,19 @@ void mmu_frame_allocate(union PML * page, unsigned int flags) {
 	page->bits.nx       = (flags & MMU_FLAG_NOEXECUTE) ? 1 : 0;
 }
 
+/**
+ * @brief Reserve a user page without backing it yet.
+ *
+ * The page is left not present and marked as demand-zero; the first
+ * read maps the shared zero page and the first write allocates a
+ * cleared frame, see mmu_demand_fault().
+ */
+void mmu_frame_reserve(union PML * page) {
+	page->raw = 0;
+	page->bits.user   = 1;
+	page->bits.demand = 1;
+}
+
 /**
  * @brief Map the given page to the requested physical address.
  */
@@ -419,6 +437,11 @@ union PML * mmu_clone(union PML * from) {
 							for (size_t l = 0; l < 512; ++l) {
 								uintptr_t address = ((i << (9 * 3 + 12)) | (j << (9*2 + 12)) | (k << (9 + 12)) | (l << PAGE_SHIFT));
 								if (address >= USER_DEVICE_MAP && address <= USER_SHM_HIGH) continue;
+								if (pt_in[l].bits.demand) {
+									/* Untouched or zero-page mappings stay that way */
+									pt_out[l].raw = pt_in[l].raw;
+									continue;
+								}
 								if (pt_in[l].bits.present) {
 									if (pt_in[l].bits.user) {
 										char * page_in = mmu_map_from_physical((uintptr_t)pt_in[l].bits.page << PAGE_SHIFT);
@@ -510,6 +533,8 @@ size_t mmu_count_user(union PML * from) {
 								/* Calculate final address to skip SHM */
 								uintptr_t address = ((i << (9 * 3 + 12)) | (j << (9*2 + 12)) | (k << (9 + 12)) | (l << PAGE_SHIFT));
 								if (address >= USER_DEVICE_MAP && address <= USER_SHM_HIGH) continue;
+								/* The zero page doesn't count toward the process's memory use */
+								if (pt_in[l].bits.demand) continue;
 								if (pt_in[l].bits.present) {
 									if (pt_in[l].bits.user) {
 										out++;
@@ -620,6 +645,8 @@ void mmu_free(union PML * from) {
 								uintptr_t address = ((i << (9 * 3 + 12)) | (j << (9*2 + 12)) | (k << (9 + 12)) | (l << PAGE_SHIFT));
 								/* Do not free shared mappings; SHM subsystem does that for SHM, devices don't need it. */
 								if (address >= USER_DEVICE_MAP && address <= USER_SHM_HIGH) continue;
+								/* Nothing of ours behind demand-zero pages */
+								if (pt_in[l].bits.demand) continue;
 								if (pt_in[l].bits.present) {
 									/* Free only user pages */
 									if (pt_in[l].bits.user) {
@@ -686,6 +713,72 @@ void mmu_invalidate(uintptr_t addr) {
 static char * heapStart = NULL;
 extern char end[];
 
+/* Shared read-only frame for demand-zero pages that have only been read */
+static uintptr_t zero_frame = 0;
+static spin_lock_t demand_lock = { 0 };
+
+/**
+ * @brief Populate a demand-zero page in the current address space.
+ *
+ * Called on page faults, and for pointers handed to system calls
+ * so that the kernel never has to fault on them itself.
+ *
+ * @param addr  Faulting address
+ * @param write Whether the access was a write
+ * @returns 1 if the page was (or already is) populated, 0 if this isn't a demand-zero page.
+ */
+int mmu_demand_fault(uintptr_t addr, int write) {
+	if (!this_core->current_process) return 0;
+	if (addr >= 0x800000000000) return 0;
+
+	spin_lock(demand_lock);
+	union PML * page = mmu_get_page_other(this_core->current_process->thread.page_directory->directory, addr);
+
+	/*
+	 * Another thread may have populated this page while we waited for the
+	 * lock, or this core may still have the read-only zero page cached after
+	 * the shootdown. Either way the mapping is already good: drop our stale
+	 * TLB entry and retry the access.
+	 */
+	if (page && page->bits.present && page->bits.user && (!write || page->bits.writable)) {
+		asm volatile ("invlpg (%0)" : : "r"(addr & PAGE_SIZE_MASK));
+		spin_unlock(demand_lock);
+		return 1;
+	}
+
+	if (!page || !page->bits.demand) {
+		spin_unlock(demand_lock);
+		return 0;
+	}
+
+	if (!write) {
+		if (!page->bits.present) {
+			page->bits.page = zero_frame >> PAGE_SHIFT;
+			page->bits.present = 1;
+			page->bits.writable = 0;
+			page->bits.user = 1;
+		}
+		spin_unlock(demand_lock);
+		return 1;
+	}
+
+	uintptr_t frame = mmu_allocate_a_frame() << PAGE_SHIFT;
+	memset(mmu_map_from_physical(frame), 0, PAGE_SIZE);
+
+	int was_present = page->bits.present;
+	page->raw = 0;
+	page->bits.page = frame >> PAGE_SHIFT;
+	page->bits.present = 1;
+	page->bits.writable = 1;
+	page->bits.user = 1;
+
+	/* Other threads may still have the zero page cached */
+	if (was_present) mmu_invalidate(addr & PAGE_SIZE_MASK);
+
+	spin_unlock(demand_lock);
+	return 1;
+}
+
 /**
  * @brief Prepare virtual page mappings for use by the kernel.
  *
@@ -791,6 +884,9 @@ void mmu_init(size_t memsize, uintptr_t firstFreePage) {
 	}
 
 	heapStart = (char*)KERNEL_HEAP_START + bytesOfFrames;
+
+	zero_frame = mmu_allocate_a_frame() << PAGE_SHIFT;
+	memset(mmu_map_from_physical(zero_frame), 0, PAGE_SIZE);
 }
 
 /**
@@ -921,6 +1017,9 @@ int mmu_validate_user_pointer(void * addr, size_t size, int flags) {
 		if ((page & 0xffff800000000) != 0 && (page & 0xffff800000000) != 0xffff800000000) return 0;
 		union PML * page_entry = mmu_get_page_other(this_core->current_process->thread.page_directory->directory, page << 12);
 		if (!page_entry) return 0;
+		if (page_entry->bits.demand && (!page_entry->bits.present || (flags & MMU_PTR_WRITE))) {
+			mmu_demand_fault(page << 12, flags & MMU_PTR_WRITE);
+		}
 		if (!page_entry->bits.present) return 0;
 		if (!page_entry->bits.user) return 0;
 		if (!page_entry->bits.writable && (flags & MMU_PTR_WRITE)) return 0;
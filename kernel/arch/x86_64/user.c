@@ -4,6 +4,7 @@
  */
 #include <stdint.h>
 #include <kernel/process.h>
+#include <kernel/printf.h>
 #include <kernel/string.h>
 #include <kernel/arch/x86_64/regs.h>
 #include <kernel/arch/x86_64/mmu.h>
@@ -99,6 +100,7 @@ void arch_fatal_prepare(void) {
 		if (i == this_core->cpu_id) continue;
 		lapic_send_ipi(processor_local_data[i].lapic_id, 0x447D);
 	}
+	console_panic();
 }
 
 void arch_fatal(void) {
@@ -48,6 +48,8 @@ void generic_startup(void) {
 }
 
 int generic_main(void) {
+	console_start();
+
 	if (args_present("root")) {
 		const char * root_type = "tar";
 		if (args_present("root_type")) {
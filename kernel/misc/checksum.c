@@ -0,0 +1,13 @@
+/**
+ * @file  kernel/misc/checksum.c
+ * @brief CRC-32 and Adler-32 checksums.
+ *
+ * This is libtoaru_checksum built into the kernel, so the ramdisk
+ * decompressor can check what it produced.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include "../../lib/checksum.c"
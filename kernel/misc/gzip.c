@@ -16,6 +16,7 @@
  */
 #include <stdint.h>
 #include <stddef.h>
+#include <kernel/checksum.h>
 
 static uint8_t bit_buffer = 0;
 static char buffer_size = 0;
@@ -476,15 +477,17 @@ int gzip_decompress(void) {
 	}
 	(void)crc16;
 
+	uint8_t * output = gzip_outputPtr;
 	int status = deflate_decompress();
+	if (status) return status;
 
-	/* Read CRC and decompressed size from end of input */
+	/* Output is contiguous, so it can be checked in one go at the end */
 	unsigned int crc32 = read_32le();
 	unsigned int dsize = read_32le();
 
-	(void)crc32;
-	(void)dsize;
+	if (dsize != (uint32_t)(gzip_outputPtr - output)) return 2;
+	if (crc32 != checksum_crc32(CHECKSUM_CRC32_INIT, output, gzip_outputPtr - output)) return 2;
 
-	return status;
+	return 0;
 }
 
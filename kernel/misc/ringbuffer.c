@@ -67,8 +67,9 @@ void ring_buffer_alert_waiters(ring_buffer_t * ring_buffer) {
 	if (ring_buffer->alert_waiters) {
 		while (ring_buffer->alert_waiters->head) {
 			node_t * node = list_dequeue(ring_buffer->alert_waiters);
-			process_t * p = node->value;
-			process_alert_node(p, ring_buffer);
+			process_handle_t * handle = node->value;
+			process_alert_node(handle, ring_buffer);
+			free(handle);
 			free(node);
 		}
 	}
@@ -79,9 +80,7 @@ void ring_buffer_select_wait(ring_buffer_t * ring_buffer, void * process) {
 		ring_buffer->alert_waiters = list_create("ringbuffer alerts", ring_buffer);
 	}
 
-	if (!list_find(ring_buffer->alert_waiters, process)) {
-		list_insert(ring_buffer->alert_waiters, process);
-	}
+	process_handle_insert(ring_buffer->alert_waiters, process);
 	list_insert(((process_t *)process)->node_waits, ring_buffer);
 }
 
@@ -182,6 +181,7 @@ void ring_buffer_destroy(ring_buffer_t * ring_buffer) {
 	free(ring_buffer->wait_queue_readers);
 
 	if (ring_buffer->alert_waiters) {
+		list_destroy(ring_buffer->alert_waiters);
 		list_free(ring_buffer->alert_waiters);
 		free(ring_buffer->alert_waiters);
 	}
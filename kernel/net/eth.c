@@ -34,7 +34,7 @@ void net_eth_handle(struct ethernet_packet * frame, fs_node_t * nic, size_t size
 	struct EthernetDevice * nic_eth = nic->device;
 
 	if (size < sizeof(struct ethernet_packet)) {
-		dprintf("eth: %s: invalid ethernet frame (too small)\n",
+		dprintf(LOG_WARNING "eth: %s: invalid ethernet frame (too small)\n",
 			nic_eth->if_name);
 		return;
 	}
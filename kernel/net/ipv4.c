@@ -15,6 +15,7 @@
 #include <kernel/vfs.h>
 #include <kernel/time.h>
 #include <kernel/misc.h>
+#include <kernel/random.h>
 #include <kernel/assert.h>
 
 #include <kernel/net/netif.h>
@@ -25,7 +26,7 @@
 #include <arpa/inet.h>
 
 #ifndef MISAKA_DEBUG_NET
-#define printf(...) if (_debug) printf(__VA_ARGS__)
+#define printf(...) if (_debug) dprintf(LOG_DEBUG __VA_ARGS__)
 //#define printf(...)
 #endif
 
@@ -212,7 +213,7 @@ static long sock_icmp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	struct ipv4_packet * data = (struct ipv4_packet*)(packet + sizeof(size_t));
 
 	if (packet_size > msg->msg_iov[0].iov_len) {
-		dprintf("ICMP recv too big for vector\n");
+		dprintf(LOG_WARNING "ICMP recv too big for vector\n");
 		packet_size = msg->msg_iov[0].iov_len;
 	}
 
@@ -382,7 +383,7 @@ static int tcp_ack(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet,
 void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size) {
 
 	if (size < sizeof(struct ipv4_packet)) {
-		dprintf("ipv4: Incoming packet is too small.\n");
+		dprintf(LOG_WARNING "ipv4: Incoming packet is too small.\n");
 	}
 
 	char dest[16];
@@ -689,7 +690,7 @@ static long sock_tcp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	unsigned long resp = ntohs(data->length);
 
 	if (resp != packet_size) {
-		dprintf("packet size does not match: %zu %zu\n", resp, packet_size);
+		dprintf(LOG_WARNING "packet size does not match: %zu %zu\n", resp, packet_size);
 		resp = packet_size;
 	}
 
@@ -716,8 +717,6 @@ static long sock_tcp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	return resp;
 }
 
-extern uint32_t rand(void);
-
 static long sock_tcp_connect(sock_t * sock, const struct sockaddr *addr, socklen_t addrlen) {
 	const struct sockaddr_in * dest = (const struct sockaddr_in *)addr;
 	char deststr[16];
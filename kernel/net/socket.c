@@ -35,10 +35,11 @@ void net_sock_alert(sock_t * sock) {
 	spin_lock(sock->alert_lock);
 	while (sock->alert_wait->head) {
 		node_t * node = list_dequeue(sock->alert_wait);
-		process_t * p = node->value;
+		process_handle_t * handle = node->value;
 		free(node);
 		spin_unlock(sock->alert_lock);
-		process_alert_node(p, (fs_node_t*)sock);
+		process_alert_node(handle, (fs_node_t*)sock);
+		free(handle);
 		spin_lock(sock->alert_lock);
 	}
 	spin_unlock(sock->alert_lock);
@@ -83,9 +84,7 @@ int sock_generic_wait(fs_node_t *node, void * process) {
 	sock_t * sock = (sock_t*)node;
 
 	spin_lock(sock->alert_lock);
-	if (!list_find(sock->alert_wait, process)) {
-		list_insert(sock->alert_wait, process);
-	}
+	process_handle_insert(sock->alert_wait, process);
 	list_insert(((process_t *)process)->node_waits, sock);
 	spin_unlock(sock->alert_lock);
 	return 0;
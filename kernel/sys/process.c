@@ -44,6 +44,8 @@
 tree_t * process_tree;  /* Stores the parent-child process relationships; the root of this graph is 'init'. */
 list_t * process_list;  /* Stores all existing processes. Mostly used for sanity checking or for places where iterating over all processes is useful. */
 list_t * process_queue; /* Scheduler ready queue. This the round-robin source. The head is the next process to run. */
+list_t * interactive_queue; /* Ready SCHED_OTHER processes that woke up before using their time slice; served before process_queue. */
+list_t * realtime_queue;    /* Ready SCHED_FIFO and SCHED_RR processes, highest priority first; served before everything else. */
 list_t * sleep_queue;   /* Ordered list of processes waiting to be awoken by timeouts. The head is the earliest thread to awaken. */
 list_t * reap_queue;    /* Processes that could not be cleaned up and need to be deleted. */
 
@@ -58,6 +60,45 @@ static spin_lock_t wait_lock_tmp = { 0 };
 static spin_lock_t sleep_lock = { 0 };
 static spin_lock_t reap_lock = { 0 };
 
+/**
+ * PID lookup table.
+ *
+ * Processes are chained through @c pid_next into a fixed number of buckets
+ * indexed by the low bits of their PID. Each bucket has its own lock, so
+ * lookups never contend with the tree lock or with lookups of unrelated PIDs.
+ * PIDs are handed out sequentially, so consecutive PIDs land in consecutive
+ * buckets and the chains stay short.
+ */
+#define PID_HASH_SIZE 1024
+#define PID_HASH(pid) ((unsigned int)(pid) & (PID_HASH_SIZE - 1))
+static process_t * pid_hash[PID_HASH_SIZE] = {0};
+static spin_lock_t pid_hash_lock[PID_HASH_SIZE] = {0};
+static unsigned long pid_hash_generation = 0;
+
+static void pid_hash_insert(process_t * proc) {
+	unsigned int bucket = PID_HASH(proc->id);
+	proc->generation = __sync_add_and_fetch(&pid_hash_generation, 1);
+	spin_lock(pid_hash_lock[bucket]);
+	proc->pid_next = pid_hash[bucket];
+	pid_hash[bucket] = proc;
+	spin_unlock(pid_hash_lock[bucket]);
+}
+
+static void pid_hash_remove(process_t * proc) {
+	unsigned int bucket = PID_HASH(proc->id);
+	spin_lock(pid_hash_lock[bucket]);
+	process_t ** prev = &pid_hash[bucket];
+	while (*prev) {
+		if (*prev == proc) {
+			*prev = proc->pid_next;
+			break;
+		}
+		prev = &(*prev)->pid_next;
+	}
+	proc->pid_next = NULL;
+	spin_unlock(pid_hash_lock[bucket]);
+}
+
 void update_process_times(int includeSystem) {
 	uint64_t pTime = arch_perf_timer();
 	if (this_core->current_process->time_in && this_core->current_process->time_in < pTime) {
@@ -208,6 +249,10 @@ void switch_task(uint8_t reschedule) {
 	 *      picks it up before we saved the thread context or the FPU state... */
 	if (reschedule) {
 		make_process_ready((process_t*)this_core->current_process);
+	} else {
+		/* Blocking before the time slice is up is what interactive
+		 * processes do; they will be picked first when they wake. */
+		this_core->current_process->sched_boost = 1;
 	}
 
 	/* @ref switch_next() does not return. */
@@ -224,33 +269,69 @@ void initialize_process_tree(void) {
 	process_tree = tree_create();
 	process_list = list_create("global process list",NULL);
 	process_queue = list_create("global scheduler queue",NULL);
+	interactive_queue = list_create("global interactive scheduler queue",NULL);
+	realtime_queue = list_create("global real-time scheduler queue",NULL);
 	sleep_queue = list_create("global timed sleep queue",NULL);
 	reap_queue = list_create("processes awaiting later cleanup",NULL);
 
 	/* TODO: PID bitset? */
+	for (int i = 0; i < PID_HASH_SIZE; ++i) {
+		spin_init(pid_hash_lock[i]);
+	}
+}
+
+/**
+ * @brief Make a handle to a live process.
+ *
+ * The caller owns the returned handle and frees it when done.
+ */
+process_handle_t * process_handle(process_t * process) {
+	process_handle_t * handle = malloc(sizeof(process_handle_t));
+	handle->process    = process;
+	handle->pid        = process->id;
+	handle->generation = process->generation;
+	return handle;
+}
+
+/**
+ * @brief Add a handle to @p process to a list of waiters,
+ *        unless it already has one there.
+ */
+void process_handle_insert(list_t * list, process_t * process) {
+	foreach(node, list) {
+		process_handle_t * handle = node->value;
+		if (handle->process == process && handle->generation == process->generation) return;
+	}
+	list_insert(list, process_handle(process));
 }
 
 /**
  * @brief Determines if a process is alive and valid.
  *
- * Scans @ref process_list to see if @p process is a valid
- * process object or not.
+ * Looks for the process in the bucket for the PID the handle was made
+ * with. The process may already have been freed, so the handle's pointer
+ * is only compared, never dereferenced; a new process at the same address
+ * has a different generation.
  *
- * XXX This is horribly inefficient, and its very existence
- *     is likely indicative of bugs whereever it needed to
- *     be called...
+ * XXX Its very existence is likely indicative of bugs whereever
+ *     it needed to be called...
  *
- * @param process Process object to check.
+ * @param handle Handle to the process to check.
  * @returns 1 if the process is valid, 0 if it is not.
  */
-int is_valid_process(process_t * process) {
-	foreach(lnode, process_list) {
-		if (lnode->value == process) {
-			return 1;
+int is_valid_process(process_handle_t * handle) {
+	if (!handle || !handle->process) return 0;
+	unsigned int bucket = PID_HASH(handle->pid);
+	int valid = 0;
+	spin_lock(pid_hash_lock[bucket]);
+	for (process_t * p = pid_hash[bucket]; p; p = p->pid_next) {
+		if (p == handle->process && p->generation == handle->generation) {
+			valid = 1;
+			break;
 		}
 	}
-
-	return 0;
+	spin_unlock(pid_hash_lock[bucket]);
+	return valid;
 }
 
 /**
@@ -273,6 +354,7 @@ unsigned long process_append_fd(process_t * proc, fs_node_t * node) {
 			/* modes, offsets must be set by caller */
 			proc->fds->modes[i] = 0;
 			proc->fds->offsets[i] = 0;
+			proc->fds->paths[i] = NULL;
 			spin_unlock(proc->fds->lock);
 			return i;
 		}
@@ -283,11 +365,13 @@ unsigned long process_append_fd(process_t * proc, fs_node_t * node) {
 		proc->fds->entries = realloc(proc->fds->entries, sizeof(fs_node_t *) * proc->fds->capacity);
 		proc->fds->modes   = realloc(proc->fds->modes,   sizeof(int) * proc->fds->capacity);
 		proc->fds->offsets = realloc(proc->fds->offsets, sizeof(uint64_t) * proc->fds->capacity);
+		proc->fds->paths   = realloc(proc->fds->paths,   sizeof(char *) * proc->fds->capacity);
 	}
 	proc->fds->entries[proc->fds->length] = node;
 	/* modes, offsets must be set by caller */
 	proc->fds->modes[proc->fds->length] = 0;
 	proc->fds->offsets[proc->fds->length] = 0;
+	proc->fds->paths[proc->fds->length] = NULL;
 	proc->fds->length++;
 	spin_unlock(proc->fds->lock);
 	return proc->fds->length-1;
@@ -402,6 +486,7 @@ process_t * spawn_init(void) {
 	init->fds->entries  = malloc(init->fds->capacity * sizeof(fs_node_t *));
 	init->fds->modes    = malloc(init->fds->capacity * sizeof(int));
 	init->fds->offsets  = malloc(init->fds->capacity * sizeof(uint64_t));
+	init->fds->paths    = malloc(init->fds->capacity * sizeof(char *));
 	spin_init(init->fds->lock);
 
 	init->wd_node = clone_fs(fs_root);
@@ -431,12 +516,16 @@ process_t * spawn_init(void) {
 
 	init->timed_sleep_node = NULL;
 
+	init->sched_policy = SCHED_OTHER;
+	init->cpu_affinity = (uint64_t)-1;
+
 	init->thread.page_directory = malloc(sizeof(page_directory_t));
 	init->thread.page_directory->refcount = 1;
 	init->thread.page_directory->directory = this_core->current_pml;
 	spin_init(init->thread.page_directory->lock);
 	init->description = strdup("[init]");
 	list_insert(process_list, (void*)init);
+	pid_hash_insert(init);
 
 	return init;
 }
@@ -458,6 +547,11 @@ process_t * spawn_process(volatile process_t * parent, int flags) {
 	proc->job         = parent->job;
 	proc->session     = parent->session;
 
+	proc->sched_policy   = parent->sched_policy;
+	proc->sched_priority = parent->sched_priority;
+	proc->nice           = parent->nice;
+	proc->cpu_affinity   = parent->cpu_affinity;
+
 	if (parent->supplementary_group_count) {
 		proc->supplementary_group_count = parent->supplementary_group_count;
 		proc->supplementary_group_list = malloc(sizeof(gid_t) * proc->supplementary_group_count);
@@ -495,10 +589,12 @@ process_t * spawn_process(volatile process_t * parent, int flags) {
 		proc->fds->entries = malloc(proc->fds->capacity * sizeof(fs_node_t *));
 		proc->fds->modes   = malloc(proc->fds->capacity * sizeof(int));
 		proc->fds->offsets = malloc(proc->fds->capacity * sizeof(uint64_t));
+		proc->fds->paths   = malloc(proc->fds->capacity * sizeof(char *));
 		for (uint32_t i = 0; i < parent->fds->length; ++i) {
 			proc->fds->entries[i] = clone_fs(parent->fds->entries[i]);
 			proc->fds->modes[i]   = parent->fds->modes[i];
 			proc->fds->offsets[i] = parent->fds->offsets[i];
+			proc->fds->paths[i]   = parent->fds->paths[i] ? strdup(parent->fds->paths[i]) : NULL;
 		}
 		spin_unlock(parent->fds->lock);
 	}
@@ -521,6 +617,7 @@ process_t * spawn_process(volatile process_t * parent, int flags) {
 	tree_node_insert_child_node(process_tree, parent->tree_entry, entry);
 	list_insert(process_list, (void*)proc);
 	spin_unlock(tree_lock);
+	pid_hash_insert(proc);
 	return proc;
 }
 
@@ -533,7 +630,9 @@ void process_reap(process_t * proc) {
 
 	if (proc->tracees) {
 		while (proc->tracees->length) {
-			free(list_pop(proc->tracees));
+			node_t * n = list_pop(proc->tracees);
+			free(n->value);
+			free(n);
 		}
 		free(proc->tracees);
 	}
@@ -599,6 +698,8 @@ void process_delete(process_t * proc) {
 		return;
 	}
 
+	pid_hash_remove(proc);
+
 	spin_lock(tree_lock);
 	int has_children = entry->children->length;
 	tree_remove_reparent_root(process_tree, entry);
@@ -667,67 +768,147 @@ void make_process_ready(volatile process_t * proc) {
 
 	spin_lock(process_queue_lock);
 	if (proc->sched_node.owner) {
-		/* There's only one ready queue, so this means the process was already ready, which
-		 * is indicative of a bug somewhere as we shouldn't be added processes to the ready
+		/* The process was already in one of the ready queues, which is indicative
+		 * of a bug somewhere as we shouldn't be added processes to the ready
 		 * queue multiple times. */
 		spin_unlock(process_queue_lock);
 		return;
 	}
 
-	list_append(process_queue, (node_t*)&proc->sched_node);
+	if (proc->sched_policy != SCHED_OTHER) {
+		/* Behind everything of the same or higher priority. */
+		node_t * before = NULL;
+		foreach(node, realtime_queue) {
+			if (((process_t*)node->value)->sched_priority < proc->sched_priority) {
+				before = node;
+				break;
+			}
+		}
+		list_append_before(realtime_queue, before, (node_t*)&proc->sched_node);
+	} else if (proc->sched_boost) {
+		list_append(interactive_queue, (node_t*)&proc->sched_node);
+	} else {
+		list_append(process_queue, (node_t*)&proc->sched_node);
+	}
 	spin_unlock(process_queue_lock);
 
 	arch_wakeup_others();
 }
 
 /**
- * @brief Pop the next available process from the queue.
- *
- * Gets the next available process from the round-robin scheduling
- * queue. If there is no process to run, the idle task is returned.
+ * @brief Remove the first process in a ready queue that can run on this core.
  *
- * TODO This needs more locking for SMP...
+ * Skips processes whose affinity excludes this core, and processes that were
+ * marked ready by another core that has not yet finished switching away from them.
  */
-volatile process_t * next_ready_process(void) {
-	spin_lock(process_queue_lock);
-
-	if (!process_queue->head) {
-		if (process_queue->length) {
+static volatile process_t * take_ready_process(list_t * queue) {
+	foreach(np, queue) {
+		if ((uintptr_t)np < 0xFFFFff0000000000UL || (uintptr_t)np > 0xFFFFfff000000000UL) {
 			arch_fatal_prepare();
-			printf("Queue has a length but head is NULL\n");
+			printf("Suspicious pointer in queue: %#zx\n", (uintptr_t)np);
 			arch_dump_traceback();
 			arch_fatal();
 		}
-		spin_unlock(process_queue_lock);
-		return this_core->kernel_idle_task;
+		volatile process_t * proc = np->value;
+		if (!(proc->cpu_affinity & (1UL << this_core->cpu_id))) continue;
+		if ((proc->flags & PROC_FLAG_RUNNING) && (proc->owner != this_core->cpu_id)) continue;
+		list_delete(queue, np);
+		return proc;
 	}
+	return NULL;
+}
 
-	node_t * np = list_dequeue(process_queue);
+/**
+ * @brief Length of a time slice, in timer ticks.
+ *
+ * SCHED_OTHER processes share the processor round-robin, so the
+ * length of their slice sets their share: nice -20 gets nine ticks,
+ * nice 0 five, and nice 15 and above just one.
+ */
+static int process_time_slice(volatile process_t * proc) {
+	if (proc->sched_policy == SCHED_RR) return 10;
+	return (20 - proc->nice) / 5 + 1;
+}
 
-	if ((uintptr_t)np < 0xFFFFff0000000000UL || (uintptr_t)np > 0xFFFFfff000000000UL) {
-		arch_fatal_prepare();
-		printf("Suspicious pointer in queue: %#zx\n", (uintptr_t)np);
-		arch_dump_traceback();
-		arch_fatal();
-	}
-	volatile process_t * next = np->value;
+/**
+ * @brief Pop the next available process from the queue.
+ *
+ * Real-time processes are taken first, in priority order, then
+ * SCHED_OTHER processes that woke up with time left in their slice,
+ * and then everything else in round-robin order. If there is no
+ * process to run on this core, the idle task is returned.
+ */
+volatile process_t * next_ready_process(void) {
+	spin_lock(process_queue_lock);
 
-	if ((next->flags & PROC_FLAG_RUNNING) && (next->owner != this_core->cpu_id)) {
-		/* We pulled a process too soon, switch to idle for a bit so the
-		 * core that marked this process as ready can finish switching away from it. */
-		list_append(process_queue, (node_t*)&next->sched_node);
-		spin_unlock(process_queue_lock);
-		return this_core->kernel_idle_task;
-	}
+	volatile process_t * next = take_ready_process(realtime_queue);
+	if (!next) next = take_ready_process(interactive_queue);
+	if (!next) next = take_ready_process(process_queue);
 
 	spin_unlock(process_queue_lock);
 
+	if (!next) return this_core->kernel_idle_task;
+
 	__sync_or_and_fetch(&next->flags, PROC_FLAG_RUNNING);
 	next->owner = this_core->cpu_id;
+	if (next->time_slice <= 0) next->time_slice = process_time_slice(next);
 
 	return next;
 }
 
+/**
+ * @brief Whether any process is waiting in a ready queue.
+ */
+int process_ready_waiting(void) {
+	return (process_queue && process_queue->head) ||
+		(interactive_queue && interactive_queue->head) ||
+		(realtime_queue && realtime_queue->head);
+}
+
+/**
+ * @brief Account a timer tick to the current process.
+ *
+ * Called on each core from the preemption timer. Returns non-zero if the
+ * current process should give up the core: its time slice is spent, it is
+ * no longer allowed to run here, or something that outranks it is ready.
+ * A SCHED_FIFO process is only ever displaced by a higher priority one.
+ */
+int process_tick(void) {
+	volatile process_t * proc = this_core->current_process;
+	if (!proc) return 0;
+	if (proc == this_core->kernel_idle_task) return 1;
+	if (!(proc->cpu_affinity & (1UL << this_core->cpu_id))) return 1;
+
+	/* Only peeking; a stale answer just costs or saves one switch. */
+	node_t * rt = realtime_queue->head;
+
+	if (proc->sched_policy != SCHED_OTHER) {
+		if (proc->sched_policy == SCHED_RR && --proc->time_slice <= 0) return 1;
+		return rt && ((process_t*)rt->value)->sched_priority > proc->sched_priority;
+	}
+
+	if (--proc->time_slice <= 0) {
+		/* Used the whole slice; it goes back with everyone else. */
+		proc->sched_boost = 0;
+		return 1;
+	}
+
+	if (rt) return 1;
+	return !proc->sched_boost && interactive_queue->head;
+}
+
+/**
+ * @brief Change the scheduling parameters of a process.
+ *
+ * Takes effect from the next time the process is placed in a ready queue.
+ */
+void process_set_scheduling(process_t * proc, int policy, int priority, int nice) {
+	proc->sched_policy = policy;
+	proc->sched_priority = (policy == SCHED_OTHER) ? 0 : priority;
+	proc->nice = nice;
+	proc->time_slice = 0;
+}
+
 /**
  * @brief Signal a semaphore.
  *
@@ -825,7 +1006,7 @@ int process_is_ready(process_t * proc) {
 	return (proc->sched_node.owner != NULL && !(proc->flags & PROC_FLAG_RUNNING));
 }
 
-int process_alert_node_locked(process_t * process, void * value);
+int process_alert_node_locked(process_handle_t * handle, void * value);
 
 /**
  * @brief Wake up processes that were sleeping on timers.
@@ -843,9 +1024,9 @@ void wakeup_sleepers(unsigned long seconds, unsigned long subseconds) {
 
 			if (proc->is_fswait) {
 				proc->is_fswait = -1;
-				process_alert_node_locked(proc->process,proc);
+				process_alert_node_locked(&proc->handle,proc);
 			} else {
-				process_t * process = proc->process;
+				process_t * process = proc->handle.process;
 				process->sleep_node.owner = NULL;
 				process->timed_sleep_node = NULL;
 				if (!process_is_ready(process)) {
@@ -895,7 +1076,9 @@ void sleep_until(process_t * process, unsigned long seconds, unsigned long subse
 		before = node;
 	}
 	sleeper_t * proc = malloc(sizeof(sleeper_t));
-	proc->process     = process;
+	proc->handle.process    = process;
+	proc->handle.pid        = process->id;
+	proc->handle.generation = process->generation;
 	proc->end_tick    = seconds;
 	proc->end_subtick = subseconds;
 	proc->is_fswait = 0;
@@ -903,23 +1086,28 @@ void sleep_until(process_t * process, unsigned long seconds, unsigned long subse
 	spin_unlock(sleep_lock);
 }
 
-uint8_t process_compare(void * proc_v, void * pid_v) {
-	pid_t pid = (*(pid_t *)pid_v);
-	process_t * proc = (process_t *)proc_v;
-
-	return (uint8_t)(proc->id == pid);
-}
-
+/**
+ * @brief Look up a process by PID.
+ *
+ * Only the PID table bucket for @p pid is locked and searched.
+ *
+ * @param pid Process identifier to find.
+ * @returns the process, or NULL if there is no such process.
+ */
 process_t * process_from_pid(pid_t pid) {
 	if (pid < 0) return NULL;
 
-	spin_lock(tree_lock);
-	tree_node_t * entry = tree_find(process_tree,&pid,process_compare);
-	spin_unlock(tree_lock);
-	if (entry) {
-		return (process_t *)entry->value;
+	unsigned int bucket = PID_HASH(pid);
+	process_t * out = NULL;
+	spin_lock(pid_hash_lock[bucket]);
+	for (process_t * p = pid_hash[bucket]; p; p = p->pid_next) {
+		if (p->id == pid) {
+			out = p;
+			break;
+		}
 	}
-	return NULL;
+	spin_unlock(pid_hash_lock[bucket]);
+	return out;
 }
 
 
@@ -935,6 +1123,8 @@ long process_move_fd(process_t * proc, long src, long dest) {
 		proc->fds->entries[dest] = proc->fds->entries[src];
 		proc->fds->modes[dest] = proc->fds->modes[src];
 		proc->fds->offsets[dest] = proc->fds->offsets[src];
+		if (proc->fds->paths[dest]) free(proc->fds->paths[dest]);
+		proc->fds->paths[dest] = proc->fds->paths[src] ? strdup(proc->fds->paths[src]) : NULL;
 		open_fs(proc->fds->entries[dest], 0);
 	}
 	return dest;
@@ -1005,7 +1195,9 @@ int waitpid(int pid, int * status, int options) {
 
 		if (!candidate && proc->tracees) {
 			foreach(node, proc->tracees) {
-				process_t * child = node->value;
+				process_handle_t * handle = node->value;
+				if (!is_valid_process(handle)) continue;
+				process_t * child = handle->process;
 				if (wait_candidate(proc,pid,options,child)) {
 					has_children = 1;
 					if (child->flags & (PROC_FLAG_SUSPENDED | PROC_FLAG_FINISHED)) {
@@ -1061,7 +1253,9 @@ int process_timeout_sleep(process_t * process, int timeout) {
 		before = node;
 	}
 	sleeper_t * proc = malloc(sizeof(sleeper_t));
-	proc->process     = process;
+	proc->handle.process    = process;
+	proc->handle.pid        = process->id;
+	proc->handle.generation = process->generation;
 	proc->end_tick    = s;
 	proc->end_subtick = ss;
 	proc->is_fswait = 1;
@@ -1158,14 +1352,16 @@ void process_awaken_signal(process_t * process) {
 	spin_unlock(sleep_lock);
 }
 
-int process_alert_node_locked(process_t * process, void * value) {
+int process_alert_node_locked(process_handle_t * handle, void * value) {
 	must_have_lock(sleep_lock);
 
-	if (!is_valid_process(process)) {
+	if (!is_valid_process(handle)) {
 		printf("invalid process\n");
 		return 0;
 	}
 
+	process_t * process = handle->process;
+
 	spin_lock(process->sched_lock);
 
 	if (!process->node_waits) {
@@ -1185,9 +1381,9 @@ int process_alert_node_locked(process_t * process, void * value) {
 	return -1;
 }
 
-int process_alert_node(process_t * process, void * value) {
+int process_alert_node(process_handle_t * handle, void * value) {
 	spin_lock(sleep_lock);
-	int result = process_alert_node_locked(process, value);
+	int result = process_alert_node_locked(handle, value);
 	spin_unlock(sleep_lock);
 	return result;
 }
@@ -1230,10 +1426,14 @@ void task_exit(int retval) {
 					close_fs(this_core->current_process->fds->entries[i]);
 					this_core->current_process->fds->entries[i] = NULL;
 				}
+				if (this_core->current_process->fds->paths[i]) {
+					free(this_core->current_process->fds->paths[i]);
+				}
 			}
 			free(this_core->current_process->fds->entries);
 			free(this_core->current_process->fds->offsets);
 			free(this_core->current_process->fds->modes);
+			free(this_core->current_process->fds->paths);
 			free(this_core->current_process->fds);
 			this_core->current_process->fds = NULL;
 		} else {
@@ -1245,9 +1445,11 @@ void task_exit(int retval) {
 		spin_lock(this_core->current_process->wait_lock);
 		while (this_core->current_process->tracees->length) {
 			node_t * n = list_pop(this_core->current_process->tracees);
-			process_t * tracee = n->value;
+			process_handle_t * handle = n->value;
 			free(n);
-			if (is_valid_process(tracee)) {
+			process_t * tracee = is_valid_process(handle) ? handle->process : NULL;
+			free(handle);
+			if (tracee) {
 				tracee->tracer = 0;
 				__sync_and_and_fetch(&tracee->flags, ~(PROC_FLAG_TRACE_SIGNALS | PROC_FLAG_TRACE_SYSCALLS));
 				if (tracee->flags & PROC_FLAG_SUSPENDED) {
@@ -1295,6 +1497,12 @@ pid_t fork(void) {
 	new_proc->thread.page_directory = malloc(sizeof(page_directory_t));
 	new_proc->thread.page_directory->refcount = 1;
 	new_proc->thread.page_directory->directory = directory;
+
+	/* Threads share their creator's real-time policy, but new processes
+	 * start out time-shared so a real-time parent can't hand it out. */
+	if (new_proc->sched_policy != SCHED_OTHER) {
+		process_set_scheduling(new_proc, SCHED_OTHER, 0, new_proc->nice);
+	}
 	spin_init(new_proc->thread.page_directory->lock);
 
 	struct regs r;
@@ -1373,6 +1581,9 @@ process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * na
 	proc->job         = proc->id;
 	proc->session     = proc->id;
 
+	proc->sched_policy = SCHED_OTHER;
+	proc->cpu_affinity = (uint64_t)-1;
+
 	proc->thread.page_directory = malloc(sizeof(page_directory_t));
 	proc->thread.page_directory->refcount = 1;
 	proc->thread.page_directory->directory = mmu_clone(mmu_get_kernel_directory());
@@ -1402,6 +1613,7 @@ process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * na
 	tree_node_insert_child_node(process_tree, this_core->current_process->tree_entry, entry);
 	list_insert(process_list, (void*)proc);
 	spin_unlock(tree_lock);
+	pid_hash_insert(proc);
 
 	make_process_ready(proc);
 
@@ -1416,13 +1628,22 @@ static void update_one_process(uint64_t clock_ticks, uint64_t perf_scale, proces
 	proc->time_prev = proc->time_total;
 }
 
+/**
+ * @brief Update the usage samples of every process.
+ *
+ * Walks the PID table one bucket at a time, so at most one bucket
+ * is locked at any point and process creation, deletion, and
+ * lookups elsewhere are never stalled behind the whole walk.
+ */
 void update_process_usage(uint64_t clock_ticks, uint64_t perf_scale) {
-	spin_lock(tree_lock);
-	foreach(lnode, process_list) {
-		process_t * proc = lnode->value;
-		update_one_process(clock_ticks, perf_scale, proc);
+	for (int i = 0; i < PID_HASH_SIZE; ++i) {
+		if (!pid_hash[i]) continue;
+		spin_lock(pid_hash_lock[i]);
+		for (process_t * proc = pid_hash[i]; proc; proc = proc->pid_next) {
+			update_one_process(clock_ticks, perf_scale, proc);
+		}
+		spin_unlock(pid_hash_lock[i]);
 	}
-	spin_unlock(tree_lock);
 	/* Now use idle tasks to calculator processor activity? */
 	for (int i = 0; i < processor_count; ++i) {
 		process_t * proc = processor_local_data[i].kernel_idle_task;
@@ -20,7 +20,7 @@ static void _ptrace_trace(process_t * tracer, process_t * tracee) {
 		tracer->tracees = list_create("debug tracees", tracer);
 	}
 
-	list_insert(tracer->tracees, tracee);
+	process_handle_insert(tracer->tracees, tracee);
 
 	tracee->tracer = tracer->id;
 
@@ -6,6 +6,8 @@
 #include <sys/time.h>
 #include <sys/times.h>
 #include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/random.h>
 #include <syscall_nums.h>
 #include <kernel/printf.h>
 #include <kernel/process.h>
@@ -21,6 +23,7 @@
 #include <kernel/syscall.h>
 #include <kernel/misc.h>
 #include <kernel/ptrace.h>
+#include <kernel/random.h>
 
 static char   hostname[256];
 static size_t hostname_len = 0;
@@ -48,10 +51,12 @@ long sys_sbrk(ssize_t size) {
 	uintptr_t out = proc->image.heap;
 	for (uintptr_t i = out; i < out + size; i += 0x1000) {
 		union PML * page = mmu_get_page(i, MMU_GET_MAKE);
-		if (page->bits.page != 0) {
+		if (page->bits.page != 0 || page->bits.demand) {
 			printf("odd, %#zx is already allocated?\n", i);
+			continue;
 		}
-		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+		/* Only reserve the address space; frames are allocated on first touch */
+		mmu_frame_reserve(page);
 	}
 	proc->image.heap += size;
 	spin_unlock(proc->image.lock);
@@ -64,11 +69,9 @@ long sys_sysfunc(long fn, char ** args) {
 	/* FIXME: Most of these should be top-level, many are hacks/broken in Misaka */
 	switch (fn) {
 		case TOARU_SYS_FUNC_SYNC:
-			/* FIXME: There is no sync ability in the VFS at the moment.
-			 * XXX: Should this just be an ioctl on individual devices?
-			 *      Or possibly even an ioctl we can send to arbitrary files? */
-			printf("sync: not implemented\n");
-			return -EINVAL;
+			/* Kept for older binaries; this is sync(2) now */
+			vfs_sync();
+			return 0;
 
 		case TOARU_SYS_FUNC_LOGHERE:
 			/* FIXME: The entire kernel logging system needs to be revamped as
@@ -292,10 +295,24 @@ long sys_lstat(char * file, uintptr_t st) {
 	return result;
 }
 
-long sys_open(const char * file, long flags, long mode) {
-	PTR_VALIDATE(file);
-	if (!file) return -EFAULT;
-	fs_node_t * node = kopen((char *)file, flags);
+/**
+ * Find the directory an *at() call should resolve @p name in.
+ * Absolute names and AT_FDCWD leave @p dir NULL, meaning the
+ * working directory.
+ */
+static long at_directory(int dirfd, const char * name, fs_node_t ** dir, const char ** dir_path) {
+	*dir = NULL;
+	*dir_path = NULL;
+	if (name[0] == '/' || dirfd == AT_FDCWD) return 0;
+	if (!FD_CHECK(dirfd)) return -EBADF;
+	if (!(FD_ENTRY(dirfd)->flags & FS_DIRECTORY) || !FD_PATH(dirfd)) return -ENOTDIR;
+	*dir = FD_ENTRY(dirfd);
+	*dir_path = FD_PATH(dirfd);
+	return 0;
+}
+
+static long open_at(fs_node_t * dir, const char * dir_path, const char * file, long flags, long mode) {
+	fs_node_t * node = kopen_at(dir, dir_path, file, flags);
 
 	int access_bits = 0;
 
@@ -329,9 +346,9 @@ long sys_open(const char * file, long flags, long mode) {
 
 	if (!node && (flags & O_CREAT)) {
 		/* TODO check directory permissions */
-		int result = create_file_fs((char *)file, mode);
+		int result = create_file_at_fs(dir, dir_path, (char *)file, mode);
 		if (!result) {
-			node = kopen((char *)file, flags);
+			node = kopen_at(dir, dir_path, file, flags);
 		} else {
 			return result;
 		}
@@ -360,6 +377,10 @@ long sys_open(const char * file, long flags, long mode) {
 	}
 	int fd = process_append_fd((process_t *)this_core->current_process, node);
 	FD_MODE(fd) = access_bits;
+	if (node->flags & FS_DIRECTORY) {
+		/* Kept so this can be used as the directory for *at() calls */
+		FD_PATH(fd) = canonicalize_path(dir_path ? dir_path : this_core->current_process->wd_name, file);
+	}
 	if (flags & O_APPEND) {
 		FD_OFFSET(fd) = node->length;
 	} else {
@@ -368,10 +389,73 @@ long sys_open(const char * file, long flags, long mode) {
 	return fd;
 }
 
+long sys_open(const char * file, long flags, long mode) {
+	PTR_VALIDATE(file);
+	if (!file) return -EFAULT;
+	return open_at(NULL, NULL, file, flags, mode);
+}
+
+long sys_openat(int dirfd, const char * file, long flags, long mode) {
+	fs_node_t * dir;
+	const char * dir_path;
+	PTR_VALIDATE(file);
+	if (!file) return -EFAULT;
+	long result = at_directory(dirfd, file, &dir, &dir_path);
+	if (result) return result;
+	return open_at(dir, dir_path, file, flags, mode);
+}
+
+long sys_fstatat(int dirfd, const char * file, uintptr_t st, long flags) {
+	fs_node_t * dir;
+	const char * dir_path;
+	PTR_VALIDATE(file);
+	PTR_VALIDATE(st);
+	if (!file || !st) return -EFAULT;
+	if (flags & ~(AT_SYMLINK_NOFOLLOW | AT_EMPTY_PATH)) return -EINVAL;
+
+	if (!file[0]) {
+		/* Like fstat(), without a path */
+		if (!(flags & AT_EMPTY_PATH)) return -ENOENT;
+		if (dirfd != AT_FDCWD) return sys_stat(dirfd, st);
+		file = ".";
+	}
+
+	long result = at_directory(dirfd, file, &dir, &dir_path);
+	if (result) return result;
+
+	fs_node_t * fn = kopen_at(dir, dir_path, file, (flags & AT_SYMLINK_NOFOLLOW) ? (O_PATH | O_NOFOLLOW) : 0);
+	result = stat_node(fn, st);
+	if (fn) {
+		close_fs(fn);
+	}
+	return result;
+}
+
+long sys_readlinkat(int dirfd, const char * file, char * ptr, long len) {
+	fs_node_t * dir;
+	const char * dir_path;
+	PTR_VALIDATE(file);
+	if (!file) return -EFAULT;
+	PTRCHECK(ptr,len,MMU_PTR_WRITE);
+	long result = at_directory(dirfd, file, &dir, &dir_path);
+	if (result) return result;
+	fs_node_t * node = kopen_at(dir, dir_path, file, O_PATH | O_NOFOLLOW);
+	if (!node) {
+		return -ENOENT;
+	}
+	long rv = readlink_fs(node, ptr, len);
+	close_fs(node);
+	return rv;
+}
+
 long sys_close(int fd) {
 	if (FD_CHECK(fd)) {
 		close_fs(FD_ENTRY(fd));
 		FD_ENTRY(fd) = NULL;
+		if (FD_PATH(fd)) {
+			free(FD_PATH(fd));
+			FD_PATH(fd) = NULL;
+		}
 		return 0;
 	}
 	return -EBADF;
@@ -446,6 +530,44 @@ long sys_mkdir(char * path, uint64_t mode) {
 	return mkdir_fs(path, mode);
 }
 
+long sys_mkdirat(int dirfd, char * path, uint64_t mode) {
+	fs_node_t * dir;
+	const char * dir_path;
+	PTR_VALIDATE(path);
+	if (!path) return -EFAULT;
+	if (!path[0]) return -ENOENT;
+	long result = at_directory(dirfd, path, &dir, &dir_path);
+	if (result) return result;
+	return mkdir_at_fs(dir, dir_path, path, mode);
+}
+
+/**
+ * Copy between two open files without passing the data through
+ * userspace. Offsets given by pointer are used and updated in place;
+ * otherwise the descriptors' own offsets are used and advanced.
+ */
+long sys_copy_file_range(int fd_in, off_t * off_in, int fd_out, off_t * off_out, size_t len) {
+	if (!FD_CHECK(fd_in) || !FD_CHECK(fd_out)) return -EBADF;
+	if (!(FD_MODE(fd_in) & 01) || !(FD_MODE(fd_out) & 02)) return -EBADF;
+	if (off_in) PTRCHECK(off_in, sizeof(off_t), MMU_PTR_WRITE);
+	if (off_out) PTRCHECK(off_out, sizeof(off_t), MMU_PTR_WRITE);
+
+	fs_node_t * src = FD_ENTRY(fd_in);
+	fs_node_t * dst = FD_ENTRY(fd_out);
+	if ((src->flags & FS_DIRECTORY) || (dst->flags & FS_DIRECTORY)) return -EISDIR;
+
+	off_t src_off = off_in ? *off_in : (off_t)FD_OFFSET(fd_in);
+	off_t dst_off = off_out ? *off_out : (off_t)FD_OFFSET(fd_out);
+	if (src_off < 0 || dst_off < 0) return -EINVAL;
+
+	ssize_t out = copy_range_fs(src, src_off, dst, dst_off, len);
+	if (out > 0) {
+		if (off_in) *off_in += out; else FD_OFFSET(fd_in) += out;
+		if (off_out) *off_out += out; else FD_OFFSET(fd_out) += out;
+	}
+	return out;
+}
+
 long sys_access(const char * file, long flags) {
 	PTR_VALIDATE(file);
 	if (!file) return -EFAULT;
@@ -782,6 +904,21 @@ long sys_unlink(char * file) {
 	return unlink_fs(file);
 }
 
+/**
+ * AT_REMOVEDIR is accepted, but as with unlink(), whether a
+ * directory can be removed is up to its file system.
+ */
+long sys_unlinkat(int dirfd, char * file, long flags) {
+	fs_node_t * dir;
+	const char * dir_path;
+	PTR_VALIDATE(file);
+	if (!file) return -EFAULT;
+	if (flags & ~AT_REMOVEDIR) return -EINVAL;
+	long result = at_directory(dirfd, file, &dir, &dir_path);
+	if (result) return result;
+	return unlink_at_fs(dir, dir_path, file);
+}
+
 long sys_execve(const char * filename, char *const argv[], char *const envp[]) {
 	PTR_VALIDATE(filename);
 	PTR_VALIDATE(argv);
@@ -831,6 +968,10 @@ long sys_execve(const char * filename, char *const argv[], char *const envp[]) {
 			close_fs(this_core->current_process->fds->entries[i]);
 			this_core->current_process->fds->entries[i] = NULL;
 		}
+		if (this_core->current_process->fds->paths[i]) {
+			free(this_core->current_process->fds->paths[i]);
+			this_core->current_process->fds->paths[i] = NULL;
+		}
 	}
 
 	shm_release_all((process_t *)this_core->current_process);
@@ -1042,6 +1183,177 @@ long sys_times(struct tms *buf) {
 	return arch_perf_timer() / arch_cpu_mhz();
 }
 
+long sys_sync(void) {
+	vfs_sync();
+	return 0;
+}
+
+long sys_fsync(int fd) {
+	if (FD_CHECK(fd)) {
+		return sync_fs(FD_ENTRY(fd), 0);
+	}
+	return -EBADF;
+}
+
+long sys_fdatasync(int fd) {
+	if (FD_CHECK(fd)) {
+		return sync_fs(FD_ENTRY(fd), 1);
+	}
+	return -EBADF;
+}
+
+static int priority_matches(process_t * proc, int which, id_t who) {
+	switch (which) {
+		case PRIO_PROCESS: return proc->id == who || proc->group == who;
+		case PRIO_PGRP:    return proc->job == who;
+		case PRIO_USER:    return proc->user == who;
+	}
+	return 0;
+}
+
+static id_t priority_default(int which) {
+	switch (which) {
+		case PRIO_PROCESS: return this_core->current_process->group ? this_core->current_process->group : this_core->current_process->id;
+		case PRIO_PGRP:    return this_core->current_process->job;
+		case PRIO_USER:    return this_core->current_process->user;
+	}
+	return 0;
+}
+
+/**
+ * getpriority() returns the lowest nice value among the matching processes,
+ * offset by 20 so that it is never negative; libc undoes the offset.
+ */
+long sys_getpriority(int which, id_t who) {
+	if (which < PRIO_PROCESS || which > PRIO_USER) return -EINVAL;
+	if (who == 0) who = priority_default(which);
+
+	int best = PRIO_MAX + 1;
+	foreach(node, process_list) {
+		process_t * proc = node->value;
+		if (proc->flags & PROC_FLAG_IS_TASKLET) continue;
+		if (priority_matches(proc, which, who) && proc->nice < best) best = proc->nice;
+	}
+
+	if (best > PRIO_MAX) return -ESRCH;
+	return 20 - best;
+}
+
+long sys_setpriority(int which, id_t who, int prio) {
+	if (which < PRIO_PROCESS || which > PRIO_USER) return -EINVAL;
+	if (who == 0) who = priority_default(which);
+	if (prio < PRIO_MIN) prio = PRIO_MIN;
+	if (prio > PRIO_MAX) prio = PRIO_MAX;
+
+	/* Check every match before changing any, so a failure changes nothing */
+	int found = 0;
+	foreach(node, process_list) {
+		process_t * proc = node->value;
+		if (proc->flags & PROC_FLAG_IS_TASKLET) continue;
+		if (!priority_matches(proc, which, who)) continue;
+		found = 1;
+		if (this_core->current_process->user != USER_ROOT_UID) {
+			if (proc->user != this_core->current_process->user) return -EPERM;
+			if (prio < proc->nice) return -EACCES;
+		}
+	}
+
+	if (!found) return -ESRCH;
+
+	foreach(node, process_list) {
+		process_t * proc = node->value;
+		if (proc->flags & PROC_FLAG_IS_TASKLET) continue;
+		if (!priority_matches(proc, which, who)) continue;
+		process_set_scheduling(proc, proc->sched_policy, proc->sched_priority, prio);
+	}
+
+	return 0;
+}
+
+static process_t * sched_target(pid_t pid) {
+	return pid == 0 ? (process_t*)this_core->current_process : process_from_pid(pid);
+}
+
+long sys_sched_setscheduler(pid_t pid, int policy, struct sched_param * param) {
+	PTRCHECK(param,sizeof(struct sched_param),0);
+	process_t * proc = sched_target(pid);
+	if (!proc) return -ESRCH;
+
+	if (policy < 0) policy = proc->sched_policy; /* sched_setparam */
+	int priority = param->sched_priority;
+
+	switch (policy) {
+		case SCHED_OTHER:
+			if (priority != 0) return -EINVAL;
+			break;
+		case SCHED_FIFO:
+		case SCHED_RR:
+			if (priority < SCHED_PRIORITY_MIN || priority > SCHED_PRIORITY_MAX) return -EINVAL;
+			/* A real-time process can keep everyone else off of a core. */
+			if (this_core->current_process->user != USER_ROOT_UID) return -EPERM;
+			break;
+		default:
+			return -EINVAL;
+	}
+
+	if (this_core->current_process->user != USER_ROOT_UID && proc->user != this_core->current_process->user) {
+		return -EPERM;
+	}
+
+	process_set_scheduling(proc, policy, priority, proc->nice);
+	return 0;
+}
+
+/**
+ * Returns the policy, and fills in @p param with the priority;
+ * this covers both sched_getscheduler() and sched_getparam().
+ */
+long sys_sched_getparam(pid_t pid, struct sched_param * param) {
+	PTRCHECK(param,sizeof(struct sched_param),MMU_PTR_NULL|MMU_PTR_WRITE);
+	process_t * proc = sched_target(pid);
+	if (!proc) return -ESRCH;
+	if (param) param->sched_priority = proc->sched_priority;
+	return proc->sched_policy;
+}
+
+long sys_sched_setaffinity(pid_t pid, size_t size, cpu_set_t * mask) {
+	if (size < sizeof(cpu_set_t)) return -EINVAL;
+	PTRCHECK(mask,sizeof(cpu_set_t),0);
+	process_t * proc = sched_target(pid);
+	if (!proc) return -ESRCH;
+
+	uint64_t online = (processor_count >= 64) ? (uint64_t)-1 : ((1ULL << processor_count) - 1);
+	if (!(mask->bits & online)) return -EINVAL;
+
+	if (this_core->current_process->user != USER_ROOT_UID && proc->user != this_core->current_process->user) {
+		return -EPERM;
+	}
+
+	/* If it is running somewhere it is no longer allowed, the next tick moves it. */
+	proc->cpu_affinity = mask->bits;
+	return 0;
+}
+
+long sys_sched_getaffinity(pid_t pid, size_t size, cpu_set_t * mask) {
+	if (size < sizeof(cpu_set_t)) return -EINVAL;
+	PTRCHECK(mask,sizeof(cpu_set_t),MMU_PTR_WRITE);
+	process_t * proc = sched_target(pid);
+	if (!proc) return -ESRCH;
+
+	uint64_t online = (processor_count >= 64) ? (uint64_t)-1 : ((1ULL << processor_count) - 1);
+	mask->bits = proc->cpu_affinity & online;
+	return sizeof(cpu_set_t);
+}
+
+long sys_getrandom(void * buf, size_t len, unsigned int flags) {
+	/* The generator is seeded before userspace starts, so nothing here ever blocks. */
+	if (flags & ~(GRND_NONBLOCK | GRND_RANDOM)) return -EINVAL;
+	if (len > 0x2000000) len = 0x2000000;
+	PTRCHECK(buf,len,MMU_PTR_WRITE);
+	random_get_bytes(buf, len);
+	return len;
+}
+
 extern long net_socket();
 extern long net_setsockopt();
 extern long net_bind();
@@ -1117,6 +1429,22 @@ static long (*syscalls[])() = {
 	[SYS_GETGROUPS]    = sys_getgroups,
 	[SYS_SETGROUPS]    = sys_setgroups,
 	[SYS_TIMES]        = sys_times,
+	[SYS_SYNC]         = sys_sync,
+	[SYS_FSYNC]        = sys_fsync,
+	[SYS_FDATASYNC]    = sys_fdatasync,
+	[SYS_GETPRIORITY]  = sys_getpriority,
+	[SYS_SETPRIORITY]  = sys_setpriority,
+	[SYS_SCHED_SETSCHEDULER] = sys_sched_setscheduler,
+	[SYS_SCHED_GETPARAM]     = sys_sched_getparam,
+	[SYS_SCHED_SETAFFINITY]  = sys_sched_setaffinity,
+	[SYS_SCHED_GETAFFINITY]  = sys_sched_getaffinity,
+	[SYS_GETRANDOM]    = sys_getrandom,
+	[SYS_OPENAT]       = sys_openat,
+	[SYS_FSTATAT]      = sys_fstatat,
+	[SYS_READLINKAT]   = sys_readlinkat,
+	[SYS_UNLINKAT]     = sys_unlinkat,
+	[SYS_MKDIRAT]      = sys_mkdirat,
+	[SYS_COPY_FILE_RANGE] = sys_copy_file_range,
 	[SYS_PTRACE]       = ptrace_handle,
 
 	[SYS_SOCKET]       = net_socket,
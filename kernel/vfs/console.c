@@ -1,6 +1,21 @@
 /**
  * @file  kernel/vfs/console.c
- * @brief Device file interface to the kernel console.
+ * @brief Kernel log, and the device file interface to the kernel console.
+ *
+ * dprintf() formats its message into a record in a ring belonging to
+ * the current core and returns; it never waits on the console. Space
+ * in a ring is claimed with a compare-and-swap on the ring's head, so
+ * an interrupt handler that logs while another message on the same
+ * core is half-written just takes the next slot, and a record is
+ * published by setting its committed flag last.
+ *
+ * A low-priority kernel thread takes the records from every ring in
+ * the order they were logged, writes them to the console in batches,
+ * and keeps recent ones in a history that /proc/kmsg shows. It sleeps
+ * until the timer tick sees there is something new.
+ *
+ * Before that thread is started, and once the system is going down,
+ * dprintf() writes to the console itself.
  *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
@@ -14,101 +29,491 @@
 #include <kernel/string.h>
 #include <kernel/printf.h>
 #include <kernel/time.h>
+#include <kernel/args.h>
+#include <kernel/misc.h>
+#include <kernel/procfs.h>
+#include <kernel/spinlock.h>
+#include <kernel/kmsg.h>
 
-static fs_node_t * console_dev = NULL;
+#define KMSG_RING_SIZE    8192        /* per core; must be a power of two */
+#define KMSG_HISTORY_SIZE (64 * 1024)
+#define KMSG_LINE_MAX     512         /* longer messages are cut off */
+#define KMSG_BATCH_SIZE   4096
+
+/* processor_local_data has room for this many cores */
+#define KMSG_MAX_CPUS 32
 
-/** Things we use to determine if the clock is ready. */
-extern uint64_t arch_boot_time;
+#define KMSG_COMMITTED    (1 << 0)
+#define KMSG_PAD          (1 << 1)    /* filler up to the end of a ring */
+#define KMSG_CONTINUATION (1 << 2)    /* continues the previous message; no timestamp */
+
+struct kmsg_record {
+	uint16_t size;        /* of the whole record, rounded up to 8 bytes */
+	uint8_t  flags;
+	uint8_t  level;
+	uint16_t length;      /* of the text */
+	uint16_t cpu;
+	uint64_t seq;
+	uint32_t seconds;
+	uint32_t subseconds;
+	char text[];
+};
+
+struct kmsg_ring {
+	volatile uint64_t head;   /* claimed up to, by writers on this core */
+	volatile uint64_t tail;   /* consumed up to, by the drain */
+	uint8_t data[KMSG_RING_SIZE] __attribute__((aligned(8)));
+};
 
-/** Things we use for framebuffer output. */
-extern uint16_t lfb_resolution_x;
-extern size_t (*printf_output)(size_t, uint8_t *);
+static struct kmsg_ring kmsg_rings[KMSG_MAX_CPUS];
+static volatile uint64_t kmsg_seq = 0;
+static volatile int kmsg_pending = 0;
+static volatile int kmsg_panicking = 0;
 
+static struct kmsg_levels kmsg_levels = { KMSG_LEVEL_INFO, KMSG_LEVEL_DEBUG };
+static struct kmsg_stats kmsg_stats = { 0 }; /* times are in TSC cycles here */
+
+static uint8_t history[KMSG_HISTORY_SIZE] __attribute__((aligned(8)));
+static uint64_t history_head = 0;
+static uint64_t history_tail = 0;
+static spin_lock_t history_lock = { 0 };
+
+static spin_lock_t drain_lock = { 0 };
+static char drain_batch[KMSG_BATCH_SIZE];
+static uint64_t drain_reported_drops = 0;
+static process_t * kmsg_drainer = NULL;
+static list_t * kmsg_wait = NULL;
+
+static fs_node_t * console_dev = NULL;
 static size_t (*console_write)(size_t, uint8_t *) = NULL;
 
-static uint8_t tmp_buffer[4096] __attribute__((aligned(4096)));
-static uint8_t * buffer_start = tmp_buffer;
+static void stat_max(volatile uint64_t * stat, uint64_t value) {
+	uint64_t old;
+	while ((old = *stat) < value && !__sync_bool_compare_and_swap(stat, old, value));
+}
 
-static ssize_t write_console(size_t size, uint8_t *buffer) {
-	if (console_write) return console_write(size,buffer);
+/**
+ * @brief Put a message in the current core's ring.
+ *
+ * Safe from any context. If the ring is full, the message is
+ * counted as dropped rather than waited on.
+ */
+static void kmsg_log(int level, int flags, const char * text, size_t length) {
+	struct kmsg_ring * ring = &kmsg_rings[this_core->cpu_id];
+	size_t size = (sizeof(struct kmsg_record) + length + 7) & ~7UL;
+	uint64_t head, pad, next;
 
-	if (buffer_start + size >= tmp_buffer + sizeof(tmp_buffer)) {
-		return 0; /* uh oh */
+	do {
+		head = ring->head;
+		uint64_t offset = head & (KMSG_RING_SIZE - 1);
+		pad  = (offset + size > KMSG_RING_SIZE) ? KMSG_RING_SIZE - offset : 0;
+		next = head + pad + size;
+		if (next - ring->tail > KMSG_RING_SIZE) {
+			__sync_fetch_and_add(&kmsg_stats.dropped, 1);
+			return;
+		}
+	} while (!__sync_bool_compare_and_swap(&ring->head, head, next));
+
+	if (pad) {
+		struct kmsg_record * filler = (void*)&ring->data[head & (KMSG_RING_SIZE - 1)];
+		filler->size = pad;
+		__atomic_store_n(&filler->flags, KMSG_PAD | KMSG_COMMITTED, __ATOMIC_RELEASE);
 	}
 
-	memcpy(buffer_start, buffer, size);
-	buffer_start += size;
+	struct kmsg_record * record = (void*)&ring->data[(head + pad) & (KMSG_RING_SIZE - 1)];
+	unsigned long seconds, subseconds;
+	relative_time(0, 0, &seconds, &subseconds);
+	record->size   = size;
+	record->level  = level;
+	record->length = length;
+	record->cpu    = this_core->cpu_id;
+	record->seq    = __sync_fetch_and_add(&kmsg_seq, 1);
+	record->seconds    = seconds;
+	record->subseconds = subseconds;
+	memcpy(record->text, text, length);
+	__atomic_store_n(&record->flags, flags | KMSG_COMMITTED, __ATOMIC_RELEASE);
 
-	return size;
+	__sync_fetch_and_add(&kmsg_stats.records, 1);
+	kmsg_pending = 1;
 }
 
-struct dprintf_data {
-	int prev_was_lf;
-	int left_width;
-};
+/**
+ * @brief Find the oldest committed record across all of the rings.
+ *
+ * Filler at the front of a ring is consumed on the way. A record
+ * that has been claimed but not yet committed holds up its own ring
+ * only.
+ */
+static struct kmsg_record * kmsg_next(struct kmsg_ring ** ring_out) {
+	struct kmsg_record * best = NULL;
+	for (int i = 0; i < KMSG_MAX_CPUS; ++i) {
+		struct kmsg_ring * ring = &kmsg_rings[i];
+		while (ring->tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+			struct kmsg_record * record = (void*)&ring->data[ring->tail & (KMSG_RING_SIZE - 1)];
+			uint8_t flags = __atomic_load_n(&record->flags, __ATOMIC_ACQUIRE);
+			if (!(flags & KMSG_COMMITTED)) break;
+			if (flags & KMSG_PAD) {
+				size_t size = record->size;
+				memset(record, 0, size);
+				__atomic_store_n(&ring->tail, ring->tail + size, __ATOMIC_RELEASE);
+				continue;
+			}
+			if (!best || record->seq < best->seq) {
+				best = record;
+				*ring_out = ring;
+			}
+			break;
+		}
+	}
+	return best;
+}
 
-static int cb_printf(void * user, char c) {
-	struct dprintf_data * data = user;
-	if (data->prev_was_lf) {
-		for (int i = 0; i < data->left_width; ++i) write_console(1, (uint8_t*)" ");
-		data->prev_was_lf = 0;
+/* Records are zeroed as they are consumed, so a claimed slot never shows a stale committed flag. */
+static void kmsg_consume(struct kmsg_ring * ring, struct kmsg_record * record) {
+	size_t size = record->size;
+	memset(record, 0, size);
+	__atomic_store_n(&ring->tail, ring->tail + size, __ATOMIC_RELEASE);
+}
+
+/* Called with the history lock held. The oldest records make room for new ones. */
+static void history_append(struct kmsg_record * record) {
+	size_t size = record->size;
+	uint64_t offset = history_head % KMSG_HISTORY_SIZE;
+	size_t pad = (offset + size > KMSG_HISTORY_SIZE) ? KMSG_HISTORY_SIZE - offset : 0;
+
+	while (history_head + pad + size - history_tail > KMSG_HISTORY_SIZE) {
+		struct kmsg_record * oldest = (void*)&history[history_tail % KMSG_HISTORY_SIZE];
+		history_tail += oldest->size;
 	}
-	if (c == '\n') data->prev_was_lf = 1;
-	write_console(1, (uint8_t*)&c);
-	return 0;
+
+	if (pad) {
+		struct kmsg_record * filler = (void*)&history[offset];
+		filler->size  = pad;
+		filler->flags = KMSG_PAD;
+		history_head += pad;
+	}
+
+	memcpy(&history[history_head % KMSG_HISTORY_SIZE], record, size);
+	history_head += size;
 }
 
-void console_set_output(size_t (*output)(size_t,uint8_t*)) {
-	console_write = output;
+/**
+ * @brief Format a record the way the console shows it.
+ *
+ * Lines after the first are indented to line up with the text
+ * after the timestamp. Output that doesn't fit in @p space is cut.
+ */
+static size_t console_format(struct kmsg_record * record, char * out, size_t space) {
+	size_t len = 0;
+	size_t left_width = 0;
+
+	if (!(record->flags & KMSG_CONTINUATION)) {
+		char timestamp[32];
+		left_width = snprintf(timestamp, sizeof(timestamp), "[%5lu.%06lu] ",
+			(unsigned long)record->seconds, (unsigned long)record->subseconds);
+		for (size_t i = 0; i < left_width && len < space; ++i) out[len++] = timestamp[i];
+	}
 
-	if (buffer_start != tmp_buffer) {
-		console_write(buffer_start - tmp_buffer, tmp_buffer);
-		buffer_start = tmp_buffer;
+	int prev_was_lf = 0;
+	for (size_t i = 0; i < record->length; ++i) {
+		if (prev_was_lf) {
+			for (size_t j = 0; j < left_width && len < space; ++j) out[len++] = ' ';
+			prev_was_lf = 0;
+		}
+		if (record->text[i] == '\n') prev_was_lf = 1;
+		if (len < space) out[len++] = record->text[i];
 	}
+
+	return len;
 }
 
-int dprintf(const char * fmt, ...) {
-	va_list args;
-	va_start(args, fmt);
+static void console_flush_batch(size_t size, size_t records) {
+	if (!size) return;
+	uint64_t start = arch_perf_timer();
+	console_write(size, (uint8_t*)drain_batch);
+	uint64_t elapsed = arch_perf_timer() - start;
+	kmsg_stats.console_ns_total += elapsed;
+	kmsg_stats.console_records  += records;
+	stat_max(&kmsg_stats.console_ns_max, elapsed);
+}
+
+/**
+ * @brief Move everything in the rings to the history and the console.
+ *
+ * Only one core drains at a time; anyone else finding it busy leaves
+ * their records for the drain already in progress.
+ */
+static void kmsg_drain(void) {
+	if (__sync_lock_test_and_set(drain_lock.latch, 0x01)) return;
+
+	size_t batched = 0;
+	size_t records = 0;
+	struct kmsg_ring * ring;
+	struct kmsg_record * record;
+
+	while ((record = kmsg_next(&ring))) {
+		/* Whoever holds the history lock may have been stopped for good. */
+		if (!kmsg_panicking) {
+			spin_lock(history_lock);
+			history_append(record);
+			spin_unlock(history_lock);
+		}
+
+		if (console_write && (record->level <= kmsg_levels.console || kmsg_panicking)) {
+			if (batched + KMSG_LINE_MAX > KMSG_BATCH_SIZE) {
+				console_flush_batch(batched, records);
+				batched = records = 0;
+			}
+			batched += console_format(record, drain_batch + batched, KMSG_BATCH_SIZE - batched);
+			records++;
+		}
+
+		kmsg_consume(ring, record);
+	}
+
+	uint64_t dropped = kmsg_stats.dropped;
+	if (console_write && dropped != drain_reported_drops) {
+		if (batched + 64 > KMSG_BATCH_SIZE) {
+			console_flush_batch(batched, records);
+			batched = records = 0;
+		}
+		batched += snprintf(drain_batch + batched, 64, "kmsg: %lu messages lost\n", (unsigned long)(dropped - drain_reported_drops));
+		drain_reported_drops = dropped;
+	}
+
+	if (console_write) console_flush_batch(batched, records);
+
+	__sync_lock_release(drain_lock.latch);
+}
+
+static void kmsg_drain_thread(void * argp) {
+	while (1) {
+		kmsg_pending = 0;
+		kmsg_drain();
+		if (!kmsg_pending) sleep_on(kmsg_wait);
+	}
+}
 
-	/* Is this a FATAL message? */
+/**
+ * @brief Start writing the log from its own thread.
+ *
+ * Until this is called, dprintf() writes out its own messages.
+ */
+void console_start(void) {
+	kmsg_wait = list_create("kmsg drain", NULL);
+	kmsg_drainer = spawn_worker_thread(kmsg_drain_thread, "[kmsg]", NULL);
+	process_set_scheduling(kmsg_drainer, SCHED_OTHER, 0, 19);
+}
 
-	/* If it's ready now but wasn't ready previously, are there
-	 * things in the queue to dump? */
+/**
+ * @brief Wake the log thread if there is something for it.
+ *
+ * Called from the timer interrupt, as dprintf() may be called with
+ * scheduler locks held and so can't wake anything itself.
+ */
+void console_tick(void) {
+	if (kmsg_pending && kmsg_wait && kmsg_wait->length) {
+		wakeup_queue(kmsg_wait);
+	}
+}
 
-	/* Is this a fresh message for this core that we need to assign a timestamp to? */
+/**
+ * @brief Switch to writing messages out immediately.
+ *
+ * For fatal errors, after the other cores have been stopped: whatever
+ * was left in the rings is written now, and every message after.
+ */
+void console_panic(void) {
+	kmsg_panicking = 1;
+	drain_lock.latch[0] = 0;
+	kmsg_drain();
+}
 
+void console_set_output(size_t (*output)(size_t,uint8_t*)) {
+	spin_lock(drain_lock);
+	console_write = output;
+
+	/* Show the new console what was logged before it existed. */
+	size_t batched = 0;
+	size_t records = 0;
+	spin_lock(history_lock);
+	for (uint64_t pos = history_tail; pos != history_head; ) {
+		struct kmsg_record * record = (void*)&history[pos % KMSG_HISTORY_SIZE];
+		pos += record->size;
+		if ((record->flags & KMSG_PAD) || record->level > kmsg_levels.console) continue;
+		if (batched + KMSG_LINE_MAX > KMSG_BATCH_SIZE) {
+			console_flush_batch(batched, records);
+			batched = records = 0;
+		}
+		batched += console_format(record, drain_batch + batched, KMSG_BATCH_SIZE - batched);
+		records++;
+	}
+	spin_unlock(history_lock);
+	console_flush_batch(batched, records);
 
-	struct dprintf_data _data = {0,0};
+	spin_unlock(drain_lock);
+}
+
+struct dprintf_data {
+	char * text;
+	size_t length;
+};
+
+static int cb_printf(void * user, char c) {
+	struct dprintf_data * data = user;
+	if (data->length < KMSG_LINE_MAX) data->text[data->length++] = c;
+	return 0;
+}
+
+/**
+ * @brief Log a kernel message.
+ *
+ * The format may start with one of the LOG_ levels, which otherwise
+ * defaults to LOG_INFO, and then with \a to continue the previous
+ * message without a new timestamp.
+ */
+int dprintf(const char * fmt, ...) {
+	uint64_t start = arch_perf_timer();
+	int level = KMSG_LEVEL_INFO;
+	int flags = 0;
+
+	if (fmt[0] == '\001' && fmt[1] >= '0' && fmt[1] <= '7') {
+		level = fmt[1] - '0';
+		fmt += 2;
+	}
 
 	if (*fmt == '\a') {
+		flags |= KMSG_CONTINUATION;
 		fmt++;
-	} else {
-		char timestamp[32];
-		unsigned long timer_ticks, timer_subticks;
-		relative_time(0,0,&timer_ticks,&timer_subticks);
-		size_t ts_len = snprintf(timestamp, 31, "[%5lu.%06lu] ", timer_ticks, timer_subticks);
-		_data.left_width = ts_len;
-		write_console(ts_len, (uint8_t*)timestamp);
 	}
 
-	int out = xvasprintf(cb_printf, &_data, fmt, args);
+	if (level > kmsg_levels.record && !kmsg_panicking) return 0;
+
+	char text[KMSG_LINE_MAX];
+	struct dprintf_data _data = {text, 0};
+
+	va_list args;
+	va_start(args, fmt);
+	xvasprintf(cb_printf, &_data, fmt, args);
 	va_end(args);
-	return out;
+
+	kmsg_log(level, flags, text, _data.length);
+
+	uint64_t elapsed = arch_perf_timer() - start;
+	__sync_fetch_and_add(&kmsg_stats.log_ns_total, elapsed);
+	stat_max(&kmsg_stats.log_ns_max, elapsed);
+
+	if (!kmsg_drainer || kmsg_panicking) kmsg_drain();
+
+	return _data.length;
 }
 
 static ssize_t write_fs_console(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
 	if (size > 0x1000) return -EINVAL;
 	size_t size_in = size;
 	if (size && *buffer == '\r') {
-		write_console(1,(uint8_t*)"\r");
+		kmsg_log(KMSG_LEVEL_INFO, KMSG_CONTINUATION, "\r", 1);
 		buffer++;
 		size--;
 	}
-	if (size) dprintf("%*s", (unsigned int)size, buffer);
+	int flags = 0;
+	while (size) {
+		size_t chunk = size < KMSG_LINE_MAX ? size : KMSG_LINE_MAX;
+		kmsg_log(KMSG_LEVEL_INFO, flags, (char*)buffer, chunk);
+		flags = KMSG_CONTINUATION;
+		buffer += chunk;
+		size -= chunk;
+	}
+	if (!kmsg_drainer) kmsg_drain();
 	return size_in;
 }
 
+extern void ptr_validate(void * ptr, const char * syscall);
+#define validate(o) ptr_validate(o,"ioctl")
+
+static uint64_t cycles_to_ns(uint64_t cycles) {
+	size_t mhz = arch_cpu_mhz();
+	return mhz ? cycles * 1000 / mhz : 0;
+}
+
+static int ioctl_console(fs_node_t * node, unsigned long request, void * argp) {
+	switch (request) {
+		case IO_KMSG_GET_LEVELS:
+			validate(argp);
+			memcpy(argp, &kmsg_levels, sizeof(struct kmsg_levels));
+			return 0;
+		case IO_KMSG_SET_LEVELS: {
+			if (this_core->current_process->user != USER_ROOT_UID) return -EPERM;
+			validate(argp);
+			struct kmsg_levels * levels = argp;
+			if (levels->console < 0 || levels->console > 7) return -EINVAL;
+			if (levels->record < 0 || levels->record > 7) return -EINVAL;
+			kmsg_levels = *levels;
+			return 0;
+		}
+		case IO_KMSG_GET_STATS: {
+			validate(argp);
+			struct kmsg_stats * stats = argp;
+			*stats = kmsg_stats;
+			stats->log_ns_max       = cycles_to_ns(stats->log_ns_max);
+			stats->log_ns_total     = cycles_to_ns(stats->log_ns_total);
+			stats->console_ns_max   = cycles_to_ns(stats->console_ns_max);
+			stats->console_ns_total = cycles_to_ns(stats->console_ns_total);
+			return 0;
+		}
+		default:
+			return -EINVAL;
+	}
+}
+
+/**
+ * /proc/kmsg: the history, one "<level>[timestamp] text" per message.
+ * Continuations are shown as they were logged, without a prefix.
+ */
+static ssize_t kmsg_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	spin_lock(history_lock);
+
+	size_t total_size = 0;
+	for (uint64_t pos = history_tail; pos != history_head; ) {
+		struct kmsg_record * record = (void*)&history[pos % KMSG_HISTORY_SIZE];
+		pos += record->size;
+		if (record->flags & KMSG_PAD) continue;
+		/* "<7>" and a timestamp of up to "[4294967295.999999] " */
+		total_size += 24 + record->length;
+	}
+
+	char * buf = malloc(total_size + 1);
+	size_t soffset = 0;
+	for (uint64_t pos = history_tail; pos != history_head; ) {
+		struct kmsg_record * record = (void*)&history[pos % KMSG_HISTORY_SIZE];
+		pos += record->size;
+		if (record->flags & KMSG_PAD) continue;
+		if (record->flags & KMSG_CONTINUATION) {
+			memcpy(&buf[soffset], record->text, record->length);
+			soffset += record->length;
+		} else {
+			soffset += snprintf(&buf[soffset], 25, "<%d>[%5lu.%06lu] ", record->level,
+				(unsigned long)record->seconds, (unsigned long)record->subseconds);
+			memcpy(&buf[soffset], record->text, record->length);
+			soffset += record->length;
+		}
+	}
+
+	spin_unlock(history_lock);
+
+	if ((size_t)offset >= soffset) {
+		free(buf);
+		return 0;
+	}
+
+	if (size > soffset - offset) size = soffset - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+
+static struct procfs_entry kmsg_entry = {0, "kmsg", kmsg_func};
+
 static fs_node_t * console_device_create(void) {
 	fs_node_t * fnode = malloc(sizeof(fs_node_t));
 	memset(fnode, 0x00, sizeof(fs_node_t));
@@ -119,10 +524,17 @@ static fs_node_t * console_device_create(void) {
 	fnode->mask = 0660;
 	fnode->flags   = FS_CHARDEVICE;
 	fnode->write   = write_fs_console;
+	fnode->ioctl   = ioctl_console;
 	return fnode;
 }
 
 void console_initialize(void) {
+	if (args_present("loglevel")) {
+		int level = atoi(args_value("loglevel"));
+		if (level >= 0 && level <= 7) kmsg_levels.console = level;
+	}
+
 	console_dev = console_device_create();
 	vfs_mount("/dev/console", console_dev);
+	procfs_install(&kmsg_entry);
 }
@@ -97,11 +97,12 @@ static void pipe_alert_waiters(pipe_device_t * pipe) {
 	spin_lock(pipe->alert_lock);
 	while (pipe->alert_waiters->head) {
 		node_t * node = list_dequeue(pipe->alert_waiters);
-		process_t * p = node->value;
+		process_handle_t * handle = node->value;
 		free(node);
 		spin_unlock(pipe->alert_lock);
 
-		process_alert_node(p, pipe);
+		process_alert_node(handle, pipe);
+		free(handle);
 
 		spin_lock(pipe->alert_lock);
 	}
@@ -216,9 +217,7 @@ static int pipe_wait(fs_node_t * node, void * process) {
 	pipe_device_t * pipe = (pipe_device_t *)node->device;
 
 	spin_lock(pipe->alert_lock);
-	if (!list_find(pipe->alert_waiters, process)) {
-		list_insert(pipe->alert_waiters, process);
-	}
+	process_handle_insert(pipe->alert_waiters, process);
 	spin_unlock(pipe->alert_lock);
 
 	spin_lock(pipe->wait_lock);
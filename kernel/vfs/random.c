@@ -1,37 +1,276 @@
 /**
  * @file  kernel/vfs/random.c
- * @brief Bad RNG.
+ * @brief Kernel random number generator.
  *
- * Provides a terrible little xorshift random number generator.
+ * Each core has its own ChaCha20 generator, so readers on different
+ * cores never share state. Output is produced a 64-byte block at a time;
+ * after every request the generator replaces its own key with fresh
+ * output, so a later look at its state can't reveal what it produced.
+ *
+ * The generators are keyed from a shared entropy pool, which is fed
+ * from RDSEED/RDRAND where the processor has them and from timing
+ * jitter in the TSC. Each generator takes a new key from the pool
+ * every few minutes or after enough output.
  *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
- * Copyright (C) 2014-2018 K. Lange
+ * Copyright (C) 2014-2021 K. Lange
  */
 #include <stdint.h>
+#include <errno.h>
 #include <kernel/vfs.h>
 #include <kernel/string.h>
+#include <kernel/process.h>
+#include <kernel/spinlock.h>
+#include <kernel/random.h>
+#include <kernel/time.h>
 
-uint32_t rand(void) {
-	static uint32_t x = 123456789;
-	static uint32_t y = 362436069;
-	static uint32_t z = 521288629;
-	static uint32_t w = 88675123;
+#define RANDOM_RESEED_SECONDS 300
+#define RANDOM_RESEED_BYTES   (16UL << 20)
+
+/* processor_local_data has room for this many cores */
+#define RANDOM_MAX_CPUS 32
+
+struct random_state {
+	spin_lock_t lock;
+	uint32_t key[8];
+	uint64_t generated;   /* bytes since the last reseed */
+	uint64_t seeded_at;   /* now() at the last reseed */
+	int seeded;
+};
+
+static struct random_state random_states[RANDOM_MAX_CPUS];
+
+static spin_lock_t pool_lock = { 0 };
+static uint32_t pool[8];
+static uint64_t pool_counter = 0;
+
+#define ROTL(v,n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define QR(a,b,c,d) do { \
+	a += b; d ^= a; d = ROTL(d,16); \
+	c += d; b ^= c; b = ROTL(b,12); \
+	a += b; d ^= a; d = ROTL(d,8);  \
+	c += d; b ^= c; b = ROTL(b,7);  \
+} while (0)
+
+/**
+ * @brief Produce one ChaCha20 block.
+ *
+ * The 64-bit block counter and 64-bit nonce take the last four
+ * words of the input, as in the original ChaCha construction.
+ */
+static void chacha20_block(const uint32_t key[8], uint64_t counter, uint64_t nonce, uint32_t out[16]) {
+	uint32_t in[16] = {
+		0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+		key[0], key[1], key[2], key[3],
+		key[4], key[5], key[6], key[7],
+		(uint32_t)counter, (uint32_t)(counter >> 32),
+		(uint32_t)nonce, (uint32_t)(nonce >> 32),
+	};
+	uint32_t x[16];
+	memcpy(x, in, sizeof(x));
 
-	uint32_t t;
+	for (int i = 0; i < 10; ++i) {
+		QR(x[0], x[4], x[8],  x[12]);
+		QR(x[1], x[5], x[9],  x[13]);
+		QR(x[2], x[6], x[10], x[14]);
+		QR(x[3], x[7], x[11], x[15]);
+		QR(x[0], x[5], x[10], x[15]);
+		QR(x[1], x[6], x[11], x[12]);
+		QR(x[2], x[7], x[8],  x[13]);
+		QR(x[3], x[4], x[9],  x[14]);
+	}
 
-	t = x ^ (x << 11);
-	x = y; y = z; z = w;
-	return w = w ^ (w >> 19) ^ t ^ (t >> 8);
+	for (int i = 0; i < 16; ++i) {
+		out[i] = x[i] + in[i];
+	}
 }
 
-static ssize_t read_random(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
-	size_t s = 0;
-	while (s < size) {
-		buffer[s] = rand() % 0xFF;
-		s++;
+/**
+ * @brief Mix data into the entropy pool.
+ *
+ * Safe to call from any thread context, but not from interrupt
+ * handlers, as the pool lock is also taken by ordinary readers.
+ */
+void random_add_entropy(const void * data, size_t len) {
+	const uint8_t * in = data;
+	uint32_t out[16];
+
+	spin_lock(pool_lock);
+	while (len) {
+		size_t chunk = len < sizeof(pool) ? len : sizeof(pool);
+		for (size_t i = 0; i < chunk; ++i) {
+			pool[i / 4] ^= (uint32_t)in[i] << (8 * (i % 4));
+		}
+		in += chunk;
+		len -= chunk;
+
+		/* Stir: the pool becomes the output of a block keyed with itself */
+		chacha20_block(pool, pool_counter++, 0x6c6f6f70, out);
+		memcpy(pool, out, sizeof(pool));
+	}
+	spin_unlock(pool_lock);
+
+	memset(out, 0, sizeof(out));
+}
+
+#ifdef __x86_64__
+static int has_rdrand = 0;
+static int has_rdseed = 0;
+
+static void detect_hardware_random(void) {
+	uint32_t a, b, c, d;
+	asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1));
+	has_rdrand = !!(c & (1 << 30));
+	asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0));
+	if (a >= 7) {
+		asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(7), "c"(0));
+		has_rdseed = !!(b & (1 << 18));
+	}
+}
+
+/**
+ * @brief Fill @p out with words from the processor's generator.
+ *
+ * RDSEED is preferred as it comes straight from the entropy source;
+ * RDRAND is the output of a DRBG over the same source. Either can
+ * briefly run dry, so each word gets a few tries.
+ */
+static int hardware_random(uint64_t * out, int words) {
+	int got = 0;
+	for (int i = 0; i < words; ++i) {
+		for (int tries = 0; tries < 10; ++tries) {
+			uint8_t ok = 0;
+			if (has_rdseed) {
+				asm volatile ("rdseed %0; setc %1" : "=r"(out[got]), "=qm"(ok));
+			} else if (has_rdrand) {
+				asm volatile ("rdrand %0; setc %1" : "=r"(out[got]), "=qm"(ok));
+			} else {
+				return got;
+			}
+			if (ok) {
+				got++;
+				break;
+			}
+		}
+	}
+	return got;
+}
+#else
+static void detect_hardware_random(void) { }
+static int hardware_random(uint64_t * out, int words) { return 0; }
+#endif
+
+/**
+ * @brief Feed the pool from the hardware generator and timer jitter.
+ *
+ * The jitter loop times a short, data-dependent amount of work; its
+ * duration varies with cache and bus state and interrupt arrival.
+ * Only the low bits carry anything, but they are all mixed in.
+ */
+static void gather_entropy(int samples) {
+	uint64_t buf[32];
+
+	int got = hardware_random(buf, 8);
+	if (got) random_add_entropy(buf, got * sizeof(uint64_t));
+
+	while (samples > 0) {
+		int n = samples < 32 ? samples : 32;
+		volatile uint64_t sink = 0;
+		for (int i = 0; i < n; ++i) {
+			uint64_t start = arch_perf_timer();
+			for (uint64_t j = 0; j < 16 + (start & 0x3F); ++j) {
+				sink += j * start;
+			}
+			buf[i] = arch_perf_timer() ^ (start << 32) ^ sink;
+		}
+		random_add_entropy(buf, n * sizeof(uint64_t));
+		samples -= n;
+	}
+
+	memset(buf, 0, sizeof(buf));
+}
+
+/**
+ * @brief Give a core's generator a new key derived from the pool.
+ *
+ * Called with the state locked. The old key is mixed in, so a
+ * reseed never makes the generator weaker than it was.
+ */
+static void reseed(struct random_state * state, int cpu) {
+	uint32_t out[16];
+
+	gather_entropy(16);
+
+	spin_lock(pool_lock);
+	chacha20_block(pool, pool_counter++, 0x7365656400000000UL | cpu, out);
+	spin_unlock(pool_lock);
+
+	for (int i = 0; i < 8; ++i) {
+		state->key[i] ^= out[i];
+	}
+	state->generated = 0;
+	state->seeded_at = now();
+	state->seeded = 1;
+
+	memset(out, 0, sizeof(out));
+}
+
+/**
+ * @brief Fill @p buffer with @p size random bytes.
+ *
+ * The generator is rekeyed while its lock is held; the output itself
+ * is produced afterwards from a private copy of the old key, so long
+ * reads don't hold up other readers.
+ */
+void random_get_bytes(void * buffer, size_t size) {
+	int cpu = this_core->cpu_id;
+	struct random_state * state = &random_states[cpu];
+	uint32_t key[8];
+	uint32_t block[16];
+	uint64_t blocks = (size + 63) / 64;
+
+	spin_lock(state->lock);
+	if (!state->seeded || state->generated >= RANDOM_RESEED_BYTES ||
+		now() - state->seeded_at >= RANDOM_RESEED_SECONDS) {
+		reseed(state, cpu);
+	}
+
+	/* Every request gets a key of its own and counts blocks up from zero.
+	 * Fast key erasure: the next key comes from just past those blocks. */
+	memcpy(key, state->key, sizeof(key));
+	uint64_t counter = 0;
+	uint64_t nonce = cpu;
+	chacha20_block(state->key, blocks, nonce, block);
+	memcpy(state->key, block, sizeof(state->key));
+	state->generated += size;
+	spin_unlock(state->lock);
+
+	uint8_t * out = buffer;
+	while (size >= 64) {
+		chacha20_block(key, counter++, nonce, block);
+		memcpy(out, block, 64);
+		out += 64;
+		size -= 64;
 	}
+	if (size) {
+		chacha20_block(key, counter++, nonce, block);
+		memcpy(out, block, size);
+	}
+
+	memset(key, 0, sizeof(key));
+	memset(block, 0, sizeof(block));
+}
+
+uint32_t rand(void) {
+	uint32_t out;
+	random_get_bytes(&out, sizeof(out));
+	return out;
+}
+
+static ssize_t read_random(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	random_get_bytes(buffer, size);
 	return size;
 }
 
@@ -50,7 +289,17 @@ static fs_node_t * random_device_create(void) {
 }
 
 void random_initialize(void) {
+	for (int i = 0; i < RANDOM_MAX_CPUS; ++i) {
+		spin_init(random_states[i].lock);
+	}
+
+	detect_hardware_random();
+
+	/* Boot is very regular, so take plenty of jitter samples to start. */
+	uint64_t boot[2] = { arch_perf_timer(), now() };
+	random_add_entropy(boot, sizeof(boot));
+	gather_entropy(256);
+
 	vfs_mount("/dev/random", random_device_create());
 	vfs_mount("/dev/urandom", random_device_create());
 }
-
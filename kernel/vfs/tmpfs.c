@@ -5,6 +5,11 @@
  * Generally provides the filesystem for "migrated" live CDs,
  * as well as /tmp and /var.
  *
+ * Files are sparse: a block that was never written has frame 0 and
+ * reads as zeros. copy_range shares whole blocks between files rather
+ * than copying them; a shared frame is counted in tmpfs_shared_frames
+ * and copied the first time either file writes to it.
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -23,6 +28,7 @@
 #include <kernel/mmu.h>
 #include <kernel/time.h>
 #include <kernel/procfs.h>
+#include <kernel/hashmap.h>
 
 /* 4KB */
 #define BLOCKSIZE 0x1000
@@ -34,6 +40,12 @@
 static struct tmpfs_dir * tmpfs_root = NULL;
 static volatile intptr_t tmpfs_total_blocks = 0;
 
+/* Frame index -> number of additional files using it */
+static hashmap_t * tmpfs_shared_frames = NULL;
+static spin_lock_t tmpfs_share_lock = { 0 };
+
+static const uint8_t tmpfs_zero_block[BLOCKSIZE] = { 0 };
+
 static fs_node_t * tmpfs_from_dir(struct tmpfs_dir * d);
 
 static struct tmpfs_file * tmpfs_file_new(char * name) {
@@ -124,6 +136,39 @@ static struct tmpfs_dir * tmpfs_dir_new(char * name, struct tmpfs_dir * parent)
 	return d;
 }
 
+/* Drop one file's use of a frame, freeing it if nothing else shares it. */
+static void tmpfs_frame_release(uintptr_t frame) {
+	if (!frame) return;
+
+	spin_lock(tmpfs_share_lock);
+	intptr_t shares = (intptr_t)hashmap_get(tmpfs_shared_frames, (void*)frame);
+	if (shares > 1) {
+		hashmap_set(tmpfs_shared_frames, (void*)frame, (void*)(shares - 1));
+	} else if (shares == 1) {
+		hashmap_remove(tmpfs_shared_frames, (void*)frame);
+	} else {
+		mmu_frame_clear(frame * 0x1000);
+		tmpfs_total_blocks--;
+	}
+	spin_unlock(tmpfs_share_lock);
+}
+
+static void tmpfs_frame_share(uintptr_t frame) {
+	if (!frame) return;
+
+	spin_lock(tmpfs_share_lock);
+	intptr_t shares = (intptr_t)hashmap_get(tmpfs_shared_frames, (void*)frame);
+	hashmap_set(tmpfs_shared_frames, (void*)frame, (void*)(shares + 1));
+	spin_unlock(tmpfs_share_lock);
+}
+
+static int tmpfs_frame_is_shared(uintptr_t frame) {
+	spin_lock(tmpfs_share_lock);
+	int shared = hashmap_has(tmpfs_shared_frames, (void*)frame);
+	spin_unlock(tmpfs_share_lock);
+	return shared;
+}
+
 static void tmpfs_file_free(struct tmpfs_file * t) {
 	if (t->type == TMPFS_TYPE_LINK) {
 		printf("tmpfs: bad link free?\n");
@@ -131,8 +176,7 @@ static void tmpfs_file_free(struct tmpfs_file * t) {
 	}
 	spin_lock(t->lock);
 	for (size_t i = 0; i < t->block_count; ++i) {
-		mmu_frame_clear((uintptr_t)t->blocks[i] * 0x1000);
-		tmpfs_total_blocks--;
+		tmpfs_frame_release(t->blocks[i]);
 	}
 	spin_unlock(t->lock);
 }
@@ -142,21 +186,41 @@ static void tmpfs_file_blocks_embiggen(struct tmpfs_file * t) {
 	t->blocks = realloc(t->blocks, sizeof(char *) * t->pointers);
 }
 
+/* Extend the block list with holes up to and including blockid. */
+static void tmpfs_file_extend(struct tmpfs_file * t, size_t blockid) {
+	while (blockid >= t->pointers) {
+		tmpfs_file_blocks_embiggen(t);
+	}
+	while (blockid >= t->block_count) {
+		t->blocks[t->block_count] = 0;
+		t->block_count += 1;
+	}
+}
+
+/**
+ * Get a block to read from, or (with create) to write to. Holes read
+ * as the zero block; writing fills them, and writing a shared block
+ * gives this file its own copy first.
+ */
 static char * tmpfs_file_getset_block(struct tmpfs_file * t, size_t blockid, int create) {
 	if (create) {
-		while (blockid >= t->pointers) {
-			tmpfs_file_blocks_embiggen(t);
-		}
-		while (blockid >= t->block_count) {
+		tmpfs_file_extend(t, blockid);
+		uintptr_t frame = t->blocks[blockid];
+		if (!frame) {
+			uintptr_t index = mmu_allocate_a_frame();
+			tmpfs_total_blocks++;
+			memset(mmu_map_from_physical(index << 12), 0, BLOCKSIZE);
+			t->blocks[blockid] = index;
+		} else if (tmpfs_frame_is_shared(frame)) {
 			uintptr_t index = mmu_allocate_a_frame();
 			tmpfs_total_blocks++;
-			t->blocks[t->block_count] = index;
-			t->block_count += 1;
+			memcpy(mmu_map_from_physical(index << 12), mmu_map_from_physical(frame << 12), BLOCKSIZE);
+			t->blocks[blockid] = index;
+			tmpfs_frame_release(frame);
 		}
 	} else {
-		if (blockid >= t->block_count) {
-			printf("tmpfs: not enough blocks?\n");
-			return NULL;
+		if (blockid >= t->block_count || !t->blocks[blockid]) {
+			return (char *)tmpfs_zero_block;
 		}
 	}
 
@@ -277,8 +341,7 @@ static int truncate_tmpfs(fs_node_t * node) {
 	struct tmpfs_file * t = (struct tmpfs_file *)(node->device);
 	spin_lock(t->lock);
 	for (size_t i = 0; i < t->block_count; ++i) {
-		mmu_frame_clear((uintptr_t)t->blocks[i] * 0x1000);
-		tmpfs_total_blocks--;
+		tmpfs_frame_release(t->blocks[i]);
 		t->blocks[i] = 0;
 	}
 	t->block_count = 0;
@@ -294,6 +357,96 @@ static void open_tmpfs(fs_node_t * node, unsigned int flags) {
 	t->atime = now();
 }
 
+/* Copy a piece that doesn't cover whole blocks the ordinary way. */
+static ssize_t copy_range_bytes(fs_node_t * src, off_t src_off, fs_node_t * dst, off_t dst_off, size_t size) {
+	uint8_t * buf = malloc(BLOCKSIZE);
+	ssize_t total = 0;
+	while (size) {
+		size_t chunk = size < BLOCKSIZE ? size : BLOCKSIZE;
+		ssize_t r = read_tmpfs(src, src_off + total, chunk, buf);
+		if (r <= 0) break;
+		write_tmpfs(dst, dst_off + total, r, buf);
+		total += r;
+		size -= r;
+		if ((size_t)r < chunk) break;
+	}
+	free(buf);
+	return total;
+}
+
+/**
+ * Copy between two tmpfs files. Where both offsets fall at the same
+ * place in a block, every whole block of the source is shared with
+ * the destination instead of copied, and holes stay holes.
+ */
+static ssize_t copy_range_tmpfs(fs_node_t * src, off_t src_off, fs_node_t * dst, off_t dst_off, size_t size) {
+	struct tmpfs_file * s = (struct tmpfs_file *)(src->device);
+	struct tmpfs_file * d = (struct tmpfs_file *)(dst->device);
+
+	if (s == d || (src_off % BLOCKSIZE) != (dst_off % BLOCKSIZE)) return -ENOTSUP;
+
+	spin_lock(s->lock);
+	size_t length = s->length;
+	spin_unlock(s->lock);
+
+	if ((size_t)src_off >= length) return 0;
+	if (size > length - src_off) size = length - src_off;
+
+	/* Unaligned start */
+	ssize_t total = 0;
+	if (src_off % BLOCKSIZE) {
+		size_t head = BLOCKSIZE - (src_off % BLOCKSIZE);
+		if (head > size) head = size;
+		total = copy_range_bytes(src, src_off, dst, dst_off, head);
+		if ((size_t)total < head) return total;
+		size -= head;
+	}
+
+	/* Whole blocks; the final partial block of the source isn't shared,
+	 * as whatever lies past its end would be visible in the destination. */
+	size_t first = (src_off + total) / BLOCKSIZE;
+	size_t count = size / BLOCKSIZE;
+	size_t dst_first = (dst_off + total) / BLOCKSIZE;
+
+	if (count) {
+		/* Lock in a fixed order so two opposing copies can't deadlock */
+		if (s < d) {
+			spin_lock(s->lock);
+			spin_lock(d->lock);
+		} else {
+			spin_lock(d->lock);
+			spin_lock(s->lock);
+		}
+
+		tmpfs_file_extend(d, dst_first + count - 1);
+		for (size_t i = 0; i < count; ++i) {
+			uintptr_t frame = first + i < s->block_count ? s->blocks[first + i] : 0;
+			uintptr_t old = d->blocks[dst_first + i];
+			if (frame == old) continue;
+			tmpfs_frame_share(frame);
+			d->blocks[dst_first + i] = frame;
+			tmpfs_frame_release(old);
+		}
+
+		size_t end = (dst_first + count) * BLOCKSIZE;
+		if (end > d->length) d->length = end;
+		d->mtime = now();
+
+		spin_unlock(s->lock);
+		spin_unlock(d->lock);
+
+		total += count * BLOCKSIZE;
+		size -= count * BLOCKSIZE;
+	}
+
+	/* Partial tail */
+	if (size) {
+		total += copy_range_bytes(src, src_off + total, dst, dst_off + total, size);
+	}
+
+	return total;
+}
+
 static fs_node_t * tmpfs_from_file(struct tmpfs_file * t) {
 	fs_node_t * fnode = malloc(sizeof(fs_node_t));
 	spin_lock(t->lock);
@@ -318,6 +471,7 @@ static fs_node_t * tmpfs_from_file(struct tmpfs_file * t) {
 	fnode->chown   = chown_tmpfs;
 	fnode->length  = t->length;
 	fnode->truncate = truncate_tmpfs;
+	fnode->copy_range = copy_range_tmpfs;
 	fnode->nlink   = 1;
 	spin_unlock(t->lock);
 	return fnode;
@@ -578,6 +732,7 @@ static struct procfs_entry tmpfs_entry = {
 };
 
 void tmpfs_register_init(void) {
+	tmpfs_shared_frames = hashmap_create_int(64);
 	vfs_register("tmpfs", tmpfs_mount);
 	procfs_install(&tmpfs_entry);
 }
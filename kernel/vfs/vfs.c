@@ -211,6 +211,88 @@ int truncate_fs(fs_node_t * node) {
 	return -EINVAL;
 }
 
+/**
+ * @brief Write back anything a file system has cached for a node.
+ *
+ * @param node     File to sync
+ * @param datasync Only what is needed to read the data back
+ */
+int sync_fs(fs_node_t * node, int datasync) {
+	if (!node) return -ENOENT;
+
+	if (node->sync) {
+		return node->sync(node, datasync);
+	}
+
+	/* Nothing cached, nothing to do */
+	return 0;
+}
+
+#define COPY_CHUNK (128 * 1024)
+
+/**
+ * @brief Copy data from one node to another inside the kernel.
+ *
+ * When both nodes come from a file system with its own copy_range,
+ * it gets the first try; it may be able to share or clone storage
+ * rather than copy it. Otherwise, or if it declines with -ENOTSUP,
+ * data goes through a kernel buffer in large pieces.
+ *
+ * @returns Bytes copied, which is short at the end of @p src
+ */
+ssize_t copy_range_fs(fs_node_t * src, off_t src_off, fs_node_t * dst, off_t dst_off, size_t size) {
+	if (!src || !dst) return -ENOENT;
+	if (!src->read) return -EINVAL;
+	if (!dst->write) return -EROFS;
+
+	if (src->copy_range && src->copy_range == dst->copy_range) {
+		ssize_t out = dst->copy_range(src, src_off, dst, dst_off, size);
+		if (out != -ENOTSUP) return out;
+	}
+
+	uint8_t * buf = malloc(size < COPY_CHUNK ? size : COPY_CHUNK);
+	ssize_t total = 0;
+	while (size) {
+		size_t chunk = size < COPY_CHUNK ? size : COPY_CHUNK;
+		ssize_t r = read_fs(src, src_off, chunk, buf);
+		if (r <= 0) {
+			if (r < 0 && !total) total = r;
+			break;
+		}
+		ssize_t w = write_fs(dst, dst_off, r, buf);
+		if (w <= 0) {
+			if (w < 0 && !total) total = w;
+			break;
+		}
+		total   += w;
+		src_off += w;
+		dst_off += w;
+		size    -= w;
+		if (w < r) break;
+	}
+	free(buf);
+	return total;
+}
+
+static void vfs_sync_node(tree_node_t * node) {
+	if (!node) return;
+	struct vfs_entry * fnode = (struct vfs_entry *)node->value;
+	if (fnode->file) {
+		sync_fs(fnode->file, 0);
+	}
+	foreach(child, node->children) {
+		vfs_sync_node(child->value);
+	}
+}
+
+/**
+ * @brief Write back all mounted file systems.
+ */
+void vfs_sync(void) {
+	if (!fs_tree) return;
+	vfs_sync_node(fs_tree->root);
+}
+
 //volatile uint8_t tmp_refcount_lock = 0;
 static spin_lock_t tmp_refcount_lock = { 0 };
 
@@ -348,6 +430,58 @@ int ioctl_fs(fs_node_t *node, unsigned long request, void * argp) {
 }
 
 
+/**
+ * @brief Is @p name a single path component that names a child?
+ *
+ * "." and ".." are excluded, as ".." leaving a mount point has to be
+ * resolved through the mount tree.
+ */
+static int is_plain_name(const char * name) {
+	if (!name[0]) return 0;
+	if (!strcmp(name, ".") || !strcmp(name, "..")) return 0;
+	return !strchr(name, PATH_SEPARATOR);
+}
+
+/**
+ * @brief Is something mounted at, or beneath, @p name in @p dir_path?
+ *
+ * Only the mount tree is consulted, so this is cheap. Names where it
+ * is true can't be looked up directly in the directory's file system
+ * and need a full path walk.
+ */
+static int mount_below(const char * dir_path, const char * name) {
+	tree_node_t * node = fs_tree->root;
+	const char * at = dir_path;
+
+	while (1) {
+		while (*at == PATH_SEPARATOR) at++;
+		if (!*at) break;
+		const char * end = at;
+		while (*end && *end != PATH_SEPARATOR) end++;
+		size_t len = end - at;
+
+		int found = 0;
+		foreach(child, node->children) {
+			tree_node_t * tchild = (tree_node_t *)child->value;
+			struct vfs_entry * ent = (struct vfs_entry *)tchild->value;
+			if (strlen(ent->name) == len && !memcmp(ent->name, at, len)) {
+				node = tchild;
+				found = 1;
+				break;
+			}
+		}
+		if (!found) return 0;
+		at = end;
+	}
+
+	foreach(child, node->children) {
+		tree_node_t * tchild = (tree_node_t *)child->value;
+		struct vfs_entry * ent = (struct vfs_entry *)tchild->value;
+		if (!strcmp(ent->name, name)) return 1;
+	}
+	return 0;
+}
+
 /*
  * XXX: The following two function should be replaced with
  *      one function to create children of directory nodes.
@@ -520,6 +654,61 @@ int mkdir_fs(char *name, mode_t permission) {
 	return ret;
 }
 
+/*
+ * The *_at_fs variants act on @p name relative to the open directory
+ * @p dir, whose canonical path is @p dir_path. A plain name is handed
+ * straight to the directory; anything else, or a NULL @p dir, goes
+ * through the path-based functions above.
+ */
+
+int create_file_at_fs(fs_node_t * dir, const char * dir_path, char * name, mode_t permission) {
+	if (!dir || !is_plain_name(name) || mount_below(dir_path, name)) {
+		if (!dir) return create_file_fs(name, permission);
+		char * path = canonicalize_path(dir_path, name);
+		int ret = create_file_fs(path, permission);
+		free(path);
+		return ret;
+	}
+
+	if (!has_permission(dir, 02)) return -EACCES;
+	if (!dir->create) return -EINVAL;
+	return dir->create(dir, name, permission);
+}
+
+int unlink_at_fs(fs_node_t * dir, const char * dir_path, char * name) {
+	if (!dir || !is_plain_name(name) || mount_below(dir_path, name)) {
+		if (!dir) return unlink_fs(name);
+		char * path = canonicalize_path(dir_path, name);
+		int ret = unlink_fs(path);
+		free(path);
+		return ret;
+	}
+
+	if (!has_permission(dir, 02)) return -EACCES;
+	if (!dir->unlink) return -EINVAL;
+	return dir->unlink(dir, name);
+}
+
+int mkdir_at_fs(fs_node_t * dir, const char * dir_path, char * name, mode_t permission) {
+	if (!dir || !is_plain_name(name) || mount_below(dir_path, name)) {
+		if (!dir) return mkdir_fs(name, permission);
+		char * path = canonicalize_path(dir_path, name);
+		int ret = mkdir_fs(path, permission);
+		free(path);
+		return ret;
+	}
+
+	fs_node_t * this = finddir_fs(dir, name);
+	if (this) {
+		free(this);
+		return -EEXIST;
+	}
+
+	if (!has_permission(dir, 02)) return -EACCES;
+	if (!dir->mkdir) return -EROFS;
+	return dir->mkdir(dir, name, permission);
+}
+
 fs_node_t *clone_fs(fs_node_t *source) {
 	if (!source) return NULL;
 
@@ -1126,3 +1315,34 @@ fs_node_t *kopen(const char *filename, unsigned int flags) {
 	return kopen_recur(filename, flags, 0, (char *)(this_core->current_process->wd_name));
 }
 
+/**
+ * @brief Open a file relative to an open directory.
+ *
+ * A plain name is looked up directly in @p dir, with no need to
+ * rebuild and walk the directory's path from the root. Other names,
+ * and symlinks that need following, are resolved against @p dir_path
+ * as kopen() resolves them against the working directory.
+ *
+ * @param dir      Open directory, or NULL for the working directory
+ * @param dir_path Canonical path of @p dir
+ * @param filename Filename to open
+ * @param flags    Flag bits for read/write mode.
+ * @returns A file system node element that the caller can free.
+ */
+fs_node_t *kopen_at(fs_node_t * dir, const char * dir_path, const char * filename, unsigned int flags) {
+	if (!filename) return NULL;
+	if (!dir) return kopen(filename, flags);
+
+	if (is_plain_name(filename) && !mount_below(dir_path, filename)) {
+		fs_node_t * node = finddir_fs(dir, (char *)filename);
+		if (!node) return NULL;
+		if (!(node->flags & FS_SYMLINK) || ((flags & O_NOFOLLOW) && (flags & O_PATH))) {
+			open_fs(node, flags);
+			return node;
+		}
+		free(node);
+	}
+
+	return kopen_recur(filename, flags, 0, (char *)dir_path);
+}
+
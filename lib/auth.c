@@ -12,6 +12,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <pwd.h>
+#include <grp.h>
 
 #ifndef fgetpwent
 extern struct passwd *fgetpwent(FILE *stream);
@@ -72,58 +73,26 @@ void toaru_auth_set_groups(uid_t uid) {
 	/* No username? No group memberships! */
 	if (!pwd) goto no_groups;
 
-	/* Open the group file */
-	FILE * groupList = fopen("/etc/group","r");
-
-	/* No groups? No membership. */
-	if (!groupList) goto no_groups;
-
-	/* Scan through lines of groups. */
-#define LINE_LEN 2048
-	char * pw_blob = malloc(LINE_LEN);
-
 	int groupCount = 0;
 	gid_t myGroups[32] = {0};
 
-	while (!feof(groupList)) {
-		memset(pw_blob, 0x00, LINE_LEN);
-		fgets(pw_blob, LINE_LEN, groupList);
-		if (pw_blob[strlen(pw_blob)-1] == '\n') {
-			pw_blob[strlen(pw_blob)-1] = '\0'; /* erase newline */
-		}
-
-		/* Tokenize */
-		char * memberlist = NULL;
-		char *p, *last;
-		gid_t groupNumber = -1;
-		int i = 0;
-		for ((p = strtok_r(pw_blob, ":", &last)); p;
-				(p = strtok_r(NULL, ":", &last)), i++) {
-			if (i == 2) {
-				groupNumber = atoi(p);
-			} else if (i == 3) {
-				memberlist = p;
-				break;
-			}
-		}
-
-		if (groupNumber == -1) continue;
-		if (!memberlist) continue;
-
-		for ((p = strtok_r(memberlist, ",", &last)); p;
-				(p = strtok_r(NULL, ",", &last))) {
-			if (!strcmp(p, pwd->pw_name)) {
+	/* Scan through the groups for ones that list us as a member. */
+	struct group * g;
+	setgrent();
+	while ((g = getgrent())) {
+		for (char ** member = g->gr_mem; *member; ++member) {
+			if (!strcmp(*member, pwd->pw_name)) {
 				if (groupCount < 32) {
-					myGroups[groupCount] = groupNumber;
+					myGroups[groupCount] = g->gr_gid;
 					groupCount++;
 				}
+				break;
 			}
 		}
 	}
+	endgrent();
 
 	setgroups(groupCount, myGroups);
-	free(pw_blob);
-	fclose(groupList);
 	return;
 
 no_groups:
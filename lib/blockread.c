@@ -0,0 +1,176 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * blockread - block-at-a-time input and counting for text utilities
+ *
+ * Tools like wc and head used to take their input one fgetc() at a
+ * time and look at each byte with isspace(); on a large file that was
+ * many times slower than reading it. Here input comes in with one
+ * read() per block, and the counting functions look at eight bytes at
+ * once: every byte of a word is compared against newline or the
+ * whitespace characters in parallel, and the matches are counted with
+ * a population count.
+ *
+ * Whole words are loaded with memcpy, so blocks need no particular
+ * alignment. The bit tricks assume a little-endian machine, which is
+ * what we run on.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <toaru/blockread.h>
+
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define LOWS  0x7F7F7F7F7F7F7F7FULL
+
+/* The high bit of every byte of @p w that is zero */
+static inline uint64_t zero_bytes(uint64_t w) {
+	return ~(((w & LOWS) + LOWS) | w | LOWS);
+}
+
+/* The high bit of every byte of @p w that is a space, tab, newline, \v, \f or \r */
+static inline uint64_t space_bytes(uint64_t w) {
+	uint64_t spaces = zero_bytes(w ^ (ONES * ' '));
+	uint64_t low = w & LOWS;
+	uint64_t at_least_tab = low + ONES * (0x80 - '\t');
+	uint64_t past_return  = low + ONES * (0x80 - '\r' - 1);
+	return spaces | (at_least_tab & ~past_return & ~w & HIGHS);
+}
+
+static inline int is_space(unsigned char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline uint64_t load(const char * data) {
+	uint64_t w;
+	memcpy(&w, data, sizeof(w));
+	return w;
+}
+
+/**
+ * Set up a reader for @p fd with a buffer of @p size bytes, or
+ * BLOCK_READER_SIZE if @p size is 0. The descriptor still belongs to
+ * the caller.
+ */
+block_reader_t * block_reader_open(int fd, size_t size) {
+	block_reader_t * reader = malloc(sizeof(block_reader_t));
+	if (!reader) return NULL;
+	reader->fd = fd;
+	reader->size = size ? size : BLOCK_READER_SIZE;
+	reader->buffer = malloc(reader->size);
+	reader->error = 0;
+	if (!reader->buffer) {
+		free(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+/**
+ * Read the next block, pointing @p data at it. Returns its length,
+ * 0 at end of input, or -1 with reader->error set if the read failed.
+ */
+ssize_t block_reader_next(block_reader_t * reader, char ** data) {
+	ssize_t r;
+	do {
+		r = read(reader->fd, reader->buffer, reader->size);
+	} while (r < 0 && errno == EINTR);
+	if (r < 0) {
+		reader->error = errno;
+		return -1;
+	}
+	*data = reader->buffer;
+	return r;
+}
+
+void block_reader_close(block_reader_t * reader) {
+	free(reader->buffer);
+	free(reader);
+}
+
+size_t block_count_lines(const char * data, size_t len) {
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		count += __builtin_popcountll(zero_bytes(load(data + i) ^ (ONES * '\n')));
+	}
+	for (; i < len; ++i) {
+		count += data[i] == '\n';
+	}
+	return count;
+}
+
+/* UTF-8 characters are counted by their lead bytes: everything but 10xxxxxx. */
+size_t block_count_chars(const char * data, size_t len) {
+	size_t count = 0;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		uint64_t w = load(data + i);
+		count += 8 - __builtin_popcountll(w & ~(w << 1) & HIGHS);
+	}
+	for (; i < len; ++i) {
+		count += ((unsigned char)data[i] & 0xC0) != 0x80;
+	}
+	return count;
+}
+
+/**
+ * Count the words that start in this block: bytes that are not
+ * whitespace and follow one that is. @p state says whether the
+ * previous block ended inside a word, and should start zeroed.
+ */
+size_t block_count_words(const char * data, size_t len, block_words_t * state) {
+	size_t count = 0;
+	uint64_t after_space = state->in_word ? 0 : 0x80;
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		uint64_t spaces = space_bytes(load(data + i));
+		uint64_t starts = ~spaces & HIGHS & ((spaces << 8) | after_space);
+		count += __builtin_popcountll(starts);
+		after_space = (spaces >> 56) & 0x80;
+	}
+	int in_word = !after_space;
+	for (; i < len; ++i) {
+		int space = is_space(data[i]);
+		count += !space && !in_word;
+		in_word = !space;
+	}
+	state->in_word = in_word;
+	return count;
+}
+
+/**
+ * Find the end of the next @p *lines lines in a block. Returns the
+ * offset just past the last newline consumed, or @p len if the block
+ * ran out first, and takes what was consumed off @p *lines.
+ */
+size_t block_skip_lines(const char * data, size_t len, size_t * lines) {
+	size_t offset = 0;
+	while (*lines && offset < len) {
+		const char * nl = memchr(data + offset, '\n', len - offset);
+		if (!nl) return len;
+		offset = nl - data + 1;
+		(*lines)--;
+	}
+	return offset;
+}
+
+/* write() all of @p data, however many calls it takes. */
+int block_write_all(int fd, const char * data, size_t len) {
+	while (len) {
+		ssize_t w = write(fd, data, len);
+		if (w < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		data += w;
+		len -= w;
+	}
+	return 0;
+}
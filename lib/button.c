@@ -23,7 +23,7 @@ void ttk_button_draw(gfx_context_t * ctx, struct TTKButton * button) {
 	/* Dark edge */
 	if (hilight < 3) {
 		struct gradient_definition edge = {button->height, button->y, rgb(166,166,166), rgb(136,136,136)};
-		draw_rounded_rectangle_pattern(ctx, button->x, button->y, button->width, button->height, 4, gfx_vertical_gradient_pattern, &edge);
+		draw_rounded_rectangle_span(ctx, button->x, button->y, button->width, button->height, 4, gfx_vertical_gradient_span, &edge);
 	}
 
 	/* Sheen */
@@ -32,14 +32,14 @@ void ttk_button_draw(gfx_context_t * ctx, struct TTKButton * button) {
 	/* Button face - this should normally be a gradient */
 		if (hilight == 1) {
 			struct gradient_definition face = {button->height-3, button->y + 2, rgb(240,240,240), rgb(230,230,230)};
-			draw_rounded_rectangle_pattern(ctx, button->x + 2, button->y + 2, button->width - 4, button->height - 3, 2, gfx_vertical_gradient_pattern, &face);
+			draw_rounded_rectangle_span(ctx, button->x + 2, button->y + 2, button->width - 4, button->height - 3, 2, gfx_vertical_gradient_span, &face);
 		} else {
 			struct gradient_definition face = {button->height-3, button->y + 2, rgb(219,219,219), rgb(204,204,204)};
-			draw_rounded_rectangle_pattern(ctx, button->x + 2, button->y + 2, button->width - 4, button->height - 3, 2, gfx_vertical_gradient_pattern, &face);
+			draw_rounded_rectangle_span(ctx, button->x + 2, button->y + 2, button->width - 4, button->height - 3, 2, gfx_vertical_gradient_span, &face);
 		}
 	} else if (hilight == 2) {
 		struct gradient_definition face = {button->height-2, button->y + 1, rgb(180,180,180), rgb(160,160,160)};
-		draw_rounded_rectangle_pattern(ctx, button->x + 1, button->y + 1, button->width - 2, button->height - 2, 3, gfx_vertical_gradient_pattern, &face);
+		draw_rounded_rectangle_span(ctx, button->x + 1, button->y + 1, button->width - 2, button->height - 2, 3, gfx_vertical_gradient_span, &face);
 	}
 
 	if (button->title[0] != '\033') {
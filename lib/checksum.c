@@ -0,0 +1,253 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * libtoaru_checksum: CRC-32 and Adler-32.
+ *
+ * CRC-32 is computed eight bytes at a time from eight 256-entry
+ * tables ("slice-by-8"), which are built the first time they are
+ * needed. On CPUs with carry-less multiplication, long runs are
+ * instead folded down sixteen bytes at a time with PCLMULQDQ, four
+ * streams in parallel, and only the final sixteen bytes go through
+ * the tables.
+ *
+ * Adler-32 defers its modulo for as long as the sums are sure not to
+ * overflow. On x86-64 the sums over each sixteen bytes are taken with
+ * SSE2: PSADBW adds up the bytes, and PMADDWD weights each by how
+ * many more times it will be added into the second sum.
+ *
+ * This file is also built into the kernel (see kernel/misc/checksum.c).
+ * The kernel is compiled without SSE, so it gets only the scalar
+ * slice-by-8 and Adler-32 paths. Loads go through memcpy, so data
+ * needs no particular alignment. Like the rest of our bit-twiddling,
+ * this assumes a little-endian machine.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _KERNEL_
+#	include <kernel/string.h>
+#	include <kernel/checksum.h>
+#else
+#	include <string.h>
+#	include <toaru/checksum.h>
+#endif
+
+#define CRC32_POLY   0xEDB88320
+#define ADLER32_BASE 65521
+/* Most bytes we can add up before the second Adler-32 sum could overflow */
+#define ADLER32_NMAX 5552
+
+static uint32_t crc_table[8][256];
+static volatile int crc_table_ready = 0;
+
+static void crc_table_build(void) {
+	for (unsigned int i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) {
+			c = (c >> 1) ^ (CRC32_POLY & -(c & 1));
+		}
+		crc_table[0][i] = c;
+	}
+	/* crc_table[t][i] is the CRC of i followed by t zero bytes */
+	for (unsigned int i = 0; i < 256; ++i) {
+		for (int t = 1; t < 8; ++t) {
+			uint32_t c = crc_table[t-1][i];
+			crc_table[t][i] = (c >> 8) ^ crc_table[0][c & 0xFF];
+		}
+	}
+	__sync_synchronize();
+	crc_table_ready = 1;
+}
+
+/* Run the (uninverted) CRC register over @p len bytes with the tables. */
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t * p, size_t len) {
+	while (len >= 8) {
+		uint32_t lo, hi;
+		memcpy(&lo, p, sizeof(lo));
+		memcpy(&hi, p + 4, sizeof(hi));
+		lo ^= crc;
+		crc = crc_table[7][lo & 0xFF] ^
+		      crc_table[6][(lo >> 8) & 0xFF] ^
+		      crc_table[5][(lo >> 16) & 0xFF] ^
+		      crc_table[4][lo >> 24] ^
+		      crc_table[3][hi & 0xFF] ^
+		      crc_table[2][(hi >> 8) & 0xFF] ^
+		      crc_table[1][(hi >> 16) & 0xFF] ^
+		      crc_table[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+	while (len--) {
+		crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+	}
+	return crc;
+}
+
+/* The kernel is built with -mgeneral-regs-only; no vector registers there */
+#if defined(__x86_64__) && !defined(_KERNEL_)
+#define CHECKSUM_VECTOR
+#endif
+
+#ifdef CHECKSUM_VECTOR
+typedef long long v2di __attribute__((vector_size(16)));
+typedef unsigned int v4su __attribute__((vector_size(16)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef char v16qi __attribute__((vector_size(16)));
+
+static int cpu_has_pclmul = -1;
+
+static int check_pclmul(void) {
+	if (cpu_has_pclmul < 0) {
+		uint32_t a, b, c, d;
+		asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1), "c"(0));
+		cpu_has_pclmul = !!(c & (1 << 1));
+	}
+	return cpu_has_pclmul;
+}
+
+static inline v2di load128(const uint8_t * p) {
+	v2di v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/* Multiply each half of @p x by the matching constant in @p k and add the products. */
+#define FOLD(x,k) (__builtin_ia32_pclmulqdq128((x),(k),0x00) ^ __builtin_ia32_pclmulqdq128((x),(k),0x11))
+
+/**
+ * Fold @p len bytes, a multiple of sixteen and at least 64, into the
+ * CRC register. The constants are x^n mod P for the distances being
+ * folded across (4x128+32 and 4x128-32 bits for four streams,
+ * 128+32 and 128-32 to bring them together), bit-reflected.
+ */
+__attribute__((target("pclmul")))
+static uint32_t crc32_fold(uint32_t crc, const uint8_t * p, size_t len) {
+	const v2di k1k2 = {0x0154442bd4, 0x01c6e41596};
+	const v2di k3k4 = {0x01751997d0, 0x00ccaa009e};
+
+	v2di x0 = load128(p) ^ (v2di){crc, 0};
+	v2di x1 = load128(p + 16);
+	v2di x2 = load128(p + 32);
+	v2di x3 = load128(p + 48);
+	p += 64;
+	len -= 64;
+
+	while (len >= 64) {
+		x0 = FOLD(x0, k1k2) ^ load128(p);
+		x1 = FOLD(x1, k1k2) ^ load128(p + 16);
+		x2 = FOLD(x2, k1k2) ^ load128(p + 32);
+		x3 = FOLD(x3, k1k2) ^ load128(p + 48);
+		p += 64;
+		len -= 64;
+	}
+
+	x0 = FOLD(x0, k3k4) ^ x1;
+	x0 = FOLD(x0, k3k4) ^ x2;
+	x0 = FOLD(x0, k3k4) ^ x3;
+
+	while (len >= 16) {
+		x0 = FOLD(x0, k3k4) ^ load128(p);
+		p += 16;
+		len -= 16;
+	}
+
+	/* What's left has the same CRC as everything folded into it */
+	uint8_t rest[16];
+	memcpy(rest, &x0, sizeof(rest));
+	return crc32_slice8(0, rest, sizeof(rest));
+}
+
+/**
+ * Add @p len bytes, a multiple of sixteen, into both sums.
+ */
+static uint32_t adler32_sse2(uint32_t adler, const uint8_t * p, size_t len) {
+	uint32_t s1 = adler & 0xFFFF;
+	uint32_t s2 = adler >> 16;
+	const v8hi weight_lo = {16, 15, 14, 13, 12, 11, 10, 9};
+	const v8hi weight_hi = {8, 7, 6, 5, 4, 3, 2, 1};
+	const v16qi zero = {0};
+
+	while (len) {
+		size_t n = len < ADLER32_NMAX ? len : ADLER32_NMAX;
+		len -= n;
+
+		/* Every byte of this run will add the current first sum to the second */
+		s2 += s1 * n;
+
+		v4su sum = {0};
+		v4su weighted = {0};
+		v4su prefix = {0}; /* sum at the start of each block, added up */
+		for (; n; n -= 16, p += 16) {
+			v16qi bytes;
+			memcpy(&bytes, p, sizeof(bytes));
+			prefix += sum;
+			sum += (v4su)__builtin_ia32_psadbw128(bytes, zero);
+			weighted += (v4su)__builtin_ia32_pmaddwd128((v8hi)__builtin_ia32_punpcklbw128(bytes, zero), weight_lo);
+			weighted += (v4su)__builtin_ia32_pmaddwd128((v8hi)__builtin_ia32_punpckhbw128(bytes, zero), weight_hi);
+		}
+		weighted += prefix << 4;
+
+		s1 += sum[0] + sum[1] + sum[2] + sum[3];
+		s2 += weighted[0] + weighted[1] + weighted[2] + weighted[3];
+		s1 %= ADLER32_BASE;
+		s2 %= ADLER32_BASE;
+	}
+
+	return s1 | (s2 << 16);
+}
+#endif
+
+/**
+ * Update the CRC-32 @p crc with @p len bytes of @p data.
+ */
+uint32_t checksum_crc32(uint32_t crc, const void * data, size_t len) {
+	const uint8_t * p = data;
+	if (!crc_table_ready) crc_table_build();
+
+	crc = ~crc;
+#ifdef CHECKSUM_VECTOR
+	if (len >= 256 && check_pclmul()) {
+		size_t n = len & ~(size_t)15;
+		crc = crc32_fold(crc, p, n);
+		p += n;
+		len -= n;
+	}
+#endif
+	return ~crc32_slice8(crc, p, len);
+}
+
+/**
+ * Update the Adler-32 @p adler with @p len bytes of @p data.
+ */
+uint32_t checksum_adler32(uint32_t adler, const void * data, size_t len) {
+	const uint8_t * p = data;
+#ifdef CHECKSUM_VECTOR
+	if (len >= 32) {
+		size_t n = len & ~(size_t)15;
+		adler = adler32_sse2(adler, p, n);
+		p += n;
+		len -= n;
+	}
+#endif
+	uint32_t s1 = adler & 0xFFFF;
+	uint32_t s2 = adler >> 16;
+	while (len) {
+		size_t n = len < ADLER32_NMAX ? len : ADLER32_NMAX;
+		len -= n;
+		for (; n >= 4; n -= 4, p += 4) {
+			s1 += p[0]; s2 += s1;
+			s1 += p[1]; s2 += s1;
+			s1 += p[2]; s2 += s1;
+			s1 += p[3]; s2 += s1;
+		}
+		for (; n; n--) {
+			s1 += *p++;
+			s2 += s1;
+		}
+		s1 %= ADLER32_BASE;
+		s2 %= ADLER32_BASE;
+	}
+	return s1 | (s2 << 16);
+}
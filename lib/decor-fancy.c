@@ -138,6 +138,162 @@ static char * ellipsify(char * input, int font_size, struct TT_Font * font, int
 	return out;
 }
 
+/**
+ * Blend a run of a single premultiplied color into one row.
+ */
+static void blend_span(gfx_context_t * ctx, int x, int y, int w, uint32_t color) {
+	uint32_t * span = &GFX(ctx,x,y);
+	if (_ALP(color) == 0xFF) {
+		for (int i = 0; i < w; ++i) span[i] = color;
+	} else if (_ALP(color)) {
+		for (int i = 0; i < w; ++i) span[i] = alpha_blend_rgba(span[i], color);
+	}
+}
+
+struct clip_rect {
+	int left, top, right, bottom;
+};
+
+/**
+ * Draw a nine-slice piece so that it covers the rectangle (x,y,w,h),
+ * tiling it in either direction if the rectangle is larger than the
+ * sprite, but only touching pixels within the clip rectangle. The
+ * edge pieces are a single pixel wide (or tall), so tiling them turns
+ * into one color run per row instead of one sprite draw per pixel.
+ */
+static void draw_piece(gfx_context_t * ctx, sprite_t * sprite, int x, int y, int w, int h, const struct clip_rect * clip) {
+	int left = x < clip->left ? clip->left : x;
+	int top  = y < clip->top ? clip->top : y;
+	int right  = x + w > clip->right ? clip->right : x + w;
+	int bottom = y + h > clip->bottom ? clip->bottom : y + h;
+	if (left >= right || top >= bottom) return;
+
+	for (int _y = top; _y < bottom; ++_y) {
+		uint32_t * row = &SPRITE(sprite, 0, (_y - y) % sprite->height);
+		if (sprite->width == 1) {
+			blend_span(ctx, left, _y, right - left, row[0]);
+		} else {
+			uint32_t * span = &GFX(ctx,0,_y);
+			for (int _x = left; _x < right; ++_x) {
+				span[_x] = alpha_blend_rgba(span[_x], row[(_x - x) % sprite->width]);
+			}
+		}
+	}
+}
+
+/**
+ * Lay out all nine pieces of a border set, clipped to @p clip.
+ */
+static void draw_nine_slice(gfx_context_t * ctx, int base, int width, int height, const struct clip_rect * clip) {
+	int um = width - (ul_width + ur_width);
+	int lm = width - (ll_width + lr_width);
+	int mh = height - (u_height + l_height);
+
+	draw_piece(ctx, sprites[base + 0], 0, 0, ul_width, u_height, clip);
+	if (um > 0) draw_piece(ctx, sprites[base + 1], ul_width, 0, um, u_height, clip);
+	draw_piece(ctx, sprites[base + 2], width - ur_width, 0, ur_width, u_height, clip);
+	if (mh > 0) {
+		draw_piece(ctx, sprites[base + 3], 0, u_height, ml_width, mh, clip);
+		draw_piece(ctx, sprites[base + 4], width - mr_width, u_height, mr_width, mh, clip);
+	}
+	draw_piece(ctx, sprites[base + 5], 0, height - l_height, ll_width, l_height, clip);
+	if (lm > 0) draw_piece(ctx, sprites[base + 6], ll_width, height - l_height, lm, l_height, clip);
+	draw_piece(ctx, sprites[base + 7], width - lr_width, height - l_height, lr_width, l_height, clip);
+}
+
+/**
+ * Rendered frames are cached by everything that affects how they look,
+ * so a focus change or a redraw of an unchanged window is just a copy.
+ * Only the pixels the decorations own (the area described by the bounds)
+ * are kept; the border pieces also shade a few pixels of the window
+ * content, and those are blended again on every draw.
+ */
+#define DECOR_CACHE_SIZE 4
+
+struct decor_cache {
+	int width;
+	int height;
+	uint32_t flags;
+	int active;
+	char * title;
+	unsigned long used;
+	struct decor_bounds bounds;
+	uint32_t * top;
+	uint32_t * bottom;
+	uint32_t * left;
+	uint32_t * right;
+};
+
+static struct decor_cache decor_cache[DECOR_CACHE_SIZE];
+static unsigned long decor_cache_clock = 0;
+
+static struct decor_cache * cache_lookup(yutani_window_t * window, char * title, int active) {
+	for (int i = 0; i < DECOR_CACHE_SIZE; ++i) {
+		struct decor_cache * c = &decor_cache[i];
+		if (c->title && c->width == (int)window->width && c->height == (int)window->height &&
+			c->flags == window->decorator_flags && c->active == active && !strcmp(c->title, title)) {
+			c->used = ++decor_cache_clock;
+			return c;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Copy a rectangle of rows between a window and a cache buffer.
+ */
+static void cache_rows(gfx_context_t * ctx, uint32_t * buf, int x, int y, int w, int h, int store) {
+	for (int j = 0; j < h; ++j) {
+		if (store) {
+			memcpy(&buf[j * w], &GFX(ctx,x,y+j), w * sizeof(uint32_t));
+		} else {
+			memcpy(&GFX(ctx,x,y+j), &buf[j * w], w * sizeof(uint32_t));
+		}
+	}
+}
+
+static void cache_transfer(struct decor_cache * c, gfx_context_t * ctx, int store) {
+	int mid = c->height - c->bounds.height;
+	cache_rows(ctx, c->top, 0, 0, c->width, c->bounds.top_height, store);
+	cache_rows(ctx, c->bottom, 0, c->height - c->bounds.bottom_height, c->width, c->bounds.bottom_height, store);
+	if (mid > 0) {
+		cache_rows(ctx, c->left, 0, c->bounds.top_height, c->bounds.left_width, mid, store);
+		cache_rows(ctx, c->right, c->width - c->bounds.right_width, c->bounds.top_height, c->bounds.right_width, mid, store);
+	}
+}
+
+static void cache_store(yutani_window_t * window, gfx_context_t * ctx, char * title, int active, struct decor_bounds * bounds) {
+	int width = window->width;
+	int height = window->height;
+	int mid = height - bounds->height;
+	if (mid < 0) return;
+
+	struct decor_cache * c = &decor_cache[0];
+	for (int i = 1; i < DECOR_CACHE_SIZE; ++i) {
+		if (decor_cache[i].used < c->used) c = &decor_cache[i];
+	}
+
+	free(c->title);
+	free(c->top);
+	free(c->bottom);
+	free(c->left);
+	free(c->right);
+
+	c->width = width;
+	c->height = height;
+	c->flags = window->decorator_flags;
+	c->active = active;
+	c->title = strdup(title);
+	c->used = ++decor_cache_clock;
+	c->bounds = *bounds;
+	c->top    = malloc(sizeof(uint32_t) * width * bounds->top_height);
+	c->bottom = malloc(sizeof(uint32_t) * width * bounds->bottom_height);
+	c->left   = malloc(sizeof(uint32_t) * bounds->left_width * mid);
+	c->right  = malloc(sizeof(uint32_t) * bounds->right_width * mid);
+
+	cache_transfer(c, ctx, 1);
+}
+
 static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * ctx, char * title, int decors_active) {
 	int width = window->width;
 	int height = window->height;
@@ -145,25 +301,33 @@ static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * c
 	struct decor_bounds bounds;
 	get_bounds_fancy(window, &bounds);
 
-	for (int j = 0; j < (int)bounds.top_height; ++j) {
-		for (int i = 0; i < width; ++i) {
-			GFX(ctx,i,j) = 0;
+	decors_active = (decors_active == DECOR_INACTIVE) ? INACTIVE : ACTIVE;
+
+	/* The window content, which the border pieces partly overlap */
+	struct clip_rect content = {bounds.left_width, bounds.top_height, width - bounds.right_width, height - bounds.bottom_height};
+
+	struct decor_cache * cached = cache_lookup(window, title, decors_active);
+	if (cached) {
+		cache_transfer(cached, ctx, 0);
+		if (!(window->decorator_flags & DECOR_FLAG_TILED)) {
+			draw_nine_slice(ctx, decors_active, width, height, &content);
 		}
+		return;
 	}
 
-	decors_active = (decors_active == DECOR_INACTIVE) ? INACTIVE : ACTIVE;
+	for (int j = 0; j < (int)bounds.top_height; ++j) {
+		memset(&GFX(ctx,0,j), 0, width * sizeof(uint32_t));
+	}
 
 	if ((window->decorator_flags & DECOR_FLAG_TILED)) {
-		for (int i = 0; i < width; ++i) {
-			draw_sprite(ctx, sprites[decors_active + 1], i, -6 * TOTAL_SCALE + !(window->decorator_flags & DECOR_FLAG_TILE_UP));
-		}
+		struct clip_rect all = {0, 0, width, height};
+		draw_piece(ctx, sprites[decors_active + 1], 0, -6 * TOTAL_SCALE + !(window->decorator_flags & DECOR_FLAG_TILE_UP),
+			width, u_height, &all);
 
 		uint32_t clear_color = BORDER_COLOR;
 		if (!(window->decorator_flags & DECOR_FLAG_TILE_DOWN)) {
 			/* Draw bottom line */
-			for (int i = 0; i < (int)window->width; ++i) {
-				GFX(ctx,i,window->height-1) = clear_color;
-			}
+			blend_span(ctx, 0, window->height-1, window->width, clear_color);
 		}
 
 		if (!(window->decorator_flags & DECOR_FLAG_TILE_LEFT)) {
@@ -182,37 +346,17 @@ static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * c
 
 	} else {
 
-		uint32_t clear_color = 0x000000;
-
 		for (int j = (int)bounds.top_height; j < height - (int)bounds.bottom_height; ++j) {
-			for (int i = 0; i < (int)bounds.left_width; ++i) {
-				GFX(ctx,i,j) = clear_color;
-			}
-			for (int i = width - (int)bounds.right_width; i < width; ++i) {
-				GFX(ctx,i,j) = clear_color;
-			}
+			memset(&GFX(ctx,0,j), 0, bounds.left_width * sizeof(uint32_t));
+			memset(&GFX(ctx,width - bounds.right_width,j), 0, bounds.right_width * sizeof(uint32_t));
 		}
 
 		for (int j = height - (int)bounds.bottom_height; j < height; ++j) {
-			for (int i = 0; i < width; ++i) {
-				GFX(ctx,i,j) = clear_color;
-			}
+			memset(&GFX(ctx,0,j), 0, width * sizeof(uint32_t));
 		}
 
-		draw_sprite(ctx, sprites[decors_active + 0], 0, 0);
-		for (int i = 0; i < width - (ul_width + ur_width); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 1], i + ul_width, 0);
-		}
-		draw_sprite(ctx, sprites[decors_active + 2], width - ur_width, 0);
-		for (int i = 0; i < height - (u_height + l_height); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 3], 0, i + u_height);
-			draw_sprite(ctx, sprites[decors_active + 4], width - mr_width, i + u_height);
-		}
-		draw_sprite(ctx, sprites[decors_active + 5], 0, height - l_height);
-		for (int i = 0; i < width - (ll_width + lr_width); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 6], i + ll_width, height - l_height);
-		}
-		draw_sprite(ctx, sprites[decors_active + 7], width - lr_width, height - l_height);
+		struct clip_rect all = {0, 0, width, height};
+		draw_nine_slice(ctx, decors_active, width, height, &all);
 	}
 
 #define EXTRA_SPACE 120
@@ -250,6 +394,8 @@ static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * c
 			}
 		}
 	}
+
+	cache_store(window, ctx, title, decors_active, &bounds);
 }
 
 static int check_button_press_fancy(yutani_window_t * window, int x, int y) {
@@ -590,6 +590,129 @@ __attribute__((constructor)) static void _masks(void) {
 }
 #endif
 
+/**
+ * Span primitives.
+ *
+ * These operate on a single horizontal run of pixels that has
+ * already been clipped by the caller, so the inner loops never
+ * need to check bounds. Primitives that cover an area should
+ * compute their clipped extents once per row and hand each row
+ * to one of these.
+ */
+
+/**
+ * @brief Fill @p count pixels with @p color.
+ */
+static void gfx_span_fill(uint32_t * dst, size_t count, uint32_t color) {
+	size_t i = 0;
+#ifndef NO_SSE
+	__m128i c = _mm_set1_epi32(color);
+	for (; i < count && ((uintptr_t)&dst[i] & 15); ++i) {
+		dst[i] = color;
+	}
+	for (; i + 15 < count; i += 16) {
+		_mm_store_si128((void*)&dst[i],    c);
+		_mm_store_si128((void*)&dst[i+4],  c);
+		_mm_store_si128((void*)&dst[i+8],  c);
+		_mm_store_si128((void*)&dst[i+12], c);
+	}
+	for (; i + 3 < count; i += 4) {
+		_mm_store_si128((void*)&dst[i], c);
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = color;
+	}
+}
+
+/**
+ * @brief Blend one premultiplied @p color over @p count pixels.
+ *
+ * The source is constant, so it is unpacked and its inverse alpha
+ * computed once for the whole run.
+ */
+static void gfx_span_blend_solid(uint32_t * dst, size_t count, uint32_t color) {
+	if (_ALP(color) == 255) {
+		gfx_span_fill(dst, count, color);
+		return;
+	}
+	if (_ALP(color) == 0) return;
+	size_t i = 0;
+#ifndef NO_SSE
+	__m128i s = _mm_unpacklo_epi8(_mm_set1_epi32(color), _mm_setzero_si128());
+	__m128i t = _mm_set1_epi16(0xFF ^ _ALP(color));
+	for (; i < count && ((uintptr_t)&dst[i] & 15); ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], color);
+	}
+	for (; i + 3 < count; i += 4) {
+		__m128i d = _mm_load_si128((void*)&dst[i]);
+		__m128i d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
+		__m128i d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+		d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t),mask0080),mask0101);
+		d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t),mask0080),mask0101);
+		d_l = _mm_adds_epu8(s,d_l);
+		d_h = _mm_adds_epu8(s,d_h);
+		_mm_store_si128((void*)&dst[i], _mm_packus_epi16(d_l,d_h));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], color);
+	}
+}
+
+/**
+ * @brief Blend @p count premultiplied source pixels over @p dst.
+ */
+__attribute__((__force_align_arg_pointer__))
+static void gfx_span_blend(uint32_t * dst, const uint32_t * src, size_t count) {
+	size_t i = 0;
+#ifndef NO_SSE
+	for (; i < count && ((uintptr_t)&dst[i] & 15); ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+	for (; i + 3 < count; i += 4) {
+		__m128i d = _mm_load_si128((void *)&dst[i]);
+		__m128i s = _mm_loadu_si128((void *)&src[i]);
+
+		__m128i d_l, d_h;
+		__m128i s_l, s_h;
+
+		// unpack destination
+		d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
+		d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+
+		// unpack source
+		s_l = _mm_unpacklo_epi8(s, _mm_setzero_si128());
+		s_h = _mm_unpackhi_epi8(s, _mm_setzero_si128());
+
+		__m128i a_l, a_h;
+		__m128i t_l, t_h;
+
+		// extract source alpha RGBA → AAAA
+		a_l = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_l, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+		a_h = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_h, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+
+		// negate source alpha
+		t_l = _mm_xor_si128(a_l, mask00ff);
+		t_h = _mm_xor_si128(a_h, mask00ff);
+
+		// apply source alpha to destination
+		d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t_l),mask0080),mask0101);
+		d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t_h),mask0080),mask0101);
+
+		// combine source and destination
+		d_l = _mm_adds_epu8(s_l,d_l);
+		d_h = _mm_adds_epu8(s_h,d_h);
+
+		// pack low + high and write back to memory
+		_mm_store_si128((void*)&dst[i], _mm_packus_epi16(d_l,d_h));
+	}
+#endif
+	for (; i < count; ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+}
+
 __attribute__((__force_align_arg_pointer__))
 void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y) {
 
@@ -603,61 +726,10 @@ void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_
 			if (y + _y < _top) continue;
 			if (y + _y > _bottom) break;
 			if (!_is_in_clip(ctx, y + _y)) continue;
-#ifdef NO_SSE
-			for (uint16_t _x = 0; _x < sprite->width; ++_x) {
-				if (x + _x < _left || x + _x > _right || y + _y < _top || y + _y > _bottom)
-					continue;
-				GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), SPRITE(sprite, _x, _y));
-			}
-#else
-			uint16_t _x = (x < _left) ? _left - x : 0;
-
-			/* Ensure alignment */
-			for (; _x < sprite->width && x + _x <= _right; ++_x) {
-				if (!((uintptr_t)&GFX(ctx, x + _x, y + _y) & 15)) break;
-				GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), SPRITE(sprite, _x, _y));
-			}
-			for (; _x < sprite->width - 3 && x + _x + 3 <= _right; _x += 4) {
-				__m128i d = _mm_load_si128((void *)&GFX(ctx, x + _x, y + _y));
-				__m128i s = _mm_loadu_si128((void *)&SPRITE(sprite, _x, _y));
-
-				__m128i d_l, d_h;
-				__m128i s_l, s_h;
-
-				// unpack destination
-				d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
-				d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
-
-				// unpack source
-				s_l = _mm_unpacklo_epi8(s, _mm_setzero_si128());
-				s_h = _mm_unpackhi_epi8(s, _mm_setzero_si128());
-
-				__m128i a_l, a_h;
-				__m128i t_l, t_h;
-
-				// extract source alpha RGBA → AAAA
-				a_l = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_l, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
-				a_h = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_h, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
-
-				// negate source alpha
-				t_l = _mm_xor_si128(a_l, mask00ff);
-				t_h = _mm_xor_si128(a_h, mask00ff);
-
-				// apply source alpha to destination
-				d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t_l),mask0080),mask0101);
-				d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t_h),mask0080),mask0101);
-
-				// combine source and destination
-				d_l = _mm_adds_epu8(s_l,d_l);
-				d_h = _mm_adds_epu8(s_h,d_h);
-
-				// pack low + high and write back to memory
-				_mm_storeu_si128((void*)&GFX(ctx, x + _x, y + _y), _mm_packus_epi16(d_l,d_h));
-			}
-			for (; _x < sprite->width && x + _x <= _right; ++_x) {
-				GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), SPRITE(sprite, _x, _y));
-			}
-#endif
+			int32_t _x = (x < _left) ? _left - x : 0;
+			int32_t _end = min(sprite->width, _right - x + 1);
+			if (_end <= _x) continue;
+			gfx_span_blend(&GFX(ctx, x + _x, y + _y), &SPRITE(sprite, _x, _y), _end - _x);
 		}
 	} else if (sprite->alpha == ALPHA_OPAQUE) {
 		for (uint16_t _y = 0; _y < sprite->height; ++_y) {
@@ -1004,6 +1076,156 @@ void draw_sprite_scaled_alpha(gfx_context_t * ctx, const sprite_t * sprite, int3
 	draw_sprite_transform(ctx,sprite,m,alpha);
 }
 
+/**
+ * @brief Halve a sprite with a 2x2 box filter.
+ *
+ * This is one step of a mip chain. Colors are premultiplied, so
+ * averaging each channel on its own is also right for translucent
+ * pixels. An odd last row or column is averaged with itself.
+ */
+sprite_t * gfx_sprite_halve(const sprite_t * sprite) {
+	int width  = (sprite->width + 1) / 2;
+	int height = (sprite->height + 1) / 2;
+	sprite_t * out = create_sprite(width, height, ALPHA_EMBEDDED);
+
+	for (int y = 0; y < height; ++y) {
+		int y0 = y * 2;
+		int y1 = (y0 + 1 < sprite->height) ? y0 + 1 : y0;
+		for (int x = 0; x < width; ++x) {
+			int x0 = x * 2;
+			int x1 = (x0 + 1 < sprite->width) ? x0 + 1 : x0;
+			uint32_t a = SPRITE(sprite, x0, y0);
+			uint32_t b = SPRITE(sprite, x1, y0);
+			uint32_t c = SPRITE(sprite, x0, y1);
+			uint32_t d = SPRITE(sprite, x1, y1);
+			SPRITE(out, x, y) = rgba(
+				(_RED(a) + _RED(b) + _RED(c) + _RED(d) + 2) / 4,
+				(_GRE(a) + _GRE(b) + _GRE(c) + _GRE(d) + 2) / 4,
+				(_BLU(a) + _BLU(b) + _BLU(c) + _BLU(d) + 2) / 4,
+				(_ALP(a) + _ALP(b) + _ALP(c) + _ALP(d) + 2) / 4);
+		}
+	}
+
+	return out;
+}
+
+/* Catmull-Rom cubic */
+static float cubic_weight(float x) {
+	x = fabsf(x);
+	if (x < 1.0f) return (1.5f * x - 2.5f) * x * x + 1.0f;
+	if (x < 2.0f) return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+	return 0.0f;
+}
+
+/**
+ * Filter taps for resampling @p src samples to @p dst: for output i,
+ * source samples start[i] .. start[i]+taps-1, weighted by
+ * weights[i*taps ...], with indices clamped to the edges.
+ */
+static float * resample_taps(int src, int dst, int ** start_out, int * taps_out) {
+	float scale = (float)src / (float)dst;
+	float stretch = scale > 1.0f ? scale : 1.0f;
+	int taps = (int)ceil(2.0 * stretch) * 2 + 1;
+	float * weights = malloc(sizeof(float) * taps * dst);
+	int * start = malloc(sizeof(int) * dst);
+
+	for (int i = 0; i < dst; ++i) {
+		float center = (i + 0.5f) * scale - 0.5f;
+		start[i] = (int)floor(center) - taps / 2;
+		float total = 0.0f;
+		for (int t = 0; t < taps; ++t) {
+			float w = cubic_weight((start[i] + t - center) / stretch);
+			weights[i * taps + t] = w;
+			total += w;
+		}
+		for (int t = 0; t < taps; ++t) {
+			weights[i * taps + t] /= total;
+		}
+	}
+
+	*start_out = start;
+	*taps_out = taps;
+	return weights;
+}
+
+static uint8_t resample_clamp(float v, float max) {
+	if (v < 0.0f) return 0;
+	if (v > max) return (uint8_t)max;
+	return (uint8_t)(v + 0.5f);
+}
+
+/**
+ * @brief Make a high-quality scaled copy of a sprite.
+ *
+ * Large reductions first step down through box-filtered mip levels
+ * until within a factor of two of the target size. A separable bicubic
+ * filter, widened to cover whatever reduction is left, then finishes
+ * the job. This is much slower than @ref draw_sprite_scaled, so it is
+ * meant for scaling that happens once, with the result kept around.
+ */
+sprite_t * gfx_sprite_resample(const sprite_t * sprite, uint16_t width, uint16_t height) {
+	if (!width || !height) return create_sprite(1, 1, ALPHA_EMBEDDED);
+
+	const sprite_t * source = sprite;
+	sprite_t * level = NULL;
+	while (source->width >= width * 2 && source->height >= height * 2) {
+		sprite_t * next = gfx_sprite_halve(source);
+		if (level) sprite_free(level);
+		level = next;
+		source = level;
+	}
+
+	int * xstart, * ystart;
+	int xtaps, ytaps;
+	float * xweights = resample_taps(source->width, width, &xstart, &xtaps);
+	float * yweights = resample_taps(source->height, height, &ystart, &ytaps);
+
+	/* Horizontal pass into a float buffer, then vertical into the output */
+	float * tmp = malloc(sizeof(float) * 4 * width * source->height);
+	for (int y = 0; y < source->height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			float r = 0, g = 0, b = 0, a = 0;
+			for (int t = 0; t < xtaps; ++t) {
+				int sx = xstart[x] + t;
+				if (sx < 0) sx = 0;
+				if (sx >= source->width) sx = source->width - 1;
+				uint32_t c = SPRITE(source, sx, y);
+				float w = xweights[x * xtaps + t];
+				r += _RED(c) * w; g += _GRE(c) * w; b += _BLU(c) * w; a += _ALP(c) * w;
+			}
+			float * out = &tmp[(y * width + x) * 4];
+			out[0] = r; out[1] = g; out[2] = b; out[3] = a;
+		}
+	}
+
+	sprite_t * out = create_sprite(width, height, ALPHA_EMBEDDED);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			float r = 0, g = 0, b = 0, a = 0;
+			for (int t = 0; t < ytaps; ++t) {
+				int sy = ystart[y] + t;
+				if (sy < 0) sy = 0;
+				if (sy >= source->height) sy = source->height - 1;
+				float * in = &tmp[(sy * width + x) * 4];
+				float w = yweights[y * ytaps + t];
+				r += in[0] * w; g += in[1] * w; b += in[2] * w; a += in[3] * w;
+			}
+			/* Cubic filters overshoot; keep the result a valid premultiplied color */
+			uint8_t alpha = resample_clamp(a, 255.0f);
+			SPRITE(out, x, y) = rgba(resample_clamp(r, alpha), resample_clamp(g, alpha), resample_clamp(b, alpha), alpha);
+		}
+	}
+
+	free(tmp);
+	free(xweights);
+	free(xstart);
+	free(yweights);
+	free(ystart);
+	if (level) sprite_free(level);
+
+	return out;
+}
+
 uint32_t interp_colors(uint32_t bottom, uint32_t top, uint8_t interp) {
 	uint8_t red = (_RED(bottom) * (255 - interp) + _RED(top) * interp) / 255;
 	uint8_t gre = (_GRE(bottom) * (255 - interp) + _GRE(top) * interp) / 255;
@@ -1015,30 +1237,24 @@ uint32_t interp_colors(uint32_t bottom, uint32_t top, uint8_t interp) {
 void draw_rectangle(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, uint32_t color) {
 	int32_t _left   = max(x, 0);
 	int32_t _top    = max(y, 0);
-	int32_t _right  = min(x + width,  ctx->width - 1);
-	int32_t _bottom = min(y + height, ctx->height - 1);
-	for (uint16_t _y = 0; _y < height; ++_y) {
-		if (!_is_in_clip(ctx, y + _y)) continue;
-		for (uint16_t _x = 0; _x < width; ++_x) {
-			if (x + _x < _left || x + _x > _right || y + _y < _top || y + _y > _bottom)
-				continue;
-			GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), color);
-		}
+	int32_t _right  = min(x + width,  ctx->width);
+	int32_t _bottom = min(y + height, ctx->height);
+	if (_right <= _left) return;
+	for (int32_t _y = _top; _y < _bottom; ++_y) {
+		if (!_is_in_clip(ctx, _y)) continue;
+		gfx_span_blend_solid(&GFX(ctx, _left, _y), _right - _left, color);
 	}
 }
 
 void draw_rectangle_solid(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, uint32_t color) {
 	int32_t _left   = max(x, 0);
 	int32_t _top    = max(y, 0);
-	int32_t _right  = min(x + width,  ctx->width - 1);
-	int32_t _bottom = min(y + height, ctx->height - 1);
-	for (uint16_t _y = 0; _y < height; ++_y) {
-		if (!_is_in_clip(ctx, y + _y)) continue;
-		for (uint16_t _x = 0; _x < width; ++_x) {
-			if (x + _x < _left || x + _x > _right || y + _y < _top || y + _y > _bottom)
-				continue;
-			GFX(ctx, x + _x, y + _y) = color;
-		}
+	int32_t _right  = min(x + width,  ctx->width);
+	int32_t _bottom = min(y + height, ctx->height);
+	if (_right <= _left) return;
+	for (int32_t _y = _top; _y < _bottom; ++_y) {
+		if (!_is_in_clip(ctx, _y)) continue;
+		gfx_span_fill(&GFX(ctx, _left, _y), _right - _left, color);
 	}
 }
 
@@ -1073,17 +1289,10 @@ void draw_rounded_rectangle_pattern(gfx_context_t * ctx, int32_t x, int32_t y, u
 		radius = height / 2;
 	}
 
-	for (int row = y; row < y + height; row++){
-		if (row < 0) continue;
-		if (row >= ctx->height) break;
-		for (int col = x; col < x + width; col++) {
-			if (col < 0) continue;
-			if (col >= ctx->width) break;
-
-			if ((col < x + radius || col > x + width - radius - 1) &&
-				(row < y + radius || row > y + height - radius - 1)) {
-				continue;
-			}
+	for (int row = max(y, 0); row < min(y + height, ctx->height); row++){
+		int inset = (row < y + radius || row > y + height - radius - 1) ? radius : 0;
+		int col_end = min(x + width - inset, ctx->width);
+		for (int col = max(x + inset, 0); col < col_end; col++) {
 			GFX(ctx, col, row) = alpha_blend_rgba(GFX(ctx, col, row), pattern(col,row,1.0,extra));
 		}
 	}
@@ -1118,8 +1327,106 @@ uint32_t gfx_fill_pattern(int32_t x, int32_t y, double alpha, void * extra) {
 	return premultiply(rgba(_RED(c),_GRE(c),_BLU(c),(int)((double)_ALP(c) * alpha)));
 }
 
+/**
+ * @brief Scale a premultiplied color by a coverage value.
+ */
+static inline uint32_t gfx_scale_premultiplied(uint32_t color, uint8_t alpha) {
+	if (alpha == 255) return color;
+	uint8_t r = (((uint16_t)_RED(color) * alpha + 0x80) * 0x101) >> 16UL;
+	uint8_t g = (((uint16_t)_GRE(color) * alpha + 0x80) * 0x101) >> 16UL;
+	uint8_t b = (((uint16_t)_BLU(color) * alpha + 0x80) * 0x101) >> 16UL;
+	uint8_t a = (((uint16_t)_ALP(color) * alpha + 0x80) * 0x101) >> 16UL;
+	return rgba(r,g,b,a);
+}
+
+/**
+ * @brief Span shader for a vertical gradient.
+ *
+ * The color only depends on the row, so it is computed once per call
+ * and the run is filled with it.
+ */
+void gfx_vertical_gradient_span(uint32_t * span, int32_t x, int32_t y, int32_t count, void * extra) {
+	uint32_t color = gfx_vertical_gradient_pattern(x, y, 1.0, extra);
+	gfx_span_fill(span, count, color);
+}
+
+/**
+ * @brief Span shader for a solid color.
+ *
+ * @p extra points to an already premultiplied color.
+ */
+void gfx_fill_span(uint32_t * span, int32_t x, int32_t y, int32_t count, void * extra) {
+	gfx_span_fill(span, count, *(uint32_t*)extra);
+}
+
+/**
+ * @brief Draw a rounded rectangle, shading whole runs at a time.
+ *
+ * Each row of the rectangle body is clipped once and handed to
+ * @p shader as a single run, which is then blended with the span
+ * blender. Only the anti-aliased corner pixels are shaded one at a time.
+ *
+ * @p shader must produce premultiplied pixels. If @p shader is
+ * @ref gfx_fill_span, runs are blended directly without a scratch buffer.
+ */
+void draw_rounded_rectangle_span(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, int radius, gfx_span_shader_t shader, void * extra) {
+	if (radius > width / 2) {
+		radius = width / 2;
+	}
+
+	if (radius > height / 2) {
+		radius = height / 2;
+	}
+
+	uint32_t solid = (shader == gfx_fill_span) ? *(uint32_t*)extra : 0;
+	uint32_t * span = (shader == gfx_fill_span) ? NULL : malloc(sizeof(uint32_t) * (width ? width : 1));
+
+	for (int row = max(y, 0); row < min(y + height, ctx->height); row++) {
+		if (!_is_in_clip(ctx, row)) continue;
+		int inset = (row < y + radius || row > y + height - radius - 1) ? radius : 0;
+		int col_start = max(x + inset, 0);
+		int col_end = min(x + width - inset, ctx->width);
+		if (col_end <= col_start) continue;
+		if (span) {
+			shader(span, col_start, row, col_end - col_start, extra);
+			gfx_span_blend(&GFX(ctx, col_start, row), span, col_end - col_start);
+		} else {
+			gfx_span_blend_solid(&GFX(ctx, col_start, row), col_end - col_start, solid);
+		}
+	}
+
+	struct gfx_point origin = {0.0,0.0};
+
+	for (int py = 0; py < radius + 1; ++py) {
+		for (int px = 0; px < radius + 1; ++px) {
+			struct gfx_point this = {px,py};
+			float dist = gfx_point_distance(&origin,&this);
+			if (dist > (double)radius) continue;
+			uint8_t alpha = 255;
+			if (dist > (double)(radius-1)) {
+				alpha = (1.0 - (dist - (double)(radius-1))) * 255;
+			}
+			int xs[2] = {x + width - radius + px, x + radius - px - 1};
+			int ys[2] = {y + height - radius + py, y + radius - py - 1};
+			for (int i = 0; i < 2; ++i) {
+				if (xs[i] < 0 || xs[i] >= ctx->width) continue;
+				for (int j = 0; j < 2; ++j) {
+					if (ys[j] < 0 || ys[j] >= ctx->height) continue;
+					if (!_is_in_clip(ctx, ys[j])) continue;
+					uint32_t color = solid;
+					if (span) shader(&color, xs[i], ys[j], 1, extra);
+					GFX(ctx, xs[i], ys[j]) = alpha_blend_rgba(GFX(ctx, xs[i], ys[j]), gfx_scale_premultiplied(color, alpha));
+				}
+			}
+		}
+	}
+
+	free(span);
+}
+
 void draw_rounded_rectangle(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, int radius, uint32_t color) {
-	draw_rounded_rectangle_pattern(ctx,x,y,width,height,radius,gfx_fill_pattern,&color);
+	uint32_t pre = premultiply(color);
+	draw_rounded_rectangle_span(ctx,x,y,width,height,radius,gfx_fill_span,&pre);
 }
 
 float gfx_point_distance_squared(const struct gfx_point * a, const struct gfx_point * b) {
@@ -1159,37 +1466,439 @@ float gfx_line_distance(const struct gfx_point * p, const struct gfx_point * v,
 }
 
 /**
- * This is slow, but it works...
- *
- * Maybe acceptable for baked UI elements?
+ * Draw an antialiased line with round caps, @p thickness pixels
+ * out from the segment between @p v and @p w.
  */
 void draw_line_aa_points(gfx_context_t * ctx, struct gfx_point *v, struct gfx_point *w, uint32_t color, float thickness) {
+	gfx_path_t * path = gfx_path_create();
+	gfx_path_move_to(path, v->x, v->y);
+	gfx_path_line_to(path, w->x, w->y);
+	gfx_path_stroke(ctx, path, thickness * 2.0, color);
+	gfx_path_free(path);
+}
 
-	/* Calculate viable bounds */
-	int x_0 = max(min(v->x - thickness - 1, w->x - thickness - 1), 0);
-	int x_1 = min(max(v->x + thickness + 1, w->x + thickness + 1), ctx->width);
-	int y_0 = max(min(v->y - thickness - 1, w->y - thickness - 1), 0);
-	int y_1 = min(max(v->y + thickness + 1, w->y + thickness + 1), ctx->height);
-
-	for (int y = y_0; y < y_1; ++y) {
-		for (int x = x_0; x < x_1; ++x) {
-			struct gfx_point p = {x,y};
-			float d = gfx_line_distance(&p,v,w);
-			if (d < thickness + 0.5) {
-				if (d < thickness - 0.5) {
-					GFX(ctx,x,y) = alpha_blend_rgba(GFX(ctx,x,y), color);
-				} else {
-					float alpha = 1.0 - (d - thickness + 0.5);
-					GFX(ctx,x,y) = alpha_blend_rgba(GFX(ctx,x,y), premultiply(rgba(_RED(color),_GRE(color),_BLU(color),(int)((double)_ALP(color) * alpha))));
+void draw_line_aa(gfx_context_t * ctx, int x_1, int x_2, int y_1, int y_2, uint32_t color, float thickness) {
+	struct gfx_point v = {(float)x_1, (float)y_1};
+	struct gfx_point w = {(float)x_2, (float)y_2};
+	draw_line_aa_points(ctx,&v,&w,color,thickness);
+}
+
+
+/**
+ * Vector paths.
+ *
+ * A path is a list of subpaths, each a polyline. Curves are flattened
+ * into line segments as they are added, with a segment count chosen from
+ * how far the control points pull away from the chord, so a gentle curve
+ * costs a handful of segments and a tight one costs more.
+ *
+ * Filling converts the path into edges and scan converts them with
+ * GFX_PATH_SUBSAMPLES sample rows per pixel row. Edges are bucketed by
+ * the row where they begin and only the edges active on a row are
+ * examined there, and horizontal coverage is accumulated exactly: partial
+ * cells at each end of a covered run get their fractional area, and the
+ * fully covered cells in between are recorded as two entries in a
+ * difference array that is summed as the row is painted. The cost of a
+ * fill is therefore proportional to the length of its edges plus the
+ * area it touches, not to its bounding box.
+ */
+#define GFX_PATH_SUBSAMPLES 4
+#define GFX_PATH_TOLERANCE  0.2f
+
+#define GFX_PATH_POINT_MOVE  0x01
+#define GFX_PATH_POINT_CLOSE 0x02
+
+struct gfx_path_point {
+	float x;
+	float y;
+	int flags;
+};
+
+struct gfx_path {
+	size_t count;
+	size_t capacity;
+	struct gfx_path_point * points;
+};
+
+gfx_path_t * gfx_path_create(void) {
+	gfx_path_t * path = malloc(sizeof(gfx_path_t));
+	path->count = 0;
+	path->capacity = 16;
+	path->points = malloc(sizeof(struct gfx_path_point) * path->capacity);
+	return path;
+}
+
+void gfx_path_free(gfx_path_t * path) {
+	free(path->points);
+	free(path);
+}
+
+void gfx_path_reset(gfx_path_t * path) {
+	path->count = 0;
+}
+
+static void gfx_path_push(gfx_path_t * path, float x, float y, int flags) {
+	if (path->count == path->capacity) {
+		path->capacity *= 2;
+		path->points = realloc(path->points, sizeof(struct gfx_path_point) * path->capacity);
+	}
+	path->points[path->count].x = x;
+	path->points[path->count].y = y;
+	path->points[path->count].flags = flags;
+	path->count++;
+}
+
+void gfx_path_move_to(gfx_path_t * path, float x, float y) {
+	/* A move directly after a move replaces it. */
+	if (path->count && (path->points[path->count-1].flags & GFX_PATH_POINT_MOVE)) {
+		path->points[path->count-1].x = x;
+		path->points[path->count-1].y = y;
+		return;
+	}
+	gfx_path_push(path, x, y, GFX_PATH_POINT_MOVE);
+}
+
+void gfx_path_line_to(gfx_path_t * path, float x, float y) {
+	if (!path->count || (path->points[path->count-1].flags & GFX_PATH_POINT_CLOSE)) {
+		gfx_path_move_to(path, x, y);
+		return;
+	}
+	gfx_path_push(path, x, y, 0);
+}
+
+void gfx_path_quad_to(gfx_path_t * path, float cx, float cy, float x, float y) {
+	if (!path->count) gfx_path_move_to(path, cx, cy);
+	float x_0 = path->points[path->count-1].x;
+	float y_0 = path->points[path->count-1].y;
+
+	/* Deviation from the chord of n segments is |p0 - 2c + p1| / (8n^2) */
+	float dx = x_0 - 2 * cx + x;
+	float dy = y_0 - 2 * cy + y;
+	int n = (int)ceil(sqrtf(sqrtf(dx * dx + dy * dy) / (8 * GFX_PATH_TOLERANCE)));
+	if (n < 1) n = 1;
+	if (n > 100) n = 100;
+
+	for (int i = 1; i < n; ++i) {
+		float t = (float)i / (float)n;
+		float nt = 1.0f - t;
+		gfx_path_line_to(path,
+			nt * nt * x_0 + 2 * t * nt * cx + t * t * x,
+			nt * nt * y_0 + 2 * t * nt * cy + t * t * y);
+	}
+	gfx_path_line_to(path, x, y);
+}
+
+void gfx_path_cubic_to(gfx_path_t * path, float c1x, float c1y, float c2x, float c2y, float x, float y) {
+	if (!path->count) gfx_path_move_to(path, c1x, c1y);
+	float x_0 = path->points[path->count-1].x;
+	float y_0 = path->points[path->count-1].y;
+
+	/* Bound the second differences of the control polygon */
+	float d1x = x_0 - 2 * c1x + c2x, d1y = y_0 - 2 * c1y + c2y;
+	float d2x = c1x - 2 * c2x + x,   d2y = c1y - 2 * c2y + y;
+	float dd = fmax(d1x * d1x + d1y * d1y, d2x * d2x + d2y * d2y);
+	int n = (int)ceil(sqrtf(3.0f * sqrtf(dd) / (4 * GFX_PATH_TOLERANCE)));
+	if (n < 1) n = 1;
+	if (n > 100) n = 100;
+
+	for (int i = 1; i < n; ++i) {
+		float t = (float)i / (float)n;
+		float nt = 1.0f - t;
+		float a = nt * nt * nt, b = 3 * nt * nt * t, c = 3 * nt * t * t, d = t * t * t;
+		gfx_path_line_to(path,
+			a * x_0 + b * c1x + c * c2x + d * x,
+			a * y_0 + b * c1y + c * c2y + d * y);
+	}
+	gfx_path_line_to(path, x, y);
+}
+
+void gfx_path_close(gfx_path_t * path) {
+	if (path->count) path->points[path->count-1].flags |= GFX_PATH_POINT_CLOSE;
+}
+
+struct gfx_edge_list {
+	size_t count;
+	size_t capacity;
+	struct gfx_edge * edges;
+};
+
+static void gfx_edge_add(struct gfx_edge_list * list, float x_0, float y_0, float x_1, float y_1) {
+	if (y_0 == y_1) return; /* Horizontal edges never cross a sample row */
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 32;
+		list->edges = realloc(list->edges, sizeof(struct gfx_edge) * list->capacity);
+	}
+	list->edges[list->count].x0 = x_0;
+	list->edges[list->count].y0 = y_0;
+	list->edges[list->count].x1 = x_1;
+	list->edges[list->count].y1 = y_1;
+	list->count++;
+}
+
+struct gfx_active_edge {
+	float x0;
+	float y0;
+	float y1;
+	float dxdy;
+	int dir;
+	struct gfx_active_edge * next;
+};
+
+struct gfx_crossing {
+	float x;
+	int dir;
+};
+
+static inline void gfx_coverage_add(float * acc, float * delta, int width, float x_a, float x_b, float weight, int * min_x, int * max_x) {
+	if (x_a < 0) x_a = 0;
+	if (x_b > width) x_b = width;
+	if (x_b <= x_a) return;
+	int i_a = (int)x_a;
+	int i_b = (int)x_b;
+	if (i_a == i_b) {
+		acc[i_a] += (x_b - x_a) * weight;
+	} else {
+		acc[i_a] += ((float)(i_a + 1) - x_a) * weight;
+		delta[i_a + 1] += weight;
+		delta[i_b] -= weight;
+		acc[i_b] += (x_b - (float)i_b) * weight;
+	}
+	if (i_a < *min_x) *min_x = i_a;
+	if (i_b > *max_x) *max_x = i_b;
+}
+
+/**
+ * @brief Scan convert a set of edges and blend @p color through the coverage.
+ *
+ * Edges do not need to be in any particular order or direction; an edge
+ * running downwards counts +1 to the winding number and one running upwards
+ * counts -1.
+ *
+ * @param color Premultiplied color to paint.
+ * @param rule  GFX_FILL_NONZERO or GFX_FILL_EVENODD
+ */
+void gfx_fill_edges(gfx_context_t * ctx, const struct gfx_edge * edges, size_t count, uint32_t color, int rule) {
+	if (!count) return;
+
+	float min_y = edges[0].y0, max_y = edges[0].y0;
+	for (size_t i = 0; i < count; ++i) {
+		min_y = fmin(min_y, fmin(edges[i].y0, edges[i].y1));
+		max_y = fmax(max_y, fmax(edges[i].y0, edges[i].y1));
+	}
+
+	int start_row = max((int)floor(min_y), 0);
+	int end_row   = min((int)ceil(max_y), ctx->height);
+	if (end_row <= start_row) return;
+
+	int rows = end_row - start_row;
+	int width = ctx->width;
+
+	struct gfx_active_edge ** buckets = calloc(rows, sizeof(struct gfx_active_edge *));
+	struct gfx_active_edge * storage = malloc(sizeof(struct gfx_active_edge) * count);
+	struct gfx_crossing * crosses = malloc(sizeof(struct gfx_crossing) * count);
+	float * acc   = calloc(width + 2, sizeof(float));
+	float * delta = calloc(width + 2, sizeof(float));
+	uint8_t * cover = malloc(width + 1);
+
+	for (size_t i = 0; i < count; ++i) {
+		struct gfx_active_edge * e = &storage[i];
+		if (edges[i].y0 < edges[i].y1) {
+			e->x0 = edges[i].x0; e->y0 = edges[i].y0; e->y1 = edges[i].y1; e->dir = 1;
+		} else if (edges[i].y0 > edges[i].y1) {
+			e->x0 = edges[i].x1; e->y0 = edges[i].y1; e->y1 = edges[i].y0; e->dir = -1;
+		} else {
+			continue;
+		}
+		if (e->y1 <= start_row || e->y0 >= end_row) continue;
+		e->dxdy = (edges[i].x1 - edges[i].x0) / (edges[i].y1 - edges[i].y0);
+		int row = max((int)floor(e->y0), start_row) - start_row;
+		e->next = buckets[row];
+		buckets[row] = e;
+	}
+
+	struct gfx_active_edge * active = NULL;
+
+	for (int row = start_row; row < end_row; ++row) {
+		/* Edges starting on this row become active */
+		struct gfx_active_edge * e = buckets[row - start_row];
+		while (e) {
+			struct gfx_active_edge * next = e->next;
+			e->next = active;
+			active = e;
+			e = next;
+		}
+
+		if (!active) continue;
+
+		int min_x = width, max_x = -1;
+
+		for (int sub = 0; sub < GFX_PATH_SUBSAMPLES; ++sub) {
+			float sy = (float)row + ((float)sub + 0.5f) / (float)GFX_PATH_SUBSAMPLES;
+			size_t cnt = 0;
+			for (e = active; e; e = e->next) {
+				if (sy < e->y0 || sy >= e->y1) continue;
+				struct gfx_crossing c = {e->x0 + (sy - e->y0) * e->dxdy, e->dir};
+				/* Insertion sort; the active set is small and mostly ordered */
+				size_t j = cnt++;
+				while (j > 0 && crosses[j-1].x > c.x) {
+					crosses[j] = crosses[j-1];
+					j--;
 				}
+				crosses[j] = c;
+			}
+
+			int wind = 0;
+			for (size_t j = 0; j + 1 < cnt; ++j) {
+				wind += (rule == GFX_FILL_EVENODD) ? 1 : crosses[j].dir;
+				int inside = (rule == GFX_FILL_EVENODD) ? (wind & 1) : (wind != 0);
+				if (inside) {
+					gfx_coverage_add(acc, delta, width, crosses[j].x, crosses[j+1].x,
+						1.0f / (float)GFX_PATH_SUBSAMPLES, &min_x, &max_x);
+				}
+			}
+		}
+
+		/* Retire edges that end before the next row */
+		struct gfx_active_edge ** prev = &active;
+		while (*prev) {
+			if ((*prev)->y1 <= (float)(row + 1)) {
+				*prev = (*prev)->next;
+			} else {
+				prev = &(*prev)->next;
+			}
+		}
+
+		if (max_x < min_x) continue;
+		if (max_x > width - 1) {
+			/* A run ending exactly on the right edge touches no pixel there */
+			delta[max_x] = 0;
+			acc[max_x] = 0;
+			max_x = width - 1;
+		}
+
+		float running = 0;
+		for (int x = min_x; x <= max_x; ++x) {
+			running += delta[x];
+			float c = acc[x] + running;
+			cover[x] = c >= 1.0f ? 255 : (c <= 0.0f ? 0 : (uint8_t)(c * 255.0f + 0.5f));
+			acc[x] = 0;
+			delta[x] = 0;
+		}
+		delta[max_x + 1] = 0;
+
+		if (!_is_in_clip(ctx, row)) continue;
+
+		for (int x = min_x; x <= max_x;) {
+			if (cover[x] == 255) {
+				int run = x;
+				while (run <= max_x && cover[run] == 255) run++;
+				gfx_span_blend_solid(&GFX(ctx, x, row), run - x, color);
+				x = run;
+			} else {
+				if (cover[x]) {
+					GFX(ctx, x, row) = alpha_blend_rgba(GFX(ctx, x, row), gfx_scale_premultiplied(color, cover[x]));
+				}
+				x++;
 			}
 		}
 	}
+
+	free(cover);
+	free(delta);
+	free(acc);
+	free(crosses);
+	free(storage);
+	free(buckets);
 }
 
-void draw_line_aa(gfx_context_t * ctx, int x_1, int x_2, int y_1, int y_2, uint32_t color, float thickness) {
-	struct gfx_point v = {(float)x_1, (float)y_1};
-	struct gfx_point w = {(float)x_2, (float)y_2};
-	draw_line_aa_points(ctx,&v,&w,color,thickness);
+/**
+ * @brief Fill a path.
+ *
+ * Every subpath is implicitly closed.
+ */
+void gfx_path_fill(gfx_context_t * ctx, gfx_path_t * path, uint32_t color, int rule) {
+	struct gfx_edge_list list = {0, 0, NULL};
+	size_t start = 0;
+	for (size_t i = 0; i < path->count; ++i) {
+		if (path->points[i].flags & GFX_PATH_POINT_MOVE) {
+			start = i;
+		} else {
+			gfx_edge_add(&list, path->points[i-1].x, path->points[i-1].y, path->points[i].x, path->points[i].y);
+		}
+		if (i + 1 == path->count || (path->points[i+1].flags & GFX_PATH_POINT_MOVE)) {
+			gfx_edge_add(&list, path->points[i].x, path->points[i].y, path->points[start].x, path->points[start].y);
+		}
+	}
+	gfx_fill_edges(ctx, list.edges, list.count, color, rule);
+	free(list.edges);
 }
 
+static void gfx_stroke_polygon(struct gfx_edge_list * list, int n, float * xs, float * ys) {
+	/* Everything a stroke adds must wind the same way so nonzero fill unions them */
+	float area = 0;
+	for (int i = 0; i < n; ++i) {
+		int j = (i + 1) % n;
+		area += xs[i] * ys[j] - xs[j] * ys[i];
+	}
+	for (int i = 0; i < n; ++i) {
+		int j = (i + 1) % n;
+		if (area >= 0) {
+			gfx_edge_add(list, xs[i], ys[i], xs[j], ys[j]);
+		} else {
+			gfx_edge_add(list, xs[j], ys[j], xs[i], ys[i]);
+		}
+	}
+}
+
+static void gfx_stroke_round(struct gfx_edge_list * list, float x, float y, float radius) {
+	int n = (int)(radius * 4.0f);
+	if (n < 8) n = 8;
+	if (n > 64) n = 64;
+	float xs[64], ys[64];
+	for (int i = 0; i < n; ++i) {
+		float theta = (float)i * 2.0f * (float)M_PI / (float)n;
+		xs[i] = x + radius * cos(theta);
+		ys[i] = y + radius * sin(theta);
+	}
+	gfx_stroke_polygon(list, n, xs, ys);
+}
+
+/**
+ * @brief Stroke a path with round joins and caps.
+ *
+ * Each segment becomes a rectangle and each vertex a disc, all wound the
+ * same way, and the lot is filled with the nonzero rule.
+ *
+ * @param width Full width of the stroke in pixels.
+ * @param color Premultiplied color to paint.
+ */
+void gfx_path_stroke(gfx_context_t * ctx, gfx_path_t * path, float width, uint32_t color) {
+	struct gfx_edge_list list = {0, 0, NULL};
+	float half = width / 2.0f;
+	size_t start = 0;
+	for (size_t i = 0; i < path->count; ++i) {
+		struct gfx_path_point * p = &path->points[i];
+		if (p->flags & GFX_PATH_POINT_MOVE) start = i;
+		gfx_stroke_round(&list, p->x, p->y, half);
+
+		struct gfx_path_point * q = NULL;
+		if (i + 1 < path->count && !(path->points[i+1].flags & GFX_PATH_POINT_MOVE)) {
+			q = &path->points[i+1];
+		} else if ((p->flags & GFX_PATH_POINT_CLOSE) && i != start) {
+			q = &path->points[start];
+		}
+		if (!q) continue;
+
+		float dx = q->x - p->x;
+		float dy = q->y - p->y;
+		float len = sqrtf(dx * dx + dy * dy);
+		if (len == 0.0f) continue;
+		float nx = -dy / len * half;
+		float ny =  dx / len * half;
+		float xs[4] = {p->x + nx, q->x + nx, q->x - nx, p->x - nx};
+		float ys[4] = {p->y + ny, q->y + ny, q->y - ny, p->y - ny};
+		gfx_stroke_polygon(&list, 4, xs, ys);
+	}
+	gfx_fill_edges(ctx, list.edges, list.count, color, GFX_FILL_NONZERO);
+	free(list.edges);
+}
@@ -6,7 +6,10 @@
  * icon_cache - caches icons
  *
  * Used be a few different applications.
- * Probably needs scaling?
+ *
+ * Also keeps a small LRU of scaled sprites, so icons and thumbnails
+ * drawn at the same reduced size over and over are scaled once and
+ * then just blitted.
  */
 #include <stdlib.h>
 #include <stdio.h>
@@ -16,6 +19,22 @@
 #include <toaru/graphics.h>
 #include <toaru/hashmap.h>
 
+#define SCALED_CACHE_SIZE  32
+#define SCALED_CACHE_BYTES (8 * 1024 * 1024)
+
+struct scaled_entry {
+	const sprite_t * source;
+	uint32_t * bitmap;   /* source->bitmap when scaled, to notice reloads */
+	uint16_t width;
+	uint16_t height;
+	sprite_t * scaled;
+	unsigned long used;
+};
+
+static struct scaled_entry scaled_cache[SCALED_CACHE_SIZE];
+static unsigned long scaled_clock = 0;
+static size_t scaled_bytes = 0;
+
 static hashmap_t * icon_cache_16;
 static hashmap_t * icon_cache_48;
 
@@ -108,3 +127,69 @@ sprite_t * icon_get_16(const char * name) {
 sprite_t * icon_get_48(const char * name) {
 	return icon_get_int(name, icon_cache_48, icon_directories_48);
 }
+
+static void scaled_evict(struct scaled_entry * entry) {
+	scaled_bytes -= entry->scaled->width * entry->scaled->height * sizeof(uint32_t);
+	sprite_free(entry->scaled);
+	entry->scaled = NULL;
+	entry->source = NULL;
+}
+
+/**
+ * Get a copy of @p sprite scaled to @p width by @p height.
+ *
+ * Scaled copies are made with gfx_sprite_resample() and kept in an
+ * LRU, so drawing the same icon at the same size again is a plain
+ * blit. The returned sprite belongs to the cache and stays valid until
+ * the next call; if @p sprite is already the right size, it is returned
+ * unchanged.
+ */
+sprite_t * icon_get_scaled(const sprite_t * sprite, uint16_t width, uint16_t height) {
+	if (sprite->width == width && sprite->height == height) return (sprite_t *)sprite;
+
+	struct scaled_entry * victim = &scaled_cache[0];
+	for (int i = 0; i < SCALED_CACHE_SIZE; ++i) {
+		struct scaled_entry * entry = &scaled_cache[i];
+		if (entry->scaled && entry->source == sprite && entry->bitmap == sprite->bitmap &&
+			entry->width == width && entry->height == height) {
+			entry->used = ++scaled_clock;
+			return entry->scaled;
+		}
+		if (!entry->scaled || (victim->scaled && entry->used < victim->used)) victim = entry;
+	}
+
+	if (victim->scaled) scaled_evict(victim);
+
+	victim->source = sprite;
+	victim->bitmap = sprite->bitmap;
+	victim->width  = width;
+	victim->height = height;
+	victim->scaled = gfx_sprite_resample(sprite, width, height);
+	victim->used   = ++scaled_clock;
+	scaled_bytes += width * height * sizeof(uint32_t);
+
+	/* Keep big scales (wallpapers) from piling up */
+	while (scaled_bytes > SCALED_CACHE_BYTES) {
+		struct scaled_entry * oldest = NULL;
+		for (int i = 0; i < SCALED_CACHE_SIZE; ++i) {
+			struct scaled_entry * entry = &scaled_cache[i];
+			if (entry->scaled && entry != victim && (!oldest || entry->used < oldest->used)) oldest = entry;
+		}
+		if (!oldest) break;
+		scaled_evict(oldest);
+	}
+
+	return victim->scaled;
+}
+
+/**
+ * Drop any scaled copies of @p sprite; call before freeing or
+ * reloading a sprite that was passed to icon_get_scaled().
+ */
+void icon_cache_forget(const sprite_t * sprite) {
+	for (int i = 0; i < SCALED_CACHE_SIZE; ++i) {
+		if (scaled_cache[i].scaled && scaled_cache[i].source == sprite) {
+			scaled_evict(&scaled_cache[i]);
+		}
+	}
+}
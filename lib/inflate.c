@@ -10,6 +10,7 @@
 
 #ifndef _BOOT_LOADER
 #include <toaru/inflate.h>
+#include <toaru/checksum.h>
 #endif
 
 /**
@@ -22,12 +23,23 @@ struct huff {
 
 /**
  * 32K ringbuffer for backwards lookup
+ *
+ * Output is checksummed from here a ring at a time, rather than as
+ * each byte is emitted.
  */
 struct huff_ring {
 	size_t pointer;
+	size_t checked;  /* Bytes of data[] already checksummed */
+	uint32_t total;  /* Output size, modulo 2^32 as gzip records it */
+	uint32_t sum;
+	int check;       /* Which checksum to keep, if any */
 	uint8_t data[32768];
 };
 
+#define CHECK_NONE    0
+#define CHECK_CRC32   1
+#define CHECK_ADLER32 2
+
 /**
  * Fixed Huffman code tables, generated later.
  */
@@ -158,6 +170,20 @@ static int decode(struct inflate_context * ctx, struct huff * huff) {
 	return huff->symbols[count + cur];
 }
 
+/**
+ * Add what has been emitted since the last call to the checksum.
+ */
+static void update_checksum(struct huff_ring * ring) {
+	size_t len = ring->pointer - ring->checked;
+	if (ring->check == CHECK_CRC32) {
+		ring->sum = checksum_crc32(ring->sum, ring->data + ring->checked, len);
+	} else if (ring->check == CHECK_ADLER32) {
+		ring->sum = checksum_adler32(ring->sum, ring->data + ring->checked, len);
+	}
+	ring->total += len;
+	ring->checked = ring->pointer;
+}
+
 /**
  * Emit one byte to the output, maintaining the ringbuffer.
  * The ringbuffer ensures we can always look back 32K bytes
@@ -165,7 +191,9 @@ static int decode(struct inflate_context * ctx, struct huff * huff) {
  */
 static void emit(struct inflate_context * ctx, unsigned char byte) {
 	if (ctx->ring->pointer == 32768) {
+		update_checksum(ctx->ring);
 		ctx->ring->pointer = 0;
+		ctx->ring->checked = 0;
 	}
 
 	ctx->ring->data[ctx->ring->pointer] = byte;
@@ -363,12 +391,13 @@ static int uncompressed(struct inflate_context * ctx) {
 	return 0;
 }
 
-static struct huff_ring data = {0, {0}};
+static struct huff_ring data = {0, 0, 0, 0, CHECK_NONE, {0}};
 
 /**
- * Decompress DEFLATE-compressed data.
+ * Decompress DEFLATE-compressed data, keeping a checksum of
+ * the output in the ring.
  */
-int deflate_decompress(struct inflate_context * ctx) {
+static int decompress(struct inflate_context * ctx, int check) {
 	ctx->bit_buffer = 0;
 	ctx->buffer_size = 0;
 
@@ -378,6 +407,11 @@ int deflate_decompress(struct inflate_context * ctx) {
 		ctx->ring = &data;
 	}
 
+	ctx->ring->checked = ctx->ring->pointer;
+	ctx->ring->total = 0;
+	ctx->ring->sum = (check == CHECK_ADLER32) ? CHECKSUM_ADLER32_INIT : CHECKSUM_CRC32_INIT;
+	ctx->ring->check = check;
+
 	/* read compressed data */
 	while (1) {
 		/* Read bit */
@@ -404,9 +438,17 @@ int deflate_decompress(struct inflate_context * ctx) {
 		}
 	}
 
+	update_checksum(ctx->ring);
 	return 0;
 }
 
+/**
+ * Decompress DEFLATE-compressed data.
+ */
+int deflate_decompress(struct inflate_context * ctx) {
+	return decompress(ctx, CHECK_NONE);
+}
+
 #define GZIP_FLAG_TEXT (1 << 0)
 #define GZIP_FLAG_HCRC (1 << 1)
 #define GZIP_FLAG_EXTR (1 << 2)
@@ -468,14 +510,48 @@ int gzip_decompress(struct inflate_context * ctx) {
 	}
 	(void)crc16;
 
-	int status = deflate_decompress(ctx);
+	int status = decompress(ctx, CHECK_CRC32);
+	if (status) return status;
 
-	/* Read CRC and decompressed size from end of input */
+	/* Check the CRC and decompressed size from the end of input */
 	unsigned int crc32 = read_32le(ctx);
 	unsigned int dsize = read_32le(ctx);
 
-	(void)crc32;
-	(void)dsize;
+	if (crc32 != ctx->ring->sum) return 2;
+	if (dsize != ctx->ring->total) return 2;
 
-	return status;
+	return 0;
+}
+
+static unsigned int read_32be(struct inflate_context * ctx) {
+	unsigned int a, b, c, d;
+	a = ctx->get_input(ctx);
+	b = ctx->get_input(ctx);
+	c = ctx->get_input(ctx);
+	d = ctx->get_input(ctx);
+
+	return (a << 24) | (b << 16) | (c << 8) | (d << 0);
+}
+
+/**
+ * Decompress a zlib stream: a two-byte header, DEFLATE data,
+ * and the Adler-32 of what it decompresses to.
+ */
+int zlib_decompress(struct inflate_context * ctx) {
+	unsigned int cmf = ctx->get_input(ctx);
+	unsigned int flg = ctx->get_input(ctx);
+
+	/* Method must be DEFLATE, and the header its own check */
+	if ((cmf & 0xF) != 8) return 1;
+	if (((cmf << 8) | flg) % 31) return 1;
+
+	/* We don't have any preset dictionaries */
+	if (flg & (1 << 5)) return 1;
+
+	int status = decompress(ctx, CHECK_ADLER32);
+	if (status) return status;
+
+	if (read_32be(ctx) != ctx->ring->sum) return 2;
+
+	return 0;
 }
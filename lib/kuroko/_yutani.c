@@ -4,6 +4,7 @@
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
 #include <toaru/text.h>
+#include <toaru/hashmap.h>
 #include <kuroko/kuroko.h>
 #include <kuroko/vm.h>
 #include <kuroko/value.h>
@@ -355,7 +356,8 @@ GFX_PROPERTY(height);
 #define CHECK_GFX() \
 	if (argc < 1 || !krk_isInstanceOf(argv[0], GraphicsContext)) \
 		return krk_runtimeError(vm.exceptions->typeError, "expected GraphicsContext"); \
-	struct GraphicsContext * self = (struct GraphicsContext*)AS_INSTANCE(argv[0])
+	struct GraphicsContext * self = (struct GraphicsContext*)AS_INSTANCE(argv[0]); \
+	if (!self->ctx) return krk_runtimeError(vm.exceptions->valueError, "GraphicsContext is closed")
 
 static KrkValue _gfx_fill(int argc, KrkValue argv[], int hasKw) {
 	CHECK_GFX();
@@ -516,6 +518,288 @@ static KrkValue _gfx_draw_sprite(int argc, KrkValue argv[], int hasKw) {
 	return NONE_VAL();
 }
 
+/**
+ * Colors for the batched calls may be given as color() objects or as
+ * plain ints holding the 32-bit ARGB value, which is cheaper to build
+ * in bulk from a script.
+ */
+static int _color_arg(KrkValue value, uint32_t * out) {
+	if (krk_isInstanceOf(value, YutaniColor)) {
+		*out = ((struct YutaniColor*)AS_INSTANCE(value))->color;
+		return 1;
+	} else if (IS_INTEGER(value)) {
+		*out = (uint32_t)AS_INTEGER(value);
+		return 1;
+	}
+	return 0;
+}
+
+static int _sequence_arg(KrkValue value, size_t * count, KrkValue ** values) {
+	if (IS_TUPLE(value)) {
+		*count = AS_TUPLE(value)->values.count;
+		*values = AS_TUPLE(value)->values.values;
+		return 1;
+	} else if (krk_isInstanceOf(value, vm.baseClasses->listClass)) {
+		*count = AS_LIST(value)->count;
+		*values = AS_LIST(value)->values;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Clip a region against the context; returns 0 if nothing is left.
+ * The edges are worked out in 64 bits, as the values come straight
+ * from scripts and x + w can overflow an int32.
+ */
+static int _clip_region(gfx_context_t * ctx, int32_t * x, int32_t * y, int32_t * w, int32_t * h) {
+	int64_t left = *x, top = *y;
+	int64_t right = left + *w, bottom = top + *h;
+	if (left < 0) left = 0;
+	if (top < 0) top = 0;
+	if (right > ctx->width) right = ctx->width;
+	if (bottom > ctx->height) bottom = ctx->height;
+	if (right <= left || bottom <= top) return 0;
+	*x = left;
+	*y = top;
+	*w = right - left;
+	*h = bottom - top;
+	return 1;
+}
+
+static KrkValue _gfx_get_pixels(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	int32_t x = 0, y = 0, w = self->ctx->width, h = self->ctx->height;
+	if (argc > 1) {
+		if (argc != 5 || !IS_INTEGER(argv[1]) || !IS_INTEGER(argv[2]) || !IS_INTEGER(argv[3]) || !IS_INTEGER(argv[4]))
+			return krk_runtimeError(vm.exceptions->typeError, "get_pixels() expects no arguments or 4 ints");
+		x = AS_INTEGER(argv[1]);
+		y = AS_INTEGER(argv[2]);
+		w = AS_INTEGER(argv[3]);
+		h = AS_INTEGER(argv[4]);
+	}
+
+	if (!_clip_region(self->ctx, &x, &y, &w, &h))
+		return OBJECT_VAL(krk_newBytes(0, NULL));
+
+	size_t row = w * sizeof(uint32_t);
+	uint8_t * out = malloc(row * h);
+	for (int32_t i = 0; i < h; ++i) {
+		memcpy(&out[row * i], &GFX(self->ctx, x, y + i), row);
+	}
+	KrkBytes * bytes = krk_newBytes(row * h, out);
+	free(out);
+	return OBJECT_VAL(bytes);
+}
+
+static KrkValue _gfx_put_pixels(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	if (argc != 6 || !IS_INTEGER(argv[1]) || !IS_INTEGER(argv[2]) || !IS_INTEGER(argv[3]) || !IS_INTEGER(argv[4]) || !IS_BYTES(argv[5]))
+		return krk_runtimeError(vm.exceptions->typeError, "put_pixels() expects 4 ints and bytes");
+
+	int32_t x = AS_INTEGER(argv[1]);
+	int32_t y = AS_INTEGER(argv[2]);
+	int32_t w = AS_INTEGER(argv[3]);
+	int32_t h = AS_INTEGER(argv[4]);
+	KrkBytes * bytes = AS_BYTES(argv[5]);
+
+	if (w < 0 || h < 0 || bytes->length != (size_t)w * h * sizeof(uint32_t))
+		return krk_runtimeError(vm.exceptions->valueError, "expected %d bytes of pixel data", (int)(w < 0 || h < 0 ? 0 : w * h * 4));
+
+	size_t stride = w * sizeof(uint32_t);
+	int64_t ox = x, oy = y;
+	if (!_clip_region(self->ctx, &x, &y, &w, &h)) return NONE_VAL();
+
+	/* Source offsets for the part of the region that survived clipping */
+	size_t sx = x - ox;
+	size_t sy = y - oy;
+
+	for (int32_t i = 0; i < h; ++i) {
+		memcpy(&GFX(self->ctx, x, y + i), &bytes->bytes[stride * (sy + i) + sx * sizeof(uint32_t)], w * sizeof(uint32_t));
+	}
+	return NONE_VAL();
+}
+
+static KrkValue _gfx_rects(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	size_t count;
+	KrkValue * items;
+	uint32_t color = 0;
+	if (argc < 2 || !_sequence_arg(argv[1], &count, &items))
+		return krk_runtimeError(vm.exceptions->typeError, "rects() expects a list of (x,y,width,height[,color])");
+	if (argc > 2 && !_color_arg(argv[2], &color))
+		return krk_runtimeError(vm.exceptions->typeError, "color must be color or int, not '%s'", krk_typeName(argv[2]));
+
+	KrkValue solid = BOOLEAN_VAL(0);
+	if (hasKw) krk_tableGet(AS_DICT(argv[argc]), OBJECT_VAL(S("solid")), &solid);
+	if (!IS_BOOLEAN(solid))
+		return krk_runtimeError(vm.exceptions->typeError, "solid must be bool");
+
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t c = color;
+		if (!IS_TUPLE(items[i]) || AS_TUPLE(items[i])->values.count < 4 || AS_TUPLE(items[i])->values.count > 5)
+			return krk_runtimeError(vm.exceptions->typeError, "rect %d is not (x,y,width,height[,color])", (int)i);
+		KrkValue * v = AS_TUPLE(items[i])->values.values;
+		if (!IS_INTEGER(v[0]) || !IS_INTEGER(v[1]) || !IS_INTEGER(v[2]) || !IS_INTEGER(v[3]))
+			return krk_runtimeError(vm.exceptions->typeError, "rect %d: expected 4 ints", (int)i);
+		if (AS_TUPLE(items[i])->values.count == 5 && !_color_arg(v[4], &c))
+			return krk_runtimeError(vm.exceptions->typeError, "rect %d: color must be color or int", (int)i);
+		else if (AS_TUPLE(items[i])->values.count == 4 && argc < 3)
+			return krk_runtimeError(vm.exceptions->typeError, "rect %d has no color and no default was given", (int)i);
+		if (AS_BOOLEAN(solid)) {
+			draw_rectangle_solid(self->ctx, AS_INTEGER(v[0]), AS_INTEGER(v[1]), AS_INTEGER(v[2]), AS_INTEGER(v[3]), c);
+		} else {
+			draw_rectangle(self->ctx, AS_INTEGER(v[0]), AS_INTEGER(v[1]), AS_INTEGER(v[2]), AS_INTEGER(v[3]), c);
+		}
+	}
+
+	return NONE_VAL();
+}
+
+static KrkValue _gfx_lines(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	size_t count;
+	KrkValue * items;
+	uint32_t color = 0;
+	if (argc < 2 || !_sequence_arg(argv[1], &count, &items))
+		return krk_runtimeError(vm.exceptions->typeError, "lines() expects a list of (x0,x1,y0,y1[,color])");
+	if (argc > 2 && !_color_arg(argv[2], &color))
+		return krk_runtimeError(vm.exceptions->typeError, "color must be color or int, not '%s'", krk_typeName(argv[2]));
+
+	KrkValue thickness = NONE_VAL();
+	if (hasKw) krk_tableGet(AS_DICT(argv[argc]), OBJECT_VAL(S("thickness")), &thickness);
+	if (!IS_NONE(thickness) && !IS_INTEGER(thickness) && !IS_FLOATING(thickness))
+		return krk_runtimeError(vm.exceptions->typeError, "thickness must be int or float, not '%s'", krk_typeName(thickness));
+
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t c = color;
+		if (!IS_TUPLE(items[i]) || AS_TUPLE(items[i])->values.count < 4 || AS_TUPLE(items[i])->values.count > 5)
+			return krk_runtimeError(vm.exceptions->typeError, "line %d is not (x0,x1,y0,y1[,color])", (int)i);
+		KrkValue * v = AS_TUPLE(items[i])->values.values;
+		if (!IS_INTEGER(v[0]) || !IS_INTEGER(v[1]) || !IS_INTEGER(v[2]) || !IS_INTEGER(v[3]))
+			return krk_runtimeError(vm.exceptions->typeError, "line %d: expected 4 ints", (int)i);
+		if (AS_TUPLE(items[i])->values.count == 5 && !_color_arg(v[4], &c))
+			return krk_runtimeError(vm.exceptions->typeError, "line %d: color must be color or int", (int)i);
+		else if (AS_TUPLE(items[i])->values.count == 4 && argc < 3)
+			return krk_runtimeError(vm.exceptions->typeError, "line %d has no color and no default was given", (int)i);
+		int32_t x0 = AS_INTEGER(v[0]);
+		int32_t x1 = AS_INTEGER(v[1]);
+		int32_t y0 = AS_INTEGER(v[2]);
+		int32_t y1 = AS_INTEGER(v[3]);
+		if (IS_INTEGER(thickness)) {
+			draw_line_thick(self->ctx,x0,x1,y0,y1,c,AS_INTEGER(thickness));
+		} else if (IS_FLOATING(thickness)) {
+			draw_line_aa(self->ctx,x0,x1,y0,y1,c,AS_FLOATING(thickness));
+		} else {
+			draw_line(self->ctx,x0,x1,y0,y1,c);
+		}
+	}
+
+	return NONE_VAL();
+}
+
+static KrkValue _gfx_points(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	size_t count;
+	KrkValue * items;
+	uint32_t color = 0;
+	if (argc < 2 || !_sequence_arg(argv[1], &count, &items))
+		return krk_runtimeError(vm.exceptions->typeError, "points() expects a list of (x,y[,color])");
+	if (argc > 2 && !_color_arg(argv[2], &color))
+		return krk_runtimeError(vm.exceptions->typeError, "color must be color or int, not '%s'", krk_typeName(argv[2]));
+
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t c = color;
+		if (!IS_TUPLE(items[i]) || AS_TUPLE(items[i])->values.count < 2 || AS_TUPLE(items[i])->values.count > 3)
+			return krk_runtimeError(vm.exceptions->typeError, "point %d is not (x,y[,color])", (int)i);
+		KrkValue * v = AS_TUPLE(items[i])->values.values;
+		if (!IS_INTEGER(v[0]) || !IS_INTEGER(v[1]))
+			return krk_runtimeError(vm.exceptions->typeError, "point %d: expected 2 ints", (int)i);
+		if (AS_TUPLE(items[i])->values.count == 3 && !_color_arg(v[2], &c))
+			return krk_runtimeError(vm.exceptions->typeError, "point %d: color must be color or int", (int)i);
+		else if (AS_TUPLE(items[i])->values.count == 2 && argc < 3)
+			return krk_runtimeError(vm.exceptions->typeError, "point %d has no color and no default was given", (int)i);
+		int32_t x = AS_INTEGER(v[0]);
+		int32_t y = AS_INTEGER(v[1]);
+		if (x < 0 || y < 0 || x >= self->ctx->width || y >= self->ctx->height) continue;
+		GFX(self->ctx, x, y) = alpha_blend_rgba(GFX(self->ctx, x, y), c);
+	}
+
+	return NONE_VAL();
+}
+
+/**
+ * class PixelView():
+ *     A live view of a context's backbuffer, indexed by (x,y) or by
+ *     position in row order. Holds a reference to the context, and
+ *     looks up its buffer on every access, so it stays valid across
+ *     window resizes. Once the window is closed there is no buffer,
+ *     and using the view raises ValueError.
+ */
+static KrkClass * PixelView;
+struct PixelView {
+	KrkInstance inst;
+	struct GraphicsContext * context;
+};
+
+static KrkValue _gfx_pixels(int argc, KrkValue argv[], int hasKw) {
+	CHECK_GFX();
+	struct PixelView * view = (struct PixelView*)krk_newInstance(PixelView);
+	krk_push(OBJECT_VAL(view));
+	view->context = self;
+	krk_attachNamedValue(&view->inst.fields, "context", argv[0]);
+	return krk_pop();
+}
+
+#define CHECK_PIXELVIEW() \
+	if (argc < 1 || !krk_isInstanceOf(argv[0], PixelView)) \
+		return krk_runtimeError(vm.exceptions->typeError, "expected PixelView"); \
+	struct PixelView * self = (struct PixelView*)AS_INSTANCE(argv[0]); \
+	gfx_context_t * ctx = self->context->ctx; \
+	if (!ctx) return krk_runtimeError(vm.exceptions->valueError, "GraphicsContext is closed")
+
+static int _pixel_index(gfx_context_t * ctx, KrkValue index, int32_t * x, int32_t * y) {
+	if (IS_INTEGER(index)) {
+		krk_integer_type i = AS_INTEGER(index);
+		if (i < 0) i += (krk_integer_type)ctx->width * ctx->height;
+		if (i < 0 || i >= (krk_integer_type)ctx->width * ctx->height) return 0;
+		*x = i % ctx->width;
+		*y = i / ctx->width;
+		return 1;
+	} else if (IS_TUPLE(index) && AS_TUPLE(index)->values.count == 2 &&
+		IS_INTEGER(AS_TUPLE(index)->values.values[0]) && IS_INTEGER(AS_TUPLE(index)->values.values[1])) {
+		*x = AS_INTEGER(AS_TUPLE(index)->values.values[0]);
+		*y = AS_INTEGER(AS_TUPLE(index)->values.values[1]);
+		return *x >= 0 && *y >= 0 && *x < ctx->width && *y < ctx->height;
+	}
+	return 0;
+}
+
+static KrkValue _pixelview_getitem(int argc, KrkValue argv[], int hasKw) {
+	CHECK_PIXELVIEW();
+	int32_t x, y;
+	if (argc != 2 || !_pixel_index(ctx, argv[1], &x, &y))
+		return krk_runtimeError(vm.exceptions->indexError, "pixel index out of range");
+	return INTEGER_VAL(GFX(ctx, x, y));
+}
+
+static KrkValue _pixelview_setitem(int argc, KrkValue argv[], int hasKw) {
+	CHECK_PIXELVIEW();
+	int32_t x, y;
+	uint32_t color;
+	if (argc != 3 || !_pixel_index(ctx, argv[1], &x, &y))
+		return krk_runtimeError(vm.exceptions->indexError, "pixel index out of range");
+	if (!_color_arg(argv[2], &color))
+		return krk_runtimeError(vm.exceptions->typeError, "pixel must be color or int, not '%s'", krk_typeName(argv[2]));
+	GFX(ctx, x, y) = color;
+	return argv[2];
+}
+
+static KrkValue _pixelview_len(int argc, KrkValue argv[], int hasKw) {
+	CHECK_PIXELVIEW();
+	return INTEGER_VAL((krk_integer_type)ctx->width * ctx->height);
+}
+
 static void _sprite_sweep(KrkInstance * self) {
 	struct YutaniSprite * sprite = (struct YutaniSprite*)self;
 
@@ -631,6 +915,25 @@ static KrkValue _window_flip(int argc, KrkValue argv[], int hasKw) {
 	return NONE_VAL();
 }
 
+static KrkValue _window_flip_region(int argc, KrkValue argv[], int hasKw) {
+	CHECK_WINDOW();
+	if (argc != 5 || !IS_INTEGER(argv[1]) || !IS_INTEGER(argv[2]) || !IS_INTEGER(argv[3]) || !IS_INTEGER(argv[4]))
+		return krk_runtimeError(vm.exceptions->typeError, "flip_region() expects 4 ints");
+	int32_t x = AS_INTEGER(argv[1]);
+	int32_t y = AS_INTEGER(argv[2]);
+	int32_t w = AS_INTEGER(argv[3]);
+	int32_t h = AS_INTEGER(argv[4]);
+	if (!_clip_region(self->ctx, &x, &y, &w, &h)) return NONE_VAL();
+	if (self->doubleBuffered) {
+		/* Only copy the rows and columns that changed, rather than the whole backbuffer */
+		for (int32_t i = 0; i < h; ++i) {
+			memcpy(&GFXR(self->ctx, x, y + i), &GFX(self->ctx, x, y + i), w * sizeof(uint32_t));
+		}
+	}
+	yutani_flip_region(((struct YutaniClass*)yctxInstance)->yctx, self->window, x, y, w, h);
+	return NONE_VAL();
+}
+
 static KrkValue _window_move(int argc, KrkValue argv[], int hasKw) {
 	CHECK_WINDOW();
 	if (argc < 3 || !IS_INTEGER(argv[1]) || !IS_INTEGER(argv[2]))
@@ -878,6 +1181,43 @@ static KrkValue _yutani_color_str(int argc, KrkValue argv[], int hasKw) {
 		return krk_runtimeError(vm.exceptions->typeError, "expected Font"); \
 	struct YutaniFont * self = (struct YutaniFont*)AS_INSTANCE(argv[0])
 
+/**
+ * Font files are read into memory once and shared by every Font made
+ * from them, the same way tt_font_from_shm shares the system fonts;
+ * glyphs are then read from memory rather than with a seek and read
+ * on the file for each one.
+ */
+static hashmap_t * file_font_cache = NULL;
+
+static struct TT_Font * _font_from_file_cached(const char * fileName) {
+	if (!file_font_cache) file_font_cache = hashmap_create(10);
+
+	uint8_t * fontData = hashmap_get(file_font_cache, (char*)fileName);
+	if (!fontData) {
+		FILE * f = fopen(fileName, "r");
+		if (!f) return NULL;
+		fseek(f, 0, SEEK_END);
+		long size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		fontData = malloc(size);
+		if (fread(fontData, 1, size, f) != (size_t)size) {
+			fclose(f);
+			free(fontData);
+			return NULL;
+		}
+		fclose(f);
+		struct TT_Font * font = tt_font_from_memory(fontData);
+		if (!font) {
+			free(fontData);
+			return NULL;
+		}
+		hashmap_set(file_font_cache, (char*)fileName, fontData);
+		return font;
+	}
+
+	return tt_font_from_memory(fontData);
+}
+
 static KrkValue _font_init(int argc, KrkValue argv[], int hasKw) {
 	CHECK_FONT();
 
@@ -896,7 +1236,7 @@ static KrkValue _font_init(int argc, KrkValue argv[], int hasKw) {
 	if (strstr(AS_CSTRING(argv[1]), "sans-serif") == AS_CSTRING(argv[1]) || strstr(AS_CSTRING(argv[1]), "monospace") == AS_CSTRING(argv[1])) {
 		self->fontData = tt_font_from_shm(AS_CSTRING(argv[1]));
 	} else {
-		self->fontData = tt_font_from_file(AS_CSTRING(argv[1]));
+		self->fontData = _font_from_file_cached(AS_CSTRING(argv[1]));
 	}
 
 	if (!self->fontData)
@@ -950,6 +1290,41 @@ static KrkValue _font_width(int argc, KrkValue argv[], int hasKw) {
 	return INTEGER_VAL(tt_string_width(self->fontData, str));
 }
 
+static KrkValue _font_draw_strings(int argc, KrkValue argv[], int hasKw) {
+	CHECK_FONT();
+	size_t count;
+	KrkValue * items;
+	if (argc < 2 || !krk_isInstanceOf(argv[1], GraphicsContext))
+		return krk_runtimeError(vm.exceptions->typeError, "expected GraphicsContext");
+	if (argc < 3 || !_sequence_arg(argv[2], &count, &items))
+		return krk_runtimeError(vm.exceptions->typeError, "expected list of (str,x,y[,color])");
+
+	gfx_context_t * ctx = ((struct GraphicsContext*)AS_INSTANCE(argv[1]))->ctx;
+	KrkValue widths = krk_list_of(0,NULL,0);
+	krk_push(widths);
+
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t color = self->fontColor;
+		if (!IS_TUPLE(items[i]) || AS_TUPLE(items[i])->values.count < 3 || AS_TUPLE(items[i])->values.count > 4) {
+			krk_pop();
+			return krk_runtimeError(vm.exceptions->typeError, "run %d is not (str,x,y[,color])", (int)i);
+		}
+		KrkValue * v = AS_TUPLE(items[i])->values.values;
+		if (!IS_STRING(v[0]) || !IS_INTEGER(v[1]) || !IS_INTEGER(v[2])) {
+			krk_pop();
+			return krk_runtimeError(vm.exceptions->typeError, "run %d: expected str and int coordinate pair", (int)i);
+		}
+		if (AS_TUPLE(items[i])->values.count == 4 && !_color_arg(v[3], &color)) {
+			krk_pop();
+			return krk_runtimeError(vm.exceptions->typeError, "run %d: color must be color or int", (int)i);
+		}
+		int width = tt_draw_string(ctx, self->fontData, AS_INTEGER(v[1]), AS_INTEGER(v[2]), AS_CSTRING(v[0]), color);
+		krk_writeValueArray(AS_LIST(widths), INTEGER_VAL(width));
+	}
+
+	return krk_pop();
+}
+
 static void _MenuBar_gcsweep(KrkInstance * _self) {
 	struct MenuBarClass * self = (struct MenuBarClass*)_self;
 	if (self->menuBar.entries) {
@@ -1293,8 +1668,43 @@ KrkValue krk_module_onload__yutani(void) {
 		"  color:    color to paint the sprite as, can not be used with rotation or scale;\n"
 		"            used to paint a given color with this sprite as a 'brush'. Useful for\n"
 		"            colored icons, such as those found in the panel.";
+	krk_defineNative(&GraphicsContext->methods, "rects", _gfx_rects)->doc =
+		"GraphicsContext.rects(rects,color=None,solid=False)\n"
+		"  Draw a list of (x,y,width,height) or (x,y,width,height,color) rectangles in one\n"
+		"  call. Colors may be color objects or ints; color is used for rectangles that\n"
+		"  do not give their own.";
+	krk_defineNative(&GraphicsContext->methods, "lines", _gfx_lines)->doc =
+		"GraphicsContext.lines(lines,color=None,thickness=None)\n"
+		"  Draw a list of (x0,x1,y0,y1) or (x0,x1,y0,y1,color) lines in one call, as\n"
+		"  with line().";
+	krk_defineNative(&GraphicsContext->methods, "points", _gfx_points)->doc =
+		"GraphicsContext.points(points,color=None)\n"
+		"  Blend a list of (x,y) or (x,y,color) points into the context in one call.\n"
+		"  Points outside of the context are skipped.";
+	krk_defineNative(&GraphicsContext->methods, "get_pixels", _gfx_get_pixels)->doc =
+		"GraphicsContext.get_pixels(x=0,y=0,width=None,height=None)\n"
+		"  Copy a region of the backbuffer out as bytes of 32-bit native-endian ARGB\n"
+		"  pixels, row by row. The region is clipped to the context.";
+	krk_defineNative(&GraphicsContext->methods, "put_pixels", _gfx_put_pixels)->doc =
+		"GraphicsContext.put_pixels(x,y,width,height,data)\n"
+		"  Copy bytes in the format returned by get_pixels() into the backbuffer.";
+	krk_defineNative(&GraphicsContext->methods, "pixels", _gfx_pixels)->flags |= KRK_NATIVE_FLAGS_IS_DYNAMIC_PROPERTY;
 	krk_finalizeClass(GraphicsContext);
 
+	/**
+	 * class PixelView():
+	 *     context = GraphicsContext
+	 */
+	PixelView = krk_createClass(module, "PixelView", NULL);
+	PixelView->allocSize = sizeof(struct PixelView);
+	PixelView->docstring = S("GraphicsContext.pixels\n"
+		"  Indexable view of a context's backbuffer. Index with (x,y) or a position in\n"
+		"  row order; pixels are 32-bit ARGB ints.");
+	krk_defineNative(&PixelView->methods, "__getitem__", _pixelview_getitem);
+	krk_defineNative(&PixelView->methods, "__setitem__", _pixelview_setitem);
+	krk_defineNative(&PixelView->methods, "__len__", _pixelview_len);
+	krk_finalizeClass(PixelView);
+
 	/**
 	 * class Window(GraphicsContext):
 	 *     ctx = gfx_context_t *
@@ -1307,6 +1717,9 @@ KrkValue krk_module_onload__yutani(void) {
 	krk_defineNative(&YutaniWindow->methods, "__repr__", _window_repr);
 	krk_defineNative(&YutaniWindow->methods, "__init__", _window_init);
 	krk_defineNative(&YutaniWindow->methods, "flip", _window_flip);
+	krk_defineNative(&YutaniWindow->methods, "flip_region", _window_flip_region)->doc =
+		"Window.flip_region(x,y,width,height)\n"
+		"  Like flip(), but only copies and redraws the given region of the window.";
 	krk_defineNative(&YutaniWindow->methods, "move", _window_move);
 	krk_defineNative(&YutaniWindow->methods, "set_focused", _window_set_focused);
 	krk_defineNative(&YutaniWindow->methods, "close", _window_close);
@@ -1355,6 +1768,10 @@ KrkValue krk_module_onload__yutani(void) {
 	krk_defineNative(&YutaniFont->methods, "draw_string", _font_draw_string)->doc =
 		"Font.draw_string(gfxContext, string, x, y)\n"
 		"  Draw text to a graphics context with this font.";
+	krk_defineNative(&YutaniFont->methods, "draw_strings", _font_draw_strings)->doc =
+		"Font.draw_strings(gfxContext, runs)\n"
+		"  Draw a list of (string,x,y) or (string,x,y,color) runs with this font in one\n"
+		"  call. Returns a list of the widths of each run.";
 	krk_defineNative(&YutaniFont->methods, "width", _font_width)->doc =
 		"Font.width(string)\n"
 		"  Calculate the rendered width of the given string when drawn with this font.";
@@ -1,4 +1,5 @@
 #include <toaru/markup.h>
+#include <toaru/markup_text.h>
 #include <toaru/list.h>
 #include <toaru/graphics.h>
 #include <toaru/text.h>
@@ -7,24 +8,73 @@ static struct TT_Font * dejaVuSans = NULL;
 static struct TT_Font * dejaVuSans_Bold = NULL;
 static struct TT_Font * dejaVuSans_Oblique = NULL;
 static struct TT_Font * dejaVuSans_BoldOblique = NULL;
+static struct TT_Font * dejaVuSansMono = NULL;
+
+#define STATE_BOLD     (1 << 0)
+#define STATE_OBLIQUE  (1 << 1)
+#define STATE_HEADING  (1 << 2)
+#define STATE_SMALL    (1 << 3)
+#define STATE_MONO     (1 << 4)
+#define STATE_COLORED  (1 << 5)
+
+/* Document mode line metrics */
+#define LINE_HEIGHT  20
+#define HEAD_HEIGHT  28
+#define WORD_SPACING 4
+
+/* How far glyphs may reach above and below their baseline */
+#define RUN_ASCENT  28
+#define RUN_DESCENT 8
+
+/**
+ * A positioned piece of text in a single style; the unit
+ * of the display list built by a layout pass.
+ */
+struct markup_run {
+	int x;
+	int top;
+	int baseline;
+	int state;
+	uint32_t color;
+	size_t text;
+};
+
+struct markup_layout {
+	int flags;
+	int width;
+	int height;
+	size_t run_count;
+	size_t run_capacity;
+	struct markup_run * runs;
+	size_t text_size;
+	size_t text_capacity;
+	char * text;
+};
+
+/**
+ * A character waiting to be placed as part of a word,
+ * used when wrapping documents.
+ */
+struct markup_char {
+	char c;
+	int state;
+	uint32_t color;
+};
 
 struct MarkupState {
 	list_t * state;
 	int current_state;
 	int cursor_x;
 	int cursor_y;
-	int initial_left;
 	uint32_t color;
-	gfx_context_t * ctx;
-	int max_cursor_x;
 	list_t * colors;
+	int max_width;
+	markup_layout_t * layout;
+	size_t word_length;
+	size_t word_capacity;
+	struct markup_char * word;
 };
 
-#define STATE_BOLD     (1 << 0)
-#define STATE_OBLIQUE  (1 << 1)
-#define STATE_HEADING  (1 << 2)
-#define STATE_SMALL    (1 << 3)
-
 static void push_state(struct MarkupState * state, int val) {
 	list_insert(state->state, (void*)(uintptr_t)state->current_state);
 	state->current_state |= val;
@@ -32,6 +82,7 @@ static void push_state(struct MarkupState * state, int val) {
 
 static void pop_state(struct MarkupState * state) {
 	node_t * nstate = list_pop(state->state);
+	if (!nstate) return;
 	state->current_state = (int)(uintptr_t)nstate->value;
 	free(nstate);
 }
@@ -46,8 +97,131 @@ static uint32_t parseColor(const char * c) {
 	return rgba(strtoul(r,NULL,16),strtoul(g,NULL,16),strtoul(b,NULL,16),255);
 }
 
+static struct TT_Font * fontForState(int state) {
+	if (state & STATE_MONO) {
+		return dejaVuSansMono;
+	}
+	if (state & STATE_BOLD) {
+		if (state & STATE_OBLIQUE) {
+			return dejaVuSans_BoldOblique;
+		}
+		return dejaVuSans_Bold;
+	} else if (state & STATE_OBLIQUE) {
+		return dejaVuSans_Oblique;
+	}
+	return dejaVuSans;
+}
+
+static int sizeForState(int state) {
+	if (state & STATE_HEADING) return 18;
+	if (state & STATE_SMALL) return 10;
+	return 13;
+}
+
+/**
+ * Documents use larger, bold headings.
+ */
+static int effectiveState(struct MarkupState * state, int style) {
+	if ((state->layout->flags & MARKUP_LAYOUT_DOCUMENT) && (style & STATE_HEADING)) {
+		return style | STATE_BOLD;
+	}
+	return style;
+}
+
+static int effectiveSize(markup_layout_t * layout, int style) {
+	if ((layout->flags & MARKUP_LAYOUT_DOCUMENT) && (style & STATE_HEADING)) return 22;
+	return sizeForState(style);
+}
+
+static int measure(markup_layout_t * layout, int style, const char * text) {
+	struct TT_Font * font = fontForState(style);
+	tt_set_size(font, effectiveSize(layout, style));
+	return tt_string_width(font, text);
+}
+
+static void emit_run(struct MarkupState * state, int style, uint32_t color, const char * text, int width) {
+	markup_layout_t * layout = state->layout;
+
+	size_t len = strlen(text) + 1;
+	if (layout->text_size + len > layout->text_capacity) {
+		while (layout->text_size + len > layout->text_capacity) {
+			layout->text_capacity = layout->text_capacity ? layout->text_capacity * 2 : 256;
+		}
+		layout->text = realloc(layout->text, layout->text_capacity);
+	}
+	memcpy(layout->text + layout->text_size, text, len);
+
+	if (layout->run_count == layout->run_capacity) {
+		layout->run_capacity = layout->run_capacity ? layout->run_capacity * 2 : 16;
+		layout->runs = realloc(layout->runs, sizeof(struct markup_run) * layout->run_capacity);
+	}
+
+	struct markup_run * run = &layout->runs[layout->run_count++];
+	run->x = state->cursor_x;
+	run->top = state->cursor_y;
+	run->baseline = state->cursor_y;
+	if (layout->flags & MARKUP_LAYOUT_DOCUMENT) run->baseline += effectiveSize(layout, style);
+	run->state = style;
+	run->color = color;
+	run->text = layout->text_size;
+	layout->text_size += len;
+
+	state->cursor_x += width;
+	if (state->cursor_x > layout->width) layout->width = state->cursor_x;
+}
+
+static void next_line(struct MarkupState * state) {
+	state->cursor_x = 0;
+	if (state->layout->flags & MARKUP_LAYOUT_DOCUMENT) {
+		state->cursor_y += (state->current_state & STATE_HEADING) ? HEAD_HEIGHT : LINE_HEIGHT;
+	} else {
+		state->cursor_y += LINE_HEIGHT;
+	}
+}
+
+/**
+ * Place the pending word, moving to a new line first if it would not
+ * fit, as one run for each stretch of characters with the same style.
+ */
+static void flush_word(struct MarkupState * state) {
+	if (!state->word_length) return;
+
+	char * tmp = malloc(state->word_length + 1);
+	int width = 0;
+	for (size_t i = 0; i < state->word_length; ) {
+		size_t j = i;
+		while (j < state->word_length && state->word[j].state == state->word[i].state && state->word[j].color == state->word[i].color) {
+			tmp[j-i] = state->word[j].c;
+			j++;
+		}
+		tmp[j-i] = '\0';
+		width += measure(state->layout, state->word[i].state, tmp);
+		i = j;
+	}
+
+	if (state->cursor_x > 0 && state->max_width > 0 && state->cursor_x + width > state->max_width) {
+		next_line(state);
+	}
+
+	for (size_t i = 0; i < state->word_length; ) {
+		size_t j = i;
+		while (j < state->word_length && state->word[j].state == state->word[i].state && state->word[j].color == state->word[i].color) {
+			tmp[j-i] = state->word[j].c;
+			j++;
+		}
+		tmp[j-i] = '\0';
+		emit_run(state, state->word[i].state, state->word[i].color, tmp, measure(state->layout, state->word[i].state, tmp));
+		i = j;
+	}
+
+	free(tmp);
+	state->word_length = 0;
+	state->cursor_x += WORD_SPACING;
+}
+
 static int parser_open(struct markup_state * self, void * user, struct markup_tag * tag) {
 	struct MarkupState * state = (struct MarkupState*)user;
+	int document = state->layout->flags & MARKUP_LAYOUT_DOCUMENT;
 	if (!strcmp(tag->name, "b")) {
 		push_state(state, STATE_BOLD);
 	} else if (!strcmp(tag->name, "i")) {
@@ -56,15 +230,23 @@ static int parser_open(struct markup_state * self, void * user, struct markup_ta
 		push_state(state, STATE_HEADING);
 	} else if (!strcmp(tag->name, "small")) {
 		push_state(state, STATE_SMALL);
+	} else if (!strcmp(tag->name, "mono")) {
+		if (document) {
+			flush_word(state);
+			next_line(state);
+		}
+		push_state(state, STATE_MONO);
 	} else if (!strcmp(tag->name, "br")) {
-		state->cursor_x = state->initial_left;
-		state->cursor_y += 20; /* state->line_height? */
+		if (document) flush_word(state);
+		next_line(state);
 	} else if (!strcmp(tag->name, "color")) {
 		/* get options */
 		list_t * args = hashmap_keys(tag->options);
 		if (args->length == 1) {
 			list_insert(state->colors, (void*)(uintptr_t)state->color);
+			list_insert(state->colors, (void*)(uintptr_t)state->current_state);
 			state->color = parseColor((char*)args->head->value);
+			state->current_state |= STATE_COLORED;
 		}
 		free(args);
 	}
@@ -74,98 +256,196 @@ static int parser_open(struct markup_state * self, void * user, struct markup_ta
 
 static int parser_close(struct markup_state * self, void * user, char * tag_name) {
 	struct MarkupState * state = (struct MarkupState*)user;
+	int document = state->layout->flags & MARKUP_LAYOUT_DOCUMENT;
 	if (!strcmp(tag_name, "b")) {
 		pop_state(state);
 	} else if (!strcmp(tag_name, "i")) {
 		pop_state(state);
 	} else if (!strcmp(tag_name, "h1")) {
+		if (document) {
+			flush_word(state);
+			next_line(state);
+		}
 		pop_state(state);
 	} else if (!strcmp(tag_name, "small")) {
 		pop_state(state);
+	} else if (!strcmp(tag_name, "mono")) {
+		if (document) {
+			flush_word(state);
+			next_line(state);
+		}
+		pop_state(state);
 	} else if (!strcmp(tag_name, "color")) {
+		node_t * nstate = list_pop(state->colors);
 		node_t * ncolor = list_pop(state->colors);
-		state->color = (uint32_t)(uintptr_t)ncolor->value;
+		if (nstate && ncolor) {
+			state->current_state = (state->current_state & ~STATE_COLORED) | ((int)(uintptr_t)nstate->value & STATE_COLORED);
+			state->color = (uint32_t)(uintptr_t)ncolor->value;
+		}
+		free(nstate);
 		free(ncolor);
 	}
 	return 0;
 }
 
-static struct TT_Font * fontForState(struct MarkupState * state) {
-	if (state->current_state & (1 << 0)) {
-		if (state->current_state & (1 << 1)) {
-			return dejaVuSans_BoldOblique;
-		}
-		return dejaVuSans_Bold;
-	} else if (state->current_state & (1 << 1)) {
-		return dejaVuSans_Oblique;
+static void add_char(struct MarkupState * state, char c) {
+	if (state->word_length == state->word_capacity) {
+		state->word_capacity = state->word_capacity ? state->word_capacity * 2 : 32;
+		state->word = realloc(state->word, sizeof(struct markup_char) * state->word_capacity);
 	}
-	return dejaVuSans;
-}
-
-static int sizeForState(struct MarkupState * state) {
-	if (state->current_state & STATE_HEADING) return 18;
-	if (state->current_state & STATE_SMALL) return 10;
-	return 13;
+	state->word[state->word_length].c = c;
+	state->word[state->word_length].state = effectiveState(state, state->current_state);
+	state->word[state->word_length].color = state->color;
+	state->word_length++;
 }
 
 static int parser_data(struct markup_state * self, void * user, char * data) {
 	struct MarkupState * state = (struct MarkupState*)user;
-	struct TT_Font * font = fontForState(state);
-	tt_set_size(font, sizeForState(state));
-	state->cursor_x += tt_draw_string(state->ctx, font, state->cursor_x, state->cursor_y, data, state->color);
-	if (state->cursor_x > state->max_cursor_x) state->max_cursor_x = state->cursor_x;
-	return 0;
-}
 
-static int parser_dryrun(struct markup_state * self, void * user, char * data) {
-	struct MarkupState * state = (struct MarkupState*)user;
-	struct TT_Font * font = fontForState(state);
-	tt_set_size(font, sizeForState(state));
-	state->cursor_x += tt_string_width(font, data);
-	if (state->cursor_x > state->max_cursor_x) state->max_cursor_x = state->cursor_x;
+	if (!(state->layout->flags & MARKUP_LAYOUT_DOCUMENT)) {
+		emit_run(state, state->current_state, state->color, data, measure(state->layout, state->current_state, data));
+		return 0;
+	}
+
+	for (char * c = data; *c; c++) {
+		if (*c == ' ' && !(state->current_state & STATE_MONO)) {
+			flush_word(state);
+		} else if (*c == '\n') {
+			flush_word(state);
+			if (state->current_state & STATE_MONO) {
+				next_line(state);
+			}
+		} else {
+			char chr = *c;
+			if (*c == '&') {
+				if (c[1] == 'l' && c[2] == 't' && c[3] == ';') {
+					c += 3;
+					chr = '<';
+				} else if (c[1] == 'g' && c[2] == 't' && c[3] == ';') {
+					c += 3;
+					chr = '>';
+				}
+			}
+			add_char(state, chr);
+		}
+	}
 	return 0;
 }
 
-int markup_string_width(const char * str) {
-	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create()};
-	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_dryrun);
+markup_layout_t * markup_layout_create(const char * str, int max_width, int flags) {
+	markup_layout_t * layout = calloc(1, sizeof(markup_layout_t));
+	layout->flags = flags;
+
+	struct MarkupState state = {0};
+	state.state = list_create();
+	state.colors = list_create();
+	state.max_width = max_width;
+	state.layout = layout;
+
+	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_data);
 	while (*str) {
 		if (markup_parse(parser, *str++)) {
 			break;
 		}
 	}
 	markup_finish(parser);
+	flush_word(&state);
+
+	layout->height = state.cursor_y;
+
 	list_free(state.state);
+	free(state.state);
 	list_free(state.colors);
-	return state.max_cursor_x - state.initial_left;
+	free(state.colors);
+	free(state.word);
+	return layout;
 }
 
-int markup_string_height(const char * str) {
-	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create()};
-	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_dryrun);
-	while (*str) {
-		if (markup_parse(parser, *str++)) {
-			break;
+void markup_layout_free(markup_layout_t * layout) {
+	if (!layout) return;
+	free(layout->runs);
+	free(layout->text);
+	free(layout);
+}
+
+int markup_layout_width(markup_layout_t * layout) {
+	return layout->width;
+}
+
+int markup_layout_height(markup_layout_t * layout) {
+	return layout->height;
+}
+
+int markup_layout_draw(gfx_context_t * ctx, markup_layout_t * layout, int x, int y, uint32_t color) {
+	/*
+	 * Runs are in line order, so find the first line that can reach the
+	 * top of the context; a baseline is never more than RUN_ASCENT below
+	 * the top of its line.
+	 */
+	size_t lo = 0, hi = layout->run_count;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (y + layout->runs[mid].top + RUN_ASCENT + RUN_DESCENT < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
 	}
-	markup_finish(parser);
-	list_free(state.state);
-	list_free(state.colors);
-	return state.cursor_y;
+
+	for (size_t i = lo; i < layout->run_count; ++i) {
+		struct markup_run * run = &layout->runs[i];
+		if (y + run->top - RUN_ASCENT >= ctx->height) break;
+		if (y + run->baseline + RUN_DESCENT < 0) continue;
+		struct TT_Font * font = fontForState(run->state);
+		tt_set_size(font, effectiveSize(layout, run->state));
+		tt_draw_string(ctx, font, x + run->x, y + run->baseline, layout->text + run->text,
+			(run->state & STATE_COLORED) ? run->color : color);
+	}
+
+	return layout->width;
 }
 
-int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint32_t color) {
-	struct MarkupState state = {list_create(), 0, x, y, x, color, ctx, x, list_create()};
-	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_data);
-	while (*str) {
-		if (markup_parse(parser, *str++)) {
-			break;
+/**
+ * Menus and notifications measure a string and then draw it, often
+ * many times over, so keep the layouts of recently used strings.
+ */
+#define LAYOUT_CACHE_SIZE 32
+
+static struct {
+	char * string;
+	markup_layout_t * layout;
+	unsigned long used;
+} layout_cache[LAYOUT_CACHE_SIZE];
+static unsigned long layout_cache_clock = 0;
+
+static markup_layout_t * layout_for_string(const char * str) {
+	int oldest = 0;
+	for (int i = 0; i < LAYOUT_CACHE_SIZE; ++i) {
+		if (layout_cache[i].string && !strcmp(layout_cache[i].string, str)) {
+			layout_cache[i].used = ++layout_cache_clock;
+			return layout_cache[i].layout;
 		}
+		if (layout_cache[i].used < layout_cache[oldest].used) oldest = i;
 	}
-	markup_finish(parser);
-	list_free(state.state);
-	list_free(state.colors);
-	return state.max_cursor_x - state.initial_left;
+
+	free(layout_cache[oldest].string);
+	markup_layout_free(layout_cache[oldest].layout);
+	layout_cache[oldest].string = strdup(str);
+	layout_cache[oldest].layout = markup_layout_create(str, 0, 0);
+	layout_cache[oldest].used = ++layout_cache_clock;
+	return layout_cache[oldest].layout;
+}
+
+int markup_string_width(const char * str) {
+	return markup_layout_width(layout_for_string(str));
+}
+
+int markup_string_height(const char * str) {
+	return markup_layout_height(layout_for_string(str));
+}
+
+int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint32_t color) {
+	return markup_layout_draw(ctx, layout_for_string(str), x, y, color);
 }
 
 void markup_text_init(void) {
@@ -173,5 +453,6 @@ void markup_text_init(void) {
 	dejaVuSans_Bold        = tt_font_from_shm("sans-serif.bold");
 	dejaVuSans_Oblique     = tt_font_from_shm("sans-serif.italic");
 	dejaVuSans_BoldOblique = tt_font_from_shm("sans-serif.bolditalic");
+	dejaVuSansMono         = tt_font_from_shm("monospace");
 }
 
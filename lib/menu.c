@@ -80,11 +80,7 @@ void _menu_draw_MenuEntry_Normal(gfx_context_t * ctx, struct MenuEntry * self, i
 	/* Icon */
 	if (_self->icon) {
 		sprite_t * icon = icon_get_16(_self->icon);
-		if (icon->width == MENU_ICON_SIZE) {
-			draw_sprite(ctx, icon, 4, offset + 2);
-		} else {
-			draw_sprite_scaled(ctx, icon, 4, offset + 2, MENU_ICON_SIZE, MENU_ICON_SIZE);
-		}
+		draw_sprite(ctx, icon_get_scaled(icon, MENU_ICON_SIZE, MENU_ICON_SIZE), 4, offset + 2);
 	}
 
 	/* Foreground text color */
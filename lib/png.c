@@ -10,6 +10,7 @@
 
 #include <toaru/graphics.h>
 #include <toaru/inflate.h>
+#include <toaru/checksum.h>
 
 /**
  * Read 32-bit big-endian value from file.
@@ -65,7 +66,11 @@ struct png_ctx {
 	int filter;           /* Filter method (must be 0) */
 	int interlace;        /* Interlace method (we only support 0) */
 
+	uint8_t * chunk;      /* Data of the chunk being read */
+	size_t chunk_space;   /* Allocated size of the above */
 	unsigned int size;    /* Remaining IDAT chunk size */
+	unsigned int offset;  /* Offset of the next IDAT byte in chunk */
+	int bad_crc;          /* Whether an IDAT after the first failed its CRC */
 	int sf;               /* Current scanline filter type */
 };
 
@@ -81,6 +86,39 @@ struct png_ctx {
 #define PNG_FILTER_AVG   3
 #define PNG_FILTER_PAETH 4
 
+static unsigned int be32(const uint8_t * p) {
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/**
+ * Read a whole chunk into c->chunk and check its CRC, which covers
+ * the type and the data. Returns 0 if it matched, 1 if it didn't,
+ * or -1 if the file ended (or we ran out of memory) first.
+ */
+static int read_chunk(struct png_ctx * c, unsigned int * type, unsigned int * size) {
+	uint8_t header[8];
+	if (fread(header, 1, 8, c->f) != 8) return -1;
+	*size = be32(header);
+	*type = be32(header + 4);
+
+	/* Chunks are limited to 2^31-1 bytes */
+	if (*size > 0x7FFFFFFF) return -1;
+	if (*size > c->chunk_space) {
+		uint8_t * chunk = realloc(c->chunk, *size);
+		if (!chunk) return -1;
+		c->chunk = chunk;
+		c->chunk_space = *size;
+	}
+
+	uint8_t check[4];
+	if (fread(c->chunk, 1, *size, c->f) != *size) return -1;
+	if (fread(check, 1, 4, c->f) != 4) return -1;
+
+	uint32_t crc = checksum_crc32(CHECKSUM_CRC32_INIT, header + 4, 4);
+	crc = checksum_crc32(crc, c->chunk, *size);
+	return crc != be32(check);
+}
+
 /**
  * Read a byte from the IDAT chunk.
  * Tracks when an IDAT has been read to completion and
@@ -88,34 +126,27 @@ struct png_ctx {
  */
 static uint8_t _get(struct inflate_context * ctx) {
 	struct png_ctx * c = (ctx->input_priv);
-	if (c->size == 0) {
-
-		/* Read the CRC32 from the end of this IDAT */
-		unsigned int check = read_32(c->f);
-		(void)check; /* ... and in theory check it... */
-
-		/* Read the next IDAT chunk header */
-		unsigned int size = read_32(c->f);
-		unsigned int type = read_32(c->f);
-
-		c->size = size;
+	while (c->size == 0) {
+		/* Read the next IDAT chunk */
+		unsigned int size = 0, type = 0;
+		int status = read_chunk(c, &type, &size);
 
-		if (type != PNG_IDAT) {
+		if (status < 0 || type != PNG_IDAT) {
 			/* This isn't an IDAT? That's wrong! */
 			fprintf(stderr, "And this is the wrong type (0x%x), I'm just bailing.\n", type);
 			fprintf(stderr, "size read was 0x%x\n", size);
 			exit(0);
 		}
-	}
 
-	/* Read one byte from the input */
-	c->size--;
-	int i = fgetc(c->f);
+		/* Finish the stream anyway, and fail once it's done */
+		if (status) c->bad_crc = 1;
 
-	/* If this was EOF, we should handle that error case... probably... */
-	if (i < 0) fprintf(stderr, "This is probably not good.\n");
+		c->size = size;
+		c->offset = 0;
+	}
 
-	return i;
+	c->size--;
+	return c->chunk[c->offset++];
 }
 
 /**
@@ -377,6 +408,18 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 		return 1;
 	}
 
+	/* Set up context for future calls to inflate */
+	struct png_ctx c;
+	c.sprite = sprite;
+	c.x = -1;
+	c.y = 0;
+	c.f = f;
+	c.buf_off = 0;
+	c.seen_ihdr = 0;
+	c.chunk = NULL;
+	c.chunk_space = 0;
+	c.bad_crc = 0;
+
 	/* Read the PNG signature */
 	unsigned char sig[] = {137, 80, 78, 71, 13, 10, 26, 10};
 	for (int i = 0; i < 8; ++i) {
@@ -387,46 +430,45 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 		}
 	}
 
-	/* Set up context for future calls to inflate */
-	struct png_ctx c;
-	c.sprite = sprite;
-	c.x = -1;
-	c.y = 0;
-	c.f = f;
-	c.buf_off = 0;
-	c.seen_ihdr = 0;
+	int seen_idat = 0;
 
 	while (1) {
 		/* read chunks */
-		unsigned int size = read_32(f);
-		unsigned int type = read_32(f);
+		unsigned int size, type;
+		int status = read_chunk(&c, &type, &size);
+
+		if (status < 0) break;
 
-		if (feof(f)) break;
+		if (status) {
+			fprintf(stderr, "%s: chunk %.4s is corrupt (CRC mismatch)\n", filename, reorder_type(type));
+			goto _error;
+		}
 
 		switch (type) {
 			case PNG_IHDR:
 				{
 					/* Image should only have one IHDR */
-					if (c.seen_ihdr) return 1;
+					if (c.seen_ihdr) goto _error;
+					if (size < 13) goto _error;
 
 					c.seen_ihdr = 1;
-					c.width = read_32(f); /* 4 */
-					c.height = read_32(f); /* 8 */
-					c.bit_depth = fgetc(f); /* 9 */
-					c.color_type = fgetc(f); /* 10 */
-					c.compression = fgetc(f); /* 11 */
-					c.filter = fgetc(f); /* 12 */
-					c.interlace = fgetc(f); /* 13 */
+					c.width = be32(c.chunk); /* 4 */
+					c.height = be32(c.chunk + 4); /* 8 */
+					c.bit_depth = c.chunk[8]; /* 9 */
+					c.color_type = c.chunk[9]; /* 10 */
+					c.compression = c.chunk[10]; /* 11 */
+					c.filter = c.chunk[11]; /* 12 */
+					c.interlace = c.chunk[12]; /* 13 */
 
 					/* Invalid / non-standard compression and filter types */
-					if (c.compression != 0) return 1;
-					if (c.filter != 0) return 1;
+					if (c.compression != 0) goto _error;
+					if (c.filter != 0) goto _error;
 
 					/* 0 for none, 1 for Adam7 */
-					if (c.interlace != 0 && c.interlace != 1) return 1;
+					if (c.interlace != 0 && c.interlace != 1) goto _error;
 
-					if (c.bit_depth != 8) return 1; /* Sorry */
-					if (c.color_type < 0 || c.color_type > 6 || (c.color_type & 1)) return 1; /* Sorry, no indexed support */
+					if (c.bit_depth != 8) goto _error; /* Sorry */
+					if (c.color_type < 0 || c.color_type > 6 || (c.color_type & 1)) goto _error; /* Sorry, no indexed support */
 
 					/* Allocate space */
 					sprite->width  = c.width;
@@ -435,27 +477,17 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 					sprite->masks = NULL;
 					sprite->alpha = color_type_has_alpha(c.color_type);
 					sprite->blank = 0;
-
-
-					/* Skip */
-					for (unsigned int i = 13; i < size; ++i) fgetc(f);
 				}
 				break;
 
 			case PNG_IDAT:
 				{
-					/* First two bytes of IDAT data are ZLIB header */
-					unsigned int cflags = fgetc(f);
-					if ((cflags & 0xF) != 8) {
-						/* Compression type must be 8 */
-						fprintf(stderr, "Expected flags to be 8 but it's 0x%x\n", cflags);
-						return 1;
-					}
-					unsigned int aflags = fgetc(f);
-					if (aflags & (1 << 5)) {
-						fprintf(stderr, "There are preset bytes and I don't know what to do.\n");
-						return 1;
-					}
+					if (!c.seen_ihdr) goto _error;
+
+					/* The whole image is one ZLIB stream, which may be split
+					 * across several IDATs; the first reads all of them. */
+					if (seen_idat) break;
+					seen_idat = 1;
 
 					struct inflate_context ctx;
 					ctx.input_priv = &c;
@@ -464,14 +496,15 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 					ctx.write_output = _write;
 					ctx.ring = NULL; /* use builtin */
 
-					c.size = size - 2; /* 2 for the bytes we already read */
-
-					deflate_decompress(&ctx);
+					c.size = size;
+					c.offset = 0;
 
-					/* The IDATs contain a ZLIB stream, so they end with an
-					 * adler32 checksum. Skip that. */
-					unsigned int adler = read_32(f);
-					(void)adler;
+					int result = zlib_decompress(&ctx);
+					if (result || c.bad_crc) {
+						fprintf(stderr, "%s: %s\n", filename,
+							(result == 2 || c.bad_crc) ? "image data is corrupt (checksum mismatch)" : "can't decompress image data");
+						goto _error;
+					}
 				}
 				break;
 			case PNG_IEND:
@@ -479,17 +512,14 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 				break;
 			default:
 				/* IHDR must be first */
-				if (!c.seen_ihdr) return 1;
+				if (!c.seen_ihdr) goto _error;
 				//fprintf(stderr, "I don't know what this is! %4s 0x%x\n", reorder_type(type), type);
-				/* Skip */
-				for (unsigned int i = 0; i < size; ++i) fgetc(f);
 				break;
 		}
-
-		unsigned int crc32 = read_32(f);
-		(void)crc32;
 	}
 
+	if (!seen_idat) goto _error;
+
 	/*
 	 * Data in PNGs is unpremultiplied, but our sprites expect
 	 * premultiplied alpha, so convert the image data
@@ -500,9 +530,12 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 		}
 	}
 
+	free(c.chunk);
+	fclose(f);
 	return 0;
 
 _error:
+	free(c.chunk);
 	fclose(f);
 	return 1;
 }
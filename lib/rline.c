@@ -10,6 +10,7 @@
 #define _XOPEN_SOURCE
 #define _DEFAULT_SOURCE
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <ctype.h>
@@ -28,6 +29,7 @@
 #endif
 #ifdef __toaru__
 #include <toaru/rline.h>
+#include <toaru/termbuf.h>
 #else
 #include "rline.h"
 #endif
@@ -230,8 +232,41 @@ int rline_exp_set_tab_complete_func(rline_callback_t func) {
 	return 0;
 }
 
+#ifdef __toaru__
+/**
+ * The line is drawn into a one-row shadow screen so that redrawing
+ * it after each key only sends the cells that actually changed.
+ */
+static termbuf_t * screen = NULL;
+#endif
+
+static int rline_printf(const char * fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int out;
+#ifdef __toaru__
+	if (screen) {
+		out = termbuf_vprintf(screen, fmt, args);
+	} else
+#endif
+	out = vprintf(fmt, args);
+	va_end(args);
+	return out;
+}
+
+static void rline_flush(void) {
+#ifdef __toaru__
+	if (screen) {
+		termbuf_flush(screen);
+		return;
+	}
+#endif
+	fflush(stdout);
+}
+
 static int have_unget = -1;
 static int getch(int timeout) {
+	rline_flush();
 	if (have_unget >= 0) {
 		int out = have_unget;
 		have_unget = -1;
@@ -1248,28 +1283,27 @@ static void recalculate_syntax(line_t * line) {
  * Set colors
  */
 static void set_colors(const char * fg, const char * bg) {
-	printf("\033[22;23;");
+	rline_printf("\033[22;23;");
 	if (*bg == '@') {
 		int _bg = atoi(bg+1);
 		if (_bg < 10) {
-			printf("4%d;", _bg);
+			rline_printf("4%d;", _bg);
 		} else {
-			printf("10%d;", _bg-10);
+			rline_printf("10%d;", _bg-10);
 		}
 	} else {
-		printf("48;%s;", bg);
+		rline_printf("48;%s;", bg);
 	}
 	if (*fg == '@') {
 		int _fg = atoi(fg+1);
 		if (_fg < 10) {
-			printf("3%dm", _fg);
+			rline_printf("3%dm", _fg);
 		} else {
-			printf("9%dm", _fg-10);
+			rline_printf("9%dm", _fg-10);
 		}
 	} else {
-		printf("38;%sm", fg);
+		rline_printf("38;%sm", fg);
 	}
-	fflush(stdout);
 }
 
 /**
@@ -1278,18 +1312,17 @@ static void set_colors(const char * fg, const char * bg) {
  * (See set_colors above)
  */
 static void set_fg_color(const char * fg) {
-	printf("\033[22;23;");
+	rline_printf("\033[22;23;");
 	if (*fg == '@') {
 		int _fg = atoi(fg+1);
 		if (_fg < 10) {
-			printf("3%dm", _fg);
+			rline_printf("3%dm", _fg);
 		} else {
-			printf("9%dm", _fg-10);
+			rline_printf("9%dm", _fg-10);
 		}
 	} else {
-		printf("38;%sm", fg);
+		rline_printf("38;%sm", fg);
 	}
-	fflush(stdout);
 }
 
 void rline_set_colors(rline_style_t style) {
@@ -1326,16 +1359,16 @@ void rline_set_colors(rline_style_t style) {
  * alterations and removal of selection support.
  */
 static void render_line(void) {
-	printf("\033[?25l");
+	rline_printf("\033[?25l");
 	if (show_left_side) {
-		printf("\033[0m\r%s", prompt);
+		rline_printf("\033[0m\r%s", prompt);
 	} else {
-		printf("\033[0m\r$");
+		rline_printf("\033[0m\r$");
 	}
 
 	if (offset && prompt_width_calc) {
 		set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-		printf("\b<");
+		rline_printf("\b<");
 	}
 
 	int i = 0; /* Offset in char_t line data entries */
@@ -1368,7 +1401,7 @@ static void render_line(void) {
 			if (j >= offset) {
 				/* Fill remainder with -'s */
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("-");
+				rline_printf("-");
 				set_colors(COLOR_FG, COLOR_BG);
 			}
 
@@ -1403,12 +1436,12 @@ static void render_line(void) {
 
 				/* If it's wide, draw ---> as needed */
 				while (j - offset < width - prompt_width_calc - 1) {
-					printf("-");
+					rline_printf("-");
 					j++;
 				}
 
 				/* End the line with a > to show it overflows */
-				printf(">");
+				rline_printf(">");
 				set_colors(COLOR_FG, COLOR_BG);
 				j++;
 				break;
@@ -1418,7 +1451,7 @@ static void render_line(void) {
 			const char * color = flag_to_color(c.flags);
 			if (c.flags & FLAG_SELECT) {
 				set_colors(color, COLOR_BG);
-				fprintf(stdout,"\033[7m");
+				rline_printf("\033[7m");
 				was_searching = 1;
 			} else if (c.flags == FLAG_NOTICE) {
 				set_colors(COLOR_SEARCH_FG, COLOR_SEARCH_BG);
@@ -1427,7 +1460,7 @@ static void render_line(void) {
 				set_colors(COLOR_ERROR_FG, COLOR_ERROR_BG);
 				was_searching = 1; /* co-opting this should work... */
 			} else if (was_searching) {
-				fprintf(stdout,"\033[0m");
+				rline_printf("\033[0m");
 				set_colors(color, COLOR_BG);
 				last_color = color;
 			} else if (!last_color || strcmp(color, last_color)) {
@@ -1438,52 +1471,52 @@ static void render_line(void) {
 			/* Render special characters */
 			if (c.codepoint == '\t') {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("»");
+				rline_printf("»");
 				for (int i = 1; i < c.display_width; ++i) {
-					printf("·");
+					rline_printf("·");
 				}
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint < 32) {
 				/* Codepoints under 32 to get converted to ^@ escapes */
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("^%c", '@' + c.codepoint);
+				rline_printf("^%c", '@' + c.codepoint);
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint == 0x7f) {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("^?");
+				rline_printf("^?");
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint > 0x7f && c.codepoint < 0xa0) {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("<%2x>", c.codepoint);
+				rline_printf("<%2x>", c.codepoint);
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.codepoint == 0xa0) {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("_");
+				rline_printf("_");
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.display_width == 8) {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("[U+%04x]", c.codepoint);
+				rline_printf("[U+%04x]", c.codepoint);
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else if (c.display_width == 10) {
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("[U+%06x]", c.codepoint);
+				rline_printf("[U+%06x]", c.codepoint);
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 #if 0
 			} else if (c.codepoint == ' ' && i == line->actual - 1) {
 				/* Special case: space at end of line */
 				set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-				printf("·");
+				rline_printf("·");
 				set_colors(COLOR_FG, COLOR_BG);
 #endif
 			} else if (i > 0 && is_spaces && c.codepoint == ' ' && !(i % 4)) {
 				set_colors(COLOR_ALT_FG, COLOR_BG); /* Normal background so this is more subtle */
-				printf("▏");
+				rline_printf("▏");
 				set_colors(last_color ? last_color : COLOR_FG, COLOR_BG);
 			} else {
 				/* Normal characters get output */
 				char tmp[7]; /* Max six bytes, use 7 to ensure last is always nil */
 				to_eight(c.codepoint, tmp);
-				printf("%s", tmp);
+				rline_printf("%s", tmp);
 			}
 
 			/* Advance the terminal cell offset by the render width of this character */
@@ -1507,21 +1540,20 @@ static void render_line(void) {
 		}
 	}
 
-	printf("\033[0m");
+	rline_printf("\033[0m");
 	set_colors(COLOR_FG, COLOR_BG);
 
 	if (show_right_side && prompt_right_width) {
 		/* Fill to end right hand side */
 		for (; j < width + offset - prompt_width_calc; ++j) {
-			printf(" ");
+			rline_printf(" ");
 		}
 
 		/* Print right hand side */
-		printf("\033[0m%s", prompt_right);
+		rline_printf("\033[0m%s", prompt_right);
 	} else {
-		printf("\033[0K");
+		rline_printf("\033[0K");
 	}
-	fflush(stdout);
 }
 
 /**
@@ -1580,6 +1612,13 @@ static void get_size(void) {
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
 	GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi);
 	rline_terminal_width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+#endif
+#ifdef __toaru__
+	if (!screen) {
+		screen = termbuf_create(stdout, rline_terminal_width, 1, TERMBUF_LINE_MODE);
+	} else if (screen->width != rline_terminal_width) {
+		termbuf_resize(screen, rline_terminal_width, 1);
+	}
 #endif
 	if (rline_terminal_width - prompt_right_width - prompt_width > MINIMUM_SIZE) {
 		show_right_side = 1;
@@ -1625,8 +1664,7 @@ void rline_place_cursor(void) {
 		render_line();
 	}
 
-	printf("\033[?25h\033[%dG", x);
-	fflush(stdout);
+	rline_printf("\033[?25h\033[%dG", x);
 }
 
 /**
@@ -2094,10 +2132,16 @@ static void call_rline_func(rline_callback_t func, rline_context_t * context) {
 	context->requested = 1024;
 
 	/* Reset colors (for tab completion candidates, etc. */
-	printf("\033[0m");
+	rline_printf("\033[0m");
 
-	/* Call the function */
+	/* Call the function; it may print freely */
+#ifdef __toaru__
+	if (screen) termbuf_suspend(screen);
+#endif
 	func(context);
+#ifdef __toaru__
+	if (screen) termbuf_resume(screen);
+#endif
 
 	/* Now convert back */
 	loading = 1;
@@ -2206,8 +2250,7 @@ static int reverse_search(void) {
 			column = 0;
 			rline_place_cursor();
 			set_fg_color(COLOR_ALT_FG);
-			printf("%s", buffer);
-			fflush(stdout);
+			rline_printf("%s", buffer);
 		}
 
 		while ((cin = getch(timeout))) {
@@ -2267,12 +2310,22 @@ static int read_line(void) {
 	int this_buf[20];
 	uint32_t istate = 0;
 
+	/*
+	 * The partial-line marker has to reach the terminal as-is,
+	 * so that it wraps when the cursor wasn't in the first column.
+	 */
+#ifdef __toaru__
+	if (screen) termbuf_suspend(screen);
+#endif
 	/* Let's disable this under Windows... */
 	set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-	fprintf(stdout, "◄\033[0m"); /* TODO: This could be retrieved from an envvar */
+	rline_printf("◄\033[0m"); /* TODO: This could be retrieved from an envvar */
 	for (int i = 0; i < rline_terminal_width - 1; ++i) {
-		fprintf(stdout, " ");
+		rline_printf(" ");
 	}
+#ifdef __toaru__
+	if (screen) termbuf_resume(screen);
+#endif
 
 	if (rline_preload) {
 		char * c = rline_preload;
@@ -2295,8 +2348,9 @@ static int read_line(void) {
 				if (c != '\t') tabbed = 0;
 				if (_INTR && c == _INTR) {
 					set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-					printf("^%c", (int)('@' + c));
-					printf("\033[0m");
+					rline_printf("^%c", (int)('@' + c));
+					rline_printf("\033[0m");
+					rline_flush();
 					loading = 1;
 					the_line->actual = 0;
 					column = 0;
@@ -2314,7 +2368,7 @@ static int read_line(void) {
 						rline_place_cursor();
 						if (!*rline_exit_string) {
 							set_colors(COLOR_ALT_FG, COLOR_ALT_BG);
-							printf("^D\033[0m");
+							rline_printf("^D\033[0m");
 						}
 						return 1;
 					} else { /* Otherwise act like delete */
@@ -2348,7 +2402,7 @@ static int read_line(void) {
 					case 22: /* ^V */
 						/* Don't bother with unicode, just take the next byte */
 						rline_place_cursor();
-						printf("^\b");
+						rline_printf("^\b");
 						insert_char(getc(stdin));
 						break;
 					case 23: /* ^W */
@@ -2365,7 +2419,11 @@ static int read_line(void) {
 						}
 						break;
 					case 12: /* ^L - Repaint the whole screen */
+						rline_flush();
 						printf("\033[2J\033[H");
+#ifdef __toaru__
+						if (screen) termbuf_invalidate(screen);
+#endif
 						render_line();
 						rline_place_cursor();
 						break;
@@ -2436,9 +2494,14 @@ int rline(char * buffer, int buf_size) {
 		rline_exp_load_colorscheme_default();
 	}
 
+#ifdef __toaru__
+	if (screen) termbuf_invalidate(screen);
+#endif
+
 	the_line = line_create();
 	loading = 0;
 	read_line();
+	rline_flush();
 	printf("\r\033[?25h\033[0m\n");
 
 	unsigned int off = 0;
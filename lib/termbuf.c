@@ -0,0 +1,958 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * termbuf - shadow-screen terminal output
+ *
+ * Full-screen terminal applications like bim, and line editors like
+ * rline, tend to repaint far more than actually changes: a whole line
+ * for a keystroke, the status bar for a cursor movement, and so on.
+ * Over a serial console or a slow PTY, that is most of what gets sent.
+ *
+ * Instead of going to the terminal, output is parsed here (a small
+ * subset of what a VT100-style terminal understands) into a grid of
+ * cells. When the application is done with a frame, we compare that
+ * grid against what we know the terminal is showing and send only
+ * cursor movement, attribute changes and text for cells that differ,
+ * all in one write().
+ *
+ * Sequences that do not affect what is on screen - mode switches,
+ * title changes, mouse reporting - are passed straight through.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+
+#include <toaru/termbuf.h>
+
+#define STATE_GROUND   0
+#define STATE_ESC      1
+#define STATE_CSI      2
+#define STATE_OSC      3
+#define STATE_OSC_ESC  4
+#define STATE_CHARSET  5
+
+/* Attributes that show up even on blank cells */
+#define VISIBLE_ON_BLANK (TERMBUF_UNDERLINE | TERMBUF_INVERSE)
+
+#define CELL(grid,x,y) ((grid)[(y) * tb->width + (x)])
+
+static const termbuf_cell_t default_pen = {' ', TERMBUF_COLOR_DEFAULT, TERMBUF_COLOR_DEFAULT, 0, 1};
+
+/**
+ * Queue bytes for the next write.
+ */
+static void out_bytes(termbuf_t * tb, const char * data, size_t len) {
+	if (tb->out_len + len > tb->out_size) {
+		while (tb->out_len + len > tb->out_size) {
+			tb->out_size = tb->out_size ? tb->out_size * 2 : 4096;
+		}
+		tb->out = realloc(tb->out, tb->out_size);
+	}
+	memcpy(tb->out + tb->out_len, data, len);
+	tb->out_len += len;
+}
+
+static void out_fmt(termbuf_t * tb, const char * fmt, ...) {
+	char tmp[64];
+	va_list args;
+	va_start(args, fmt);
+	int len = vsnprintf(tmp, sizeof(tmp), fmt, args);
+	va_end(args);
+	if (len > 0) out_bytes(tb, tmp, len);
+}
+
+static void out_codepoint(termbuf_t * tb, uint32_t c) {
+	char tmp[4];
+	int len;
+	if (c < 0x80) {
+		tmp[0] = c;
+		len = 1;
+	} else if (c < 0x800) {
+		tmp[0] = 0xC0 | (c >> 6);
+		tmp[1] = 0x80 | (c & 0x3F);
+		len = 2;
+	} else if (c < 0x10000) {
+		tmp[0] = 0xE0 | (c >> 12);
+		tmp[1] = 0x80 | ((c >> 6) & 0x3F);
+		tmp[2] = 0x80 | (c & 0x3F);
+		len = 3;
+	} else {
+		tmp[0] = 0xF0 | (c >> 18);
+		tmp[1] = 0x80 | ((c >> 12) & 0x3F);
+		tmp[2] = 0x80 | ((c >> 6) & 0x3F);
+		tmp[3] = 0x80 | (c & 0x3F);
+		len = 4;
+	}
+	out_bytes(tb, tmp, len);
+}
+
+static termbuf_cell_t blank_with(termbuf_cell_t pen) {
+	termbuf_cell_t cell = {' ', pen.fg, pen.bg, 0, 1};
+	return cell;
+}
+
+static int is_blank(const termbuf_cell_t * c) {
+	return c->codepoint == ' ' && !(c->attr & VISIBLE_ON_BLANK);
+}
+
+/**
+ * Do two cells look the same? Blanks only need to agree on
+ * their background.
+ */
+static int cell_same(const termbuf_cell_t * a, const termbuf_cell_t * b) {
+	if (is_blank(a) && is_blank(b)) return a->bg == b->bg;
+	return a->codepoint == b->codepoint && a->width == b->width &&
+		a->fg == b->fg && a->bg == b->bg && a->attr == b->attr;
+}
+
+static void fill_grid(termbuf_t * tb, termbuf_cell_t * grid, termbuf_cell_t cell) {
+	for (int i = 0; i < tb->width * tb->height; ++i) grid[i] = cell;
+}
+
+/**
+ * Before overwriting cells [x, x+w) of a row, blank out the
+ * other half of any wide character they would split.
+ */
+static void split_wide(termbuf_t * tb, termbuf_cell_t * grid, int x, int y, int w) {
+	if (x > 0 && x < tb->width && CELL(grid,x,y).width == 0) {
+		CELL(grid,x-1,y) = blank_with(CELL(grid,x-1,y));
+	}
+	int end = x + w - 1;
+	if (end >= 0 && end < tb->width - 1 && CELL(grid,end,y).width == 2) {
+		CELL(grid,end+1,y) = blank_with(CELL(grid,end+1,y));
+	}
+}
+
+/**
+ * Move rows [top, bottom) of a grid by amount (positive is up),
+ * filling the rows that come in with blanks.
+ */
+static void shift_rows(termbuf_t * tb, termbuf_cell_t * grid, int top, int bottom, int amount) {
+	int n = amount > 0 ? amount : -amount;
+	int rows = bottom - top;
+	size_t row_size = sizeof(termbuf_cell_t) * tb->width;
+	if (n < rows) {
+		if (amount > 0) {
+			memmove(&CELL(grid,0,top), &CELL(grid,0,top+n), row_size * (rows - n));
+		} else {
+			memmove(&CELL(grid,0,top+n), &CELL(grid,0,top), row_size * (rows - n));
+		}
+	} else {
+		n = rows;
+	}
+	int start = amount > 0 ? bottom - n : top;
+	for (int y = start; y < start + n; ++y) {
+		for (int x = 0; x < tb->width; ++x) {
+			CELL(grid,x,y) = default_pen;
+		}
+	}
+}
+
+static void erase(termbuf_t * tb, int y, int from, int to) {
+	if (y < 0 || y >= tb->height) return;
+	if (from < 0) from = 0;
+	if (to > tb->width) to = tb->width;
+	if (from >= to) return;
+	split_wide(tb, tb->next, from, y, to - from);
+	for (int x = from; x < to; ++x) {
+		CELL(tb->next,x,y) = blank_with(tb->pen);
+	}
+	tb->dirty = 1;
+}
+
+static void put_codepoint(termbuf_t * tb, uint32_t c) {
+	int w = wcwidth(c);
+	if (w < 1) return; /* Combining characters are not tracked */
+	if (w > 2) w = 2;
+	if (tb->y < 0 || tb->y >= tb->height) return;
+	if (tb->x + w > tb->width) {
+		/* We don't wrap; applications here always position explicitly */
+		tb->x = tb->width;
+		return;
+	}
+
+	split_wide(tb, tb->next, tb->x, tb->y, w);
+
+	termbuf_cell_t cell = tb->pen;
+	cell.codepoint = c;
+	cell.width = w;
+	CELL(tb->next,tb->x,tb->y) = cell;
+	if (w == 2) {
+		cell.codepoint = 0;
+		cell.width = 0;
+		CELL(tb->next,tb->x+1,tb->y) = cell;
+	}
+	tb->x += w;
+	tb->dirty = 1;
+}
+
+static void clamp_cursor(termbuf_t * tb) {
+	if (tb->x < 0) tb->x = 0;
+	if (tb->x > tb->width) tb->x = tb->width;
+	if (tb->y < 0) tb->y = 0;
+	if (tb->y >= tb->height) tb->y = tb->height - 1;
+}
+
+/**
+ * Parse the numeric arguments of a CSI sequence.
+ */
+static int parse_args(const char * seq, int * args, int max) {
+	int count = 0;
+	int value = 0;
+	int have = 0;
+	for (const char * c = seq; *c; ++c) {
+		if (*c >= '0' && *c <= '9') {
+			value = value * 10 + (*c - '0');
+			have = 1;
+		} else if (*c == ';' || *c == ':') {
+			if (count < max) args[count++] = have ? value : -1;
+			value = 0;
+			have = 0;
+		}
+	}
+	if (count < max) args[count++] = have ? value : -1;
+	return count;
+}
+
+static uint32_t extended_color(int * args, int count, int * i) {
+	if (*i + 1 < count && args[*i+1] == 5 && *i + 2 < count) {
+		uint32_t out = TERMBUF_COLOR_INDEX(args[*i+2]);
+		*i += 2;
+		return out;
+	}
+	if (*i + 1 < count && args[*i+1] == 2 && *i + 4 < count) {
+		uint32_t out = TERMBUF_COLOR_RGB(args[*i+2], args[*i+3], args[*i+4]);
+		*i += 4;
+		return out;
+	}
+	return TERMBUF_COLOR_DEFAULT;
+}
+
+static void handle_sgr(termbuf_t * tb, int * args, int count) {
+	for (int i = 0; i < count; ++i) {
+		int a = args[i] < 0 ? 0 : args[i];
+		if (a == 0) {
+			tb->pen = default_pen;
+		} else if (a == 1) {
+			tb->pen.attr |= TERMBUF_BOLD;
+		} else if (a == 3) {
+			tb->pen.attr |= TERMBUF_ITALIC;
+		} else if (a == 4) {
+			tb->pen.attr |= TERMBUF_UNDERLINE;
+		} else if (a == 7) {
+			tb->pen.attr |= TERMBUF_INVERSE;
+		} else if (a == 22) {
+			tb->pen.attr &= ~TERMBUF_BOLD;
+		} else if (a == 23) {
+			tb->pen.attr &= ~TERMBUF_ITALIC;
+		} else if (a == 24) {
+			tb->pen.attr &= ~TERMBUF_UNDERLINE;
+		} else if (a == 27) {
+			tb->pen.attr &= ~TERMBUF_INVERSE;
+		} else if (a >= 30 && a <= 37) {
+			tb->pen.fg = TERMBUF_COLOR_INDEX(a - 30);
+		} else if (a == 38) {
+			tb->pen.fg = extended_color(args, count, &i);
+		} else if (a == 39) {
+			tb->pen.fg = TERMBUF_COLOR_DEFAULT;
+		} else if (a >= 40 && a <= 47) {
+			tb->pen.bg = TERMBUF_COLOR_INDEX(a - 40);
+		} else if (a == 48) {
+			tb->pen.bg = extended_color(args, count, &i);
+		} else if (a == 49) {
+			tb->pen.bg = TERMBUF_COLOR_DEFAULT;
+		} else if (a >= 90 && a <= 97) {
+			tb->pen.fg = TERMBUF_COLOR_INDEX(a - 90 + 8);
+		} else if (a >= 100 && a <= 107) {
+			tb->pen.bg = TERMBUF_COLOR_INDEX(a - 100 + 8);
+		}
+	}
+}
+
+/**
+ * Private modes: only the cursor is ours to track. Switching
+ * screens changes everything the terminal shows.
+ */
+static void handle_private(termbuf_t * tb, char final) {
+	int args[16];
+	int count = parse_args(tb->seq + 1, args, 16);
+	int passthrough = 0;
+	for (int i = 0; i < count; ++i) {
+		if (args[i] == 25) {
+			tb->cursor_visible = (final == 'h');
+		} else {
+			passthrough = 1;
+			if (args[i] == 47 || args[i] == 1047 || args[i] == 1049) {
+				tb->valid = 0;
+			}
+		}
+	}
+	if (passthrough) {
+		out_bytes(tb, "\033[", 2);
+		out_bytes(tb, tb->seq, tb->seq_len);
+		out_bytes(tb, &final, 1);
+	}
+}
+
+static void handle_csi(termbuf_t * tb, char final) {
+	if (tb->seq[0] == '?') {
+		if (final == 'h' || final == 'l') {
+			handle_private(tb, final);
+			return;
+		}
+		goto _unknown;
+	}
+	if (tb->seq[0] == '<' || tb->seq[0] == '=' || tb->seq[0] == '>') goto _unknown;
+
+	int args[32];
+	int count = parse_args(tb->seq, args, 32);
+	int n = args[0] < 1 ? 1 : args[0];
+
+	switch (final) {
+		case 'H':
+		case 'f':
+			if (!(tb->flags & TERMBUF_LINE_MODE)) tb->y = n - 1;
+			tb->x = (count > 1 && args[1] > 0) ? args[1] - 1 : 0;
+			break;
+		case 'G':
+			tb->x = n - 1;
+			break;
+		case 'd':
+			if (!(tb->flags & TERMBUF_LINE_MODE)) tb->y = n - 1;
+			break;
+		case 'A':
+			tb->y -= n;
+			break;
+		case 'B':
+			tb->y += n;
+			break;
+		case 'C':
+			tb->x += n;
+			break;
+		case 'D':
+			tb->x -= n;
+			break;
+		case 'J': {
+			int mode = args[0] < 0 ? 0 : args[0];
+			if (mode == 0) {
+				erase(tb, tb->y, tb->x, tb->width);
+				for (int y = tb->y + 1; y < tb->height; ++y) erase(tb, y, 0, tb->width);
+			} else if (mode == 1) {
+				for (int y = 0; y < tb->y; ++y) erase(tb, y, 0, tb->width);
+				erase(tb, tb->y, 0, tb->x + 1);
+			} else {
+				for (int y = 0; y < tb->height; ++y) erase(tb, y, 0, tb->width);
+			}
+			break;
+		}
+		case 'K': {
+			int mode = args[0] < 0 ? 0 : args[0];
+			if (mode == 0) erase(tb, tb->y, tb->x, tb->width);
+			else if (mode == 1) erase(tb, tb->y, 0, tb->x + 1);
+			else erase(tb, tb->y, 0, tb->width);
+			break;
+		}
+		case 'X':
+			erase(tb, tb->y, tb->x, tb->x + n);
+			break;
+		case 'm':
+			handle_sgr(tb, args, count);
+			break;
+		case 'S':
+			termbuf_scroll(tb, tb->scroll_top, tb->scroll_bottom, n);
+			break;
+		case 'T':
+			termbuf_scroll(tb, tb->scroll_top, tb->scroll_bottom, -n);
+			break;
+		case 'L':
+			if (tb->y >= tb->scroll_top && tb->y < tb->scroll_bottom) {
+				termbuf_scroll(tb, tb->y, tb->scroll_bottom, -n);
+			}
+			break;
+		case 'M':
+			if (tb->y >= tb->scroll_top && tb->y < tb->scroll_bottom) {
+				termbuf_scroll(tb, tb->y, tb->scroll_bottom, n);
+			}
+			break;
+		case 'r':
+			tb->scroll_top = (args[0] > 0) ? args[0] - 1 : 0;
+			tb->scroll_bottom = (count > 1 && args[1] > 0) ? args[1] : tb->height;
+			if (tb->scroll_bottom > tb->height) tb->scroll_bottom = tb->height;
+			if (tb->scroll_top >= tb->scroll_bottom) {
+				tb->scroll_top = 0;
+				tb->scroll_bottom = tb->height;
+			}
+			tb->x = 0;
+			tb->y = 0;
+			break;
+		case 's':
+			tb->saved_x = tb->x;
+			tb->saved_y = tb->y;
+			break;
+		case 'u':
+			tb->x = tb->saved_x;
+			tb->y = tb->saved_y;
+			break;
+		default:
+			goto _unknown;
+	}
+	clamp_cursor(tb);
+	return;
+
+_unknown:
+	/* We don't know what this does to the screen, so assume the worst */
+	out_bytes(tb, "\033[", 2);
+	out_bytes(tb, tb->seq, tb->seq_len);
+	out_bytes(tb, &final, 1);
+	tb->valid = 0;
+	tb->term_x = -1;
+	tb->term_y = -1;
+}
+
+static void handle_control(termbuf_t * tb, unsigned char c) {
+	switch (c) {
+		case '\r':
+			tb->x = 0;
+			break;
+		case '\n':
+			if (tb->flags & TERMBUF_LINE_MODE) {
+				/* We have left our line; whatever comes next starts fresh */
+				termbuf_flush(tb);
+				out_bytes(tb, "\n", 1);
+				tb->valid = 0;
+				tb->x = 0;
+			} else if (tb->y == tb->scroll_bottom - 1) {
+				termbuf_scroll(tb, tb->scroll_top, tb->scroll_bottom, 1);
+			} else if (tb->y < tb->height - 1) {
+				tb->y++;
+			}
+			break;
+		case '\b':
+			if (tb->x > 0) tb->x--;
+			break;
+		case '\t':
+			tb->x = (tb->x + 8) & ~7;
+			if (tb->x > tb->width - 1) tb->x = tb->width - 1;
+			break;
+		case '\a':
+			out_bytes(tb, "\a", 1);
+			break;
+		default:
+			break;
+	}
+}
+
+static void feed(termbuf_t * tb, unsigned char c) {
+	switch (tb->state) {
+		case STATE_GROUND:
+			if (tb->utf8_state) {
+				if ((c & 0xC0) == 0x80) {
+					tb->utf8_codepoint = (tb->utf8_codepoint << 6) | (c & 0x3F);
+					if (--tb->utf8_state == 0) put_codepoint(tb, tb->utf8_codepoint);
+					return;
+				}
+				/* Invalid sequence; drop what we had and reprocess this byte */
+				tb->utf8_state = 0;
+				put_codepoint(tb, 0xFFFD);
+			}
+			if (c == '\033') {
+				tb->state = STATE_ESC;
+				tb->seq_len = 0;
+			} else if (c < 0x20 || c == 0x7F) {
+				handle_control(tb, c);
+			} else if (c < 0x80) {
+				put_codepoint(tb, c);
+			} else if ((c & 0xE0) == 0xC0) {
+				tb->utf8_codepoint = c & 0x1F;
+				tb->utf8_state = 1;
+			} else if ((c & 0xF0) == 0xE0) {
+				tb->utf8_codepoint = c & 0x0F;
+				tb->utf8_state = 2;
+			} else if ((c & 0xF8) == 0xF0) {
+				tb->utf8_codepoint = c & 0x07;
+				tb->utf8_state = 3;
+			} else {
+				put_codepoint(tb, 0xFFFD);
+			}
+			break;
+
+		case STATE_ESC:
+			if (c == '[') {
+				tb->state = STATE_CSI;
+			} else if (c == ']') {
+				out_bytes(tb, "\033]", 2);
+				tb->state = STATE_OSC;
+			} else if (c == '(' || c == ')') {
+				out_bytes(tb, "\033", 1);
+				out_bytes(tb, (char *)&c, 1);
+				tb->state = STATE_CHARSET;
+			} else if (c == '7') {
+				tb->saved_x = tb->x;
+				tb->saved_y = tb->y;
+				tb->state = STATE_GROUND;
+			} else if (c == '8') {
+				tb->x = tb->saved_x;
+				tb->y = tb->saved_y;
+				tb->state = STATE_GROUND;
+			} else {
+				out_bytes(tb, "\033", 1);
+				out_bytes(tb, (char *)&c, 1);
+				if (c == 'c') tb->valid = 0;
+				tb->state = STATE_GROUND;
+			}
+			break;
+
+		case STATE_CSI:
+			if (c >= 0x40 && c <= 0x7E) {
+				tb->seq[tb->seq_len] = '\0';
+				tb->state = STATE_GROUND;
+				handle_csi(tb, c);
+			} else if (tb->seq_len < (int)sizeof(tb->seq) - 1) {
+				tb->seq[tb->seq_len++] = c;
+			}
+			break;
+
+		case STATE_OSC:
+			out_bytes(tb, (char *)&c, 1);
+			if (c == '\a') tb->state = STATE_GROUND;
+			else if (c == '\033') tb->state = STATE_OSC_ESC;
+			break;
+
+		case STATE_OSC_ESC:
+			out_bytes(tb, (char *)&c, 1);
+			tb->state = (c == '\\') ? STATE_GROUND : STATE_OSC;
+			break;
+
+		case STATE_CHARSET:
+			out_bytes(tb, (char *)&c, 1);
+			tb->state = STATE_GROUND;
+			break;
+	}
+}
+
+/**
+ * Emit an SGR sequence so the terminal draws with @p cell's attributes.
+ */
+static void set_pen(termbuf_t * tb, const termbuf_cell_t * cell) {
+	termbuf_cell_t * t = &tb->term_pen;
+
+	if (tb->term_pen_valid) {
+		if (is_blank(cell) && !(t->attr & VISIBLE_ON_BLANK) && t->bg == cell->bg) return;
+		if (t->fg == cell->fg && t->bg == cell->bg && t->attr == cell->attr) return;
+	}
+
+	char tmp[64];
+	char * o = tmp;
+	o += sprintf(o, "\033[");
+
+	if (!tb->term_pen_valid || (t->attr & ~cell->attr)) {
+		/* Easier to start over than to turn things off individually */
+		o += sprintf(o, "0;");
+		*t = default_pen;
+	}
+
+	uint8_t add = cell->attr & ~t->attr;
+	if (add & TERMBUF_BOLD)      o += sprintf(o, "1;");
+	if (add & TERMBUF_ITALIC)    o += sprintf(o, "3;");
+	if (add & TERMBUF_UNDERLINE) o += sprintf(o, "4;");
+	if (add & TERMBUF_INVERSE)   o += sprintf(o, "7;");
+
+	if (cell->fg != t->fg) {
+		if (cell->fg == TERMBUF_COLOR_DEFAULT) {
+			o += sprintf(o, "39;");
+		} else if (cell->fg & 0x02000000) {
+			o += sprintf(o, "38;2;%d;%d;%d;", (cell->fg >> 16) & 0xFF, (cell->fg >> 8) & 0xFF, cell->fg & 0xFF);
+		} else if ((cell->fg & 0xFF) < 8) {
+			o += sprintf(o, "3%d;", cell->fg & 0xFF);
+		} else if ((cell->fg & 0xFF) < 16) {
+			o += sprintf(o, "9%d;", (cell->fg & 0xFF) - 8);
+		} else {
+			o += sprintf(o, "38;5;%d;", cell->fg & 0xFF);
+		}
+	}
+
+	if (cell->bg != t->bg) {
+		if (cell->bg == TERMBUF_COLOR_DEFAULT) {
+			o += sprintf(o, "49;");
+		} else if (cell->bg & 0x02000000) {
+			o += sprintf(o, "48;2;%d;%d;%d;", (cell->bg >> 16) & 0xFF, (cell->bg >> 8) & 0xFF, cell->bg & 0xFF);
+		} else if ((cell->bg & 0xFF) < 8) {
+			o += sprintf(o, "4%d;", cell->bg & 0xFF);
+		} else if ((cell->bg & 0xFF) < 16) {
+			o += sprintf(o, "10%d;", (cell->bg & 0xFF) - 8);
+		} else {
+			o += sprintf(o, "48;5;%d;", cell->bg & 0xFF);
+		}
+	}
+
+	/* Replace the trailing ; with the terminator */
+	o[-1] = 'm';
+	out_bytes(tb, tmp, o - tmp);
+
+	t->fg = cell->fg;
+	t->bg = cell->bg;
+	t->attr = cell->attr;
+	tb->term_pen_valid = 1;
+}
+
+/**
+ * Move the terminal cursor with the shortest sequence we can.
+ */
+static void move_to(termbuf_t * tb, int x, int y) {
+	if (tb->flags & TERMBUF_LINE_MODE) y = 0;
+	if (tb->term_x == x && tb->term_y == y) return;
+
+	if (tb->term_y == y && tb->term_x >= 0) {
+		int d = x - tb->term_x;
+		if (x == 0) out_bytes(tb, "\r", 1);
+		else if (d == -1) out_bytes(tb, "\b", 1);
+		else if (d > 0) out_fmt(tb, d == 1 ? "\033[C" : "\033[%dC", d);
+		else out_fmt(tb, "\033[%dD", -d);
+	} else if (tb->flags & TERMBUF_LINE_MODE) {
+		if (x == 0) out_bytes(tb, "\r", 1);
+		else out_fmt(tb, "\033[%dG", x + 1);
+	} else if (x == 0 && tb->term_y >= 0 && y == tb->term_y + 1) {
+		out_bytes(tb, "\r\n", 2);
+	} else if (x == 0) {
+		out_fmt(tb, "\033[%dH", y + 1);
+	} else {
+		out_fmt(tb, "\033[%d;%dH", y + 1, x + 1);
+	}
+
+	tb->term_x = x;
+	tb->term_y = y;
+}
+
+static void hide_for_update(termbuf_t * tb) {
+	if (tb->term_cursor_visible != 0) {
+		out_bytes(tb, "\033[?25l", 6);
+		tb->term_cursor_visible = 0;
+	}
+}
+
+/**
+ * Draw one cell and note that the terminal now shows it.
+ */
+static void draw_cell(termbuf_t * tb, int x, int y) {
+	termbuf_cell_t * cell = &CELL(tb->next,x,y);
+	set_pen(tb, cell);
+	out_codepoint(tb, cell->codepoint);
+	CELL(tb->screen,x,y) = *cell;
+	if (cell->width == 2) CELL(tb->screen,x+1,y) = CELL(tb->next,x+1,y);
+	tb->term_x += cell->width;
+	if (tb->term_x >= tb->width) {
+		/* Terminals disagree on where the cursor is after the last column */
+		tb->term_x = -1;
+		tb->term_y = -1;
+	}
+}
+
+/**
+ * Bring one row of the terminal in line with what was drawn.
+ */
+static void update_row(termbuf_t * tb, int y) {
+	termbuf_cell_t * want = &CELL(tb->next,0,y);
+	termbuf_cell_t * have = &CELL(tb->screen,0,y);
+
+	int first = 0;
+	while (first < tb->width && cell_same(&want[first], &have[first])) first++;
+	if (first == tb->width) return;
+
+	hide_for_update(tb);
+
+	/*
+	 * If the row ends in blanks that can be produced by erasing,
+	 * and enough of them changed, erase them instead of writing them.
+	 */
+	int tail = tb->width;
+	while (tail > 0 && is_blank(&want[tail-1]) && want[tail-1].bg == want[tb->width-1].bg) tail--;
+	int erase_tail = 0;
+	if (tail < tb->width && (want[tail].bg == TERMBUF_COLOR_DEFAULT || (tb->flags & TERMBUF_BCE))) {
+		int changed = 0;
+		for (int x = tail; x < tb->width; ++x) {
+			if (!cell_same(&want[x], &have[x])) changed++;
+		}
+		erase_tail = changed > 3;
+	}
+	int limit = erase_tail ? tail : tb->width;
+
+	for (int x = first; x < limit; ) {
+		if (cell_same(&want[x], &have[x])) {
+			x++;
+			continue;
+		}
+		if (want[x].width == 0 && x > 0) x--;
+
+		move_to(tb, x, y);
+		draw_cell(tb, x, y);
+		x += want[x].width ? want[x].width : 1;
+
+		/*
+		 * Rewriting a short run of unchanged cells is cheaper than
+		 * moving over it, as long as it doesn't need a new pen.
+		 */
+		int next = x;
+		while (next < limit && next - x <= 4 && cell_same(&want[next], &have[next])) next++;
+		if (next < limit && next > x && next - x <= 4 && tb->term_x == x) {
+			int cheap = 1;
+			for (int i = x; i < next; ++i) {
+				if (want[i].width != 1 || want[i].codepoint >= 0x80 ||
+					want[i].fg != tb->term_pen.fg || want[i].bg != tb->term_pen.bg || want[i].attr != tb->term_pen.attr) {
+					cheap = 0;
+					break;
+				}
+			}
+			if (cheap) {
+				for (int i = x; i < next; ++i) draw_cell(tb, i, y);
+				x = next;
+			}
+		}
+	}
+
+	if (erase_tail) {
+		move_to(tb, tail, y);
+		termbuf_cell_t pen = want[tail];
+		if (tb->term_pen_valid && tb->term_pen.bg == pen.bg && !(tb->term_pen.attr & VISIBLE_ON_BLANK)) {
+			/* Current pen erases the same way */
+		} else {
+			set_pen(tb, &pen);
+		}
+		out_bytes(tb, "\033[K", 3);
+		for (int x = tail; x < tb->width; ++x) have[x] = want[x];
+	}
+}
+
+termbuf_t * termbuf_create(FILE * stream, int width, int height, int flags) {
+	termbuf_t * tb = calloc(1, sizeof(termbuf_t));
+	tb->stream = stream;
+	tb->flags = flags;
+	if (flags & TERMBUF_LINE_MODE) height = 1;
+	tb->cursor_visible = 1;
+	tb->pen = default_pen;
+	termbuf_resize(tb, width, height);
+	return tb;
+}
+
+void termbuf_free(termbuf_t * tb) {
+	free(tb->screen);
+	free(tb->next);
+	free(tb->out);
+	free(tb);
+}
+
+void termbuf_resize(termbuf_t * tb, int width, int height) {
+	if (width < 1) width = 1;
+	if (height < 1 || (tb->flags & TERMBUF_LINE_MODE)) height = 1;
+
+	if (width != tb->width || height != tb->height || !tb->next) {
+		termbuf_cell_t * next = malloc(sizeof(termbuf_cell_t) * width * height);
+		for (int i = 0; i < width * height; ++i) next[i] = default_pen;
+
+		/* Keep what was drawn so far where it still fits */
+		if (tb->next) {
+			for (int y = 0; y < height && y < tb->height; ++y) {
+				for (int x = 0; x < width && x < tb->width; ++x) {
+					next[y * width + x] = tb->next[y * tb->width + x];
+				}
+			}
+		}
+
+		free(tb->next);
+		free(tb->screen);
+		tb->next = next;
+		tb->screen = malloc(sizeof(termbuf_cell_t) * width * height);
+		tb->width = width;
+		tb->height = height;
+	}
+
+	tb->scroll_top = 0;
+	tb->scroll_bottom = height;
+	clamp_cursor(tb);
+	termbuf_invalidate(tb);
+}
+
+void termbuf_write(termbuf_t * tb, const char * data, size_t len) {
+	if (tb->suspended) {
+		/* Send it as-is, but keep track of what the application drew */
+		fwrite(data, 1, len, tb->stream);
+	}
+	for (size_t i = 0; i < len; ++i) {
+		feed(tb, (unsigned char)data[i]);
+	}
+	if (tb->suspended) tb->out_len = 0;
+}
+
+int termbuf_vprintf(termbuf_t * tb, const char * fmt, va_list args) {
+	char tmp[512];
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(tmp, sizeof(tmp), fmt, copy);
+	va_end(copy);
+	if (len < 0) return len;
+	if ((size_t)len < sizeof(tmp)) {
+		termbuf_write(tb, tmp, len);
+	} else {
+		char * big = malloc(len + 1);
+		vsnprintf(big, len + 1, fmt, args);
+		termbuf_write(tb, big, len);
+		free(big);
+	}
+	return len;
+}
+
+int termbuf_printf(termbuf_t * tb, const char * fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	int out = termbuf_vprintf(tb, fmt, args);
+	va_end(args);
+	return out;
+}
+
+/**
+ * Scroll rows [top, bottom) by amount; positive moves text up.
+ *
+ * The terminal is told to do the same thing - with a plain scroll for
+ * the whole screen, or a delete-lines / insert-lines pair for part of
+ * it, which works on terminals that can't set a scrolling region - so
+ * the rows that stay on screen are never resent.
+ */
+void termbuf_scroll(termbuf_t * tb, int top, int bottom, int amount) {
+	if (top < 0) top = 0;
+	if (bottom > tb->height) bottom = tb->height;
+	if (top >= bottom || !amount) return;
+
+	int n = amount > 0 ? amount : -amount;
+	if (n > bottom - top) n = bottom - top;
+
+	shift_rows(tb, tb->next, top, bottom, amount);
+	tb->dirty = 1;
+
+	if (!tb->valid || (tb->flags & TERMBUF_LINE_MODE)) return;
+
+	hide_for_update(tb);
+
+	/* Lines come in with the current background, so make that the default */
+	if (!tb->term_pen_valid || tb->term_pen.bg != TERMBUF_COLOR_DEFAULT || tb->term_pen.attr) {
+		out_bytes(tb, "\033[0m", 4);
+		tb->term_pen = default_pen;
+		tb->term_pen_valid = 1;
+	}
+
+	if (top == 0 && bottom == tb->height) {
+		out_fmt(tb, amount > 0 ? "\033[%dS" : "\033[%dT", n);
+	} else if (amount > 0) {
+		out_fmt(tb, "\033[%dH\033[%dM", top + 1, n);
+		if (bottom < tb->height) out_fmt(tb, "\033[%dH\033[%dL", bottom - n + 1, n);
+	} else {
+		/* Delete first, so nothing below the region is pushed off the screen */
+		if (bottom < tb->height) out_fmt(tb, "\033[%dH\033[%dM", bottom - n + 1, n);
+		out_fmt(tb, "\033[%dH\033[%dL", top + 1, n);
+	}
+
+	tb->term_x = -1;
+	tb->term_y = -1;
+
+	shift_rows(tb, tb->screen, top, bottom, amount);
+}
+
+/**
+ * Send everything that changed since the last flush in one write.
+ */
+void termbuf_flush(termbuf_t * tb) {
+	if (tb->suspended) {
+		fflush(tb->stream);
+		return;
+	}
+
+	if (!tb->valid && tb->dirty) {
+		/* Start over from a blank screen (or line) */
+		out_bytes(tb, "\033[0m", 4);
+		if (tb->flags & TERMBUF_LINE_MODE) {
+			out_bytes(tb, "\r\033[K", 4);
+			tb->term_x = 0;
+			tb->term_y = 0;
+		} else {
+			out_bytes(tb, "\033[H\033[2J", 7);
+			tb->term_x = 0;
+			tb->term_y = 0;
+		}
+		tb->term_pen = default_pen;
+		tb->term_pen_valid = 1;
+		tb->term_cursor_visible = -1;
+		fill_grid(tb, tb->screen, default_pen);
+		tb->valid = 1;
+	}
+
+	if (tb->valid) {
+		if (tb->dirty) {
+			for (int y = 0; y < tb->height; ++y) {
+				update_row(tb, y);
+			}
+		}
+
+		int x = tb->x < tb->width ? tb->x : tb->width - 1;
+		move_to(tb, x, tb->y);
+
+		if (tb->cursor_visible != tb->term_cursor_visible) {
+			out_bytes(tb, tb->cursor_visible ? "\033[?25h" : "\033[?25l", 6);
+			tb->term_cursor_visible = tb->cursor_visible;
+		}
+	}
+
+	tb->dirty = 0;
+
+	if (tb->out_len) {
+		fflush(tb->stream);
+		size_t done = 0;
+		while (done < tb->out_len) {
+			ssize_t r = write(fileno(tb->stream), tb->out + done, tb->out_len - done);
+			if (r <= 0) break;
+			done += r;
+		}
+		tb->bytes_written += tb->out_len;
+		tb->frames++;
+		tb->out_len = 0;
+	} else {
+		fflush(tb->stream);
+	}
+}
+
+/**
+ * Forget what the terminal shows; the next frame that draws
+ * anything repaints everything.
+ */
+void termbuf_invalidate(termbuf_t * tb) {
+	tb->valid = 0;
+	tb->term_x = -1;
+	tb->term_y = -1;
+	tb->term_pen_valid = 0;
+	tb->term_cursor_visible = -1;
+}
+
+/**
+ * Flush, then hand the terminal over to someone else: until
+ * termbuf_resume(), output is written through untouched.
+ */
+void termbuf_suspend(termbuf_t * tb) {
+	if (tb->suspended) return;
+	termbuf_flush(tb);
+	tb->suspended = 1;
+	termbuf_invalidate(tb);
+}
+
+/**
+ * Take the terminal back. Whatever happened to it in the meantime,
+ * the next frame that draws anything repaints everything.
+ */
+void termbuf_resume(termbuf_t * tb) {
+	if (!tb->suspended) return;
+	fflush(tb->stream);
+	tb->suspended = 0;
+	termbuf_invalidate(tb);
+}
@@ -26,39 +26,6 @@ struct TT_Table {
 	size_t length;
 };
 
-struct TT_Coord {
-	float x;
-	float y;
-};
-
-struct TT_Edge {
-	struct TT_Coord start;
-	struct TT_Coord end;
-	int direction;
-};
-
-struct TT_Contour {
-	size_t edgeCount;
-	size_t nextAlloc;
-	size_t flags;
-	size_t last_start;
-	struct TT_Edge edges[];
-};
-
-struct TT_Intersection {
-	float x;
-	int affect;
-};
-
-struct TT_Shape {
-	size_t edgeCount;
-	int lastY;
-	int startY;
-	int lastX;
-	int startX;
-	struct TT_Edge edges[];
-};
-
 struct TT_Vertex {
 	unsigned char flags;
 	int x;
@@ -91,244 +58,6 @@ struct TT_Font {
 };
 
 
-/* Currently, the edge sorter is disabled. It doesn't really help much,
- * and it's very slow with our horrible qsort implementation. */
-#if 0
-static int edge_sorter_high_scanline(const void * a, const void * b) {
-	const struct TT_Edge * left  = a;
-	const struct TT_Edge * right = b;
-
-	if (left->start.y < right->start.y) return -1;
-	if (left->start.y > right->start.y) return 1;
-	return 0;
-}
-
-static void sort_edges(size_t edgeCount, struct TT_Edge edges[edgeCount]) {
-	qsort(edges, edgeCount, sizeof(struct TT_Edge), edge_sorter_high_scanline);
-}
-#endif
-
-static int intersection_sorter(const void * a, const void * b) {
-	const struct TT_Intersection * left  = a;
-	const struct TT_Intersection * right = b;
-
-	if (left->x < right->x) return -1;
-	if (left->x > right->x) return 1;
-	return 0;
-}
-
-static inline void sort_intersections(size_t cnt, struct TT_Intersection intersections[cnt]) {
-	qsort(intersections, cnt, sizeof(struct TT_Intersection), intersection_sorter);
-}
-
-static inline float edge_at(float y, const struct TT_Edge * edge) {
-	float u = (y - edge->start.y) / (edge->end.y - edge->start.y);
-	return edge->start.x + u * (edge->end.x - edge->start.x);
-}
-
-__attribute__((hot))
-static inline size_t prune_edges(size_t edgeCount, float y, const struct TT_Edge edges[edgeCount], struct TT_Intersection into[edgeCount]) {
-	size_t outWriter = 0;
-	for (size_t i = 0; i < edgeCount; ++i) {
-		if (y > edges[i].end.y || y <= edges[i].start.y) continue;
-		into[outWriter].x = edge_at(y,&edges[i]);
-		into[outWriter].affect = edges[i].direction;
-		outWriter++;
-	}
-	return outWriter;
-}
-
-static void process_scanline(
-		float _y,
-		const struct TT_Shape * shape,
-		size_t subsample_width,
-		float subsamples[subsample_width],
-		size_t cnt,
-		const struct TT_Intersection crosses[cnt]
-	) {
-	int wind = 0;
-	size_t j = 0;
-	for (int x = shape->startX; x < shape->lastX && j < cnt; ++x) {
-		while (j < cnt && x > crosses[j].x) {
-			wind += crosses[j].affect;
-			j++;
-		}
-		float last = x;
-		while (j < cnt && (x+1) > crosses[j].x) {
-			if (wind != 0) {
-				subsamples[x - shape->startX] += crosses[j].x - last;
-			}
-			last = crosses[j].x;
-			wind += crosses[j].affect;
-			j++;
-		}
-		if (wind != 0) {
-			subsamples[x - shape->startX] += (x+1) - last;
-		}
-	}
-}
-
-static inline uint32_t tt_rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-	return (a << 24U) | (r << 16) | (g << 8) | (b);
-}
-
-static inline uint32_t tt_apply_alpha(uint32_t color, uint16_t alpha) {
-	uint8_t r = ((uint32_t)(_RED(color) * alpha + 0x80) * 0x101) >> 16UL;
-	uint8_t g = ((uint32_t)(_GRE(color) * alpha + 0x80) * 0x101) >> 16UL;
-	uint8_t b = ((uint32_t)(_BLU(color) * alpha + 0x80) * 0x101) >> 16UL;
-	uint8_t a = ((uint32_t)(_ALP(color) * alpha + 0x80) * 0x101) >> 16UL;
-	return tt_rgba(r,g,b,a);
-}
-
-static inline uint32_t tt_alpha_blend_rgba(uint32_t bottom, uint32_t top) {
-	if (_ALP(bottom) == 0) return top;
-	if (_ALP(top) == 255) return top;
-	if (_ALP(top) == 0) return bottom;
-	uint8_t a = _ALP(top);
-	uint16_t t = 0xFF ^ a;
-	uint8_t d_r = _RED(top) + (((uint32_t)(_RED(bottom) * t + 0x80) * 0x101) >> 16UL);
-	uint8_t d_g = _GRE(top) + (((uint32_t)(_GRE(bottom) * t + 0x80) * 0x101) >> 16UL);
-	uint8_t d_b = _BLU(top) + (((uint32_t)(_BLU(bottom) * t + 0x80) * 0x101) >> 16UL);
-	uint8_t d_a = _ALP(top) + (((uint32_t)(_ALP(bottom) * t + 0x80) * 0x101) >> 16UL);
-	return tt_rgba(d_r, d_g, d_b, d_a);
-}
-
-
-static void paint_scanline(gfx_context_t * ctx, int y, const struct TT_Shape * shape, float * subsamples, uint32_t color) {
-	for (int x = shape->startX < 0 ? 0 : shape->startX; x < shape->lastX && x < ctx->width; ++x) {
-		uint16_t na = (int)(255 * subsamples[x - shape->startX]) >> 2;
-		uint32_t nc = tt_apply_alpha(color, na);
-		GFX(ctx, x, y) = tt_alpha_blend_rgba(GFX(ctx, x, y), nc);
-		subsamples[x-shape->startX] = 0;
-	}
-}
-
-void tt_path_paint(gfx_context_t * ctx, const struct TT_Shape * shape, uint32_t color) {
-	size_t size = shape->edgeCount;
-	struct TT_Intersection * crosses = malloc(sizeof(struct TT_Intersection) * size);
-
-	size_t subsample_width = shape->lastX - shape->startX;
-	float * subsamples = malloc(sizeof(float) * subsample_width);
-	memset(subsamples, 0, sizeof(float) * subsample_width);
-
-	int startY = shape->startY < 0 ? 0 : shape->startY;
-	int endY = shape->lastY <= ctx->height ? shape->lastY : ctx->height;
-
-	for (int y = startY; y < endY; ++y) {
-		float _y = y + 0.0001;
-		for (int l = 0; l < 4; ++l) {
-			size_t cnt;
-			if ((cnt = prune_edges(size, _y, shape->edges, crosses))) {
-				sort_intersections(cnt, crosses);
-				process_scanline(_y, shape, subsample_width, subsamples, cnt, crosses);
-			}
-			_y += 1.0/4.0;
-		}
-		paint_scanline(ctx, y, shape, subsamples, color);
-	}
-
-	free(subsamples);
-	free(crosses);
-}
-
-struct TT_Contour * tt_contour_line_to(struct TT_Contour * shape, float x, float y) {
-	if (shape->flags & 1) {
-		shape->edges[shape->edgeCount].end.x = x;
-		shape->edges[shape->edgeCount].end.y = y;
-		shape->edgeCount++;
-		shape->flags &= ~1;
-	} else {
-		if (shape->edgeCount + 1 == shape->nextAlloc) {
-			shape->nextAlloc *= 2;
-			shape = realloc(shape, sizeof(struct TT_Contour) + sizeof(struct TT_Edge) * (shape->nextAlloc));
-		}
-		shape->edges[shape->edgeCount].start.x = shape->edges[shape->edgeCount-1].end.x;
-		shape->edges[shape->edgeCount].start.y = shape->edges[shape->edgeCount-1].end.y;
-		shape->edges[shape->edgeCount].end.x = x;
-		shape->edges[shape->edgeCount].end.y = y;
-		shape->edgeCount++;
-		shape->flags &= ~1;
-	}
-	return shape;
-}
-
-struct TT_Contour * tt_contour_move_to(struct TT_Contour * shape, float x, float y) {
-	if (!(shape->flags & 1) && shape->edgeCount) {
-		shape = tt_contour_line_to(shape, shape->edges[shape->last_start].start.x, shape->edges[shape->last_start].start.y);
-	}
-	if (shape->edgeCount + 1 == shape->nextAlloc) {
-		shape->nextAlloc *= 2;
-		shape = realloc(shape, sizeof(struct TT_Contour) + sizeof(struct TT_Edge) * (shape->nextAlloc));
-	}
-	shape->edges[shape->edgeCount].start.x = x;
-	shape->edges[shape->edgeCount].start.y = y;
-	shape->last_start = shape->edgeCount;
-	shape->flags |= 1;
-	return shape;
-}
-
-struct TT_Contour * tt_contour_start(float x, float y) {
-	struct TT_Contour * shape = malloc(sizeof(struct TT_Contour) + sizeof(struct TT_Edge) * 2);
-	shape->edgeCount = 0;
-	shape->nextAlloc = 2;
-	shape->flags = 0;
-	shape->last_start = 0;
-	shape->edges[shape->edgeCount].start.x = x;
-	shape->edges[shape->edgeCount].start.y = y;
-	shape->last_start = shape->edgeCount;
-	shape->flags |= 1;
-	return shape;
-}
-
-struct TT_Shape * tt_contour_finish(struct TT_Contour * in) {
-	size_t size = in->edgeCount + 1;
-	struct TT_Shape * tmp = malloc(sizeof(struct TT_Shape) + sizeof(struct TT_Edge) * size);
-	memcpy(tmp->edges, in->edges, sizeof(struct TT_Edge) * in->edgeCount);
-
-	if (in->flags & 1) {
-		size--;
-	} else {
-		tmp->edges[in->edgeCount].start.x = in->edges[in->edgeCount-1].end.x;
-		tmp->edges[in->edgeCount].start.y = in->edges[in->edgeCount-1].end.y;
-		tmp->edges[in->edgeCount].end.x   = in->edges[in->last_start].start.x;
-		tmp->edges[in->edgeCount].end.y   = in->edges[in->last_start].start.y;
-	}
-
-	for (size_t i = 0; i < size; ++i) {
-		if (tmp->edges[i].start.y < tmp->edges[i].end.y) {
-			tmp->edges[i].direction = 1;
-		} else {
-			tmp->edges[i].direction = -1;
-			struct TT_Coord j = tmp->edges[i].start;
-			tmp->edges[i].start = tmp->edges[i].end;
-			tmp->edges[i].end = j;
-		}
-	}
-
-	//sort_edges(size, tmp->edges);
-	tmp->edgeCount = size;
-	tmp->startY = INT_MAX;
-	tmp->lastY = INT_MIN;
-	tmp->startX = INT_MAX;
-	tmp->lastX = INT_MIN;
-	for (size_t i = 0; i < size; ++i) {
-		if (tmp->edges[i].end.y + 1 > tmp->lastY) tmp->lastY = tmp->edges[i].end.y + 1;
-		if (tmp->edges[i].start.y + 1 > tmp->lastY) tmp->lastY = tmp->edges[i].start.y + 1;
-		if (tmp->edges[i].end.y < tmp->startY) tmp->startY = tmp->edges[i].end.y;
-		if (tmp->edges[i].start.y < tmp->startY) tmp->startY = tmp->edges[i].start.y;
-
-		if (tmp->edges[i].end.x + 2 > tmp->lastX) tmp->lastX = tmp->edges[i].end.x + 2;
-		if (tmp->edges[i].start.x + 2 > tmp->lastX) tmp->lastX = tmp->edges[i].start.x + 2;
-		if (tmp->edges[i].end.x < tmp->startX) tmp->startX = tmp->edges[i].end.x;
-		if (tmp->edges[i].start.x < tmp->startX) tmp->startX = tmp->edges[i].start.x;
-	}
-
-	if (tmp->lastY < tmp->startY) tmp->startY = tmp->lastY;
-	if (tmp->lastX < tmp->startX) tmp->startX = tmp->lastX;
-
-	return tmp;
-}
-
 static inline int tt_seek(struct TT_Font * font, off_t offset) {
 	if (font->privFlags & 1) {
 		return fseek(font->filePtr, offset, SEEK_SET);
@@ -452,17 +181,9 @@ int tt_glyph_for_codepoint(struct TT_Font * font, unsigned int codepoint) {
 	return 0;
 }
 
-static void midpoint(float x_0, float y_0, float cx, float cy, float x_1, float y_1, float t, float * outx, float * outy) {
-	float t2 = t * t;
-	float nt = 1.0 - t;
-	float nt2 = nt * nt;
-	*outx = nt2 * x_0 + 2 * t * nt * cx + t2 * x_1;
-	*outy = nt2 * y_0 + 2 * t * nt * cy + t2 * y_1;
-}
-
-static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struct TT_Font * font, float x_offset, float y_offset, unsigned int glyph) {
+static void tt_draw_glyph_into(gfx_path_t * path, struct TT_Font * font, float x_offset, float y_offset, unsigned int glyph) {
 	off_t glyf_offset = tt_get_glyph_offset(font, glyph);
-	if (tt_get_glyph_offset(font, glyph + 1) == glyf_offset) return contour;
+	if (tt_get_glyph_offset(font, glyph + 1) == glyf_offset) return;
 
 	tt_seek(font, font->glyf_ptr.offset + glyf_offset);
 
@@ -475,7 +196,7 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 	tt_seek(font, font->glyf_ptr.offset + glyf_offset + 10);
 
 	if (numContours > 0) {
-		uint16_t endPt;
+		uint16_t endPt = 0;
 		for (int i = 0; i < numContours; ++i) {
 			endPt = tt_read_16(font);
 		}
@@ -545,7 +266,7 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 		int move_next = 1;
 		int next_end = tt_read_16(font);
 
-		float lx = 0, ly = 0, cx = 0, cy = 0, x = 0, y = 0;
+		float cx = 0, cy = 0, x = 0, y = 0;
 		float sx = 0, sy = 0;
 		int wasControl = 0;
 
@@ -554,7 +275,6 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 			y = (-(float)vertices[i].y) * font->scale + y_offset;
 			int isCurve = !(vertices[i].flags & (1 << 0));
 			if (move_next) {
-				contour = tt_contour_move_to(contour, x, y);
 				if (isCurve) {
 					/* Is the point before this on-curve? */
 					float px = (float)vertices[next_end].x * font->scale + x_offset;
@@ -563,13 +283,9 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 						/* Else we're just a regular off-curve point? */
 						sx = px;
 						sy = py;
-						lx = px;
-						ly = py;
 					} else {
 						float dx = (px + x) / 2.0;
 						float dy = (py + y) / 2.0;
-						lx = dx;
-						ly = dy;
 						sx = dx;
 						sy = dy;
 					}
@@ -577,53 +293,37 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 					cy = y;
 					wasControl = 1;
 				} else {
-					lx = x;
-					ly = y;
 					sx = x;
 					sy = y;
 					wasControl = 0;
 				}
+				gfx_path_move_to(path, sx, sy);
 				move_next = 0;
 			} else {
 				if (isCurve) {
 					if (wasControl) {
 						float dx = (cx + x) / 2.0;
 						float dy = (cy + y) / 2.0;
-						for (int i = 1; i < 10; ++i) {
-							float mx, my;
-							midpoint(lx,ly,cx,cy,dx,dy,(float)i / 10.0,&mx,&my);
-							contour = tt_contour_line_to(contour, mx, my);
-						}
-						contour = tt_contour_line_to(contour, dx, dy);
-						lx = dx;
-						ly = dy;
+						gfx_path_quad_to(path, cx, cy, dx, dy);
 					}
 					cx = x;
 					cy = y;
 					wasControl = 1;
 				} else {
 					if (wasControl) {
-						for (int i = 1; i < 10; ++i) {
-							float mx, my;
-							midpoint(lx,ly,cx,cy,x,y,(float)i / 10.0,&mx,&my);
-							contour = tt_contour_line_to(contour, mx, my);
-						}
+						gfx_path_quad_to(path, cx, cy, x, y);
+					} else {
+						gfx_path_line_to(path, x, y);
 					}
-					contour = tt_contour_line_to(contour, x, y);
-					lx = x;
-					ly = y;
 					wasControl = 0;
 				}
 			}
 			if (i == next_end) {
 				if (wasControl) {
-					for (int i = 1; i < 10; ++i) {
-						float mx, my;
-						midpoint(lx,ly,cx,cy,sx,sy,(float)i / 10.0,&mx,&my);
-						contour = tt_contour_line_to(contour, mx, my);
-					}
+					gfx_path_quad_to(path, cx, cy, sx, sy);
+				} else {
+					gfx_path_line_to(path, sx, sy);
 				}
-				contour = tt_contour_line_to(contour, sx, sy);
 				move_next = 1;
 				next_end = tt_read_16(font);
 			}
@@ -665,25 +365,19 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 				tt_read_16(font);
 			} else {
 				long o = tt_tell(font);
-				contour = tt_draw_glyph_into(contour,font,x_f,y_f,ind);
+				tt_draw_glyph_into(path,font,x_f,y_f,ind);
 				tt_seek(font, o);
 			}
 			if (!(flags & (1 << 5))) break;
 		}
 	}
-
-	return contour;
 }
 
 void tt_draw_glyph(gfx_context_t * ctx, struct TT_Font * font, int x, int y, unsigned int glyph, uint32_t color) {
-	struct TT_Contour * contour = tt_contour_start(0, 0);
-	contour = tt_draw_glyph_into(contour,font,x,y,glyph);
-	if (contour->edgeCount) {
-		struct TT_Shape * shape = tt_contour_finish(contour);
-		tt_path_paint(ctx, shape, color);
-		free(shape);
-	}
-	free(contour);
+	gfx_path_t * path = gfx_path_create();
+	tt_draw_glyph_into(path,font,x,y,glyph);
+	gfx_path_fill(ctx, path, color, GFX_FILL_NONZERO);
+	gfx_path_free(path);
 }
 
 int tt_string_width(struct TT_Font * font, const char * s) {
@@ -702,7 +396,7 @@ int tt_string_width(struct TT_Font * font, const char * s) {
 }
 
 int tt_draw_string(gfx_context_t * ctx, struct TT_Font * font, int x, int y, const char * s, uint32_t color) {
-	struct TT_Contour * contour = tt_contour_start(0, 0);
+	gfx_path_t * path = gfx_path_create();
 
 	float x_offset = x;
 	uint32_t cp = 0;
@@ -711,17 +405,13 @@ int tt_draw_string(gfx_context_t * ctx, struct TT_Font * font, int x, int y, con
 	for (const unsigned char * c = (const unsigned char*)s; *c; ++c) {
 		if (!decode(&istate, &cp, *c)) {
 			unsigned int glyph = tt_glyph_for_codepoint(font, cp);
-			contour = tt_draw_glyph_into(contour,font,x_offset,y,glyph);
+			tt_draw_glyph_into(path,font,x_offset,y,glyph);
 			x_offset += tt_xadvance_for_glyph(font, glyph) * font->scale;
 		}
 	}
 
-	if (contour->edgeCount) {
-		struct TT_Shape * shape = tt_contour_finish(contour);
-		tt_path_paint(ctx, shape, color);
-		free(shape);
-	}
-	free(contour);
+	gfx_path_fill(ctx, path, color, GFX_FILL_NONZERO);
+	gfx_path_free(path);
 
 	return x_offset - x;
 }
@@ -1011,31 +701,3 @@ char * tt_get_name_string(struct TT_Font * font, int identifier) {
 
 	return NULL;
 }
-
-void tt_contour_stroke_bounded(gfx_context_t * ctx, struct TT_Contour * in, uint32_t color, float width,
-		int x_0, int y_0, int w, int h) {
-	/* This is a stupid slow thing */
-	for (int y = y_0; y < y_0 + h; y++) {
-		for (int x = x_0; x < x_0 + w; x++) {
-			struct gfx_point p = {(float)x + 0.5, (float)y + 0.5};
-			/* For every line in the contour... */
-			float mindist = 100.0;
-			for (size_t i = 0; i < in->edgeCount; ++i) {
-				struct gfx_point v = { in->edges[i].start.x, in->edges[i].start.y };
-				struct gfx_point w = { in->edges[i].end.x, in->edges[i].end.y };
-
-				float mine = gfx_line_distance(&p,&v,&w);
-				if (mine < mindist) mindist = mine;
-			}
-
-			if (mindist < width + 0.5) {
-				if (mindist < width - 0.5) {
-					GFX(ctx,x,y) = alpha_blend_rgba(GFX(ctx,x,y), color);
-				} else {
-					float alpha = 1.0 - (mindist - width + 0.5);
-					GFX(ctx,x,y) = alpha_blend_rgba(GFX(ctx,x,y), premultiply(rgba(_RED(color),_GRE(color),_BLU(color),(int)((double)_ALP(color) * alpha))));
-				}
-			}
-		}
-	}
-}
@@ -0,0 +1,1062 @@
+/**
+ * @file lib/ttk.c
+ * @brief Retained-mode widget toolkit.
+ *
+ * The window keeps a surface with the rendered contents of every
+ * widget. Widgets record which of their rows are out of date; an
+ * update redraws only those rows into the surface, copies the changed
+ * rectangles into the window and flips just those regions. Scroll views
+ * keep a surface of their own for their children, so scrolling is a
+ * copy and a redraw of the newly exposed rows.
+ *
+ * Widgets are kept a few pixels clear of the window edges, where the
+ * decoration theme may shade the contents, so a partial update never
+ * needs to redraw the decorations.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <toaru/yutani.h>
+#include <toaru/graphics.h>
+#include <toaru/decorations.h>
+#include <toaru/button.h>
+#include <toaru/text.h>
+#include <toaru/list.h>
+#include <toaru/ttk.h>
+
+#define TTK_WINDOW_MARGIN 5
+#define TTK_BACKGROUND rgb(204,204,204)
+
+static struct TT_Font * ttk_fonts[4] = {NULL};
+static const char * ttk_font_names[4] = {"sans-serif", "sans-serif.bold", "monospace", "monospace.bold"};
+
+static struct TT_Font * get_font(int font, int size) {
+	if (!ttk_fonts[font]) ttk_fonts[font] = tt_font_from_shm(ttk_font_names[font]);
+	tt_set_size(ttk_fonts[font], size);
+	return ttk_fonts[font];
+}
+
+static int baseline_for(int height, int size) {
+	return (height - size) / 2 + size - size / 6;
+}
+
+/* Widgets { */
+
+ttk_widget_t * ttk_widget_create(size_t size) {
+	ttk_widget_t * out = calloc(1, size);
+	out->children = list_create();
+	out->background = TTK_BACKGROUND;
+	return out;
+}
+
+static void set_window(ttk_widget_t * widget, ttk_window_t * window, ttk_widget_t * owner) {
+	widget->window = window;
+	widget->owner = owner;
+	ttk_widget_t * child_owner = (widget->flags & TTK_FLAG_SCROLLABLE) ? widget : owner;
+	foreach(node, widget->children) {
+		set_window(node->value, window, child_owner);
+	}
+}
+
+void ttk_widget_add(ttk_widget_t * parent, ttk_widget_t * child) {
+	child->parent = parent;
+	list_insert(parent->children, child);
+	set_window(child, parent->window, (parent->flags & TTK_FLAG_SCROLLABLE) ? parent : parent->owner);
+	if (parent->window) parent->window->needs_layout = 1;
+}
+
+void ttk_widget_invalidate_rows(ttk_widget_t * widget, int y, int height) {
+	int top = y < 0 ? 0 : y;
+	int bottom = y + height > widget->rect.height ? widget->rect.height : y + height;
+	if (top >= bottom) return;
+
+	if (widget->dirty_top < widget->dirty_bottom) {
+		if (top > widget->dirty_top) top = widget->dirty_top;
+		if (bottom < widget->dirty_bottom) bottom = widget->dirty_bottom;
+	}
+	widget->dirty_top = top;
+	widget->dirty_bottom = bottom;
+	if (widget->window) widget->window->pending = 1;
+}
+
+void ttk_widget_invalidate(ttk_widget_t * widget) {
+	ttk_widget_invalidate_rows(widget, 0, widget->rect.height);
+	if (widget->flags & (TTK_FLAG_CONTAINER | TTK_FLAG_SCROLLABLE)) {
+		/* Containers paint under their children; scroll views show them */
+		foreach(node, widget->children) {
+			ttk_widget_invalidate(node->value);
+		}
+	}
+}
+
+static gfx_context_t * target_surface(ttk_widget_t * widget) {
+	return widget->owner ? widget->owner->content : widget->window->surface;
+}
+
+static void add_damage(ttk_window_t * win, int x, int y, int width, int height);
+
+/**
+ * Rows of a widget's surface changed: tell whoever shows them.
+ */
+static void surface_changed(ttk_widget_t * widget, int y, int height) {
+	if (widget->owner) {
+		ttk_widget_invalidate_rows(widget->owner, widget->rect.y + y - widget->owner->scroll_y, height);
+	} else {
+		add_damage(widget->window, widget->rect.x, widget->rect.y + y, widget->rect.width, height);
+	}
+}
+
+/**
+ * Move rows [y,y+height) of a widget up by @p delta (down if negative)
+ * in the surface it renders into, and invalidate the rows that were
+ * uncovered. Used to scroll without redrawing what stays visible.
+ */
+void ttk_widget_scroll(ttk_widget_t * widget, int y, int height, int delta) {
+	if (!delta) return;
+	gfx_context_t * surface = widget->window ? target_surface(widget) : NULL;
+	int pending = widget->dirty_top < widget->dirty_bottom;
+
+	if (!surface || pending || abs(delta) >= height) {
+		ttk_widget_invalidate_rows(widget, y, height);
+		return;
+	}
+
+	int top = widget->rect.y + y;
+	size_t bytes = widget->rect.width * sizeof(uint32_t);
+	if (delta > 0) {
+		for (int row = 0; row < height - delta; ++row) {
+			memcpy(&GFX(surface, widget->rect.x, top + row), &GFX(surface, widget->rect.x, top + row + delta), bytes);
+		}
+		ttk_widget_invalidate_rows(widget, y + height - delta, delta);
+	} else {
+		for (int row = height - 1; row >= -delta; --row) {
+			memcpy(&GFX(surface, widget->rect.x, top + row), &GFX(surface, widget->rect.x, top + row + delta), bytes);
+		}
+		ttk_widget_invalidate_rows(widget, y, -delta);
+	}
+
+	surface_changed(widget, y, height);
+}
+
+static void set_state(ttk_widget_t * widget, int bit, int on) {
+	if (!widget) return;
+	int state = on ? (widget->state | bit) : (widget->state & ~bit);
+	if (state == widget->state) return;
+	widget->state = state;
+	if (((bit & (TTK_STATE_HOVER | TTK_STATE_PRESSED)) && (widget->flags & TTK_FLAG_HOVERABLE)) ||
+		((bit & TTK_STATE_FOCUSED) && (widget->flags & TTK_FLAG_FOCUSABLE)) ||
+		(bit & TTK_STATE_DISABLED)) {
+		ttk_widget_invalidate(widget);
+	}
+}
+
+void ttk_widget_set_disabled(ttk_widget_t * widget, int disabled) {
+	set_state(widget, TTK_STATE_DISABLED, disabled);
+}
+
+void ttk_widget_free(ttk_widget_t * widget) {
+	foreach(node, widget->children) {
+		ttk_widget_free(node->value);
+	}
+	list_free(widget->children);
+	free(widget->children);
+	if (widget->destroy) widget->destroy(widget);
+	if (widget->window) {
+		if (widget->window->hover == widget) widget->window->hover = NULL;
+		if (widget->window->pressed == widget) widget->window->pressed = NULL;
+		if (widget->window->focus == widget) widget->window->focus = NULL;
+	}
+	free(widget);
+}
+
+/* } Widgets */
+
+/* Layout { */
+
+struct ttk_box {
+	ttk_widget_t widget;
+	int direction;
+	int spacing;
+	int padding;
+};
+
+static void box_layout(ttk_widget_t * self);
+
+/**
+ * Boxes take their minimum size from their children.
+ */
+static void measure(ttk_widget_t * widget) {
+	foreach(node, widget->children) {
+		measure(node->value);
+	}
+	if (widget->layout != box_layout) return;
+
+	struct ttk_box * box = (struct ttk_box *)widget;
+	int along = 0, across = 0, count = 0;
+	foreach(node, widget->children) {
+		ttk_widget_t * child = node->value;
+		int a = box->direction == TTK_VERTICAL ? child->min_height : child->min_width;
+		int c = box->direction == TTK_VERTICAL ? child->min_width : child->min_height;
+		along += a;
+		if (c > across) across = c;
+		count++;
+	}
+	if (count) along += box->spacing * (count - 1);
+	along += box->padding * 2;
+	across += box->padding * 2;
+
+	int * w = box->direction == TTK_VERTICAL ? &widget->min_width : &widget->min_height;
+	int * h = box->direction == TTK_VERTICAL ? &widget->min_height : &widget->min_width;
+	if (*w < across) *w = across;
+	if (*h < along) *h = along;
+}
+
+static void box_layout(ttk_widget_t * self) {
+	struct ttk_box * box = (struct ttk_box *)self;
+	int vertical = box->direction == TTK_VERTICAL;
+	int size = (vertical ? self->rect.height : self->rect.width) - box->padding * 2;
+	int cross = (vertical ? self->rect.width : self->rect.height) - box->padding * 2;
+
+	int count = 0, total_min = 0, total_expand = 0;
+	foreach(node, self->children) {
+		ttk_widget_t * child = node->value;
+		total_min += vertical ? child->min_height : child->min_width;
+		total_expand += child->expand;
+		count++;
+	}
+	if (!count) return;
+
+	int leftover = size - total_min - box->spacing * (count - 1);
+	if (leftover < 0) leftover = 0;
+
+	int offset = box->padding;
+	int given = 0;
+	foreach(node, self->children) {
+		ttk_widget_t * child = node->value;
+		int extent = vertical ? child->min_height : child->min_width;
+		if (child->expand && total_expand) {
+			int share = leftover * child->expand / total_expand;
+			given += child->expand;
+			/* The last expanding child takes whatever rounding left over */
+			if (given == total_expand) share = leftover - (leftover * (total_expand - child->expand) / total_expand);
+			extent += share;
+		}
+		if (vertical) {
+			child->rect = (struct ttk_rect){self->rect.x + box->padding, self->rect.y + offset, cross, extent};
+		} else {
+			child->rect = (struct ttk_rect){self->rect.x + offset, self->rect.y + box->padding, extent, cross};
+		}
+		offset += extent + box->spacing;
+	}
+}
+
+ttk_widget_t * ttk_box_create(int direction, int spacing, int padding) {
+	struct ttk_box * box = (struct ttk_box *)ttk_widget_create(sizeof(struct ttk_box));
+	box->widget.layout = box_layout;
+	box->widget.flags = TTK_FLAG_CONTAINER;
+	box->direction = direction;
+	box->spacing = spacing;
+	box->padding = padding;
+	return &box->widget;
+}
+
+static void layout_tree(ttk_widget_t * widget) {
+	if (widget->layout) widget->layout(widget);
+	foreach(node, widget->children) {
+		layout_tree(node->value);
+	}
+}
+
+/* } Layout */
+
+/* Rendering { */
+
+static void render_widget(ttk_widget_t * widget) {
+	int top = widget->dirty_top;
+	int bottom = widget->dirty_bottom;
+	widget->dirty_top = widget->dirty_bottom = 0;
+
+	gfx_context_t * surface = target_surface(widget);
+	if (!surface) return;
+	if (widget->rect.y + top < 0) top = -widget->rect.y;
+	if (widget->rect.y + bottom > surface->height) bottom = surface->height - widget->rect.y;
+	int width = widget->rect.width;
+	if (widget->rect.x < 0 || widget->rect.x + width > surface->width) width = surface->width - widget->rect.x;
+	if (top >= bottom || width <= 0 || widget->rect.x < 0) return;
+
+	gfx_context_t * ctx = init_graphics_subregion(surface, widget->rect.x, widget->rect.y + top, width, bottom - top);
+	draw_fill(ctx, widget->background);
+	if (widget->draw) widget->draw(widget, ctx, top);
+	free(ctx);
+
+	surface_changed(widget, top, bottom - top);
+}
+
+static void render_tree(ttk_widget_t * widget) {
+	int after = widget->flags & TTK_FLAG_SCROLLABLE;
+	if (!after && widget->dirty_top < widget->dirty_bottom) render_widget(widget);
+	foreach(node, widget->children) {
+		render_tree(node->value);
+	}
+	if (after && widget->dirty_top < widget->dirty_bottom) render_widget(widget);
+}
+
+static int rects_touch(struct ttk_rect * a, struct ttk_rect * b) {
+	return a->x <= b->x + b->width && b->x <= a->x + a->width &&
+	       a->y <= b->y + b->height && b->y <= a->y + a->height;
+}
+
+static void rect_union(struct ttk_rect * a, struct ttk_rect * b) {
+	int x0 = a->x < b->x ? a->x : b->x;
+	int y0 = a->y < b->y ? a->y : b->y;
+	int x1 = (a->x + a->width > b->x + b->width) ? a->x + a->width : b->x + b->width;
+	int y1 = (a->y + a->height > b->y + b->height) ? a->y + a->height : b->y + b->height;
+	*a = (struct ttk_rect){x0, y0, x1 - x0, y1 - y0};
+}
+
+/**
+ * Record a changed rectangle of the surface, merging it with
+ * any damage it overlaps or touches.
+ */
+static void add_damage(ttk_window_t * win, int x, int y, int width, int height) {
+	if (x < 0) { width += x; x = 0; }
+	if (y < 0) { height += y; y = 0; }
+	if (x + width > win->surface->width) width = win->surface->width - x;
+	if (y + height > win->surface->height) height = win->surface->height - y;
+	if (width <= 0 || height <= 0) return;
+
+	struct ttk_rect r = {x, y, width, height};
+
+	int merged;
+	do {
+		merged = 0;
+		for (int i = 0; i < win->damage_count; ++i) {
+			if (rects_touch(&win->damage[i], &r)) {
+				rect_union(&r, &win->damage[i]);
+				win->damage[i] = win->damage[--win->damage_count];
+				merged = 1;
+				break;
+			}
+		}
+	} while (merged);
+
+	if (win->damage_count == TTK_MAX_DAMAGE) {
+		rect_union(&win->damage[0], &r);
+		return;
+	}
+	win->damage[win->damage_count++] = r;
+}
+
+/**
+ * Copy a rectangle of the surface into both buffers of the window.
+ */
+static void present_rect(ttk_window_t * win, struct ttk_rect * r) {
+	for (int y = 0; y < r->height; ++y) {
+		uint32_t * src = &GFX(win->surface, r->x, r->y + y);
+		memcpy(&GFX(win->ctx, win->area.x + r->x, win->area.y + r->y + y), src, r->width * sizeof(uint32_t));
+		if (win->ctx->buffer != win->ctx->backbuffer) {
+			memcpy(&GFXR(win->ctx, win->area.x + r->x, win->area.y + r->y + y), src, r->width * sizeof(uint32_t));
+		}
+	}
+}
+
+/* } Rendering */
+
+/* Windows { */
+
+ttk_window_t * ttk_window_create(yutani_t * yctx, yutani_window_t * window, gfx_context_t * ctx, char * title, int top_inset) {
+	ttk_window_t * out = calloc(1, sizeof(ttk_window_t));
+	out->yctx = yctx;
+	out->window = window;
+	out->ctx = ctx;
+	out->title = title;
+	out->top_inset = top_inset;
+	out->needs_layout = 1;
+	return out;
+}
+
+void ttk_window_set_root(ttk_window_t * win, ttk_widget_t * root) {
+	win->root = root;
+	root->parent = NULL;
+	set_window(root, win, NULL);
+	win->needs_layout = 1;
+}
+
+void ttk_window_resize(ttk_window_t * win) {
+	win->needs_layout = 1;
+	ttk_window_draw(win);
+}
+
+static void relayout(ttk_window_t * win) {
+	struct decor_bounds bounds;
+	decor_get_bounds(win->window, &bounds);
+
+	win->area.x = bounds.left_width;
+	win->area.y = bounds.top_height + win->top_inset;
+	win->area.width = win->ctx->width - bounds.width;
+	win->area.height = win->ctx->height - bounds.height - win->top_inset;
+	if (win->area.width < 1) win->area.width = 1;
+	if (win->area.height < 1) win->area.height = 1;
+
+	if (!win->surface || win->surface->width != win->area.width || win->surface->height != win->area.height) {
+		if (win->surface) {
+			free(win->surface);
+			sprite_free(win->surface_sprite);
+		}
+		win->surface_sprite = create_sprite(win->area.width, win->area.height, ALPHA_OPAQUE);
+		win->surface = init_graphics_sprite(win->surface_sprite);
+	}
+	draw_fill(win->surface, TTK_BACKGROUND);
+
+	if (win->root) {
+		measure(win->root);
+		win->root->rect = (struct ttk_rect){TTK_WINDOW_MARGIN, TTK_WINDOW_MARGIN,
+			win->area.width - TTK_WINDOW_MARGIN * 2, win->area.height - TTK_WINDOW_MARGIN * 2};
+		layout_tree(win->root);
+		ttk_widget_invalidate(win->root);
+	}
+
+	win->needs_layout = 0;
+}
+
+/**
+ * Redraw the whole window: the decorations, anything the application
+ * draws around the widgets, and whatever widgets are out of date.
+ */
+void ttk_window_draw(ttk_window_t * win) {
+	if (win->needs_layout) relayout(win);
+	if (win->root) render_tree(win->root);
+	win->damage_count = 0;
+	win->pending = 0;
+
+	for (int y = 0; y < win->area.height; ++y) {
+		memcpy(&GFX(win->ctx, win->area.x, win->area.y + y), &GFX(win->surface, 0, y), win->area.width * sizeof(uint32_t));
+	}
+
+	if (win->draw_chrome) win->draw_chrome(win);
+	render_decorations(win->window, win->ctx, win->title);
+
+	flip(win->ctx);
+	yutani_flip(win->yctx, win->window);
+}
+
+/**
+ * Redraw out-of-date widgets and send only what changed.
+ */
+void ttk_window_update(ttk_window_t * win) {
+	if (win->needs_layout) {
+		ttk_window_draw(win);
+		return;
+	}
+	if (!win->pending || !win->root) return;
+	win->pending = 0;
+
+	render_tree(win->root);
+
+	for (int i = 0; i < win->damage_count; ++i) {
+		struct ttk_rect * r = &win->damage[i];
+		present_rect(win, r);
+		yutani_flip_region(win->yctx, win->window, win->area.x + r->x, win->area.y + r->y, r->width, r->height);
+	}
+	win->damage_count = 0;
+}
+
+/**
+ * Find the deepest widget under a point given in the coordinates
+ * of @p widget's surface, and that point relative to the widget.
+ */
+static ttk_widget_t * hit_test(ttk_widget_t * widget, int x, int y, int * out_x, int * out_y) {
+	if (x < widget->rect.x || y < widget->rect.y ||
+		x >= widget->rect.x + widget->rect.width || y >= widget->rect.y + widget->rect.height) {
+		return NULL;
+	}
+
+	int cx = x, cy = y;
+	if (widget->flags & TTK_FLAG_SCROLLABLE) {
+		cx = x - widget->rect.x;
+		cy = y - widget->rect.y + widget->scroll_y;
+	}
+
+	foreach(node, widget->children) {
+		ttk_widget_t * hit = hit_test(node->value, cx, cy, out_x, out_y);
+		if (hit) return hit;
+	}
+
+	*out_x = x - widget->rect.x;
+	*out_y = y - widget->rect.y;
+	return widget;
+}
+
+/**
+ * Where a widget is relative to the window's surface.
+ */
+static void widget_origin(ttk_widget_t * widget, int * x, int * y) {
+	*x = widget->rect.x;
+	*y = widget->rect.y;
+	for (ttk_widget_t * owner = widget->owner; owner; owner = owner->owner) {
+		*x += owner->rect.x;
+		*y += owner->rect.y - owner->scroll_y;
+	}
+}
+
+static void set_focus(ttk_window_t * win, ttk_widget_t * widget) {
+	if (win->focus == widget) return;
+	set_state(win->focus, TTK_STATE_FOCUSED, 0);
+	win->focus = widget;
+	set_state(widget, TTK_STATE_FOCUSED, 1);
+}
+
+static int deliver(ttk_widget_t * widget, struct yutani_msg_window_mouse_event * me) {
+	if (!widget || !widget->mouse) return 0;
+	int x, y;
+	widget_origin(widget, &x, &y);
+	return widget->mouse(widget, me, me->new_x - widget->window->area.x - x, me->new_y - widget->window->area.y - y);
+}
+
+int ttk_window_mouse_event(ttk_window_t * win, struct yutani_msg_window_mouse_event * me) {
+	if (!win->root || win->needs_layout) return 0;
+
+	int x, y;
+	ttk_widget_t * hit = NULL;
+	if (me->command != YUTANI_MOUSE_EVENT_LEAVE) {
+		hit = hit_test(win->root, me->new_x - win->area.x, me->new_y - win->area.y, &x, &y);
+	}
+
+	if (hit != win->hover) {
+		set_state(win->hover, TTK_STATE_HOVER, 0);
+		win->hover = hit;
+		set_state(hit, TTK_STATE_HOVER, 1);
+		/* A pressed widget also shows whether the pointer is still over it */
+		if (win->pressed && (win->pressed->flags & TTK_FLAG_HOVERABLE)) ttk_widget_invalidate(win->pressed);
+	}
+
+	int handled = 0;
+
+	if (me->buttons & (YUTANI_MOUSE_SCROLL_UP | YUTANI_MOUSE_SCROLL_DOWN)) {
+		for (ttk_widget_t * w = hit; w && !handled; w = w->parent) {
+			handled = deliver(w, me);
+		}
+		return handled;
+	}
+
+	switch (me->command) {
+		case YUTANI_MOUSE_EVENT_DOWN:
+			if (hit && (me->buttons & YUTANI_MOUSE_BUTTON_LEFT) && !(hit->state & TTK_STATE_DISABLED)) {
+				win->pressed = hit;
+				set_state(hit, TTK_STATE_PRESSED, 1);
+				if (hit->flags & TTK_FLAG_FOCUSABLE) set_focus(win, hit);
+			}
+			handled = deliver(hit, me);
+			break;
+		case YUTANI_MOUSE_EVENT_RAISE:
+		case YUTANI_MOUSE_EVENT_CLICK:
+			if (win->pressed) {
+				ttk_widget_t * pressed = win->pressed;
+				win->pressed = NULL;
+				set_state(pressed, TTK_STATE_PRESSED, 0);
+				handled = deliver(pressed, me);
+			}
+			break;
+		default:
+			handled = deliver(win->pressed ? win->pressed : hit, me);
+			break;
+	}
+
+	return handled;
+}
+
+int ttk_window_key_event(ttk_window_t * win, struct yutani_msg_key_event * ke) {
+	if (win->focus && win->focus->key) {
+		return win->focus->key(win->focus, ke);
+	}
+	return 0;
+}
+
+void ttk_window_free(ttk_window_t * win) {
+	if (win->root) ttk_widget_free(win->root);
+	if (win->surface) {
+		free(win->surface);
+		sprite_free(win->surface_sprite);
+	}
+	free(win);
+}
+
+/* } Windows */
+
+/* Label { */
+
+struct ttk_label {
+	ttk_widget_t widget;
+	char * text;
+	int font;
+	int size;
+	int align;
+	uint32_t color;
+};
+
+static void label_measure(struct ttk_label * label) {
+	label->widget.min_width = tt_string_width(get_font(label->font, label->size), label->text);
+	label->widget.min_height = label->size + 7;
+}
+
+static void label_draw(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	struct ttk_label * label = (struct ttk_label *)self;
+	struct TT_Font * font = get_font(label->font, label->size);
+	int x = 0;
+	if (label->align != TTK_ALIGN_LEFT) {
+		int width = tt_string_width(font, label->text);
+		x = (label->align == TTK_ALIGN_CENTER) ? (self->rect.width - width) / 2 : self->rect.width - width;
+	}
+	uint32_t color = (self->state & TTK_STATE_DISABLED) ? rgb(120,120,120) : label->color;
+	tt_draw_string(ctx, font, x, baseline_for(self->rect.height, label->size) - top, label->text, color);
+}
+
+static void label_destroy(ttk_widget_t * self) {
+	free(((struct ttk_label *)self)->text);
+}
+
+ttk_widget_t * ttk_label_create(const char * text, int font, int size) {
+	struct ttk_label * label = (struct ttk_label *)ttk_widget_create(sizeof(struct ttk_label));
+	label->widget.draw = label_draw;
+	label->widget.destroy = label_destroy;
+	label->text = strdup(text);
+	label->font = font;
+	label->size = size;
+	label->color = rgb(0,0,0);
+	label_measure(label);
+	return &label->widget;
+}
+
+void ttk_label_set_text(ttk_widget_t * self, const char * text) {
+	struct ttk_label * label = (struct ttk_label *)self;
+	if (!strcmp(label->text, text)) return;
+	free(label->text);
+	label->text = strdup(text);
+	label_measure(label);
+	ttk_widget_invalidate(self);
+}
+
+void ttk_label_set_align(ttk_widget_t * self, int align) {
+	((struct ttk_label *)self)->align = align;
+	ttk_widget_invalidate(self);
+}
+
+void ttk_label_set_font(ttk_widget_t * self, int font, int size) {
+	struct ttk_label * label = (struct ttk_label *)self;
+	if (label->font == font && label->size == size) return;
+	label->font = font;
+	label->size = size;
+	label_measure(label);
+	ttk_widget_invalidate(self);
+}
+
+void ttk_label_set_color(ttk_widget_t * self, uint32_t color) {
+	((struct ttk_label *)self)->color = color;
+	ttk_widget_invalidate(self);
+}
+
+/* } Label */
+
+/* Button { */
+
+struct ttk_button_widget {
+	ttk_widget_t widget;
+	char * title;
+};
+
+static void button_draw(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	struct ttk_button_widget * button = (struct ttk_button_widget *)self;
+	ttk_window_t * win = self->window;
+	int hilight = 0;
+	if (self->state & TTK_STATE_DISABLED) {
+		hilight = 0x100;
+	} else if (win->pressed == self) {
+		hilight = (self->state & TTK_STATE_HOVER) ? 2 : 0;
+	} else if ((self->state & TTK_STATE_HOVER) && !win->pressed) {
+		hilight = 1;
+	}
+	struct TTKButton b = {0, -top, self->rect.width, self->rect.height, button->title, hilight};
+	ttk_button_draw(ctx, &b);
+}
+
+static int button_mouse(ttk_widget_t * self, struct yutani_msg_window_mouse_event * me, int x, int y) {
+	if (me->command != YUTANI_MOUSE_EVENT_RAISE && me->command != YUTANI_MOUSE_EVENT_CLICK) return 0;
+	if (x < 0 || y < 0 || x >= self->rect.width || y >= self->rect.height) return 0;
+	if (self->state & TTK_STATE_DISABLED) return 0;
+	if (self->activate) self->activate(self);
+	return 1;
+}
+
+static void button_destroy(ttk_widget_t * self) {
+	free(((struct ttk_button_widget *)self)->title);
+}
+
+ttk_widget_t * ttk_button_create(const char * title, void (*activate)(ttk_widget_t *)) {
+	struct ttk_button_widget * button = (struct ttk_button_widget *)ttk_widget_create(sizeof(struct ttk_button_widget));
+	button->widget.draw = button_draw;
+	button->widget.mouse = button_mouse;
+	button->widget.destroy = button_destroy;
+	button->widget.activate = activate;
+	button->widget.flags = TTK_FLAG_HOVERABLE;
+	button->title = strdup(title);
+	button->widget.min_width = (title[0] == '\033' ? 16 : tt_string_width(get_font(TTK_FONT_SANS, 13), title)) + 20;
+	button->widget.min_height = 28;
+	return &button->widget;
+}
+
+/* } Button */
+
+/* Scroll view { */
+
+struct ttk_scroll_view {
+	ttk_widget_t widget;
+	sprite_t * sprite;
+	int content_height;
+};
+
+#define SCROLL_AMOUNT 40
+
+static void scroll_view_layout(ttk_widget_t * self) {
+	struct ttk_scroll_view * view = (struct ttk_scroll_view *)self;
+	if (!self->children->head) return;
+	ttk_widget_t * child = self->children->head->value;
+
+	int height = child->min_height > self->rect.height ? child->min_height : self->rect.height;
+	child->rect = (struct ttk_rect){0, 0, self->rect.width, height};
+	view->content_height = height;
+
+	if (!self->content || self->content->width != self->rect.width || self->content->height != height) {
+		if (self->content) {
+			free(self->content);
+			sprite_free(view->sprite);
+		}
+		view->sprite = create_sprite(self->rect.width > 0 ? self->rect.width : 1, height > 0 ? height : 1, ALPHA_OPAQUE);
+		self->content = init_graphics_sprite(view->sprite);
+	}
+
+	if (self->scroll_y > height - self->rect.height) self->scroll_y = height - self->rect.height;
+	if (self->scroll_y < 0) self->scroll_y = 0;
+}
+
+static void scroll_view_draw(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	if (!self->content) return;
+	for (int y = 0; y < ctx->height; ++y) {
+		int src = self->scroll_y + top + y;
+		if (src >= self->content->height) break;
+		memcpy(&GFX(ctx, 0, y), &GFX(self->content, 0, src), ctx->width * sizeof(uint32_t));
+	}
+}
+
+static int scroll_view_mouse(ttk_widget_t * self, struct yutani_msg_window_mouse_event * me, int x, int y) {
+	if (me->buttons & YUTANI_MOUSE_SCROLL_UP) {
+		ttk_scroll_view_scroll_to(self, self->scroll_y - SCROLL_AMOUNT);
+		return 1;
+	} else if (me->buttons & YUTANI_MOUSE_SCROLL_DOWN) {
+		ttk_scroll_view_scroll_to(self, self->scroll_y + SCROLL_AMOUNT);
+		return 1;
+	}
+	return 0;
+}
+
+static void scroll_view_destroy(ttk_widget_t * self) {
+	if (self->content) {
+		free(self->content);
+		sprite_free(((struct ttk_scroll_view *)self)->sprite);
+	}
+}
+
+void ttk_scroll_view_scroll_to(ttk_widget_t * self, int offset) {
+	struct ttk_scroll_view * view = (struct ttk_scroll_view *)self;
+	if (offset > view->content_height - self->rect.height) offset = view->content_height - self->rect.height;
+	if (offset < 0) offset = 0;
+	int delta = offset - self->scroll_y;
+	self->scroll_y = offset;
+	ttk_widget_scroll(self, 0, self->rect.height, delta);
+}
+
+ttk_widget_t * ttk_scroll_view_create(ttk_widget_t * child) {
+	struct ttk_scroll_view * view = (struct ttk_scroll_view *)ttk_widget_create(sizeof(struct ttk_scroll_view));
+	view->widget.layout = scroll_view_layout;
+	view->widget.draw = scroll_view_draw;
+	view->widget.mouse = scroll_view_mouse;
+	view->widget.destroy = scroll_view_destroy;
+	view->widget.flags = TTK_FLAG_SCROLLABLE;
+	view->widget.expand = 1;
+	if (child) ttk_widget_add(&view->widget, child);
+	return &view->widget;
+}
+
+/* } Scroll view */
+
+/* List view { */
+
+struct ttk_list_view {
+	ttk_widget_t widget;
+	char ** items;
+	int count;
+	int row_height;
+	int selected;
+};
+
+static void list_view_draw(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	struct TT_Font * font = get_font(TTK_FONT_SANS, 13);
+	int first = (self->scroll_y + top) / list->row_height;
+	int last = (self->scroll_y + top + ctx->height) / list->row_height;
+	for (int i = first; i <= last && i < list->count; ++i) {
+		int y = i * list->row_height - self->scroll_y - top;
+		uint32_t color = rgb(0,0,0);
+		if (i == list->selected) {
+			draw_rectangle_solid(ctx, 0, y, self->rect.width, list->row_height, rgb(72,167,255));
+			color = rgb(255,255,255);
+		}
+		tt_draw_string(ctx, font, 4, y + baseline_for(list->row_height, 13), list->items[i], color);
+	}
+}
+
+static void list_view_invalidate_row(struct ttk_list_view * list, int row) {
+	if (row < 0) return;
+	ttk_widget_invalidate_rows(&list->widget, row * list->row_height - list->widget.scroll_y, list->row_height);
+}
+
+void ttk_list_view_scroll_to(ttk_widget_t * self, int offset) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	int max = list->count * list->row_height - self->rect.height;
+	if (offset > max) offset = max;
+	if (offset < 0) offset = 0;
+	int delta = offset - self->scroll_y;
+	self->scroll_y = offset;
+	ttk_widget_scroll(self, 0, self->rect.height, delta);
+}
+
+void ttk_list_view_select(ttk_widget_t * self, int index) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	if (index < -1 || index >= list->count || index == list->selected) return;
+	list_view_invalidate_row(list, list->selected);
+	list->selected = index;
+	list_view_invalidate_row(list, index);
+
+	/* Keep the selection in view */
+	if (index >= 0) {
+		int y = index * list->row_height;
+		if (y < self->scroll_y) {
+			ttk_list_view_scroll_to(self, y);
+		} else if (y + list->row_height > self->scroll_y + self->rect.height) {
+			ttk_list_view_scroll_to(self, y + list->row_height - self->rect.height);
+		}
+	}
+}
+
+int ttk_list_view_selected(ttk_widget_t * self) {
+	return ((struct ttk_list_view *)self)->selected;
+}
+
+static int list_view_mouse(ttk_widget_t * self, struct yutani_msg_window_mouse_event * me, int x, int y) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	if (me->buttons & YUTANI_MOUSE_SCROLL_UP) {
+		ttk_list_view_scroll_to(self, self->scroll_y - list->row_height * 3);
+		return 1;
+	} else if (me->buttons & YUTANI_MOUSE_SCROLL_DOWN) {
+		ttk_list_view_scroll_to(self, self->scroll_y + list->row_height * 3);
+		return 1;
+	}
+
+	int row = (y + self->scroll_y) / list->row_height;
+	if (y < 0 || row >= list->count) return 0;
+
+	if (me->command == YUTANI_MOUSE_EVENT_DOWN) {
+		if (row == list->selected && self->activate) {
+			/* Clicking the selected row again activates it */
+			self->activate(self);
+		} else {
+			ttk_list_view_select(self, row);
+		}
+		return 1;
+	}
+	return 0;
+}
+
+static int list_view_key(ttk_widget_t * self, struct yutani_msg_key_event * ke) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	if (ke->event.action != KEY_ACTION_DOWN) return 0;
+	switch (ke->event.keycode) {
+		case KEY_ARROW_UP:
+			ttk_list_view_select(self, list->selected > 0 ? list->selected - 1 : 0);
+			return 1;
+		case KEY_ARROW_DOWN:
+			ttk_list_view_select(self, list->selected + 1);
+			return 1;
+		case '\n':
+			if (list->selected >= 0 && self->activate) self->activate(self);
+			return 1;
+	}
+	return 0;
+}
+
+static void list_view_destroy(ttk_widget_t * self) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	for (int i = 0; i < list->count; ++i) free(list->items[i]);
+	free(list->items);
+}
+
+void ttk_list_view_set_items(ttk_widget_t * self, char ** items, int count) {
+	struct ttk_list_view * list = (struct ttk_list_view *)self;
+	list_view_destroy(self);
+	list->items = malloc(sizeof(char *) * (count ? count : 1));
+	for (int i = 0; i < count; ++i) list->items[i] = strdup(items[i]);
+	list->count = count;
+	list->selected = -1;
+	self->scroll_y = 0;
+	ttk_widget_invalidate(self);
+}
+
+ttk_widget_t * ttk_list_view_create(int row_height) {
+	struct ttk_list_view * list = (struct ttk_list_view *)ttk_widget_create(sizeof(struct ttk_list_view));
+	list->widget.draw = list_view_draw;
+	list->widget.mouse = list_view_mouse;
+	list->widget.key = list_view_key;
+	list->widget.destroy = list_view_destroy;
+	list->widget.flags = TTK_FLAG_FOCUSABLE;
+	list->widget.background = rgb(255,255,255);
+	list->widget.expand = 1;
+	list->row_height = row_height;
+	list->selected = -1;
+	return &list->widget;
+}
+
+/* } List view */
+
+/* Text entry { */
+
+struct ttk_entry {
+	ttk_widget_t widget;
+	char * text;
+	size_t length;
+	size_t capacity;
+	size_t cursor;
+	int font;
+	int size;
+};
+
+static int entry_width_to(struct ttk_entry * entry, size_t offset) {
+	char tmp = entry->text[offset];
+	entry->text[offset] = '\0';
+	int width = tt_string_width(get_font(entry->font, entry->size), entry->text);
+	entry->text[offset] = tmp;
+	return width;
+}
+
+static void entry_draw(ttk_widget_t * self, gfx_context_t * ctx, int top) {
+	struct ttk_entry * entry = (struct ttk_entry *)self;
+	int focused = self->state & TTK_STATE_FOCUSED;
+	draw_rounded_rectangle(ctx, 0, -top, self->rect.width, self->rect.height, 4, focused ? rgb(8,138,255) : rgb(166,166,166));
+	draw_rounded_rectangle(ctx, 1, 1 - top, self->rect.width - 2, self->rect.height - 2, 3, rgb(255,255,255));
+
+	/* Slide the text left when the cursor would be past the end of the box */
+	int cursor_x = entry_width_to(entry, entry->cursor);
+	int shift = cursor_x > self->rect.width - 10 ? cursor_x - (self->rect.width - 10) : 0;
+
+	int baseline = baseline_for(self->rect.height, entry->size) - top;
+	tt_draw_string(ctx, get_font(entry->font, entry->size), 5 - shift, baseline, entry->text, rgb(0,0,0));
+
+	if (focused) {
+		draw_line(ctx, 5 + cursor_x - shift, 5 + cursor_x - shift, baseline - entry->size, baseline + 3, rgb(0,0,0));
+	}
+}
+
+static void entry_insert(struct ttk_entry * entry, char c) {
+	if (entry->length + 2 > entry->capacity) {
+		entry->capacity *= 2;
+		entry->text = realloc(entry->text, entry->capacity);
+	}
+	memmove(&entry->text[entry->cursor + 1], &entry->text[entry->cursor], entry->length - entry->cursor + 1);
+	entry->text[entry->cursor++] = c;
+	entry->length++;
+}
+
+static void entry_delete(struct ttk_entry * entry, size_t at) {
+	if (at >= entry->length) return;
+	memmove(&entry->text[at], &entry->text[at + 1], entry->length - at);
+	entry->length--;
+}
+
+static int entry_key(ttk_widget_t * self, struct yutani_msg_key_event * ke) {
+	struct ttk_entry * entry = (struct ttk_entry *)self;
+	if (ke->event.action != KEY_ACTION_DOWN) return 0;
+
+	switch (ke->event.keycode) {
+		case KEY_BACKSPACE:
+			if (entry->cursor) entry_delete(entry, --entry->cursor);
+			break;
+		case KEY_DEL:
+			entry_delete(entry, entry->cursor);
+			break;
+		case KEY_ARROW_LEFT:
+			if (entry->cursor) entry->cursor--;
+			break;
+		case KEY_ARROW_RIGHT:
+			if (entry->cursor < entry->length) entry->cursor++;
+			break;
+		case KEY_HOME:
+			entry->cursor = 0;
+			break;
+		case KEY_END:
+			entry->cursor = entry->length;
+			break;
+		case '\n':
+			if (self->activate) self->activate(self);
+			return 1;
+		default:
+			if (ke->event.key >= ' ' && ke->event.key < 0x7F) {
+				entry_insert(entry, ke->event.key);
+				break;
+			}
+			return 0;
+	}
+
+	ttk_widget_invalidate(self);
+	return 1;
+}
+
+static void entry_destroy(ttk_widget_t * self) {
+	free(((struct ttk_entry *)self)->text);
+}
+
+void ttk_entry_set_text(ttk_widget_t * self, const char * text) {
+	struct ttk_entry * entry = (struct ttk_entry *)self;
+	size_t len = strlen(text);
+	if (len + 1 > entry->capacity) {
+		entry->capacity = len + 1;
+		entry->text = realloc(entry->text, entry->capacity);
+	}
+	memcpy(entry->text, text, len + 1);
+	entry->length = len;
+	entry->cursor = len;
+	ttk_widget_invalidate(self);
+}
+
+const char * ttk_entry_get_text(ttk_widget_t * self) {
+	return ((struct ttk_entry *)self)->text;
+}
+
+ttk_widget_t * ttk_entry_create(int font, int size) {
+	struct ttk_entry * entry = (struct ttk_entry *)ttk_widget_create(sizeof(struct ttk_entry));
+	entry->widget.draw = entry_draw;
+	entry->widget.key = entry_key;
+	entry->widget.destroy = entry_destroy;
+	entry->widget.flags = TTK_FLAG_FOCUSABLE;
+	entry->capacity = 64;
+	entry->text = calloc(1, entry->capacity);
+	entry->font = font;
+	entry->size = size;
+	entry->widget.min_width = 40;
+	entry->widget.min_height = size + 12;
+	return &entry->widget;
+}
+
+/* } Text entry */
@@ -500,6 +500,17 @@ void yutani_msg_buildx_special_request(yutani_msg_t * msg, yutani_wid_t wid, uin
 	sr->request = request;
 }
 
+void yutani_msg_buildx_frame(yutani_msg_t * msg, uint32_t type, yutani_wid_t wid, uint64_t time) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = type;
+	msg->size  = sizeof(struct yutani_message) + sizeof(struct yutani_msg_frame);
+
+	struct yutani_msg_frame * mf = (void *)msg->data;
+
+	mf->wid  = wid;
+	mf->time = time;
+}
+
 void yutani_msg_buildx_clipboard(yutani_msg_t * msg, char * content) {
 	msg->magic = YUTANI_MSG__MAGIC;
 	msg->type  = YUTANI_MSG_CLIPBOARD;
@@ -629,6 +640,20 @@ void yutani_flip_region(yutani_t * yctx, yutani_window_t * win, int32_t x, int32
 	yutani_msg_send(yctx, m);
 }
 
+/**
+ * yutani_window_request_frame
+ *
+ * Ask the server to send a FRAME_DONE message for this window once
+ * the next frame has been presented. Animating applications should
+ * request a frame along with each flip and draw their next frame
+ * when the message arrives, instead of drawing on a timer.
+ */
+void yutani_window_request_frame(yutani_t * yctx, yutani_window_t * window) {
+	yutani_msg_buildx_frame_alloc(m);
+	yutani_msg_buildx_frame(m, YUTANI_MSG_FRAME_REQUEST, window->wid, 0);
+	yutani_msg_send(yctx, m);
+}
+
 /**
  * yutani_close
  *
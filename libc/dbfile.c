@@ -0,0 +1,45 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * Internal helpers shared by the passwd and group caches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+/**
+ * Hash a user or group name for the by-name indexes (djb2).
+ */
+size_t __dbfile_hash_name(const char * name) {
+	size_t hash = 5381;
+	while (*name) {
+		hash = (hash << 5) + hash + (unsigned char)*name++;
+	}
+	return hash;
+}
+
+/**
+ * Read all of @p path into a nul-terminated buffer for the
+ * caller to split in place and free.
+ */
+char * __dbfile_read(const char * path, size_t * size_out) {
+	FILE * f = fopen(path, "r");
+	if (!f) return NULL;
+
+	size_t size = 0, avail = 1024;
+	char * data = malloc(avail);
+	size_t r;
+	while ((r = fread(data + size, 1, avail - size - 1, f)) > 0) {
+		size += r;
+		if (avail - size - 1 == 0) {
+			avail *= 2;
+			data = realloc(data, avail);
+		}
+	}
+	fclose(f);
+	data[size] = '\0';
+	*size_out = size;
+	return data;
+}
@@ -21,9 +21,22 @@ DIR * opendir (const char * dirname) {
 	return dir;
 }
 
+DIR * fdopendir (int fd) {
+	DIR * dir = (DIR *)malloc(sizeof(DIR));
+	dir->fd = fd;
+	dir->cur_entry = -1;
+	return dir;
+}
+
+int dirfd (DIR * dirp) {
+	return dirp->fd;
+}
+
 int closedir (DIR * dir) {
 	if (dir && (dir->fd != -1)) {
-		return close(dir->fd);
+		int ret = close(dir->fd);
+		free(dir);
+		return ret;
 	} else {
 		return -EBADF;
 	}
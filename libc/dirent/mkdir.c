@@ -4,7 +4,12 @@
 #include <sys/stat.h>
 
 DEFN_SYSCALL2(mkdir, SYS_MKDIR, char *, unsigned int);
+DEFN_SYSCALL3(mkdirat, SYS_MKDIRAT, int, const char *, unsigned int);
 
 int mkdir(const char *pathname, mode_t mode) {
 	__sets_errno(syscall_mkdir((char *)pathname, mode));
 }
+
+int mkdirat(int dirfd, const char *pathname, mode_t mode) {
+	__sets_errno(syscall_mkdirat(dirfd, pathname, mode));
+}
@@ -0,0 +1,237 @@
+/* vim: tabstop=4 shiftwidth=4 noexpandtab
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ *
+ * getgrent, setgrent, endgrent
+ * getgrgid, getgrnam, getgrgid_r, getgrnam_r
+ *
+ * These functions manage entries in the group file.
+ *
+ * As with the passwd functions, /etc/group is parsed once into a
+ * cache with hash indexes by gid and name, and reloaded when the
+ * file's mtime, size or inode change.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <grp.h>
+#include <sys/stat.h>
+
+extern size_t __dbfile_hash_name(const char * name);
+extern char * __dbfile_read(const char * path, size_t * size_out);
+
+static struct {
+	time_t mtime;
+	off_t size;
+	ino_t ino;
+	int loaded;
+
+	char * data;              /* File contents, split in place */
+	struct group * entries;
+	char ** members;          /* All gr_mem lists, back to back */
+	size_t count;
+
+	size_t hash_size;         /* Power of two */
+	int * by_gid;             /* Entry index + 1, or 0 for empty */
+	int * by_name;
+} gr_cache;
+
+/* Position for getgrent() */
+static size_t gr_next = 0;
+
+static size_t hash_gid(gid_t gid) {
+	return (size_t)gid * 2654435761U;
+}
+
+static void gr_cache_free(void) {
+	free(gr_cache.data);
+	free(gr_cache.entries);
+	free(gr_cache.members);
+	free(gr_cache.by_gid);
+	free(gr_cache.by_name);
+	memset(&gr_cache, 0, sizeof(gr_cache));
+}
+
+/**
+ * Make sure the cache reflects the current /etc/group.
+ * Returns 0 if there is no database to search.
+ */
+static int gr_cache_load(void) {
+	struct stat st;
+	if (stat("/etc/group", &st) < 0) {
+		gr_cache_free();
+		return 0;
+	}
+
+	if (gr_cache.loaded && st.st_mtime == gr_cache.mtime &&
+		st.st_size == gr_cache.size && st.st_ino == gr_cache.ino) {
+		return 1;
+	}
+
+	gr_cache_free();
+
+	size_t size;
+	char * data = __dbfile_read("/etc/group", &size);
+	if (!data) return 0;
+
+	/* Every line and comma may start a new member list or member */
+	size_t lines = 1, commas = 0;
+	for (size_t i = 0; i < size; ++i) {
+		if (data[i] == '\n') lines++;
+		if (data[i] == ',') commas++;
+	}
+
+	gr_cache.data = data;
+	gr_cache.entries = malloc(sizeof(struct group) * lines);
+	gr_cache.members = malloc(sizeof(char *) * (lines * 2 + commas));
+	char ** member = gr_cache.members;
+
+	char * line = data;
+	while (line && *line) {
+		char * next = strchr(line, '\n');
+		if (next) *next++ = '\0';
+
+		char * fields[4];
+		int n = 0;
+		fields[n++] = line;
+		for (char * c = line; n < 4 && (c = strchr(c, ':')); ) {
+			*c++ = '\0';
+			fields[n++] = c;
+		}
+
+		if (n >= 3) {
+			struct group * g = &gr_cache.entries[gr_cache.count++];
+			g->gr_name   = fields[0];
+			g->gr_passwd = fields[1];
+			g->gr_gid    = atoi(fields[2]);
+			g->gr_mem    = member;
+			if (n == 4 && *fields[3]) {
+				char * m = fields[3];
+				while (m) {
+					char * comma = strchr(m, ',');
+					if (comma) *comma++ = '\0';
+					if (*m) *member++ = m;
+					m = comma;
+				}
+			}
+			*member++ = NULL;
+		}
+
+		line = next;
+	}
+
+	gr_cache.hash_size = 16;
+	while (gr_cache.hash_size < gr_cache.count * 2) gr_cache.hash_size *= 2;
+	gr_cache.by_gid  = calloc(gr_cache.hash_size, sizeof(int));
+	gr_cache.by_name = calloc(gr_cache.hash_size, sizeof(int));
+
+	size_t mask = gr_cache.hash_size - 1;
+	for (size_t i = 0; i < gr_cache.count; ++i) {
+		struct group * g = &gr_cache.entries[i];
+		/* The first entry for a gid or name wins, as with a linear search. */
+		size_t h = hash_gid(g->gr_gid) & mask;
+		while (gr_cache.by_gid[h] && gr_cache.entries[gr_cache.by_gid[h]-1].gr_gid != g->gr_gid) h = (h + 1) & mask;
+		if (!gr_cache.by_gid[h]) gr_cache.by_gid[h] = i + 1;
+
+		h = __dbfile_hash_name(g->gr_name) & mask;
+		while (gr_cache.by_name[h] && strcmp(gr_cache.entries[gr_cache.by_name[h]-1].gr_name, g->gr_name)) h = (h + 1) & mask;
+		if (!gr_cache.by_name[h]) gr_cache.by_name[h] = i + 1;
+	}
+
+	gr_cache.mtime = st.st_mtime;
+	gr_cache.size  = st.st_size;
+	gr_cache.ino   = st.st_ino;
+	gr_cache.loaded = 1;
+	return 1;
+}
+
+static struct group * gr_cache_gid(gid_t gid) {
+	if (!gr_cache_load()) return NULL;
+	size_t mask = gr_cache.hash_size - 1;
+	for (size_t h = hash_gid(gid) & mask; gr_cache.by_gid[h]; h = (h + 1) & mask) {
+		struct group * g = &gr_cache.entries[gr_cache.by_gid[h]-1];
+		if (g->gr_gid == gid) return g;
+	}
+	return NULL;
+}
+
+static struct group * gr_cache_name(const char * name) {
+	if (!gr_cache_load()) return NULL;
+	size_t mask = gr_cache.hash_size - 1;
+	for (size_t h = __dbfile_hash_name(name) & mask; gr_cache.by_name[h]; h = (h + 1) & mask) {
+		struct group * g = &gr_cache.entries[gr_cache.by_name[h]-1];
+		if (!strcmp(g->gr_name, name)) return g;
+	}
+	return NULL;
+}
+
+/**
+ * Copy a cached entry into caller storage for the _r functions;
+ * the member pointer array goes first, then the strings.
+ */
+static int gr_copy(struct group * from, struct group * grp, char * buf, size_t buflen, struct group ** result) {
+	*result = NULL;
+	if (!from) return 0;
+
+	size_t members = 0;
+	while (from->gr_mem[members]) members++;
+
+	size_t align = (sizeof(char *) - ((uintptr_t)buf % sizeof(char *))) % sizeof(char *);
+	size_t array = sizeof(char *) * (members + 1);
+	if (align + array > buflen) return ERANGE;
+	char ** mem = (char **)(buf + align);
+	buf += align + array;
+	buflen -= align + array;
+
+	for (size_t i = 0; i <= members + 1; ++i) {
+		char * from_str = i == 0 ? from->gr_name : i == 1 ? from->gr_passwd : from->gr_mem[i-2];
+		size_t len = strlen(from_str) + 1;
+		if (len > buflen) return ERANGE;
+		memcpy(buf, from_str, len);
+		if (i == 0) grp->gr_name = buf;
+		else if (i == 1) grp->gr_passwd = buf;
+		else mem[i-2] = buf;
+		buf += len;
+		buflen -= len;
+	}
+	mem[members] = NULL;
+
+	grp->gr_gid = from->gr_gid;
+	grp->gr_mem = mem;
+	*result = grp;
+	return 0;
+}
+
+struct group * getgrent(void) {
+	if (!gr_cache_load()) return NULL;
+	if (gr_next >= gr_cache.count) return NULL;
+	return &gr_cache.entries[gr_next++];
+}
+
+void setgrent(void) {
+	gr_next = 0;
+}
+
+void endgrent(void) {
+	gr_next = 0;
+}
+
+struct group * getgrnam(const char * name) {
+	return gr_cache_name(name);
+}
+
+struct group * getgrgid(gid_t gid) {
+	return gr_cache_gid(gid);
+}
+
+int getgrnam_r(const char * name, struct group * grp, char * buf, size_t buflen, struct group ** result) {
+	return gr_copy(gr_cache_name(name), grp, buf, buflen, result);
+}
+
+int getgrgid_r(gid_t gid, struct group * grp, char * buf, size_t buflen, struct group ** result) {
+	return gr_copy(gr_cache_gid(gid), grp, buf, buflen, result);
+}
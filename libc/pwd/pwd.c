@@ -4,9 +4,14 @@
  * Copyright (C) 2013-2018 K. Lange
  *
  * getpwent, setpwent, endpwent, fgetpwent
- * getpwuid, getpwnam
+ * getpwuid, getpwnam, getpwuid_r, getpwnam_r
  *
  * These functions manage entries in the password files.
+ *
+ * Lookups by uid and name are served from a parsed copy of
+ * /etc/passwd with hash indexes over both, which is reloaded when
+ * the file's mtime, size or inode change, so looking up every
+ * file's owner in a large listing doesn't re-read the file.
  */
 
 #include <stdio.h>
@@ -14,6 +19,10 @@
 #include <string.h>
 #include <errno.h>
 #include <pwd.h>
+#include <sys/stat.h>
+
+extern size_t __dbfile_hash_name(const char * name);
+extern char * __dbfile_read(const char * path, size_t * size_out);
 
 /*
 struct passwd {
@@ -109,32 +118,181 @@ void endpwent(void) {
 	}
 }
 
-struct passwd * getpwnam(const char * name) {
-	struct passwd * p;
+/* The cached database */
+static struct {
+	time_t mtime;
+	off_t size;
+	ino_t ino;
+	int loaded;
 
-	setpwent();
+	char * data;              /* File contents, split in place */
+	struct passwd * entries;
+	size_t count;
 
-	while ((p = getpwent())) {
-		if (!strcmp(p->pw_name, name)) {
-			return p;
-		}
+	size_t hash_size;         /* Power of two */
+	int * by_uid;             /* Entry index + 1, or 0 for empty */
+	int * by_name;
+} pw_cache;
+
+static size_t hash_uid(uid_t uid) {
+	return (size_t)uid * 2654435761U;
+}
+
+/**
+ * Split @p line at up to @p max colons; fields may be empty.
+ */
+static int split_fields(char * line, char ** fields, int max) {
+	int count = 0;
+	fields[count++] = line;
+	while (count < max && (line = strchr(line, ':'))) {
+		*line++ = '\0';
+		fields[count++] = line;
 	}
+	return count;
+}
 
-	return NULL;
+static void pw_cache_free(void) {
+	free(pw_cache.data);
+	free(pw_cache.entries);
+	free(pw_cache.by_uid);
+	free(pw_cache.by_name);
+	memset(&pw_cache, 0, sizeof(pw_cache));
 }
 
-struct passwd * getpwuid(uid_t uid) {
-	struct passwd * p;
+/**
+ * Make sure the cache reflects the current /etc/passwd.
+ * Returns 0 if there is no database to search.
+ */
+static int pw_cache_load(void) {
+	struct stat st;
+	if (stat("/etc/passwd", &st) < 0) {
+		pw_cache_free();
+		return 0;
+	}
+
+	if (pw_cache.loaded && st.st_mtime == pw_cache.mtime &&
+		st.st_size == pw_cache.size && st.st_ino == pw_cache.ino) {
+		return 1;
+	}
+
+	pw_cache_free();
+
+	size_t size;
+	char * data = __dbfile_read("/etc/passwd", &size);
+	if (!data) return 0;
+
+	size_t lines = 1;
+	for (size_t i = 0; i < size; ++i) {
+		if (data[i] == '\n') lines++;
+	}
+
+	pw_cache.data = data;
+	pw_cache.entries = malloc(sizeof(struct passwd) * lines);
 
-	setpwent();
+	char * line = data;
+	while (line && *line) {
+		char * next = strchr(line, '\n');
+		if (next) *next++ = '\0';
 
-	while ((p = getpwent())) {
-		if (p->pw_uid == uid) {
-			return p;
+		char * fields[8];
+		int n = split_fields(line, fields, 8);
+		if (n >= 7) {
+			struct passwd * p = &pw_cache.entries[pw_cache.count++];
+			p->pw_name    = fields[0];
+			p->pw_passwd  = fields[1];
+			p->pw_uid     = atoi(fields[2]);
+			p->pw_gid     = atoi(fields[3]);
+			p->pw_gecos   = fields[4];
+			p->pw_dir     = fields[5];
+			p->pw_shell   = fields[6];
+			p->pw_comment = n > 7 ? fields[7] : "";
 		}
+
+		line = next;
 	}
 
+	pw_cache.hash_size = 16;
+	while (pw_cache.hash_size < pw_cache.count * 2) pw_cache.hash_size *= 2;
+	pw_cache.by_uid  = calloc(pw_cache.hash_size, sizeof(int));
+	pw_cache.by_name = calloc(pw_cache.hash_size, sizeof(int));
+
+	size_t mask = pw_cache.hash_size - 1;
+	for (size_t i = 0; i < pw_cache.count; ++i) {
+		struct passwd * p = &pw_cache.entries[i];
+		/* The first entry for a uid or name wins, as with a linear search. */
+		size_t h = hash_uid(p->pw_uid) & mask;
+		while (pw_cache.by_uid[h] && pw_cache.entries[pw_cache.by_uid[h]-1].pw_uid != p->pw_uid) h = (h + 1) & mask;
+		if (!pw_cache.by_uid[h]) pw_cache.by_uid[h] = i + 1;
+
+		h = __dbfile_hash_name(p->pw_name) & mask;
+		while (pw_cache.by_name[h] && strcmp(pw_cache.entries[pw_cache.by_name[h]-1].pw_name, p->pw_name)) h = (h + 1) & mask;
+		if (!pw_cache.by_name[h]) pw_cache.by_name[h] = i + 1;
+	}
+
+	pw_cache.mtime = st.st_mtime;
+	pw_cache.size  = st.st_size;
+	pw_cache.ino   = st.st_ino;
+	pw_cache.loaded = 1;
+	return 1;
+}
+
+static struct passwd * pw_cache_uid(uid_t uid) {
+	if (!pw_cache_load()) return NULL;
+	size_t mask = pw_cache.hash_size - 1;
+	for (size_t h = hash_uid(uid) & mask; pw_cache.by_uid[h]; h = (h + 1) & mask) {
+		struct passwd * p = &pw_cache.entries[pw_cache.by_uid[h]-1];
+		if (p->pw_uid == uid) return p;
+	}
+	return NULL;
+}
+
+static struct passwd * pw_cache_name(const char * name) {
+	if (!pw_cache_load()) return NULL;
+	size_t mask = pw_cache.hash_size - 1;
+	for (size_t h = __dbfile_hash_name(name) & mask; pw_cache.by_name[h]; h = (h + 1) & mask) {
+		struct passwd * p = &pw_cache.entries[pw_cache.by_name[h]-1];
+		if (!strcmp(p->pw_name, name)) return p;
+	}
 	return NULL;
 }
 
+/**
+ * Copy a cached entry into caller storage for the _r functions.
+ */
+static int pw_copy(struct passwd * from, struct passwd * pwd, char * buf, size_t buflen, struct passwd ** result) {
+	*result = NULL;
+	if (!from) return 0;
+
+	char * strings[] = {from->pw_name, from->pw_passwd, from->pw_comment, from->pw_gecos, from->pw_dir, from->pw_shell};
+	char ** targets[] = {&pwd->pw_name, &pwd->pw_passwd, &pwd->pw_comment, &pwd->pw_gecos, &pwd->pw_dir, &pwd->pw_shell};
+
+	for (int i = 0; i < 6; ++i) {
+		size_t len = strlen(strings[i]) + 1;
+		if (len > buflen) return ERANGE;
+		memcpy(buf, strings[i], len);
+		*targets[i] = buf;
+		buf += len;
+		buflen -= len;
+	}
 
+	pwd->pw_uid = from->pw_uid;
+	pwd->pw_gid = from->pw_gid;
+	*result = pwd;
+	return 0;
+}
+
+struct passwd * getpwnam(const char * name) {
+	return pw_cache_name(name);
+}
+
+struct passwd * getpwuid(uid_t uid) {
+	return pw_cache_uid(uid);
+}
+
+int getpwnam_r(const char * name, struct passwd * pwd, char * buf, size_t buflen, struct passwd ** result) {
+	return pw_copy(pw_cache_name(name), pwd, buf, buflen, result);
+}
+
+int getpwuid_r(uid_t uid, struct passwd * pwd, char * buf, size_t buflen, struct passwd ** result) {
+	return pw_copy(pw_cache_uid(uid), pwd, buf, buflen, result);
+}
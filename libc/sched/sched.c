@@ -0,0 +1,68 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <sched.h>
+#include <errno.h>
+
+DEFN_SYSCALL3(sched_setscheduler, SYS_SCHED_SETSCHEDULER, int, int, const void*);
+DEFN_SYSCALL2(sched_getparam, SYS_SCHED_GETPARAM, int, void*);
+DEFN_SYSCALL3(sched_setaffinity, SYS_SCHED_SETAFFINITY, int, unsigned long, const void*);
+DEFN_SYSCALL3(sched_getaffinity, SYS_SCHED_GETAFFINITY, int, unsigned long, void*);
+
+int sched_get_priority_min(int policy) {
+	switch (policy) {
+		case SCHED_OTHER: return 0;
+		case SCHED_FIFO:
+		case SCHED_RR: return SCHED_PRIORITY_MIN;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+int sched_get_priority_max(int policy) {
+	switch (policy) {
+		case SCHED_OTHER: return 0;
+		case SCHED_FIFO:
+		case SCHED_RR: return SCHED_PRIORITY_MAX;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+int sched_setscheduler(pid_t pid, int policy, const struct sched_param * param) {
+	if (policy < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	__sets_errno(syscall_sched_setscheduler(pid, policy, param));
+}
+
+int sched_setparam(pid_t pid, const struct sched_param * param) {
+	/* A negative policy keeps the current one */
+	__sets_errno(syscall_sched_setscheduler(pid, -1, param));
+}
+
+int sched_getscheduler(pid_t pid) {
+	__sets_errno(syscall_sched_getparam(pid, NULL));
+}
+
+int sched_getparam(pid_t pid, struct sched_param * param) {
+	long ret = syscall_sched_getparam(pid, param);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+	return 0;
+}
+
+int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t * mask) {
+	__sets_errno(syscall_sched_setaffinity(pid, cpusetsize, mask));
+}
+
+int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t * mask) {
+	long ret = syscall_sched_getaffinity(pid, cpusetsize, mask);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+	return 0;
+}
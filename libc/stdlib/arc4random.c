@@ -0,0 +1,30 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/random.h>
+
+void arc4random_buf(void * buf, size_t nbytes) {
+	char * out = buf;
+	while (nbytes) {
+		ssize_t got = getrandom(out, nbytes, 0);
+		if (got <= 0) abort();
+		out += got;
+		nbytes -= got;
+	}
+}
+
+unsigned int arc4random(void) {
+	uint32_t out;
+	arc4random_buf(&out, sizeof(out));
+	return out;
+}
+
+unsigned int arc4random_uniform(unsigned int upper_bound) {
+	if (upper_bound < 2) return 0;
+	/* Reject values below 2^32 % upper_bound so every result is equally likely */
+	uint32_t min = -upper_bound % upper_bound;
+	uint32_t r;
+	do {
+		r = arc4random();
+	} while (r < min);
+	return r % upper_bound;
+}
@@ -10,10 +10,11 @@ char * mktemp(char * template) {
 		errno = EINVAL;
 		return NULL;
 	}
-	static int _i = 0;
-	char tmp[7] = {0};
-	sprintf(tmp,"%04d%02d", getpid(), _i++);
-	memcpy(template + strlen(template) - 6, tmp, 6);
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	char * x = template + strlen(template) - 6;
+	for (int i = 0; i < 6; ++i) {
+		x[i] = chars[arc4random_uniform(sizeof(chars) - 1)];
+	}
 	return template;
 }
 
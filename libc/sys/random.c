@@ -0,0 +1,10 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <sys/random.h>
+#include <errno.h>
+
+DEFN_SYSCALL3(getrandom, SYS_GETRANDOM, void *, unsigned long, unsigned int);
+
+ssize_t getrandom(void * buf, size_t buflen, unsigned int flags) {
+	__sets_errno(syscall_getrandom(buf, buflen, flags));
+}
@@ -0,0 +1,14 @@
+#include <unistd.h>
+#include <errno.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL5(copy_file_range, SYS_COPY_FILE_RANGE, int, long *, int, long *, unsigned long);
+
+ssize_t copy_file_range(int fd_in, off_t * off_in, int fd_out, off_t * off_out, size_t len, unsigned int flags) {
+	if (flags) {
+		errno = EINVAL;
+		return -1;
+	}
+	__sets_errno(syscall_copy_file_range(fd_in, (long *)off_in, fd_out, (long *)off_out, len));
+}
@@ -0,0 +1,15 @@
+#include <unistd.h>
+#include <errno.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL1(fsync, SYS_FSYNC, int);
+DEFN_SYSCALL1(fdatasync, SYS_FDATASYNC, int);
+
+int fsync(int fd) {
+	__sets_errno(syscall_fsync(fd));
+}
+
+int fdatasync(int fd) {
+	__sets_errno(syscall_fdatasync(fd));
+}
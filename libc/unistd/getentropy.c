@@ -0,0 +1,12 @@
+#include <unistd.h>
+#include <errno.h>
+#include <sys/random.h>
+
+int getentropy(void * buffer, size_t length) {
+	if (length > 256) {
+		errno = EIO;
+		return -1;
+	}
+	if (getrandom(buffer, length, 0) != (ssize_t)length) return -1;
+	return 0;
+}
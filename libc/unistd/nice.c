@@ -0,0 +1,14 @@
+#include <unistd.h>
+#include <errno.h>
+#include <sys/resource.h>
+
+int nice(int inc) {
+	errno = 0;
+	int current = getpriority(PRIO_PROCESS, 0);
+	if (current == -1 && errno) return -1;
+	if (setpriority(PRIO_PROCESS, 0, current + inc) < 0) {
+		if (errno == EACCES) errno = EPERM;
+		return -1;
+	}
+	return getpriority(PRIO_PROCESS, 0);
+}
@@ -7,6 +7,7 @@
 #include <syscall_nums.h>
 
 DEFN_SYSCALL3(open,  SYS_OPEN, const char *, int, int);
+DEFN_SYSCALL4(openat, SYS_OPENAT, int, const char *, int, int);
 
 int open(const char *name, int flags, ...) {
 	va_list argp;
@@ -31,3 +32,13 @@ int open(const char *name, int flags, ...) {
 	return result;
 }
 
+
+int openat(int dirfd, const char *name, int flags, ...) {
+	va_list argp;
+	int mode = 0;
+	va_start(argp, flags);
+	if (flags & O_CREAT) mode = va_arg(argp, int);
+	va_end(argp);
+
+	__sets_errno(syscall_openat(dirfd, name, flags, mode));
+}
@@ -4,8 +4,13 @@
 #include <syscall_nums.h>
 
 DEFN_SYSCALL3(readlink, SYS_READLINK, char *, char *, int);
+DEFN_SYSCALL4(readlinkat, SYS_READLINKAT, int, const char *, char *, long);
 
 ssize_t readlink(const char * name, char * buf, size_t len) {
 	__sets_errno(syscall_readlink((char*)name, buf, len));
 }
 
+
+ssize_t readlinkat(int dirfd, const char * name, char * buf, size_t len) {
+	__sets_errno(syscall_readlinkat(dirfd, name, buf, len));
+}
@@ -6,6 +6,7 @@
 
 DEFN_SYSCALL2(statf, SYS_STATF, char *, void *);
 DEFN_SYSCALL2(lstat, SYS_LSTAT, char *, void *);
+DEFN_SYSCALL4(fstatat, SYS_FSTATAT, int, const char *, void *, int);
 
 int stat(const char *file, struct stat *st){
 	int ret = syscall_statf((char *)file, (void *)st);
@@ -28,3 +29,14 @@ int lstat(const char *path, struct stat *st) {
 		return -1;
 	}
 }
+
+int fstatat(int dirfd, const char *path, struct stat *st, int flags) {
+	int ret = syscall_fstatat(dirfd, path, (void *)st, flags);
+	if (ret >= 0) {
+		return ret;
+	} else {
+		errno = -ret;
+		memset(st, 0x00, sizeof(struct stat));
+		return -1;
+	}
+}
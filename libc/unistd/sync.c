@@ -1,8 +1,11 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL0(sync, SYS_SYNC);
 
 void sync(void) {
-	/* TODO */
+	syscall_sync();
 }
-
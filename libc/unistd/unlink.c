@@ -4,7 +4,12 @@
 #include <syscall_nums.h>
 
 DEFN_SYSCALL1(unlink, SYS_UNLINK, char *);
+DEFN_SYSCALL3(unlinkat, SYS_UNLINKAT, int, const char *, int);
 
 int unlink(const char * pathname) {
 	__sets_errno(syscall_unlink((char *)pathname));
 }
+
+int unlinkat(int dirfd, const char * pathname, int flags) {
+	__sets_errno(syscall_unlinkat(dirfd, pathname, flags));
+}
@@ -315,6 +315,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x8086, 0x2415});
+
 struct Module metadata = {
 	.name = "ac97",
 	.init = ac97_install,
@@ -917,6 +917,8 @@ static int ata_finalize(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x8086, 0x7111}, {0x8086, 0x7010});
+
 struct Module metadata = {
 	.name = "ata",
 	.init = ata_initialize,
@@ -591,6 +591,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x8086, 0x100E}, {0x8086, 0x1004}, {0x8086, 0x100F}, {0x8086, 0x10EA}, {0x8086, 0x10D3});
+
 struct Module metadata = {
 	.name = "e1000",
 	.init = e1000_install,
@@ -327,6 +327,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x1274, 0x1371});
+
 struct Module metadata = {
 	.name = "es1371",
 	.init = es1371_install,
@@ -11,6 +11,7 @@
 #include <kernel/vfs.h>
 #include <kernel/printf.h>
 #include <kernel/time.h>
+#include <kernel/process.h>
 #include <kernel/string.h>
 #include <kernel/spinlock.h>
 #include <kernel/tokenize.h>
@@ -172,11 +173,31 @@ typedef struct {
 	uint32_t block_no;
 	uint32_t last_use;
 	uint8_t  dirty;
+	uint8_t  writeback;     /* Being written out by writeback(); must not be evicted */
+	unsigned long dirtied;  /* When the entry became dirty, in seconds */
 	uint8_t *block;
 } ext2_disk_cache_entry_t;
 
 typedef int (*ext2_block_io_t) (void *, uint32_t, uint8_t *);
 
+/*
+ * A window of blocks set aside, in memory only, for the file that is
+ * currently being written, so that its blocks end up contiguous even
+ * when other files are growing at the same time.
+ */
+typedef struct {
+	uint32_t inode;
+	uint32_t next;  /* Next block to try within the window */
+	uint32_t end;   /* First block past the window */
+} ext2_reservation_t;
+
+#define EXT2_RESERVATIONS   16
+#define EXT2_RESERVE_BLOCKS 64
+
+#define EXT2_FLUSH_BATCH    64  /* Dirty blocks written out per pass */
+#define EXT2_DIRTY_AGE      5   /* Seconds a block may stay dirty before the flusher writes it */
+#define EXT2_DIRTY_RATIO    50  /* Percentage of the cache writers may dirty before they have to help */
+
 #define EXT2_BGD_BLOCK 2
 
 #define E_SUCCESS   0
@@ -214,6 +235,20 @@ typedef struct {
 
 	uint8_t *                 cache_data;
 
+	spin_lock_t               alloc_lock;          /* Bitmap, reservations and dirty flags; taken before flush_lock and lock */
+	uint8_t *                 bitmap;              /* Block bitmap of bitmap_group, written back lazily */
+	int                       bitmap_group;        /* -1 if nothing is loaded */
+	int                       bitmap_dirty;
+	int                       metadata_dirty;      /* Block group descriptors and superblock need rewriting */
+
+	ext2_reservation_t        reservations[EXT2_RESERVATIONS];
+	unsigned int              reservation_next;    /* Slot to reuse when all are taken */
+
+	unsigned int              dirty_count;         /* Dirty entries in the cache */
+	spin_lock_t               flush_lock;          /* Serializes writeback() */
+	uint8_t *                 flush_buffer;        /* EXT2_FLUSH_BATCH blocks, sorted for writing */
+	process_t *               flusher;
+
 	int flags;
 } ext2_fs_t;
 
@@ -244,7 +279,9 @@ static ext2_inodetable_t * read_inode(ext2_fs_t * this, size_t inode);
 static void refresh_inode(ext2_fs_t * this, ext2_inodetable_t * inodet,  size_t inode);
 static int write_inode(ext2_fs_t * this, ext2_inodetable_t *inode, size_t index);
 static fs_node_t * finddir_ext2(fs_node_t *node, char *name);
-static size_t allocate_block(ext2_fs_t * this);
+static size_t allocate_block(ext2_fs_t * this, unsigned int inode_no, size_t goal, int zero);
+static unsigned int writeback(ext2_fs_t * this, int all);
+static void flush_metadata(ext2_fs_t * this);
 
 /**
  * ext2->get_cache_time Increment and return the current cache time
@@ -264,10 +301,51 @@ static size_t get_cache_time(ext2_fs_t * this) {
 static int cache_flush_dirty(ext2_fs_t * this, size_t ent_no) {
 	write_fs(this->block_device, (DC[ent_no].block_no) * this->block_size, this->block_size, (uint8_t *)(DC[ent_no].block));
 	DC[ent_no].dirty = 0;
+	this->dirty_count--;
 
 	return E_SUCCESS;
 }
 
+/**
+ * ext2->cache_victim Pick the cache entry to replace.
+ *
+ * The least recently used clean entry is preferred, so that a miss only
+ * has to write a block out itself when the flusher has fallen behind.
+ * Entries under writeback are never chosen.
+ *
+ * @returns Entry number, or -1 if every entry is being written back
+ */
+static int cache_victim(ext2_fs_t * this) {
+	int clean = -1, dirty = -1;
+	unsigned int clean_age = UINT32_MAX, dirty_age = UINT32_MAX;
+	for (unsigned int i = 0; i < this->cache_entries; ++i) {
+		if (DC[i].writeback) continue;
+		if (DC[i].dirty) {
+			if (DC[i].last_use < dirty_age) {
+				dirty = i;
+				dirty_age = DC[i].last_use;
+			}
+		} else if (DC[i].last_use < clean_age) {
+			clean = i;
+			clean_age = DC[i].last_use;
+		}
+	}
+	return clean != -1 ? clean : dirty;
+}
+
+/**
+ * ext2->cache_mark_dirty Note that a cache entry has been modified.
+ */
+static void cache_mark_dirty(ext2_fs_t * this, size_t ent_no) {
+	if (!DC[ent_no].dirty) {
+		unsigned long seconds, subseconds;
+		relative_time(0, 0, &seconds, &subseconds);
+		DC[ent_no].dirty = 1;
+		DC[ent_no].dirtied = seconds;
+		this->dirty_count++;
+	}
+}
+
 /**
  * ext2->rewrite_superblock Rewrite the superblock.
  *
@@ -308,12 +386,7 @@ static int read_block(ext2_fs_t * this, unsigned int block_no, uint8_t * buf) {
 		return E_SUCCESS;
 	}
 
-	/*
-	 * Search the cache for this entry
-	 * We'll look for the oldest entry, too.
-	 */
-	int oldest = -1;
-	unsigned int oldest_age = UINT32_MAX;
+	/* Search the cache for this entry */
 	for (unsigned int i = 0; i < this->cache_entries; ++i) {
 		if (DC[i].block_no == block_no) {
 			/* We found it! Update usage times */
@@ -325,17 +398,19 @@ static int read_block(ext2_fs_t * this, unsigned int block_no, uint8_t * buf) {
 			/* Success! */
 			return E_SUCCESS;
 		}
-		if (DC[i].last_use < oldest_age) {
-			/* We found an older block, remember this. */
-			oldest = i;
-			oldest_age = DC[i].last_use;
-		}
 	}
 
 	/*
 	 * At this point, we did not find this block in the cache.
 	 * We are going to replace the oldest entry with this new one.
 	 */
+	int oldest = cache_victim(this);
+	if (oldest == -1) {
+		/* Everything is in flight; go around the cache */
+		read_fs(this->block_device, block_no * this->block_size, this->block_size, (uint8_t *)buf);
+		spin_unlock(this->lock);
+		return E_SUCCESS;
+	}
 
 	/* We'll start by flushing the block if it was dirty. */
 	if (DC[oldest].dirty) {
@@ -385,24 +460,25 @@ static int write_block(ext2_fs_t * this, unsigned int block_no, uint8_t *buf) {
 
 	/* Find the entry in the cache */
 	int oldest = -1;
-	unsigned int oldest_age = UINT32_MAX;
 	for (unsigned int i = 0; i < this->cache_entries; ++i) {
 		if (DC[i].block_no == block_no) {
 			/* We found it. Update the cache entry */
 			DC[i].last_use = get_cache_time(this);
-			DC[i].dirty = 1;
+			cache_mark_dirty(this, i);
 			memcpy(DC[i].block, buf, this->block_size);
-			spin_unlock(this->lock);
-			return E_SUCCESS;
-		}
-		if (DC[i].last_use < oldest_age) {
-			/* Keep track of the oldest entry */
-			oldest = i;
-			oldest_age = DC[i].last_use;
+			goto _written;
 		}
 	}
 
 	/* We did not find this element in the cache, so make room. */
+	oldest = cache_victim(this);
+	if (oldest == -1) {
+		/* Everything is in flight; go around the cache */
+		write_fs(this->block_device, block_no * this->block_size, this->block_size, buf);
+		spin_unlock(this->lock);
+		return E_SUCCESS;
+	}
+
 	if (DC[oldest].dirty) {
 		/* Flush the oldest entry */
 		cache_flush_dirty(this, oldest);
@@ -412,31 +488,115 @@ static int write_block(ext2_fs_t * this, unsigned int block_no, uint8_t *buf) {
 	memcpy(DC[oldest].block, buf, this->block_size);
 	DC[oldest].block_no = block_no;
 	DC[oldest].last_use = get_cache_time(this);
-	DC[oldest].dirty = 1;
+	cache_mark_dirty(this, oldest);
 
+_written:
 	/* Release the lock */
 	spin_unlock(this->lock);
 
+	/* Writers that get too far ahead of the flusher help it out */
+	if (this->dirty_count * 100 > this->cache_entries * EXT2_DIRTY_RATIO) {
+		writeback(this, 1);
+	}
+
 	/* We're done. */
 	return E_SUCCESS;
 }
 
-static unsigned int ext2_sync(ext2_fs_t * this) {
-	if (!this->disk_cache) return 0;
+/**
+ * ext2->writeback Write out a batch of dirty cache entries.
+ *
+ * Entries are copied out under the filesystem lock, then written in
+ * block order, with runs of consecutive blocks merged into one request,
+ * after the lock has been released. They stay pinned in the cache until
+ * the write is done, so nothing can read a stale copy back from the disk.
+ *
+ * @param all Take any dirty entry, not only ones older than EXT2_DIRTY_AGE
+ * @returns Number of blocks written
+ */
+static unsigned int writeback(ext2_fs_t * this, int all) {
+	struct {
+		uint32_t block_no;
+		uint32_t entry;
+	} batch[EXT2_FLUSH_BATCH];
+	unsigned int count = 0;
 
-	/* This operation requires the filesystem lock */
+	if (!DC) return 0;
+
+	unsigned long seconds, subseconds;
+	relative_time(0, 0, &seconds, &subseconds);
+
+	spin_lock(this->flush_lock);
 	spin_lock(this->lock);
 
-	/* Flush each cache entry. */
-	for (unsigned int i = 0; i < this->cache_entries; ++i) {
-		if (DC[i].dirty) {
-			cache_flush_dirty(this, i);
+	for (unsigned int i = 0; i < this->cache_entries && count < EXT2_FLUSH_BATCH; ++i) {
+		if (!DC[i].dirty || DC[i].writeback) continue;
+		if (!all && seconds - DC[i].dirtied < EXT2_DIRTY_AGE) continue;
+
+		/* Insert in block order */
+		unsigned int j = count++;
+		while (j > 0 && batch[j-1].block_no > DC[i].block_no) {
+			batch[j] = batch[j-1];
+			j--;
 		}
+		batch[j].block_no = DC[i].block_no;
+		batch[j].entry = i;
 	}
 
-	/* Release the lock */
+	for (unsigned int i = 0; i < count; ++i) {
+		ext2_disk_cache_entry_t * e = &DC[batch[i].entry];
+		memcpy(this->flush_buffer + i * this->block_size, e->block, this->block_size);
+		e->dirty = 0;
+		e->writeback = 1;
+		this->dirty_count--;
+	}
+
+	spin_unlock(this->lock);
+
+	for (unsigned int i = 0; i < count; ) {
+		unsigned int run = 1;
+		while (i + run < count && batch[i + run].block_no == batch[i].block_no + run) run++;
+		write_fs(this->block_device, (uint64_t)batch[i].block_no * this->block_size, run * this->block_size,
+			this->flush_buffer + i * this->block_size);
+		i += run;
+	}
+
+	spin_lock(this->lock);
+	for (unsigned int i = 0; i < count; ++i) {
+		DC[batch[i].entry].writeback = 0;
+	}
 	spin_unlock(this->lock);
 
+	spin_unlock(this->flush_lock);
+
+	return count;
+}
+
+/**
+ * ext2->flusher Background thread that writes out aged dirty blocks.
+ *
+ * The bitmap and group descriptors are put back in the cache on every
+ * tick, so they age out like any other block even if nothing syncs.
+ */
+static void flusher(void * data) {
+	ext2_fs_t * this = data;
+	while (1) {
+		flush_metadata(this);
+		while (writeback(this, 0) == EXT2_FLUSH_BATCH);
+
+		unsigned long s, ss;
+		relative_time(1, 0, &s, &ss);
+		sleep_until((process_t *)this_core->current_process, s, ss);
+		switch_task(0);
+	}
+}
+
+static unsigned int ext2_sync(ext2_fs_t * this) {
+	flush_metadata(this);
+
+	/* Write out everything; a batch in flight elsewhere holds flush_lock until it is done */
+	while (writeback(this, 1));
+
 	return 0;
 }
 
@@ -463,7 +623,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 	} else if (iblock < EXT2_DIRECT_BLOCKS + p) {
 		/* XXX what if inode->block[EXT2_DIRECT_BLOCKS] isn't set? */
 		if (!inode->block[EXT2_DIRECT_BLOCKS]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) return E_NOSPACE;
 			inode->block[EXT2_DIRECT_BLOCKS] = block_no;
 			write_inode(this, inode, inode_no);
@@ -483,7 +643,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 		d = b - c * p;
 
 		if (!inode->block[EXT2_DIRECT_BLOCKS+1]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) return E_NOSPACE;
 			inode->block[EXT2_DIRECT_BLOCKS+1] = block_no;
 			write_inode(this, inode, inode_no);
@@ -493,7 +653,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 		read_block(this, inode->block[EXT2_DIRECT_BLOCKS + 1], (uint8_t *)tmp);
 
 		if (!((uint32_t *)tmp)[c]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) goto no_space_free;
 			((uint32_t *)tmp)[c] = block_no;
 			write_block(this, inode->block[EXT2_DIRECT_BLOCKS + 1], (uint8_t *)tmp);
@@ -517,7 +677,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 		g = e - f * p;
 
 		if (!inode->block[EXT2_DIRECT_BLOCKS+2]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) return E_NOSPACE;
 			inode->block[EXT2_DIRECT_BLOCKS+2] = block_no;
 			write_inode(this, inode, inode_no);
@@ -527,7 +687,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 		read_block(this, inode->block[EXT2_DIRECT_BLOCKS + 2], (uint8_t *)tmp);
 
 		if (!((uint32_t *)tmp)[d]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) goto no_space_free;
 			((uint32_t *)tmp)[d] = block_no;
 			write_block(this, inode->block[EXT2_DIRECT_BLOCKS + 2], (uint8_t *)tmp);
@@ -537,7 +697,7 @@ static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 		read_block(this, nblock, (uint8_t *)tmp);
 
 		if (!((uint32_t *)tmp)[f]) {
-			unsigned int block_no = allocate_block(this);
+			unsigned int block_no = allocate_block(this, inode_no, rblock, 1);
 			if (!block_no) goto no_space_free;
 			((uint32_t *)tmp)[f] = block_no;
 			write_block(this, nblock, (uint8_t *)tmp);
@@ -650,52 +810,286 @@ static int write_inode(ext2_fs_t * this, ext2_inodetable_t *inode, size_t index)
 	return E_SUCCESS;
 }
 
-static size_t allocate_block(ext2_fs_t * this) {
-	size_t block_no     = 0;
-	size_t block_offset = 0;
-	size_t group        = 0;
-	uint8_t * bg_buffer = malloc(this->block_size);
+/**
+ * ext2->flush_metadata Write back the block bitmap, block group descriptors
+ * and superblock if allocations have changed them.
+ *
+ * Allocating a block only updates the in-memory copies; this is
+ * called once at the end of an operation instead of once per block,
+ * and by the flusher. Takes alloc_lock.
+ */
+static void flush_metadata(ext2_fs_t * this) {
+	spin_lock(this->alloc_lock);
+	if (this->bitmap_dirty) {
+		write_block(this, BGD[this->bitmap_group].block_bitmap, this->bitmap);
+		this->bitmap_dirty = 0;
+	}
 
-	for (unsigned int i = 0; i < BGDS; ++i) {
-		if (BGD[i].free_blocks_count > 0) {
-			read_block(this, BGD[i].block_bitmap, (uint8_t *)bg_buffer);
-			while (BLOCKBIT(block_offset)) {
-				++block_offset;
-			}
-			block_no = block_offset + SB->blocks_per_group * i;
-			group = i;
-			break;
+	if (this->metadata_dirty) {
+		for (int i = 0; i < this->bgd_block_span; ++i) {
+			write_block(this, this->bgd_offset + i, (uint8_t *)((uintptr_t)BGD + this->block_size * i));
 		}
+		rewrite_superblock(this);
+		this->metadata_dirty = 0;
 	}
+	spin_unlock(this->alloc_lock);
+}
 
-	if (!block_no) {
-		debug_print(CRITICAL, "No available blocks, disk is out of space!");
-		free(bg_buffer);
-		return 0;
+/**
+ * ext2->load_bitmap Make the block bitmap for a group current.
+ * Caller holds alloc_lock.
+ */
+static void load_bitmap(ext2_fs_t * this, unsigned int group) {
+	if (this->bitmap_group == (int)group) return;
+
+	if (this->bitmap_dirty) {
+		write_block(this, BGD[this->bitmap_group].block_bitmap, this->bitmap);
+		this->bitmap_dirty = 0;
 	}
 
-	debug_print(WARNING, "allocating block #%zu (group %zu)", block_no, group);
+	read_block(this, BGD[group].block_bitmap, this->bitmap);
+	this->bitmap_group = group;
+}
 
-	BLOCKBYTE(block_offset) |= SETBIT(block_offset);
-	write_block(this, BGD[group].block_bitmap, (uint8_t *)bg_buffer);
+/**
+ * ext2->group_blocks Number of blocks in a group; the last one may be short.
+ */
+static uint32_t group_blocks(ext2_fs_t * this, unsigned int group) {
+	uint32_t first = SB->first_data_block + group * SB->blocks_per_group;
+	if (first + SB->blocks_per_group > SB->blocks_count) {
+		return SB->blocks_count - first;
+	}
+	return SB->blocks_per_group;
+}
 
-	BGD[group].free_blocks_count--;
-	for (int i = 0; i < this->bgd_block_span; ++i) {
-		write_block(this, this->bgd_offset + i, (uint8_t *)((uintptr_t)BGD + this->block_size * i));
+/**
+ * ext2->bitmap_find_free Find the first clear bit in [start, limit).
+ *
+ * Full words are skipped 32 bits at a time.
+ *
+ * @returns Index of the bit, or limit if there is none.
+ */
+static uint32_t bitmap_find_free(uint8_t * bg_buffer, uint32_t start, uint32_t limit) {
+	uint32_t n = start;
+
+	/* Single bits up to a word boundary */
+	while (n < limit && (n & 31)) {
+		if (!BLOCKBIT(n)) return n;
+		n++;
 	}
 
-	SB->free_blocks_count--;
-	rewrite_superblock(this);
+	/* Then whole words */
+	while (n + 32 <= limit) {
+		uint32_t word = ((uint32_t *)bg_buffer)[n >> 5];
+		if (word != 0xFFFFFFFF) {
+			return n + __builtin_ctz(~word);
+		}
+		n += 32;
+	}
 
-	memset(bg_buffer, 0x00, this->block_size);
-	write_block(this, block_no, bg_buffer);
+	/* And whatever is left over */
+	while (n < limit) {
+		if (!BLOCKBIT(n)) return n;
+		n++;
+	}
 
-	free(bg_buffer);
+	return limit;
+}
+
+/**
+ * ext2->reservation_for Find the reservation window of an inode.
+ *
+ * @param create Take over a slot if the inode doesn't have one.
+ */
+static ext2_reservation_t * reservation_for(ext2_fs_t * this, unsigned int inode_no, int create) {
+	for (unsigned int i = 0; i < EXT2_RESERVATIONS; ++i) {
+		if (this->reservations[i].inode == inode_no) return &this->reservations[i];
+	}
+	if (!create) return NULL;
+
+	for (unsigned int i = 0; i < EXT2_RESERVATIONS; ++i) {
+		if (!this->reservations[i].inode) {
+			this->reservations[i].inode = inode_no;
+			return &this->reservations[i];
+		}
+	}
+
+	ext2_reservation_t * r = &this->reservations[this->reservation_next];
+	this->reservation_next = (this->reservation_next + 1) % EXT2_RESERVATIONS;
+	r->inode = inode_no;
+	r->next = 0;
+	r->end = 0;
+	return r;
+}
+
+/**
+ * ext2->release_reservation Drop the reservation window of an inode.
+ */
+static void release_reservation(ext2_fs_t * this, unsigned int inode_no) {
+	spin_lock(this->alloc_lock);
+	ext2_reservation_t * r = reservation_for(this, inode_no, 0);
+	if (r) {
+		memset(r, 0, sizeof(ext2_reservation_t));
+	}
+	spin_unlock(this->alloc_lock);
+}
+
+/**
+ * ext2->reserved_by_other If a block is in another inode's window,
+ * return the end of that window; otherwise 0.
+ */
+static uint32_t reserved_by_other(ext2_fs_t * this, unsigned int inode_no, uint32_t block_no) {
+	for (unsigned int i = 0; i < EXT2_RESERVATIONS; ++i) {
+		ext2_reservation_t * r = &this->reservations[i];
+		if (r->inode && r->inode != inode_no && block_no >= r->next && block_no < r->end) {
+			return r->end;
+		}
+	}
+	return 0;
+}
+
+/**
+ * ext2->claim_block Mark a block as used in the loaded bitmap.
+ * Caller holds alloc_lock.
+ */
+static size_t claim_block(ext2_fs_t * this, unsigned int group, uint32_t bit) {
+	uint8_t * bg_buffer = this->bitmap;
+	size_t block_no = SB->first_data_block + group * SB->blocks_per_group + bit;
+
+	debug_print(WARNING, "allocating block #%zu (group %u)", block_no, group);
+
+	BLOCKBYTE(bit) |= SETBIT(bit);
+	this->bitmap_dirty = 1;
+
+	BGD[group].free_blocks_count--;
+	SB->free_blocks_count--;
+	this->metadata_dirty = 1;
 
 	return block_no;
+}
+
+/**
+ * ext2->allocate_block_locked Pick and claim a block for an inode.
+ * Caller holds alloc_lock, so no other allocator can swap in a different
+ * group's bitmap while this one waits on read_block or write_block.
+ *
+ * Blocks come from the inode's reservation window while it lasts. A new
+ * window is opened at the first free block at or after @p goal (usually
+ * just past the inode's previous block), searching onwards through the
+ * following groups and avoiding windows held by other inodes.
+ *
+ * @param inode_no Inode the block is for
+ * @param goal     Preferred block number, or 0 for the inode's own group
+ * @returns Block number, or 0 if the disk is full
+ */
+static size_t allocate_block_locked(ext2_fs_t * this, unsigned int inode_no, size_t goal) {
+	uint32_t per_group = SB->blocks_per_group;
+	ext2_reservation_t * r = reservation_for(this, inode_no, 1);
+
+	/* Continue in the current window */
+	if (r->next < r->end) {
+		unsigned int group = (r->next - SB->first_data_block) / per_group;
+		uint32_t base = SB->first_data_block + group * per_group;
+		if (BGD[group].free_blocks_count > 0) {
+			load_bitmap(this, group);
+			uint32_t bit = bitmap_find_free(this->bitmap, r->next - base, r->end - base);
+			if (bit < r->end - base) {
+				r->next = base + bit + 1;
+				return claim_block(this, group, bit);
+			}
+		}
+		goal = r->end;
+	}
+
+	if (!goal && inode_no) {
+		goal = SB->first_data_block + ((inode_no - 1) / this->inodes_per_group) * per_group;
+	}
+	if (goal < SB->first_data_block || goal >= SB->blocks_count) {
+		goal = SB->first_data_block;
+	}
+
+	unsigned int first_group = (goal - SB->first_data_block) / per_group;
+
+	/* Second pass ignores other windows, in case they cover everything that is left */
+	for (int pass = 0; pass < 2; ++pass) {
+		for (unsigned int i = 0; i <= BGDS; ++i) {
+			unsigned int group = (first_group + i) % BGDS;
+			if (BGD[group].free_blocks_count == 0) continue;
+
+			uint32_t base  = SB->first_data_block + group * per_group;
+			uint32_t limit = group_blocks(this, group);
+			uint32_t start = (i == 0) ? goal - base : 0;
+			if (i == BGDS) {
+				/* Back in the first group, check what was before the goal */
+				limit = goal - base;
+				start = 0;
+			}
+
+			load_bitmap(this, group);
+			uint32_t bit = bitmap_find_free(this->bitmap, start, limit);
+			while (bit < limit) {
+				uint32_t skip = pass ? 0 : reserved_by_other(this, inode_no, base + bit);
+				if (!skip) break;
+				if (skip - base >= limit) {
+					bit = limit;
+					break;
+				}
+				bit = bitmap_find_free(this->bitmap, skip - base, limit);
+			}
+			if (bit >= limit) continue;
+
+			/* Open a new window here */
+			r->next = base + bit + 1;
+			r->end  = base + bit + EXT2_RESERVE_BLOCKS;
+			if (r->end > base + group_blocks(this, group)) {
+				r->end = base + group_blocks(this, group);
+			}
+
+			return claim_block(this, group, bit);
+		}
+	}
+
+	debug_print(CRITICAL, "No available blocks, disk is out of space!");
+	return 0;
+}
 
+/**
+ * ext2->allocate_block Allocate a block for an inode.
+ *
+ * @param zero Clear the block; not needed if it is about to be written in full
+ * @returns Block number, or 0 if the disk is full
+ */
+static size_t allocate_block(ext2_fs_t * this, unsigned int inode_no, size_t goal, int zero) {
+	spin_lock(this->alloc_lock);
+	size_t block_no = allocate_block_locked(this, inode_no, goal);
+	spin_unlock(this->alloc_lock);
+
+	if (block_no && zero) {
+		uint8_t * empty = malloc(this->block_size);
+		memset(empty, 0x00, this->block_size);
+		write_block(this, block_no, empty);
+		free(empty);
+	}
+
+	return block_no;
 }
 
+/**
+ * ext2->block_goal Where the next block of an inode should preferably go.
+ */
+static size_t block_goal(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int block) {
+	if (block == 0) return 0;
+
+	/* An open window already knows where the file left off */
+	spin_lock(this->alloc_lock);
+	ext2_reservation_t * r = reservation_for(this, inode_no, 0);
+	size_t next = (r && r->next < r->end) ? r->next : 0;
+	spin_unlock(this->alloc_lock);
+	if (next) return next;
+
+	unsigned int previous = get_block_number(this, inode, block - 1);
+	return previous ? previous + 1 : 0;
+}
 
 /**
  * ext2->allocate_inode_block Allocate a block in an inode.
@@ -703,11 +1097,12 @@ static size_t allocate_block(ext2_fs_t * this) {
  * @param inode Inode to operate on
  * @param inode_no Number of the inode (this is not part of the struct)
  * @param block Block within inode to allocate
+ * @param zero Clear the new block; not needed if it is about to be overwritten
  * @returns Error code or E_SUCCESS
  */
-static int allocate_inode_block(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int block) {
+static int allocate_inode_block(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int block, int zero) {
 	debug_print(NOTICE, "Allocating block #%d for inode #%d", block, inode_no);
-	unsigned int block_no = allocate_block(this);
+	unsigned int block_no = allocate_block(this, inode_no, block_goal(this, inode, inode_no, block), zero);
 
 	if (!block_no) return E_NOSPACE;
 
@@ -756,12 +1151,13 @@ static unsigned int inode_write_block(ext2_fs_t * this, ext2_inodetable_t * inod
 	}
 
 	debug_print(WARNING, "clearing and allocating up to required blocks (block=%d, %d)", block, inode->blocks);
-	char * empty = NULL;
 	while (block >= inode->blocks / (this->block_size / 512)) {
-		allocate_inode_block(this, inode, inode_no, inode->blocks / (this->block_size / 512));
-		refresh_inode(this, inode, inode_no);
+		unsigned int next = inode->blocks / (this->block_size / 512);
+		/* Only blocks we skip over need clearing; this one is written below */
+		if (allocate_inode_block(this, inode, inode_no, next, next != block) != E_SUCCESS) {
+			return 0;
+		}
 	}
-	if (empty) free(empty);
 	debug_print(WARNING, "... done");
 
 	unsigned int real_block = get_block_number(this, inode, block);
@@ -1363,7 +1759,7 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 		uint32_t block_offset;
 		uint32_t blocks_read = 0;
 		for (block_offset = start_block; block_offset < end_block; block_offset++, blocks_read++) {
-			if (block_offset == start_block) {
+			if (block_offset == start_block && (offset % this->block_size)) {
 				int b = inode_read_block(this, inode, block_offset, buf);
 				memcpy((uint8_t *)(((uintptr_t)buf) + ((uintptr_t)offset % this->block_size)), buffer, this->block_size - (offset % this->block_size));
 				inode_write_block(this, inode, inode_number, block_offset, buf);
@@ -1371,12 +1767,8 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 					refresh_inode(this, inode, inode_number);
 				}
 			} else {
-				int b = inode_read_block(this, inode, block_offset, buf);
-				memcpy(buf, buffer + this->block_size * blocks_read - (offset % this->block_size), this->block_size);
-				inode_write_block(this, inode, inode_number, block_offset, buf);
-				if (!b) {
-					refresh_inode(this, inode, inode_number);
-				}
+				/* The whole block is replaced, so there is nothing to read first */
+				inode_write_block(this, inode, inode_number, block_offset, buffer + this->block_size * blocks_read - (offset % this->block_size));
 			}
 		}
 		if (end_size) {
@@ -1386,6 +1778,7 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 		}
 	}
 	free(buf);
+	flush_metadata(this);
 	return size_to_read;
 }
 
@@ -1414,8 +1807,15 @@ static void open_ext2(fs_node_t *node, unsigned int flags) {
 	/* Nothing to do here */
 }
 
+static int sync_ext2(fs_node_t * node, int datasync) {
+	/* The cache is shared by the whole filesystem, so this writes out everything */
+	ext2_sync(node->device);
+	return 0;
+}
+
 static void close_ext2(fs_node_t *node) {
-	/* Nothing to do here */
+	/* Give back whatever is left of the file's reservation window */
+	release_reservation(node->device, node->inode);
 }
 
 
@@ -1606,6 +2006,7 @@ static int node_from_file(ext2_fs_t * this, ext2_inodetable_t *inode, ext2_dir_t
 	fnode->chmod   = chmod_ext2;
 	fnode->open    = open_ext2;
 	fnode->close   = close_ext2;
+	fnode->sync    = sync_ext2;
 	fnode->ioctl   = NULL;
 	return 1;
 }
@@ -1669,6 +2070,7 @@ static int ext2_root(ext2_fs_t * this, ext2_inodetable_t *inode, fs_node_t *fnod
 	fnode->chmod   = chmod_ext2;
 	fnode->open    = open_ext2;
 	fnode->close   = close_ext2;
+	fnode->sync    = sync_ext2;
 	fnode->readdir = readdir_ext2;
 	fnode->finddir = finddir_ext2;
 	fnode->ioctl   = NULL;
@@ -1732,11 +2134,15 @@ static fs_node_t * mount_ext2(fs_node_t * block_device, int flags) {
 			}
 		}
 		debug_print(INFO, "Allocated cache.");
+		this->flush_buffer = malloc(this->block_size * EXT2_FLUSH_BATCH);
 	} else {
 		DC = NULL;
 		debug_print(NOTICE, "ext2 cache is disabled (nocache)");
 	}
 
+	this->bitmap = malloc(this->block_size);
+	this->bitmap_group = -1;
+
 	// load the block group descriptors
 	this->bgd_block_span = sizeof(ext2_bgdescriptor_t) * BGDS / this->block_size + 1;
 	BGD = malloc(this->block_size * this->bgd_block_span);
@@ -1782,6 +2188,10 @@ static fs_node_t * mount_ext2(fs_node_t * block_device, int flags) {
 	free(bg_buffer);
 #endif
 
+	if (DC && (this->flags & EXT2_FLAG_READWRITE)) {
+		this->flusher = spawn_worker_thread(flusher, "[ext2 flush]", this);
+	}
+
 	ext2_inodetable_t *root_inode = read_inode(this, 2);
 	RN = (fs_node_t *)malloc(sizeof(fs_node_t));
 	if (!ext2_root(this, root_inode, RN)) {
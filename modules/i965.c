@@ -100,6 +100,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x8086, 0x0046});
+
 struct Module metadata = {
 	.name = "i965",
 	.init = i965_install,
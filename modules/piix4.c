@@ -72,6 +72,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x80EE, 0xCAFE}, {0x8086, 0x7000});
+
 struct Module metadata = {
 	.name = "piix4",
 	.init = init,
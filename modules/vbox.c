@@ -475,6 +475,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({VBOX_VENDOR_ID, VBOX_DEVICE_ID});
+
 struct Module metadata = {
 	.name = "vbox",
 	.init = vbox_install,
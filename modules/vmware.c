@@ -516,6 +516,8 @@ static int fini(void) {
 	return 0;
 }
 
+MODULE_PCI_IDS({0x1234, 0x1111}, {0x15AD, 0x07A0});
+
 struct Module metadata = {
 	.name = "vmware",
 	.init = vmware_initialize,